@@ -1,5 +1,12 @@
 #include "shaders/def.glsl"
 #include "shaders/MeshView.glsl"
+#include "shaders/Normals.glsl"
+
+// PACKED_VERTEX 1 for meshes with octahedral normals/tangents (see MeshData::PackDesc()). Quantized positions are
+// dequantized via uPositionScale/uPositionBias in either case (see GlContext::setMeshUniforms()).
+#ifndef PACKED_VERTEX
+	#define PACKED_VERTEX 0
+#endif
 
 layout(location=0) in vec3  aPosition;
 layout(location=1) in vec3  aNormal;
@@ -18,6 +25,8 @@ layout(location=3) in vec2  aTexcoord;
 uniform mat4 uWorldMatrix;
 uniform mat4 uViewMatrix;
 uniform mat4 uProjMatrix;
+uniform vec3 uPositionScale = vec3(1.0);
+uniform vec3 uPositionBias  = vec3(0.0);
 
 #if   defined(SHADED)
 	smooth out vec2 vUv;
@@ -29,6 +38,15 @@ uniform mat4 uProjMatrix;
 
 void main() 
 {
+	vec3 position = aPosition.xyz * uPositionScale + uPositionBias;
+	#if PACKED_VERTEX
+		vec3 normal  = Normals_DecodeOctahedral(aNormal.xy);
+		vec4 tangent = Normals_DecodeOctahedralTangent(aTangent.xyz);
+	#else
+		vec3 normal  = aNormal.xyz;
+		vec4 tangent = vec4(aTangent.xyz, 1.0);
+	#endif
+
 	#ifdef SKINNING
 		vec4 boneWeights = aBoneWeights;
 		uvec4 boneIndices = aBoneIndices;
@@ -38,13 +56,13 @@ void main()
 			bfSkinning[boneIndices.z] * boneWeights.z +
 			bfSkinning[boneIndices.w] * boneWeights.w
 			;
-		vec3 posM = TransformPosition(boneMatrix, aPosition.xyz);
-		vec3 nrmM = TransformDirection(boneMatrix, aNormal.xyz);
-		vec3 tngM = TransformDirection(boneMatrix, aTangent.xyz);
+		vec3 posM = TransformPosition(boneMatrix, position);
+		vec3 nrmM = TransformDirection(boneMatrix, normal);
+		vec3 tngM = TransformDirection(boneMatrix, tangent.xyz);
 	#else
-		#define posM aPosition.xyz
-		#define nrmM aNormal.xyz
-		#define tngM aTangent.xyz
+		#define posM position
+		#define nrmM normal
+		#define tngM tangent.xyz
 	#endif
 	vec3 posV = TransformPosition(uViewMatrix, TransformPosition(uWorldMatrix, posM));
 
@@ -18,4 +18,29 @@ vec3 Normals_DecodeLambertAzimuthal(in vec2 _normal)
 	return ret;
 }
 
+// Octahedral encoding as used for packed vertex normals/tangents (see MeshData::PackDesc()).
+vec2 Normals_EncodeOctahedral(in vec3 _normal)
+{
+	vec2 ret = _normal.xy / (abs(_normal.x) + abs(_normal.y) + abs(_normal.z));
+	if (_normal.z < 0.0) {
+		ret = (1.0 - abs(ret.yx)) * mix(vec2(-1.0), vec2(1.0), greaterThanEqual(ret.xy, vec2(0.0)));
+	}
+	return ret;
+}
+
+vec3 Normals_DecodeOctahedral(in vec2 _normal)
+{
+	vec3 ret = vec3(_normal.xy, 1.0 - abs(_normal.x) - abs(_normal.y));
+	if (ret.z < 0.0) {
+		ret.xy = (1.0 - abs(_normal.yx)) * mix(vec2(-1.0), vec2(1.0), greaterThanEqual(_normal.xy, vec2(0.0)));
+	}
+	return normalize(ret);
+}
+
+// Octahedral tangent in xy, bitangent sign in z (see MeshData::PackDesc()). Return the tangent in xyz, the sign in w.
+vec4 Normals_DecodeOctahedralTangent(in vec3 _tangent)
+{
+	return vec4(Normals_DecodeOctahedral(_tangent.xy), _tangent.z < 0.0 ? -1.0 : 1.0);
+}
+
 #endif // Normals_glsl
@@ -39,15 +39,42 @@ void GlContext::draw(GLsizei _instances)
 	glAssert(glGetProgramiv(m_currentShader->getHandle(), GL_ACTIVE_ATTRIBUTES, &activeAttribCount));
 	APT_ASSERT(m_currentMesh->m_desc.getVertexComponentCount() == activeAttribCount);
 #endif
+	setMeshUniforms();
 	const MeshData::Submesh& submesh = m_currentMesh->getSubmesh(m_currentSubmesh);
 
 	if (m_currentMesh->getIndexBufferHandle() != 0) {
-		glAssert(glDrawElementsInstanced(
+		GLsizei indexCount  = (GLsizei)submesh.m_indexCount;
+		GLvoid* indexOffset = (GLvoid*)submesh.m_indexOffset;
+		GLint   baseVertex  = (GLint)submesh.m_baseVertex;
+		if (m_currentLod > 0) {
+			MeshData::Lod lod = m_currentMesh->getLod(m_currentLod);
+			indexCount  = (GLsizei)lod.m_indexCount;
+			indexOffset = (GLvoid*)lod.m_indexOffset;
+			baseVertex  = 0;
+		}
+		if (m_currentSubmesh == 0 && m_currentLod == 0 && m_currentMesh->hasRebasedIndices()) {
+		 // indices are relative to each submesh, draw the submeshes individually
+			for (int i = 1; i < m_currentMesh->getSubmeshCount(); ++i) {
+				const MeshData::Submesh& rebasedSubmesh = m_currentMesh->getSubmesh(i);
+				glAssert(glDrawElementsInstancedBaseVertex(
+					m_currentMesh->getPrimitive(), 
+					(GLsizei)rebasedSubmesh.m_indexCount, 
+					m_currentMesh->getIndexDataType(), 
+					(GLvoid*)rebasedSubmesh.m_indexOffset, 
+					_instances,
+					(GLint)rebasedSubmesh.m_baseVertex
+					));
+				++m_drawCount;
+			}
+			return;
+		}
+		glAssert(glDrawElementsInstancedBaseVertex(
 			m_currentMesh->getPrimitive(), 
-			(GLsizei)submesh.m_indexCount, 
+			indexCount, 
 			m_currentMesh->getIndexDataType(), 
-			(GLvoid*)submesh.m_indexOffset, 
-			_instances
+			indexOffset, 
+			_instances,
+			baseVertex
 			));
 	} else {
 		glAssert(glDrawArraysInstanced(
@@ -74,6 +101,7 @@ void GlContext::drawIndirect(const Buffer* _buffer, const void* _offset)
 	glAssert(glGetProgramiv(m_currentShader->getHandle(), GL_ACTIVE_ATTRIBUTES, &activeAttribCount));
 	APT_ASSERT(m_currentMesh->m_desc.getVertexComponentCount() == activeAttribCount);
 #endif
+	setMeshUniforms();
 
 	if (m_currentMesh->getIndexBufferHandle() != 0) {
 		glAssert(glDrawElementsIndirect(m_currentMesh->getPrimitive(), m_currentMesh->getIndexDataType(), _offset));
@@ -84,6 +112,23 @@ void GlContext::drawIndirect(const Buffer* _buffer, const void* _offset)
 	++m_drawCount; // count an indirect draw as a single draw call
 }
 
+void GlContext::multiDrawIndirect(const Buffer* _buffer, GLsizei _drawCount, const void* _offset)
+{
+	APT_ASSERT(m_currentShader && (m_currentShader->getState() == Shader::State_Loaded));
+	APT_ASSERT(m_currentMesh);
+	
+	bindBuffer(_buffer, GL_DRAW_INDIRECT_BUFFER);
+	setMeshUniforms();
+
+	if (m_currentMesh->getIndexBufferHandle() != 0) {
+		glAssert(glMultiDrawElementsIndirect(m_currentMesh->getPrimitive(), m_currentMesh->getIndexDataType(), _offset, _drawCount, 0));
+	} else {
+		glAssert(glMultiDrawArraysIndirect(m_currentMesh->getPrimitive(), _offset, _drawCount, 0));
+	}
+
+	++m_drawCount; // count an indirect draw as a single draw call
+}
+
 void GlContext::drawNdcQuad(const Camera* _cam)
 {
 	if_unlikely (!m_ndcQuadMesh) {
@@ -230,6 +275,7 @@ void GlContext::setShader(const Shader* _shader)
 		glAssert(glUseProgram(_shader->getHandle()));
 	}
 	m_currentShader = _shader;
+	m_meshUniformsProgram = 0;
 }
 
 template <>
@@ -318,10 +364,12 @@ void GlContext::setUniformArray<mat4>(const char* _name, const mat4* _val, GLsiz
 }
 
 
-void GlContext::setMesh(const Mesh* _mesh, int _submeshId)
+void GlContext::setMesh(const Mesh* _mesh, int _submeshId, int _lod)
 {
 	APT_ASSERT(_submeshId < _mesh->getSubmeshCount());
+	APT_ASSERT(_lod == 0 || (_submeshId == 0 && _lod < _mesh->getLodCount()));
 	m_currentSubmesh = _submeshId;
+	m_currentLod = _lod;
 	if (_mesh == m_currentMesh) {
 		return;
 	}
@@ -496,6 +544,11 @@ GlContext::GlContext()
 	, m_currentFramebuffer(nullptr)
 	, m_currentShader(nullptr)
 	, m_currentMesh(nullptr)
+	, m_currentSubmesh(0)
+	, m_currentLod(0)
+	, m_meshUniformsProgram(0)
+	, m_positionScaleLocation(-1)
+	, m_positionBiasLocation(-1)
 	, m_ndcQuadMesh(nullptr)
 {
 }
@@ -509,6 +562,8 @@ bool GlContext::init()
 {
 	setVsync(m_vsync);
 	queryLimits();
+ // strips generated by MeshData::compactIndexData() use the max value of the index type as the restart index
+	glAssert(glEnable(GL_PRIMITIVE_RESTART_FIXED_INDEX));
 	return true;
 }
 void GlContext::shutdown()
@@ -533,3 +588,28 @@ void GlContext::queryLimits()
 	glAssert(glGetIntegerv(GL_MAX_ATOMIC_COUNTER_BUFFER_BINDINGS, &kMaxBufferSlots[internal::BufferTargetToIndex(GL_ATOMIC_COUNTER_BUFFER)]));
 	glAssert(glGetIntegerv(GL_MAX_TRANSFORM_FEEDBACK_BUFFERS,     &kMaxBufferSlots[internal::BufferTargetToIndex(GL_TRANSFORM_FEEDBACK_BUFFER)]));
 }
+
+void GlContext::setMeshUniforms()
+{
+	const MeshDesc& desc = m_currentMesh->getDesc();
+	float scaleBias[6];
+	memcpy(scaleBias,     &desc.getPositionScale(), sizeof(float) * 3);
+	memcpy(scaleBias + 3, &desc.getPositionBias(),  sizeof(float) * 3);
+
+	GLuint program = m_currentShader->getHandle();
+	if (program != m_meshUniformsProgram) {
+	 // the handle changes if the shader is reloaded
+		m_meshUniformsProgram   = program;
+		m_positionScaleLocation = m_currentShader->getUniformLocation("uPositionScale");
+		m_positionBiasLocation  = m_currentShader->getUniformLocation("uPositionBias");
+	} else if (memcmp(scaleBias, m_positionScaleBias, sizeof(scaleBias)) == 0) {
+		return;
+	}
+	memcpy(m_positionScaleBias, scaleBias, sizeof(scaleBias));
+	if (m_positionScaleLocation != -1) {
+		glAssert(glUniform3fv(m_positionScaleLocation, 1, scaleBias));
+	}
+	if (m_positionBiasLocation != -1) {
+		glAssert(glUniform3fv(m_positionBiasLocation, 1, scaleBias + 3));
+	}
+}
@@ -59,6 +59,8 @@ public:
 	void draw(GLsizei _instances = 1);
 	// Make an indirect draw call via glDrawArraysIndirect/glDrawElementsIndirect, with _buffer bound as GL_DRAW_INDIRECT_BUFFER.
 	void drawIndirect(const Buffer* _buffer, const void* _offset = nullptr);
+	// As drawIndirect() but via glMultiDrawArraysIndirect/glMultiDrawElementsIndirect, _buffer contains _drawCount tightly packed commands (e.g. see MeshPool).
+	void multiDrawIndirect(const Buffer* _buffer, GLsizei _drawCount, const void* _offset = nullptr);
 	
 	// Draw a quad with vertices in [-1,1]. If _cam is specified, bind the camera buffer (see shaders/Camera.glsl) or send uniforms if no buffer.
 	void drawNdcQuad(const Camera* _cam = nullptr);
@@ -111,7 +113,8 @@ public:
 
  // MESH
 
-	void setMesh(const Mesh* _mesh, int _submeshId = 0);
+	// _lod > 0 selects a LOD index range (see Mesh::selectLod()), in which case _submeshId must be 0.
+	void setMesh(const Mesh* _mesh, int _submeshId = 0, int _lod = 0);
 	const Mesh* getMesh() { return m_currentMesh; }
 
  // BUFFER
@@ -165,6 +168,13 @@ private:
 	const Shader*       m_currentShader;
 	const Mesh*         m_currentMesh;
 	int                 m_currentSubmesh;
+	int                 m_currentLod;
+
+	// Mesh uniform locations are queried once per program and the values only set if they change (see setMeshUniforms()).
+	GLuint              m_meshUniformsProgram;
+	GLint               m_positionScaleLocation;
+	GLint               m_positionBiasLocation;
+	float               m_positionScaleBias[6];
 
 	// Tracking state for all targets is redundant as only a subset use an indexed binding model
 	static const int    kBufferSlotCount  = 16;
@@ -194,6 +204,9 @@ private:
 
 	void queryLimits();
 
+	// Set the position dequantization constants (uPositionScale, uPositionBias) for the current mesh, see MeshData::PackDesc().
+	// Identity for meshes without quantized positions, as the values persist on the program between draws.
+	void setMeshUniforms();
 	
 }; // class GlContext
 
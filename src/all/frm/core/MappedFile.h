@@ -0,0 +1,40 @@
+#pragma once
+#ifndef frm_MappedFile_h
+#define frm_MappedFile_h
+
+#include <frm/core/def.h>
+
+namespace frm {
+
+////////////////////////////////////////////////////////////////////////////////
+// MappedFile
+// Read-only memory mapped file. Pages are mapped copy-on-write, hence the data
+// may be modified in place without affecting the file on disk.
+////////////////////////////////////////////////////////////////////////////////
+class MappedFile: private apt::non_copyable<MappedFile>
+{
+public:
+	// Map the file at _path, which is not relative to a FileSystem root. Return nullptr if the file doesn't exist or 
+	// couldn't be mapped.
+	static MappedFile* Create(const char* _path);
+	static void        Destroy(MappedFile*& _inst_);
+
+	const char* getData() const      { return m_data;     }
+	char*       getData()            { return m_data;     }
+	uint64      getDataSize() const  { return m_dataSize; }
+
+private:
+	char*  m_data     = nullptr;
+	uint64 m_dataSize = 0;
+
+	struct Impl;
+	Impl*  m_impl     = nullptr;
+
+	MappedFile()  {}
+	~MappedFile() {}
+
+}; // class MappedFile
+
+} // namespace frm
+
+#endif // frm_MappedFile_h
@@ -1,6 +1,7 @@
 #include "Mesh.h"
 
 #include <frm/core/gl.h>
+#include <frm/core/Camera.h>
 #include <frm/core/GlContext.h>
 #include <frm/core/Resource.h>
 
@@ -150,6 +151,21 @@ void Mesh::setIndexData(DataType _dataType, const void* _data, uint _indexCount,
 	glAssert(glBindVertexArray(prevVao));
 }
 
+void Mesh::setVertexSubData(const void* _data, uint _vertexOffset, uint _vertexCount)
+{
+	APT_ASSERT(m_vertexBuffer);
+	APT_ASSERT(_vertexOffset + _vertexCount <= getVertexCount());
+	glAssert(glNamedBufferSubData(m_vertexBuffer, (GLintptr)_vertexOffset * m_desc.getVertexSize(), (GLsizeiptr)_vertexCount * m_desc.getVertexSize(), _data));
+}
+
+void Mesh::setIndexSubData(const void* _data, uint _indexOffset, uint _indexCount)
+{
+	APT_ASSERT(m_indexBuffer);
+	APT_ASSERT(_indexOffset + _indexCount <= getIndexCount());
+	GLsizeiptr indexSize = m_indexDataType == GL_UNSIGNED_BYTE ? 1 : m_indexDataType == GL_UNSIGNED_SHORT ? 2 : 4;
+	glAssert(glNamedBufferSubData(m_indexBuffer, (GLintptr)_indexOffset * indexSize, (GLsizeiptr)_indexCount * indexSize, _data));
+}
+
 void Mesh::setBindPose(const Skeleton& _skel)
 {
 	if (!m_bindPose) {
@@ -158,6 +174,82 @@ void Mesh::setBindPose(const Skeleton& _skel)
 	*m_bindPose = _skel;
 }
 
+MeshData::Lod Mesh::getLod(int _i) const
+{
+	APT_ASSERT(_i < getLodCount());
+	if (_i > 0) {
+		return m_lods[_i - 1];
+	}
+	MeshData::Lod ret;
+	ret.m_indexOffset = 0;
+	ret.m_indexCount  = getIndexCount();
+	ret.m_error       = 0.0f;
+	return ret;
+}
+
+int Mesh::selectLod(float _projectedRadius, float _maxPixelError) const
+{
+	int ret = 0;
+	for (int i = 0; i < (int)m_lods.size(); ++i) {
+		if (m_lods[i].m_error * _projectedRadius > _maxPixelError) {
+			break;
+		}
+		ret = i + 1;
+	}
+	return ret;
+}
+
+int Mesh::selectLod(const mat4& _world, const Camera& _camera, float _viewportHeight, float _maxPixelError) const
+{
+	if (m_lods.empty()) {
+		return 0;
+	}
+	Sphere sphere = getBoundingSphere();
+	sphere.transform(_world);
+	float projHeight = fabs(_camera.m_up - _camera.m_down); // tan(fov) for perspective projections, else world units
+	if (_camera.getProjFlag(Camera::ProjFlag_Perspective)) {
+		float distance = length(sphere.m_origin - _camera.getPosition());
+		if (distance <= sphere.m_radius) {
+			return 0;
+		}
+		projHeight *= distance;
+	}
+	float projectedRadius = sphere.m_radius / projHeight * _viewportHeight;
+	return selectLod(projectedRadius, _maxPixelError);
+}
+
+uint Mesh::cullMeshlets(const Frustum& _frustum, const vec3& _eye, Buffer::DrawElementsIndirectCommand* out_, int _submeshId) const
+{
+	uint indexSize = m_indexDataType == GL_UNSIGNED_BYTE ? 1 : (m_indexDataType == GL_UNSIGNED_SHORT ? 2 : 4);
+	uint ret = 0;
+	for (auto& meshlet : m_meshlets) {
+		if (_submeshId > 0 && (int)meshlet.m_submeshId != _submeshId) {
+			continue;
+		}
+		if (meshlet.m_coneCutoff < 1.0f && dot(normalize(meshlet.m_coneApex - _eye), meshlet.m_coneAxis) >= meshlet.m_coneCutoff) {
+			continue;
+		}
+		if (!_frustum.inside(meshlet.m_boundingSphere) || !_frustum.inside(meshlet.m_boundingBox)) {
+			continue;
+		}
+
+		uint firstIndex = meshlet.m_indexOffset / indexSize;
+		uint baseVertex = m_submeshes[meshlet.m_submeshId].m_baseVertex;
+		if (ret > 0 && out_[ret - 1].m_firstIndex + out_[ret - 1].m_indexCount == firstIndex && out_[ret - 1].m_baseVertex == baseVertex) {
+		 // merge with the previous command
+			out_[ret - 1].m_indexCount += meshlet.m_indexCount;
+			continue;
+		}
+		Buffer::DrawElementsIndirectCommand& cmd = out_[ret++];
+		cmd.m_indexCount    = meshlet.m_indexCount;
+		cmd.m_instanceCount = 1;
+		cmd.m_firstIndex    = firstIndex;
+		cmd.m_baseVertex    = baseVertex;
+		cmd.m_baseInstance  = 0;
+	}
+	return ret;
+}
+
 // PRIVATE
 
 Mesh::Mesh(uint64 _id, const char* _name)
@@ -169,6 +261,7 @@ Mesh::Mesh(uint64 _id, const char* _name)
 	, m_indexBuffer(0)
 	, m_indexDataType(GL_NONE)
 	, m_primitive(GL_NONE)
+	, m_rebasedIndices(false)
 {
 	APT_ASSERT(GlContext::GetCurrent());
 	m_submeshes.push_back(MeshData::Submesh());
@@ -198,6 +291,8 @@ void Mesh::unload()
 		m_bindPose = nullptr;
 	}
 	m_submeshes.clear();
+	m_lods.clear();
+	m_meshlets.clear();
 	setState(State_Unloaded);
 }
 
@@ -213,7 +308,12 @@ void Mesh::load(const MeshData& _data)
 		setVertexData(_data.m_vertexData, _data.getVertexCount(), GL_STATIC_DRAW);
 	}
 	if (_data.m_indexData) {
-		setIndexData((DataType)_data.m_indexDataType, _data.m_indexData, _data.getIndexCount(), GL_STATIC_DRAW);
+	 // upload LODs with the base index data, setIndexData() sets the submesh 0 index count to the total
+		setIndexData((DataType)_data.m_indexDataType, _data.m_indexData, _data.getIndexDataCount(), GL_STATIC_DRAW);
+		m_submeshes[0].m_indexCount = _data.getIndexCount();
+		m_lods = _data.m_lods;
+		m_meshlets = _data.m_meshlets;
+		m_rebasedIndices = _data.hasRebasedIndices();
 	}
 	if (_data.m_bindPose) {
 		m_bindPose = APT_NEW(Skeleton);
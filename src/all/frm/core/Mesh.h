@@ -4,6 +4,7 @@
 
 #include <frm/core/def.h>
 #include <frm/core/gl.h>
+#include <frm/core/Buffer.h>
 #include <frm/core/MeshData.h>
 #include <frm/core/Resource.h>
 #include <frm/core/SkeletonAnimation.h>
@@ -32,7 +33,11 @@ public:
 
 	void setVertexData(const void* _data, uint _vertexCount, GLenum _usage = GL_STREAM_DRAW);
 	void setIndexData(apt::DataType _dataType, const void* _data, uint _indexCount, GLenum _usage = GL_STREAM_DRAW);
+	// Update a range of the data previously allocated by setVertexData()/setIndexData() (e.g. see MeshPool).
+	void setVertexSubData(const void* _data, uint _vertexOffset, uint _vertexCount);
+	void setIndexSubData(const void* _data, uint _indexOffset, uint _indexCount);
 
+	const MeshDesc& getDesc() const                      { return m_desc; }
 	uint getVertexCount() const                          { return getSubmesh(0).m_vertexCount; }
 	uint getIndexCount() const                           { return getSubmesh(0).m_indexCount;  }
 	int  getSubmeshCount() const                         { return (int)m_submeshes.size();     }
@@ -43,18 +48,38 @@ public:
 	GLuint getIndexBufferHandle() const                  { return m_indexBuffer;   }
 	GLenum getIndexDataType() const                      { return m_indexDataType; }
 	GLenum getPrimitive() const                          { return m_primitive;     }
+	// See MeshData::compactIndexData(). GlContext::draw() draws each submesh individually for submesh 0.
+	bool   hasRebasedIndices() const                     { return m_rebasedIndices; }
 
-	const AlignedBox& getBoundingBox() const             { return m_submeshes[0].m_boundingBox;    }
-	const Sphere&     getBoundingSphere() const          { return m_submeshes[0].m_boundingSphere; }
+	const AlignedBox&  getBoundingBox() const            { return m_submeshes[0].m_boundingBox;         }
+	const Sphere&      getBoundingSphere() const         { return m_submeshes[0].m_boundingSphere;      }
+	const OrientedBox& getBoundingOrientedBox() const    { return m_submeshes[0].m_boundingOrientedBox; }
 
 	const Skeleton*   getBindPose() const                { return m_bindPose; }
 	void              setBindPose(const Skeleton& _skel);
 
+	int               getLodCount() const                { return (int)m_lods.size() + 1; }
+	MeshData::Lod     getLod(int _i) const;
+	// Select the lowest LOD whose error is <= _maxPixelError, given the projected radius of the bounding sphere in pixels.
+	int               selectLod(float _projectedRadius, float _maxPixelError = 1.0f) const;
+	// As selectLod() but compute the projected radius from the mesh world matrix, the camera and the viewport height.
+	int               selectLod(const mat4& _world, const Camera& _camera, float _viewportHeight, float _maxPixelError = 1.0f) const;
+
+	uint                     getMeshletCount() const     { return (uint)m_meshlets.size(); }
+	const MeshData::Meshlet& getMeshlet(uint _i) const   { APT_ASSERT(_i < getMeshletCount()); return m_meshlets[_i]; }
+	// Cull meshlets against _frustum and their normal cones given the view position _eye (both in mesh local space, 
+	// e.g. transform Camera::m_worldFrustum by the inverse world matrix). Write a draw command for each run of 
+	// adjacent visible meshlets to out_, which must have space for getMeshletCount() commands. If _submeshId > 0 
+	// only meshlets belonging to that submesh are considered. Return the number of commands written.
+	uint cullMeshlets(const Frustum& _frustum, const vec3& _eye, Buffer::DrawElementsIndirectCommand* out_, int _submeshId = 0) const;
+
 private:
 	apt::String<32> m_path; // empty if not from a file
 
 	MeshDesc m_desc;
 	eastl::vector<MeshData::Submesh> m_submeshes;
+	eastl::vector<MeshData::Lod>     m_lods; // LODs > 0
+	eastl::vector<MeshData::Meshlet> m_meshlets;
 	Skeleton* m_bindPose; // joint hierarchy + inverse bind pose matrices
 
 	GLuint m_vertexArray;   // vertex array state (only bind this when drawing)
@@ -62,6 +87,7 @@ private:
 	GLuint m_indexBuffer;
 	GLenum m_indexDataType;
 	GLenum m_primitive;
+	bool   m_rebasedIndices;
 
 	Mesh(uint64 _id, const char* _name);
 	~Mesh();
@@ -0,0 +1,505 @@
+#include "MeshBvh.h"
+
+#include <frm/core/MeshData.h>
+
+#include <apt/log.h>
+#include <apt/Time.h>
+
+#include <algorithm> // partition
+#include <cfloat>
+#include <cmath>
+
+// SSE path for the 4-wide box test.
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE__)
+	#define MeshBvh_SIMD 1
+	#include <xmmintrin.h>
+#else
+	#define MeshBvh_SIMD 0
+#endif
+
+using namespace frm;
+using namespace apt;
+
+static const uint32 kBinCount       = 16;
+static const uint32 kMaxLeafSize    = 8;
+static const float  kTraversalCost  = 1.0f;  // relative to the cost of a triangle test
+static const uint32 kMaxBinaryDepth = 64;    // bounds the 4-wide depth and hence the traversal stack size
+static const uint32 kStackSize      = 4 * kMaxBinaryDepth;
+
+static inline float HalfArea(const AlignedBox& _box)
+{
+	vec3 d = max(_box.m_max - _box.m_min, vec3(0.0f));
+	return d.x * d.y + d.y * d.z + d.z * d.x;
+}
+
+static inline void Grow(AlignedBox& _box_, const vec3& _min, const vec3& _max)
+{
+	_box_.m_min = min(_box_.m_min, _min);
+	_box_.m_max = max(_box_.m_max, _max);
+}
+
+static inline AlignedBox EmptyBox()
+{
+	AlignedBox ret;
+	ret.m_min = vec3(FLT_MAX);
+	ret.m_max = vec3(-FLT_MAX);
+	return ret;
+}
+
+namespace {
+
+// Binary tree, collapsed into the 4-wide tree once complete.
+struct BuildNode
+{
+	AlignedBox m_box;
+	uint32     m_left;  // ~0 for leaves
+	uint32     m_right;
+	uint32     m_begin; // triangle range within BuildContext::m_order
+	uint32     m_end;
+};
+
+struct BuildContext
+{
+	const AlignedBox*        m_boxes;
+	const vec3*              m_centroids;
+	eastl::vector<uint32>    m_order;
+	eastl::vector<BuildNode> m_nodes;
+
+	uint32 build(uint32 _begin, uint32 _end, uint32 _depth)
+	{
+		BuildNode node;
+		node.m_box   = EmptyBox();
+		node.m_left  = node.m_right = ~0u;
+		node.m_begin = _begin;
+		node.m_end   = _end;
+		AlignedBox centroidBox = EmptyBox();
+		for (uint32 i = _begin; i < _end; ++i) {
+			Grow(node.m_box, m_boxes[m_order[i]].m_min, m_boxes[m_order[i]].m_max);
+			Grow(centroidBox, m_centroids[m_order[i]], m_centroids[m_order[i]]);
+		}
+		const uint32 ret = (uint32)m_nodes.size();
+		m_nodes.push_back(node);
+
+		const uint32 count = _end - _begin;
+		if (count <= 1 || _depth >= kMaxBinaryDepth) {
+			return ret;
+		}
+
+	 // binned SAH, find the best split over all 3 axes
+		float  bestCost = FLT_MAX;
+		int    bestAxis = -1;
+		uint32 bestBin  = 0;
+		for (int axis = 0; axis < 3; ++axis) {
+			const float cmin = centroidBox.m_min[axis];
+			const float cmax = centroidBox.m_max[axis];
+			if (!(cmax > cmin)) {
+				continue;
+			}
+			const float scale = (float)kBinCount / (cmax - cmin);
+			AlignedBox binBoxes[kBinCount];
+			uint32     binCounts[kBinCount] = {};
+			for (uint32 i = 0; i < kBinCount; ++i) {
+				binBoxes[i] = EmptyBox();
+			}
+			for (uint32 i = _begin; i < _end; ++i) {
+				uint32 tri = m_order[i];
+				uint32 bin = APT_MIN((uint32)((m_centroids[tri][axis] - cmin) * scale), kBinCount - 1);
+				++binCounts[bin];
+				Grow(binBoxes[bin], m_boxes[tri].m_min, m_boxes[tri].m_max);
+			}
+		 // sweep from the right to get the right side costs, then from the left
+			float      rightCost[kBinCount];
+			AlignedBox box = EmptyBox();
+			uint32     n = 0;
+			for (uint32 i = kBinCount - 1; i > 0; --i) {
+				Grow(box, binBoxes[i].m_min, binBoxes[i].m_max);
+				n += binCounts[i];
+				rightCost[i] = n ? HalfArea(box) * (float)n : 0.0f;
+			}
+			box = EmptyBox();
+			n = 0;
+			for (uint32 i = 0; i < kBinCount - 1; ++i) {
+				Grow(box, binBoxes[i].m_min, binBoxes[i].m_max);
+				n += binCounts[i];
+				if (n == 0 || n == count) {
+					continue;
+				}
+				float cost = HalfArea(box) * (float)n + rightCost[i + 1];
+				if (cost < bestCost) {
+					bestCost = cost;
+					bestAxis = axis;
+					bestBin  = i;
+				}
+			}
+		}
+
+		uint32 mid = _begin;
+		if (bestAxis >= 0) {
+			const float parentArea = HalfArea(m_nodes[ret].m_box);
+			const float splitCost  = kTraversalCost + (parentArea > 0.0f ? bestCost / parentArea : 0.0f);
+			if (splitCost >= (float)count && count <= kMaxLeafSize) {
+				return ret;
+			}
+			const float cmin  = centroidBox.m_min[bestAxis];
+			const float scale = (float)kBinCount / (centroidBox.m_max[bestAxis] - cmin);
+			const vec3* centroids = m_centroids;
+			mid = (uint32)(std::partition(m_order.begin() + _begin, m_order.begin() + _end,
+				[centroids, bestAxis, bestBin, cmin, scale](uint32 _tri)
+				{
+					return APT_MIN((uint32)((centroids[_tri][bestAxis] - cmin) * scale), kBinCount - 1) <= bestBin;
+				}) - m_order.begin());
+		} else {
+		 // centroids are coincident, split in the middle if the leaf would be too big
+			if (count <= kMaxLeafSize) {
+				return ret;
+			}
+			mid = _begin + count / 2;
+		}
+
+		uint32 left  = build(_begin, mid, _depth + 1);
+		uint32 right = build(mid, _end, _depth + 1);
+		m_nodes[ret].m_left  = left;
+		m_nodes[ret].m_right = right;
+		return ret;
+	}
+};
+
+} // namespace
+
+/*******************************************************************************
+
+                                   MeshBvh
+
+*******************************************************************************/
+
+// PUBLIC
+
+MeshBvh* MeshBvh::Create(const MeshData& _meshData)
+{
+	eastl::vector<uint32> triangles;
+	_meshData.getTriangles(triangles);
+	MeshBuilder meshBuilder;
+	meshBuilder.beginSubmesh(0);
+	meshBuilder.addVertexData(_meshData.getDesc(), _meshData.getVertexData(), _meshData.getVertexCount());
+	meshBuilder.addIndexData(DataType_Uint32, triangles.data(), (uint32)triangles.size());
+	meshBuilder.endSubmesh();
+	return Create(meshBuilder);
+}
+
+MeshBvh* MeshBvh::Create(const MeshBuilder& _meshBuilder)
+{
+	const uint32 vertexCount = _meshBuilder.getVertexCount();
+	eastl::vector<vec3> positions(vertexCount);
+	if (_meshBuilder.getLayout() == MeshBuilder::Layout_SoA) {
+		APT_ASSERT(_meshBuilder.hasStream(VertexAttr::Semantic_Positions));
+		for (int i = 0; i < 3; ++i) {
+			const float* stream = _meshBuilder.getStream(VertexAttr::Semantic_Positions, i);
+			for (uint32 j = 0; j < vertexCount; ++j) {
+				positions[j][i] = stream[j];
+			}
+		}
+	} else {
+		for (uint32 i = 0; i < vertexCount; ++i) {
+			positions[i] = _meshBuilder.getVertex(i).m_position;
+		}
+	}
+
+	MeshBvh* ret = new MeshBvh;
+	const uint32 triangleCount = _meshBuilder.getTriangleCount();
+	ret->build(positions.data(), triangleCount ? &_meshBuilder.getTriangle(0).a : nullptr, triangleCount);
+	return ret;
+}
+
+void MeshBvh::Destroy(MeshBvh*& _meshBvh_)
+{
+	delete _meshBvh_;
+	_meshBvh_ = nullptr;
+}
+
+bool MeshBvh::intersect(const Ray& _ray, Hit& hit_, float _tmax) const
+{
+	return traverse<false>(_ray.m_origin, _ray.m_direction, _tmax, &hit_);
+}
+
+bool MeshBvh::intersect(const LineSegment& _segment, Hit& hit_) const
+{
+	vec3  d   = _segment.m_end - _segment.m_start;
+	float len = length(d);
+	return len > 0.0f && traverse<false>(_segment.m_start, d / len, len, &hit_);
+}
+
+bool MeshBvh::intersects(const Ray& _ray, float _tmax) const
+{
+	return traverse<true>(_ray.m_origin, _ray.m_direction, _tmax, nullptr);
+}
+
+bool MeshBvh::intersects(const LineSegment& _segment) const
+{
+	vec3  d   = _segment.m_end - _segment.m_start;
+	float len = length(d);
+	return len > 0.0f && traverse<true>(_segment.m_start, d / len, len, nullptr);
+}
+
+// PRIVATE
+
+MeshBvh::MeshBvh()
+	: m_maxDepth(0)
+{
+	m_boundingBox = EmptyBox();
+}
+
+MeshBvh::~MeshBvh()
+{
+}
+
+void MeshBvh::build(const vec3* _positions, const uint32* _indices, uint32 _triangleCount)
+{
+	APT_AUTOTIMER("MeshBvh::build");
+
+	m_nodes.clear();
+	m_triangles.clear();
+	m_triangleIndices.clear();
+	m_boundingBox = EmptyBox();
+	m_maxDepth = 0;
+	if (_triangleCount == 0) {
+		return;
+	}
+
+	eastl::vector<AlignedBox> boxes(_triangleCount);
+	eastl::vector<vec3>       centroids(_triangleCount);
+	for (uint32 i = 0; i < _triangleCount; ++i) {
+		const vec3& a = _positions[_indices[i * 3 + 0]];
+		const vec3& b = _positions[_indices[i * 3 + 1]];
+		const vec3& c = _positions[_indices[i * 3 + 2]];
+		boxes[i].m_min = min(a, min(b, c));
+		boxes[i].m_max = max(a, max(b, c));
+		centroids[i]   = (boxes[i].m_min + boxes[i].m_max) * 0.5f;
+	}
+
+	BuildContext ctx;
+	ctx.m_boxes     = boxes.data();
+	ctx.m_centroids = centroids.data();
+	ctx.m_order.resize(_triangleCount);
+	for (uint32 i = 0; i < _triangleCount; ++i) {
+		ctx.m_order[i] = i;
+	}
+	ctx.m_nodes.reserve(_triangleCount * 2 / kMaxLeafSize * 2 + 1);
+	ctx.build(0, _triangleCount, 0);
+	m_boundingBox = ctx.m_nodes[0].m_box;
+
+ // collapse the binary tree, each inner node takes up to 4 children by repeatedly replacing the child with the
+ // largest surface area by its own children
+	struct Collapse
+	{
+		static uint32 Emit(const BuildContext& _ctx, eastl::vector<Node>& nodes_, uint32 _node, uint32 _depth, uint32& maxDepth_)
+		{
+			maxDepth_ = APT_MAX(maxDepth_, _depth);
+			const BuildNode& node = _ctx.m_nodes[_node];
+			uint32 children[4] = { _node };
+			uint32 childCount  = 1;
+			if (node.m_left != ~0u) {
+				children[0] = node.m_left;
+				children[1] = node.m_right;
+				childCount  = 2;
+				while (childCount < 4) {
+					int   best     = -1;
+					float bestArea = -1.0f;
+					for (uint32 i = 0; i < childCount; ++i) {
+						const BuildNode& candidate = _ctx.m_nodes[children[i]];
+						if (candidate.m_left != ~0u && HalfArea(candidate.m_box) > bestArea) {
+							best     = (int)i;
+							bestArea = HalfArea(candidate.m_box);
+						}
+					}
+					if (best < 0) {
+						break;
+					}
+					const BuildNode& expand = _ctx.m_nodes[children[best]];
+					children[best] = expand.m_left;
+					children[childCount++] = expand.m_right;
+				}
+			}
+
+			const uint32 ret = (uint32)nodes_.size();
+			Node empty;
+			empty.m_min   = vec3(FLT_MAX);
+			empty.m_max   = vec3(-FLT_MAX);
+			empty.m_index = 0;
+			empty.m_count = 0;
+			nodes_.resize(ret + 4, empty);
+			for (uint32 i = 0; i < childCount; ++i) {
+				const BuildNode& child = _ctx.m_nodes[children[i]];
+				Node n;
+				n.m_min = child.m_box.m_min;
+				n.m_max = child.m_box.m_max;
+				if (child.m_left == ~0u) {
+					n.m_index = child.m_begin;
+					n.m_count = child.m_end - child.m_begin;
+				} else {
+					n.m_index = Emit(_ctx, nodes_, children[i], _depth + 1, maxDepth_);
+					n.m_count = 0;
+				}
+				nodes_[ret + i] = n; // after Emit(), nodes_ may have been reallocated
+			}
+			return ret;
+		}
+	};
+	Collapse::Emit(ctx, m_nodes, 0, 1, m_maxDepth);
+	APT_ASSERT(m_maxDepth <= kMaxBinaryDepth);
+
+	m_triangles.resize(_triangleCount);
+	m_triangleIndices.resize(_triangleCount);
+	for (uint32 i = 0; i < _triangleCount; ++i) {
+		uint32 tri = ctx.m_order[i];
+		const vec3& a = _positions[_indices[tri * 3 + 0]];
+		const vec3& b = _positions[_indices[tri * 3 + 1]];
+		const vec3& c = _positions[_indices[tri * 3 + 2]];
+		m_triangles[i].m_v0 = a;
+		m_triangles[i].m_e1 = b - a;
+		m_triangles[i].m_e2 = c - a;
+		m_triangleIndices[i] = tri;
+	}
+}
+
+template <bool kAnyHit>
+bool MeshBvh::traverse(const vec3& _origin, const vec3& _direction, float _tmax, Hit* hit_) const
+{
+	if (m_nodes.empty()) {
+		return false;
+	}
+
+ // avoid inf/nan in the slab test for axis-aligned directions
+	vec3 invDirection;
+	for (int i = 0; i < 3; ++i) {
+		float d = _direction[i];
+		d = fabsf(d) < 1e-20f ? (d < 0.0f ? -1e-20f : 1e-20f) : d;
+		invDirection[i] = 1.0f / d;
+	}
+	const bool negative[3] = { invDirection.x < 0.0f, invDirection.y < 0.0f, invDirection.z < 0.0f };
+
+	float  tcur     = _tmax;
+	uint32 hitIndex = ~0u;
+	vec2   hitBarycentric;
+
+	uint32 stack[kStackSize];
+	float  stackT[kStackSize];
+	uint32 stackSize = 1;
+	stack[0]  = 0;
+	stackT[0] = 0.0f;
+
+#if MeshBvh_SIMD
+	const __m128 ox  = _mm_set1_ps(_origin.x),      oy  = _mm_set1_ps(_origin.y),      oz  = _mm_set1_ps(_origin.z);
+	const __m128 idx = _mm_set1_ps(invDirection.x), idy = _mm_set1_ps(invDirection.y), idz = _mm_set1_ps(invDirection.z);
+#endif
+
+	while (stackSize > 0) {
+		--stackSize;
+		if (stackT[stackSize] > tcur) {
+			continue;
+		}
+		const uint32 group = stack[stackSize];
+		const Node*  nodes = &m_nodes[group];
+
+	 // test the 4 children
+		float tnear[4];
+		int   mask = 0;
+	#if MeshBvh_SIMD
+		{
+			const float* base = (const float*)nodes;
+			__m128 xmin = _mm_loadu_ps(base + 0),  ymin = _mm_loadu_ps(base + 8),  zmin = _mm_loadu_ps(base + 16), wmin = _mm_loadu_ps(base + 24);
+			__m128 xmax = _mm_loadu_ps(base + 4),  ymax = _mm_loadu_ps(base + 12), zmax = _mm_loadu_ps(base + 20), wmax = _mm_loadu_ps(base + 28);
+			_MM_TRANSPOSE4_PS(xmin, ymin, zmin, wmin);
+			_MM_TRANSPOSE4_PS(xmax, ymax, zmax, wmax);
+			__m128 tx0 = _mm_mul_ps(_mm_sub_ps(negative[0] ? xmax : xmin, ox), idx);
+			__m128 tx1 = _mm_mul_ps(_mm_sub_ps(negative[0] ? xmin : xmax, ox), idx);
+			__m128 ty0 = _mm_mul_ps(_mm_sub_ps(negative[1] ? ymax : ymin, oy), idy);
+			__m128 ty1 = _mm_mul_ps(_mm_sub_ps(negative[1] ? ymin : ymax, oy), idy);
+			__m128 tz0 = _mm_mul_ps(_mm_sub_ps(negative[2] ? zmax : zmin, oz), idz);
+			__m128 tz1 = _mm_mul_ps(_mm_sub_ps(negative[2] ? zmin : zmax, oz), idz);
+			__m128 t0  = _mm_max_ps(_mm_max_ps(tx0, ty0), _mm_max_ps(tz0, _mm_setzero_ps()));
+			__m128 t1  = _mm_min_ps(_mm_min_ps(tx1, ty1), _mm_min_ps(tz1, _mm_set1_ps(tcur)));
+			mask = _mm_movemask_ps(_mm_cmple_ps(t0, t1));
+			_mm_storeu_ps(tnear, t0);
+		}
+	#else
+		for (int i = 0; i < 4; ++i) {
+			float t0 = 0.0f;
+			float t1 = tcur;
+			for (int j = 0; j < 3; ++j) {
+				float tn = ((negative[j] ? nodes[i].m_max : nodes[i].m_min)[j] - _origin[j]) * invDirection[j];
+				float tf = ((negative[j] ? nodes[i].m_min : nodes[i].m_max)[j] - _origin[j]) * invDirection[j];
+				t0 = APT_MAX(t0, tn);
+				t1 = APT_MIN(t1, tf);
+			}
+			tnear[i] = t0;
+			mask |= t0 <= t1 ? (1 << i) : 0;
+		}
+	#endif
+
+	 // leaves are tested immediately, inner nodes are pushed far to near
+		uint32 innerCount = 0;
+		uint32 inner[4];
+		for (int i = 0; i < 4; ++i) {
+			if ((mask & (1 << i)) == 0) {
+				continue;
+			}
+			const Node& node = nodes[i];
+			if (node.m_count == 0) {
+				inner[innerCount++] = (uint32)i;
+				continue;
+			}
+			for (uint32 j = node.m_index, n = node.m_index + node.m_count; j < n; ++j) {
+			 // Moller-Trumbore, two sided
+				const Triangle& tri = m_triangles[j];
+				vec3  p   = cross(_direction, tri.m_e2);
+				float det = dot(tri.m_e1, p);
+				if (det == 0.0f) {
+					continue;
+				}
+				float invDet = 1.0f / det;
+				vec3  s = _origin - tri.m_v0;
+				float u = dot(s, p) * invDet;
+				if (u < 0.0f || u > 1.0f) {
+					continue;
+				}
+				vec3  q = cross(s, tri.m_e1);
+				float v = dot(_direction, q) * invDet;
+				if (v < 0.0f || u + v > 1.0f) {
+					continue;
+				}
+				float t = dot(tri.m_e2, q) * invDet;
+				if (t < 0.0f || t > tcur) {
+					continue;
+				}
+				if (kAnyHit) {
+					return true;
+				}
+				tcur = t;
+				hitIndex = j;
+				hitBarycentric = vec2(u, v);
+			}
+		}
+		for (uint32 i = 1; i < innerCount; ++i) { // insertion sort by descending tnear
+			uint32 c = inner[i];
+			uint32 j = i;
+			for (; j > 0 && tnear[inner[j - 1]] < tnear[c]; --j) {
+				inner[j] = inner[j - 1];
+			}
+			inner[j] = c;
+		}
+		for (uint32 i = 0; i < innerCount; ++i) {
+			APT_ASSERT(stackSize < kStackSize);
+			stack[stackSize]  = nodes[inner[i]].m_index;
+			stackT[stackSize] = tnear[inner[i]];
+			++stackSize;
+		}
+	}
+
+	if (hitIndex == ~0u) {
+		return false;
+	}
+	hit_->m_t           = tcur;
+	hit_->m_triangle    = m_triangleIndices[hitIndex];
+	hit_->m_barycentric = hitBarycentric;
+	return true;
+}
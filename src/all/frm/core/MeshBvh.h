@@ -0,0 +1,90 @@
+#pragma once
+#ifndef frm_MeshBvh_h
+#define frm_MeshBvh_h
+
+#include <frm/core/def.h>
+#include <frm/core/geom.h>
+
+#include <EASTL/vector.h>
+
+namespace frm {
+
+class MeshBuilder;
+class MeshData;
+
+////////////////////////////////////////////////////////////////////////////////
+// MeshBvh
+// Bounding volume hierarchy over the triangles of a mesh for ray queries (e.g.
+// cursor picking).
+// The hierarchy is built as a binary tree (binned SAH), then collapsed into a
+// 4-wide tree such that traversal tests the 4 children of a node at once (SSE
+// where available). Each child is a 32 byte Node; the 4 children of an inner
+// node are contiguous (unused children have an empty box). Triangles are
+// stored in leaf order.
+////////////////////////////////////////////////////////////////////////////////
+class MeshBvh: private apt::non_copyable<MeshBvh>
+{
+public:
+
+	struct Node
+	{
+		vec3   m_min;
+		uint32 m_index;  // first child if m_count == 0, else first triangle
+		vec3   m_max;
+		uint32 m_count;  // triangle count (0 for inner nodes)
+	};
+
+	struct Hit
+	{
+		float  m_t;          // distance from the ray origin/segment start
+		uint32 m_triangle;   // index of the triangle in the source mesh
+		vec2   m_barycentric; // weights of the 2nd and 3rd triangle vertices
+	};
+
+	// Build from the positions of submesh 0 (i.e. the whole mesh, LOD 0).
+	static MeshBvh* Create(const MeshData& _meshData);
+	static MeshBvh* Create(const MeshBuilder& _meshBuilder);
+	static void     Destroy(MeshBvh*& _meshBvh_);
+
+	// Closest hit (hit_ is only written if the function returns true).
+	bool intersect(const Ray& _ray, Hit& hit_, float _tmax = FLT_MAX) const;
+	bool intersect(const LineSegment& _segment, Hit& hit_) const;
+	// Any hit, may be cheaper than intersect().
+	bool intersects(const Ray& _ray, float _tmax = FLT_MAX) const;
+	bool intersects(const LineSegment& _segment) const;
+
+	const AlignedBox& getBoundingBox() const   { return m_boundingBox; }
+	uint32            getNodeCount() const     { return (uint32)m_nodes.size(); }
+	const Node&       getNode(uint32 _i) const { return m_nodes[_i]; }
+	uint32            getTriangleCount() const { return (uint32)m_triangleIndices.size(); }
+	uint32            getMaxDepth() const      { return m_maxDepth; }
+
+private:
+
+	// Triangle in edge form for the intersection test (Moller-Trumbore).
+	struct Triangle
+	{
+		vec3 m_v0;
+		vec3 m_e1;
+		vec3 m_e2;
+	};
+
+	eastl::vector<Node>     m_nodes;           // m_nodes[0..3] are the children of the root
+	eastl::vector<Triangle> m_triangles;       // in leaf order
+	eastl::vector<uint32>   m_triangleIndices; // leaf order -> source mesh
+	AlignedBox              m_boundingBox;
+	uint32                  m_maxDepth;
+
+	MeshBvh();
+	~MeshBvh();
+
+	void build(const vec3* _positions, const uint32* _indices, uint32 _triangleCount);
+
+	template <bool kAnyHit>
+	bool traverse(const vec3& _origin, const vec3& _direction, float _tmax, Hit* hit_) const;
+
+}; // class MeshBvh
+
+} // namespace frm
+
+#endif // frm_MeshBvh_h
@@ -0,0 +1,388 @@
+#include "MeshCodec.h"
+
+#include <EASTL/vector.h>
+
+#include <cstring>
+
+// SSE2 path for the group unpack, prefix sum and transpose.
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+	#define MeshCodec_SIMD 1
+	#include <emmintrin.h>
+#else
+	#define MeshCodec_SIMD 0
+#endif
+
+using namespace frm;
+using namespace apt;
+
+static const uint kBlockSize = 256; // vertices per block, bounds the size of the byte planes
+static const uint kGroupSize = 16;  // deltas per bit packed group
+
+static const uint8 kGroupWidth[4] = { 0, 2, 4, 8 };
+
+static inline uint8 ZigzagByte(uint8 _delta)
+{
+	return (uint8)((_delta << 1) ^ (uint8)((sint8)_delta >> 7));
+}
+
+static inline uint8 UnzigzagByte(uint8 _code)
+{
+	return (uint8)((_code >> 1) ^ (uint8)-(sint8)(_code & 1));
+}
+
+static inline uint GroupCount(uint _count)
+{
+	return (_count + kGroupSize - 1) / kGroupSize;
+}
+
+static inline uint HeaderSize(uint _groupCount)
+{
+	return (_groupCount + 3) / 4;
+}
+
+static inline uint GroupWidth(const uint8* _header, uint _group)
+{
+	return kGroupWidth[(_header[_group / 4] >> ((_group % 4) * 2)) & 3];
+}
+
+/*******************************************************************************
+
+                                  Vertex data
+
+*******************************************************************************/
+
+uint frm::EncodeVertexDataBound(uint _vertexCount, uint _vertexSize)
+{
+	uint blockCount = (_vertexCount + kBlockSize - 1) / kBlockSize;
+	uint groupCount = GroupCount(kBlockSize);
+	return blockCount * _vertexSize * (HeaderSize(groupCount) + groupCount * kGroupSize);
+}
+
+uint frm::EncodeVertexData(const void* _src, uint _vertexCount, uint _vertexSize, void* out_)
+{
+	const uint8* src = (const uint8*)_src;
+	uint8*       dst = (uint8*)out_;
+
+	eastl::vector<uint8> prev(_vertexSize, 0);
+	uint8 deltas[kBlockSize];
+	for (uint blockBeg = 0; blockBeg < _vertexCount; blockBeg += kBlockSize) {
+		uint blockCount = APT_MIN(kBlockSize, _vertexCount - blockBeg);
+		uint groupCount = GroupCount(blockCount);
+
+		for (uint b = 0; b < _vertexSize; ++b) {
+			memset(deltas, 0, sizeof(deltas));
+			for (uint i = 0; i < blockCount; ++i) {
+				uint8 value = src[(blockBeg + i) * _vertexSize + b];
+				deltas[i] = ZigzagByte((uint8)(value - prev[b]));
+				prev[b] = value;
+			}
+
+			uint8* header = dst;
+			memset(header, 0, HeaderSize(groupCount));
+			dst += HeaderSize(groupCount);
+			for (uint g = 0; g < groupCount; ++g) {
+				const uint8* group = deltas + g * kGroupSize;
+				uint8 maxDelta = 0;
+				for (uint i = 0; i < kGroupSize; ++i) {
+					maxDelta = APT_MAX(maxDelta, group[i]);
+				}
+				uint code = maxDelta == 0 ? 0 : maxDelta < 4 ? 1 : maxDelta < 16 ? 2 : 3;
+				header[g / 4] |= (uint8)(code << ((g % 4) * 2));
+
+			 // value i of a group goes to bits [i % (8 / width) * width] of byte i / (8 / width)
+				uint width = kGroupWidth[code];
+				if (width == 8) {
+					memcpy(dst, group, kGroupSize);
+				} else if (width > 0) {
+					uint perByte = 8 / width;
+					memset(dst, 0, kGroupSize / perByte);
+					for (uint i = 0; i < kGroupSize; ++i) {
+						dst[i / perByte] |= (uint8)(group[i] << ((i % perByte) * width));
+					}
+				}
+				dst += width * kGroupSize / 8;
+			}
+		}
+	}
+
+	return (uint)(dst - (uint8*)out_);
+}
+
+#if MeshCodec_SIMD
+	// Unpack a group of 16 deltas (reads exactly _width * 2 bytes), undo the zigzag and prefix sum onto _prev_ (the
+	// previous value broadcast to all lanes). Return the decoded values, _prev_ receives the last value broadcast to all
+	// lanes.
+	static inline __m128i DecodeGroup(const uint8* _src, uint _width, __m128i& _prev_)
+	{
+		__m128i v;
+		switch (_width) {
+			default:
+			case 0:
+				v = _mm_setzero_si128();
+				break;
+			case 2: {
+				uint32 packed;
+				memcpy(&packed, _src, sizeof(uint32));
+				__m128i x    = _mm_cvtsi32_si128((int)packed);
+				__m128i mask = _mm_set1_epi8(3);
+				__m128i a    = _mm_and_si128(x, mask);
+				__m128i b    = _mm_and_si128(_mm_srli_epi16(x, 2), mask);
+				__m128i c    = _mm_and_si128(_mm_srli_epi16(x, 4), mask);
+				__m128i d    = _mm_and_si128(_mm_srli_epi16(x, 6), mask);
+				v = _mm_unpacklo_epi16(_mm_unpacklo_epi8(a, b), _mm_unpacklo_epi8(c, d));
+				break;
+			}
+			case 4: {
+				__m128i x    = _mm_loadl_epi64((const __m128i*)_src);
+				__m128i mask = _mm_set1_epi8(15);
+				v = _mm_unpacklo_epi8(_mm_and_si128(x, mask), _mm_and_si128(_mm_srli_epi16(x, 4), mask));
+				break;
+			}
+			case 8:
+				v = _mm_loadu_si128((const __m128i*)_src);
+				break;
+		};
+
+	 // unzigzag: (v >> 1) ^ -(v & 1)
+		__m128i one = _mm_set1_epi8(1);
+		__m128i neg = _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(v, one));
+		v = _mm_xor_si128(_mm_and_si128(_mm_srli_epi16(v, 1), _mm_set1_epi8(0x7f)), neg);
+
+	 // inclusive prefix sum
+		v = _mm_add_epi8(v, _mm_slli_si128(v, 1));
+		v = _mm_add_epi8(v, _mm_slli_si128(v, 2));
+		v = _mm_add_epi8(v, _mm_slli_si128(v, 4));
+		v = _mm_add_epi8(v, _mm_slli_si128(v, 8));
+		v = _mm_add_epi8(v, _prev_);
+
+		__m128i last = _mm_unpackhi_epi8(v, v);                 // bytes 15,15 in the top word
+		last = _mm_shufflehi_epi16(last, _MM_SHUFFLE(3, 3, 3, 3));
+		_prev_ = _mm_shuffle_epi32(last, _MM_SHUFFLE(3, 3, 3, 3));
+		return v;
+	}
+
+	// Transpose 4 byte planes (stride _planeStride) into _count vertices of size _vertexSize.
+	static inline void TransposePlanes4(const uint8* _planes, uint _planeStride, uint _count, uint _vertexSize, uint8* out_)
+	{
+		for (uint i = 0; i < _count; i += 16) {
+			__m128i p0 = _mm_loadu_si128((const __m128i*)(_planes + i));
+			__m128i p1 = _mm_loadu_si128((const __m128i*)(_planes + _planeStride + i));
+			__m128i p2 = _mm_loadu_si128((const __m128i*)(_planes + _planeStride * 2 + i));
+			__m128i p3 = _mm_loadu_si128((const __m128i*)(_planes + _planeStride * 3 + i));
+			__m128i t0 = _mm_unpacklo_epi8(p0, p1);
+			__m128i t1 = _mm_unpackhi_epi8(p0, p1);
+			__m128i t2 = _mm_unpacklo_epi8(p2, p3);
+			__m128i t3 = _mm_unpackhi_epi8(p2, p3);
+			uint32 v[16];
+			_mm_storeu_si128((__m128i*)v,     _mm_unpacklo_epi16(t0, t2));
+			_mm_storeu_si128((__m128i*)v + 1, _mm_unpackhi_epi16(t0, t2));
+			_mm_storeu_si128((__m128i*)v + 2, _mm_unpacklo_epi16(t1, t3));
+			_mm_storeu_si128((__m128i*)v + 3, _mm_unpackhi_epi16(t1, t3));
+			uint n = APT_MIN(16u, _count - i);
+			uint8* dst = out_ + i * _vertexSize;
+			if (n == 16) {
+				for (uint j = 0; j < 16; ++j) {
+					memcpy(dst, &v[j], sizeof(uint32));
+					dst += _vertexSize;
+				}
+				continue;
+			}
+			for (uint j = 0; j < n; ++j) {
+				memcpy(dst, &v[j], sizeof(uint32));
+				dst += _vertexSize;
+			}
+		}
+	}
+#endif
+
+bool frm::DecodeVertexData(const void* _src, uint _srcSize, uint _vertexCount, uint _vertexSize, void* out_)
+{
+	const uint8* src    = (const uint8*)_src;
+	const uint8* srcEnd = src + _srcSize;
+	uint8*       dst    = (uint8*)out_;
+
+ // decoded byte planes for the current block, padded to a whole group
+	const uint planeStride = kBlockSize + kGroupSize;
+	eastl::vector<uint8> planes(planeStride * _vertexSize);
+
+	eastl::vector<uint8> prev(_vertexSize, 0);
+
+	for (uint blockBeg = 0; blockBeg < _vertexCount; blockBeg += kBlockSize) {
+		uint blockCount = APT_MIN(kBlockSize, _vertexCount - blockBeg);
+		uint groupCount = GroupCount(blockCount);
+
+		for (uint b = 0; b < _vertexSize; ++b) {
+			const uint8* header = src;
+			if ((uint)(srcEnd - src) < HeaderSize(groupCount)) {
+				return false;
+			}
+			src += HeaderSize(groupCount);
+			uint dataSize = 0;
+			for (uint g = 0; g < groupCount; ++g) {
+				dataSize += GroupWidth(header, g) * kGroupSize / 8;
+			}
+			if ((uint)(srcEnd - src) < dataSize) {
+				return false;
+			}
+
+			uint8* plane = planes.data() + b * planeStride;
+			#if MeshCodec_SIMD
+				__m128i prevb = _mm_set1_epi8((char)prev[b]);
+			#endif
+			for (uint g = 0; g < groupCount; ++g) {
+				uint width = GroupWidth(header, g);
+				#if MeshCodec_SIMD
+					_mm_storeu_si128((__m128i*)(plane + g * kGroupSize), DecodeGroup(src, width, prevb));
+				#else
+				{
+					uint8* values = plane + g * kGroupSize;
+					uint   mask   = (1u << width) - 1;
+					for (uint i = 0; i < kGroupSize; ++i) {
+						uint8 code = 0;
+						if (width == 8) {
+							code = src[i];
+						} else if (width > 0) {
+							uint perByte = 8 / width;
+							code = (uint8)((src[i / perByte] >> ((i % perByte) * width)) & mask);
+						}
+						prev[b] = (uint8)(prev[b] + UnzigzagByte(code));
+						values[i] = prev[b];
+					}
+				}
+				#endif
+				src += width * kGroupSize / 8;
+			}
+			#if MeshCodec_SIMD
+				prev[b] = (uint8)_mm_cvtsi128_si32(prevb);
+			#endif
+		}
+
+	 // transpose the planes back into vertices
+		uint8* blockDst = dst + blockBeg * _vertexSize;
+		uint b = 0;
+		#if MeshCodec_SIMD
+			for (; b + 4 <= _vertexSize; b += 4) {
+				TransposePlanes4(planes.data() + b * planeStride, planeStride, blockCount, _vertexSize, blockDst + b);
+			}
+		#endif
+		for (; b < _vertexSize; ++b) {
+			const uint8* plane = planes.data() + b * planeStride;
+			for (uint i = 0; i < blockCount; ++i) {
+				blockDst[i * _vertexSize + b] = plane[i];
+			}
+		}
+	}
+
+	return true;
+}
+
+/*******************************************************************************
+
+                                   Index data
+
+*******************************************************************************/
+
+static inline uint32 GetRestartIndex(DataType _dataType)
+{
+	switch (_dataType) {
+		case DataType_Uint8:  return 0xffu;
+		case DataType_Uint16: return 0xffffu;
+		default:              return 0xffffffffu;
+	};
+}
+
+static inline uint32 ReadIndex(const void* _src, DataType _dataType, uint _i)
+{
+	switch (_dataType) {
+		case DataType_Uint8:  return ((const uint8*)_src)[_i];
+		case DataType_Uint16: return ((const uint16*)_src)[_i];
+		default:              return ((const uint32*)_src)[_i];
+	};
+}
+
+uint frm::EncodeIndexDataBound(uint _indexCount)
+{
+	return _indexCount * 5; // max varint size for 32 bits
+}
+
+uint frm::EncodeIndexData(const void* _src, DataType _dataType, uint _indexCount, void* out_)
+{
+	APT_ASSERT(_dataType == DataType_Uint8 || _dataType == DataType_Uint16 || _dataType == DataType_Uint32);
+
+	uint8* dst          = (uint8*)out_;
+	uint32 restartIndex = GetRestartIndex(_dataType);
+	uint32 next         = 0;
+	for (uint i = 0; i < _indexCount; ++i) {
+		uint32 index = ReadIndex(_src, _dataType, i);
+
+	 // code 0 is the restart index, else zigzag(next - index) + 1
+		uint32 code = 0;
+		if (index != restartIndex) {
+			sint32 delta = (sint32)(next - index);
+			code = (((uint32)delta << 1) ^ (uint32)(delta >> 31)) + 1;
+			next = APT_MAX(next, index + 1);
+		}
+
+		while (code >= 0x80) {
+			*dst++ = (uint8)(code | 0x80);
+			code >>= 7;
+		}
+		*dst++ = (uint8)code;
+	}
+
+	return (uint)(dst - (uint8*)out_);
+}
+
+static bool ReadVarint(const uint8*& _src_, const uint8* _srcEnd, uint32& code_)
+{
+	code_ = 0;
+	for (uint shift = 0; shift < 35; shift += 7) {
+		if (_src_ == _srcEnd) {
+			return false;
+		}
+		uint8 byte = *_src_++;
+		code_ |= (uint32)(byte & 0x7f) << shift;
+		if ((byte & 0x80) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+template <typename tIndex>
+static bool DecodeIndices(const uint8* _src, const uint8* _srcEnd, uint _indexCount, tIndex* out_)
+{
+	const tIndex restartIndex = (tIndex)~tIndex(0);
+	uint32 next = 0;
+	for (uint i = 0; i < _indexCount; ++i) {
+	 // single byte codes are the common case
+		uint32 code;
+		if (_src != _srcEnd && *_src < 0x80) {
+			code = *_src++;
+		} else if (!ReadVarint(_src, _srcEnd, code)) {
+			return false;
+		}
+
+		if (code == 0) {
+			out_[i] = restartIndex;
+			continue;
+		}
+		code -= 1;
+		uint32 index = next - ((code >> 1) ^ (uint32)-(sint32)(code & 1));
+		out_[i] = (tIndex)index;
+		next = index >= next ? index + 1 : next;
+	}
+	return _src == _srcEnd;
+}
+
+bool frm::DecodeIndexData(const void* _src, uint _srcSize, DataType _dataType, uint _indexCount, void* out_)
+{
+	const uint8* src    = (const uint8*)_src;
+	const uint8* srcEnd = src + _srcSize;
+	switch (_dataType) {
+		case DataType_Uint8:  return DecodeIndices(src, srcEnd, _indexCount, (uint8*)out_);
+		case DataType_Uint16: return DecodeIndices(src, srcEnd, _indexCount, (uint16*)out_);
+		case DataType_Uint32: return DecodeIndices(src, srcEnd, _indexCount, (uint32*)out_);
+		default:              APT_ASSERT(false); return false;
+	};
+}
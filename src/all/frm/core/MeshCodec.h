@@ -0,0 +1,41 @@
+#pragma once
+#ifndef frm_MeshCodec_h
+#define frm_MeshCodec_h
+
+#include <frm/core/def.h>
+
+namespace frm {
+
+////////////////////////////////////////////////////////////////////////////////
+// MeshCodec
+// Lossless compression of vertex/index streams, e.g. for the binary mesh cache
+// (see MeshData_bin.cpp).
+//
+// Vertex data is encoded in blocks of 256 vertices. Each byte of the vertex is
+// delta encoded against the same byte of the previous vertex and transposed
+// into a byte plane. Planes are split into groups of 16 zigzagged deltas which
+// are bit packed at 0, 2, 4 or 8 bits; the width is chosen per group and
+// stored in a 2 bit header. Decoding is vectorized (SSE2).
+//
+// Index data is delta encoded against the next unused vertex index, which is
+// the common case for vertex fetch ordered meshes (see MeshBuilder::
+// optimizeVertexFetch()), then zigzagged and written as a varint. The max
+// value of the index type is preserved as the primitive restart index.
+//
+// Encode*() write at most Encode*Bound() bytes to out_ and return the encoded
+// size. Decode*() write exactly _vertexCount/_indexCount elements to out_ and
+// return false if _src is malformed.
+////////////////////////////////////////////////////////////////////////////////
+
+uint EncodeVertexDataBound(uint _vertexCount, uint _vertexSize);
+uint EncodeVertexData(const void* _src, uint _vertexCount, uint _vertexSize, void* out_);
+bool DecodeVertexData(const void* _src, uint _srcSize, uint _vertexCount, uint _vertexSize, void* out_);
+
+// _dataType must be Uint8, Uint16 or Uint32.
+uint EncodeIndexDataBound(uint _indexCount);
+uint EncodeIndexData(const void* _src, apt::DataType _dataType, uint _indexCount, void* out_);
+bool DecodeIndexData(const void* _src, uint _srcSize, apt::DataType _dataType, uint _indexCount, void* out_);
+
+} // namespace frm
+
+#endif // frm_MeshCodec_h
@@ -1,5 +1,8 @@
 #include "MeshData.h"
 
+#include <frm/core/MappedFile.h>
+#include <frm/core/parallel.h>
+
 #include <apt/log.h>
 #include <apt/hash.h>
 #include <apt/memory.h>
@@ -7,11 +10,22 @@
 #include <apt/TextParser.h>
 #include <apt/Time.h>
 
+#include <EASTL/algorithm.h>
+#include <EASTL/sort.h>
+
 #include <algorithm> // swap
 #include <cstdarg>
 #include <cstdlib>
 #include <cstring>
 
+// SSE paths for the Layout_SoA stream functions.
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE__)
+	#define MeshBuilder_SIMD 1
+	#include <xmmintrin.h>
+#else
+	#define MeshBuilder_SIMD 0
+#endif
+
 using namespace frm;
 using namespace apt;
 
@@ -42,6 +56,233 @@ static inline DataType GetIndexDataType(uint _vertexCount)
 	return DataType_Uint16;
 }
 
+// Build the list of triangle corners (triangle index * 3 + corner) adjacent to each vertex, corners of vertex i are in
+// corners_[offsets_[i], offsets_[i + 1]) in ascending order. Accumulating per-vertex values by iterating over this list
+// sums the per-triangle contributions in the same order as a serial loop over the triangles, hence the results are
+// independent of how the work is distributed between threads.
+static void GetVertexCorners(const MeshBuilder::Triangle* _triangles, uint32 _triangleCount, uint32 _vertexCount, eastl::vector<uint32>& offsets_, eastl::vector<uint32>& corners_)
+{
+	offsets_.clear();
+	offsets_.resize(_vertexCount + 1, 0);
+	for (uint32 i = 0; i < _triangleCount; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			++offsets_[_triangles[i][j] + 1];
+		}
+	}
+	for (uint32 i = 1; i <= _vertexCount; ++i) {
+		offsets_[i] += offsets_[i - 1];
+	}
+	corners_.resize(_triangleCount * 3);
+	eastl::vector<uint32> cursor(offsets_.begin(), offsets_.end() - 1);
+	for (uint32 i = 0; i < _triangleCount; ++i) {
+		for (uint32 j = 0; j < 3; ++j) {
+			corners_[cursor[_triangles[i][j]]++] = i * 3 + j;
+		}
+	}
+}
+
+// Convert the triangle list _indices to strips separated by _restart (one after each strip), append to out_. Strips
+// are grown greedily in triangle order (i.e. following a prior vertex cache optimization), each strip starts at the
+// first unused triangle with the rotation which gives the longest strip.
+static void Stripify(const uint32* _indices, uint32 _indexCount, uint32 _restart, eastl::vector<uint32>& out_)
+{
+	const MeshBuilder::Triangle* triangles = (const MeshBuilder::Triangle*)_indices;
+	const uint32 triangleCount = _indexCount / 3;
+	uint32 vertexCount = 0;
+	for (uint32 i = 0; i < _indexCount; ++i) {
+		vertexCount = APT_MAX(vertexCount, _indices[i] + 1);
+	}
+	eastl::vector<uint32> offsets, corners;
+	GetVertexCorners(triangles, triangleCount, vertexCount, offsets, corners);
+
+ // 0 = unused, 1 = emitted, else the stamp of the strip which is being evaluated
+	eastl::vector<uint32> used(triangleCount, 0);
+	const uint32 kEmitted = 1;
+	const uint32 kMaxEvaluateLength = 256;
+
+ // find an unused triangle with the directed edge _u -> _v, return its index and the 3rd vertex
+	auto FindTriangle = [&](uint32 _u, uint32 _v, uint32 _stamp, uint32& w_) -> uint32
+		{
+			for (uint32 i = offsets[_u]; i < offsets[_u + 1]; ++i) {
+				uint32 t = corners[i] / 3;
+				uint32 k = corners[i] % 3;
+				if (used[t] == kEmitted || used[t] == _stamp) {
+					continue;
+				}
+				if (triangles[t][(k + 1) % 3] == _v) {
+					w_ = triangles[t][(k + 2) % 3];
+					return t;
+				}
+			}
+			return ~0u;
+		};
+	
+ // grow a strip from triangle _t, starting at corner _rotation; odd triangles in a strip have the reverse winding,
+ // hence the next triangle must share the directed edge (b, a) if the strip length is odd, else (a, b)
+	auto Walk = [&](uint32 _t, int _rotation, uint32 _stamp, uint32 _maxLength, eastl::vector<uint32>* out_) -> uint32
+		{
+			uint32 a = triangles[_t][(_rotation + 1) % 3];
+			uint32 b = triangles[_t][(_rotation + 2) % 3];
+			used[_t] = _stamp;
+			if (out_) {
+				out_->push_back(triangles[_t][_rotation]);
+				out_->push_back(a);
+				out_->push_back(b);
+			}
+			uint32 ret = 1;
+			while (ret < _maxLength) {
+				uint32 w;
+				uint32 t = (ret & 1) ? FindTriangle(b, a, _stamp, w) : FindTriangle(a, b, _stamp, w);
+				if (t == ~0u) {
+					break;
+				}
+				used[t] = _stamp;
+				if (out_) {
+					out_->push_back(w);
+				}
+				a = b;
+				b = w;
+				++ret;
+			}
+			return ret;
+		};
+
+	uint32 stamp = kEmitted + 1;
+	for (uint32 t = 0; t < triangleCount; ++t) {
+		if (used[t] == kEmitted) {
+			continue;
+		}
+		int    bestRotation = 0;
+		uint32 bestLength   = 0;
+		for (int rotation = 0; rotation < 3; ++rotation) {
+			uint32 length = Walk(t, rotation, stamp++, kMaxEvaluateLength, nullptr);
+			if (length > bestLength) {
+				bestLength   = length;
+				bestRotation = rotation;
+			}
+		}
+		Walk(t, bestRotation, kEmitted, ~0u, &out_);
+		out_.push_back(_restart);
+	}
+}
+
+// Append the triangles in _indices (a list, or strips separated by _restart) to out_ as a list, adding _baseVertex.
+// Degenerate triangles in strips are skipped.
+static void DecodeTriangles(const uint32* _indices, uint32 _indexCount, bool _strips, uint32 _restart, uint32 _baseVertex, eastl::vector<uint32>& out_)
+{
+	if (!_strips) {
+		for (uint32 i = 0; i < _indexCount; ++i) {
+			out_.push_back(_indices[i] + _baseVertex);
+		}
+		return;
+	}
+	uint32 stripBegin = 0;
+	for (uint32 i = 0; i <= _indexCount; ++i) {
+		if (i < _indexCount && _indices[i] != _restart) {
+			continue;
+		}
+		for (uint32 j = stripBegin; j + 2 < i; ++j) {
+			uint32 a = _indices[j];
+			uint32 b = _indices[j + 1];
+			uint32 c = _indices[j + 2];
+			if ((j - stripBegin) & 1) {
+				eastl::swap(a, b);
+			}
+			if (a == b || b == c || c == a) {
+				continue;
+			}
+			out_.push_back(a + _baseVertex);
+			out_.push_back(b + _baseVertex);
+			out_.push_back(c + _baseVertex);
+		}
+		stripBegin = i + 1;
+	}
+}
+
+// Component count per semantic in MeshBuilder::Vertex (and hence the number of MeshBuilder streams).
+static const int kStreamComponentCount[] =
+{
+	3, // Positions
+	2, // Texcoords
+	3, // Normals
+	4, // Tangents
+	4, // Colors
+	4, // BoneWeights
+	4, // BoneIndices
+};
+APT_STATIC_ASSERT(sizeof(kStreamComponentCount) / sizeof(int) == VertexAttr::Semantic_Padding);
+
+// Map a unit vector to [-1,1]^2 by projecting onto the octahedron |x|+|y|+|z| = 1 and folding the lower hemisphere.
+static vec2 OctahedralEncode(const vec3& _v)
+{
+	float l1 = fabsf(_v.x) + fabsf(_v.y) + fabsf(_v.z);
+	if (l1 == 0.0f) {
+		return vec2(0.0f);
+	}
+	vec2 ret = vec2(_v.x, _v.y) / l1;
+	if (_v.z < 0.0f) {
+		ret = vec2(
+			(1.0f - fabsf(ret.y)) * (ret.x >= 0.0f ? 1.0f : -1.0f),
+			(1.0f - fabsf(ret.x)) * (ret.y >= 0.0f ? 1.0f : -1.0f)
+			);
+	}
+	return ret;
+}
+
+static vec3 OctahedralDecode(const vec2& _v)
+{
+	vec3 ret(_v.x, _v.y, 1.0f - fabsf(_v.x) - fabsf(_v.y));
+	if (ret.z < 0.0f) {
+		ret = vec3(
+			(1.0f - fabsf(_v.y)) * (_v.x >= 0.0f ? 1.0f : -1.0f),
+			(1.0f - fabsf(_v.x)) * (_v.y >= 0.0f ? 1.0f : -1.0f),
+			ret.z
+			);
+	}
+	return normalize(ret);
+}
+
+// Write 2 components to dst_. For signed normalized types choose the rounding (floor/ceil per component) which 
+// minimizes the decoded error rather than rounding to nearest.
+static void OctahedralEncode(const vec3& _v, DataType _dataType, void* dst_)
+{
+	vec2 oct = OctahedralEncode(_v);
+	if (DataTypeIsNormalized(_dataType) && DataTypeIsSigned(_dataType)) {
+		float range = (float)((1u << (DataTypeSizeBytes(_dataType) * 8 - 1)) - 1);
+		vec2  best  = oct;
+		float bestDot = -2.0f;
+		for (int i = 0; i < 4; ++i) {
+			vec2 q(
+				((i & 1) ? ceilf(oct.x * range) : floorf(oct.x * range)) / range,
+				((i & 2) ? ceilf(oct.y * range) : floorf(oct.y * range)) / range
+				);
+			float d = dot(OctahedralDecode(q), _v);
+			if (d > bestDot) {
+				best = q;
+				bestDot = d;
+			}
+		}
+		oct = best;
+	}
+	DataTypeConvert(DataType_Float32, _dataType, &oct, dst_, 2);
+}
+
+static vec3 OctahedralDecode(DataType _dataType, const void* _src)
+{
+	vec2 oct;
+	DataTypeConvert(_dataType, DataType_Float32, _src, &oct, 2);
+	return OctahedralDecode(oct);
+}
+
+// Angle (radians) between _v and _v after encoding as _dataType.
+static float OctahedralError(const vec3& _v, DataType _dataType)
+{
+	char buf[16];
+	OctahedralEncode(_v, _dataType, buf);
+	float chord = length(OctahedralDecode(_dataType, buf) - _v);
+	return 2.0f * asinf(APT_MIN(chord * 0.5f, 1.0f)); // more precise than acos(dot()) for small angles
+}
+
 /*******************************************************************************
 
                                    VertexAttr
@@ -54,6 +295,7 @@ bool VertexAttr::operator==(const VertexAttr& _rhs) const
 		&& m_dataType == _rhs.m_dataType
 		&& m_count    == _rhs.m_count 
 		&& m_offset   == _rhs.m_offset
+		&& m_encoding == _rhs.m_encoding
 		; 
 }
 
@@ -66,7 +308,8 @@ bool VertexAttr::operator==(const VertexAttr& _rhs) const
 VertexAttr* MeshDesc::addVertexAttr(
 	VertexAttr::Semantic _semantic, 
 	DataType             _dataType,
-	uint8                _count
+	uint8                _count,
+	VertexAttr::Encoding _encoding
 	)
 {
 	APT_ASSERT_MSG(findVertexAttr(_semantic) == 0, "MeshDesc: Semantic '%s' already exists", VertexSemanticToStr(_semantic));
@@ -93,6 +336,7 @@ VertexAttr* MeshDesc::addVertexAttr(
 	ret->setSemantic(_semantic);
 	ret->setCount(_count);
 	ret->setDataType(_dataType);
+	ret->setEncoding(_encoding);
 	
  // update vertex size, add padding if required
 	m_vertexSize = ret->getOffset() + ret->getSize();
@@ -133,6 +377,8 @@ uint64 MeshDesc::getHash() const
 {
 	uint64 ret = Hash<uint64>(m_vertexDesc, sizeof(VertexAttr) * m_vertexAttrCount);
 	ret = Hash<uint64>(&m_primitive, 1, ret);
+	ret = Hash<uint64>(&m_positionScale, sizeof(vec3), ret);
+	ret = Hash<uint64>(&m_positionBias, sizeof(vec3), ret);
 	return ret;
 }
 
@@ -146,7 +392,8 @@ bool MeshDesc::operator==(const MeshDesc& _rhs) const
 			return false;
 		}
 	}
-	return m_vertexSize == _rhs.m_vertexSize && m_primitive == _rhs.m_primitive;
+	return m_vertexSize == _rhs.m_vertexSize && m_primitive == _rhs.m_primitive 
+		&& m_positionScale == _rhs.m_positionScale && m_positionBias == _rhs.m_positionBias;
 }
 
 /*******************************************************************************
@@ -162,6 +409,7 @@ MeshData::Submesh::Submesh()
 	, m_indexOffset(0)
 	, m_vertexCount(0)
 	, m_vertexOffset(0)
+	, m_baseVertex(0)
 	, m_materialId(0)
 {
 }
@@ -175,6 +423,13 @@ MeshData* MeshData::Create(const char* _path)
 	MeshData* ret = new MeshData();
 	ret->m_path.set(_path);
 
+ // binary cache is written next to the source file, invalidated if the source data changes
+	uint64  sourceHash = Hash<uint64>(f.getData(), f.getDataSize());
+	PathStr cachePath("%s.bin", f.getPath());
+	if (ReadBin(*ret, (const char*)cachePath, sourceHash)) {
+		return ret;
+	}
+
 	if        (FileSystem::CompareExtension("obj", _path)) {
 		if (!ReadObj(*ret, f.getData(), f.getDataSize())) {
 			goto MeshData_Create_error;
@@ -187,6 +442,7 @@ MeshData* MeshData::Create(const char* _path)
 		APT_ASSERT(false); // unsupported format
 		goto MeshData_Create_error;
 	}
+	WriteBin(*ret, (const char*)cachePath, sourceHash);
 	
 	return ret;
 
@@ -195,6 +451,16 @@ MeshData_Create_error:
 	return nullptr;
 }
 
+MeshData* MeshData::CreateObj(const char* _data, uint _dataSize, bool _reference)
+{
+	MeshData* ret = new MeshData();
+	if (!(_reference ? ReadObjTinyobj(*ret, _data, _dataSize) : ReadObj(*ret, _data, _dataSize))) {
+		delete ret;
+		return nullptr;
+	}
+	return ret;
+}
+
 MeshData* MeshData::Create(
 	const MeshDesc& _desc, 
 	uint            _vertexCount, 
@@ -282,9 +548,7 @@ MeshData* MeshData::CreatePlane(
 	BuildPlane(mesh, _sizeX, _sizeZ, _segsX, _segsZ);
 	
 	mesh.transform(_transform);
-	mesh.m_boundingBox.m_min = mesh.m_vertices.front().m_position;
-	mesh.m_boundingBox.m_max = mesh.m_vertices.back().m_position;
-	mesh.m_boundingSphere = Sphere(mesh.m_boundingBox);
+	mesh.updateBounds();
 
 	return Create(_desc, mesh);
 }
@@ -313,6 +577,133 @@ MeshData* MeshData::CreateSphere(
 	return Create(_desc, mesh);
 }
 
+MeshDesc MeshData::PackDesc(
+	const MeshDesc&    _desc,
+	const MeshBuilder& _meshBuilder,
+	float              _maxPositionError,
+	float              _maxNormalError,
+	float              _maxTexcoordError
+	)
+{
+	MeshDesc ret(_desc.getPrimitive());
+	const uint32 vertexCount = _meshBuilder.getVertexCount();
+	for (int i = 0; i < _desc.getVertexAttrCount(); ++i) {
+		const VertexAttr& attr = _desc[i];
+		switch (attr.getSemantic()) {
+			case VertexAttr::Semantic_Positions: {
+			 // normalized types are relative to the bounding box, the error is half a quantization step on each axis
+				vec3 boxMin(FLT_MAX);
+				vec3 boxMax(-FLT_MAX);
+				for (uint32 j = 0; j < vertexCount; ++j) {
+					MeshBuilder::Vertex vertex;
+					_meshBuilder.loadVertex(j, vertex);
+					boxMin = min(boxMin, vertex.m_position);
+					boxMax = max(boxMax, vertex.m_position);
+				}
+				vec3  boxSize = vertexCount > 0 ? boxMax - boxMin : vec3(0.0f);
+				float maxSize = APT_MAX(boxSize.x, APT_MAX(boxSize.y, boxSize.z));
+				DataType dataType = DataType_Float32;
+				if (maxSize <= 0.0f || length(boxSize * (0.5f / APT_DATA_TYPE_MAX(uint8))) / maxSize <= _maxPositionError) {
+					dataType = DataType_Uint8N;
+				} else if (length(boxSize * (0.5f / APT_DATA_TYPE_MAX(uint16))) / maxSize <= _maxPositionError) {
+					dataType = DataType_Uint16N;
+				}
+				ret.addVertexAttr(VertexAttr::Semantic_Positions, dataType, 3);
+				break;
+			}
+			case VertexAttr::Semantic_Normals:
+			case VertexAttr::Semantic_Tangents: {
+			 // attributes are 4 byte aligned, hence 16 bit octahedral normals are free vs. 8 bit; tangents need a 3rd 
+			 // component for the bitangent sign which fits in 4 bytes only as 8 bit
+				bool isNormal = attr.getSemantic() == VertexAttr::Semantic_Normals;
+				const DataType kCandidates[] = { isNormal ? DataType_Sint16N : DataType_Sint8N, DataType_Sint16N };
+				DataType dataType = DataType_Invalid;
+				for (int j = 0; j < (isNormal ? 1 : 2) && dataType == DataType_Invalid; ++j) {
+					float maxError = 0.0f;
+					for (uint32 k = 0; k < vertexCount && maxError <= _maxNormalError; ++k) {
+						MeshBuilder::Vertex vertex;
+						_meshBuilder.loadVertex(k, vertex);
+						vec3 v = isNormal ? vertex.m_normal : vec3(vertex.m_tangent.x, vertex.m_tangent.y, vertex.m_tangent.z);
+						if (length2(v) > 0.0f) {
+							maxError = APT_MAX(maxError, OctahedralError(normalize(v), kCandidates[j]));
+						}
+					}
+					if (maxError <= _maxNormalError) {
+						dataType = kCandidates[j];
+					}
+				}
+				if (dataType == DataType_Invalid) {
+					ret.addVertexAttr(attr.getSemantic(), DataType_Float32, isNormal ? 3 : 4);
+				} else {
+					ret.addVertexAttr(attr.getSemantic(), dataType, isNormal ? 2 : 3, VertexAttr::Encoding_Octahedral);
+				}
+				break;
+			}
+			case VertexAttr::Semantic_Texcoords: {
+			 // Uint16N if in [0,1] (error is half a quantization step), else Float16 if the error is within the budget
+				bool  isUnorm = true;
+				float maxError = 0.0f;
+				for (uint32 j = 0; j < vertexCount; ++j) {
+					MeshBuilder::Vertex vertex;
+					_meshBuilder.loadVertex(j, vertex);
+					const vec2& t = vertex.m_texcoord;
+					isUnorm &= t.x >= 0.0f && t.x <= 1.0f && t.y >= 0.0f && t.y <= 1.0f;
+					for (int k = 0; k < 2; ++k) {
+						float16 h;
+						float   f;
+						DataTypeConvert(DataType_Float32, DataType_Float16, &t[k], &h);
+						DataTypeConvert(DataType_Float16, DataType_Float32, &h, &f);
+						maxError = APT_MAX(maxError, fabsf(f - t[k]));
+					}
+				}
+				DataType dataType = DataType_Float32;
+				if (isUnorm && 0.5f / APT_DATA_TYPE_MAX(uint16) <= _maxTexcoordError) {
+					dataType = DataType_Uint16N;
+				} else if (maxError <= _maxTexcoordError) {
+					dataType = DataType_Float16;
+				}
+				ret.addVertexAttr(VertexAttr::Semantic_Texcoords, dataType, 2);
+				break;
+			}
+			case VertexAttr::Semantic_Colors: {
+				bool isUnorm = true;
+				for (uint32 j = 0; j < vertexCount && isUnorm; ++j) {
+					MeshBuilder::Vertex vertex;
+					_meshBuilder.loadVertex(j, vertex);
+					const vec4& c = vertex.m_color;
+					for (int k = 0; k < 4; ++k) {
+						isUnorm &= c[k] >= 0.0f && c[k] <= 1.0f;
+					}
+				}
+				ret.addVertexAttr(VertexAttr::Semantic_Colors, isUnorm ? DataType_Uint8N : DataType_Float16, 4);
+				break;
+			}
+			case VertexAttr::Semantic_BoneWeights:
+				ret.addVertexAttr(VertexAttr::Semantic_BoneWeights, DataType_Uint8N, 4);
+				break;
+			case VertexAttr::Semantic_BoneIndices: {
+				uint32 maxIndex = 0;
+				for (uint32 j = 0; j < vertexCount; ++j) {
+					MeshBuilder::Vertex vertex;
+					_meshBuilder.loadVertex(j, vertex);
+					const uvec4& b = vertex.m_boneIndices;
+					maxIndex = APT_MAX(maxIndex, APT_MAX(APT_MAX(b.x, b.y), APT_MAX(b.z, b.w)));
+				}
+				ret.addVertexAttr(VertexAttr::Semantic_BoneIndices, maxIndex <= APT_DATA_TYPE_MAX(uint8) ? DataType_Uint8 : DataType_Uint16, 4);
+				break;
+			}
+			case VertexAttr::Semantic_Padding:
+				break; // added by addVertexAttr() as required
+			default:
+				ret.addVertexAttr(attr.getSemantic(), attr.getDataType(), attr.getCount(), attr.getEncoding());
+				break;
+		};
+	}
+
+	APT_LOG("MeshData: Packed vertex size %u -> %u bytes", (uint)_desc.getVertexSize(), (uint)ret.getVertexSize());
+	return ret;
+}
+
 void MeshData::Destroy(MeshData*& _meshData_)
 {
 	delete _meshData_;
@@ -329,6 +720,9 @@ void frm::swap(MeshData& _a, MeshData& _b)
 	swap(_a.m_indexData,      _b.m_indexData);
 	swap(_a.m_indexDataType,  _b.m_indexDataType);
 	swap(_a.m_submeshes,      _b.m_submeshes);
+	swap(_a.m_lods,           _b.m_lods);
+	swap(_a.m_meshlets,       _b.m_meshlets);
+	swap(_a.m_mappedFile,     _b.m_mappedFile);
 }
 
 void MeshData::setVertexData(const void* _src)
@@ -346,12 +740,39 @@ void MeshData::setVertexData(VertexAttr::Semantic _semantic, DataType _srcType,
 	
 	const VertexAttr* attr = m_desc.findVertexAttr(_semantic);
 	APT_ASSERT(attr);
-	APT_ASSERT(attr->getCount() == _srcCount); // \todo implement count conversion (trim or pad with 0s)
 
 	const char* src = (const char*)_src;
 	char* dst = (char*)m_vertexData;
 	dst += attr->getOffset();
-	if (_srcType == attr->getDataType()) {
+	if (attr->getEncoding() == VertexAttr::Encoding_Octahedral) {
+	 // _src is an unencoded normal (3 components) or tangent (4 components, the bitangent sign in w), see MeshData(MeshBuilder)
+		APT_ASSERT(_srcCount >= 3);
+		for (auto i = 0; i < getVertexCount(); ++i) {
+			vec4 v(0.0f, 0.0f, 0.0f, 1.0f);
+			DataTypeConvert(_srcType, DataType_Float32, src, &v.x, _srcCount);
+			OctahedralEncode(vec3(v.x, v.y, v.z), attr->getDataType(), dst);
+			if (attr->getCount() > 2) {
+				float sign = v.w < 0.0f ? -1.0f : 1.0f;
+				DataTypeConvert(DataType_Float32, attr->getDataType(), &sign, dst + 2 * DataTypeSizeBytes(attr->getDataType()));
+			}
+			src += DataTypeSizeBytes(_srcType) * _srcCount;
+			dst += m_desc.getVertexSize();
+		}
+
+	} else if (_semantic == VertexAttr::Semantic_Positions && m_desc.isPositionQuantized()) {
+	 // quantize relative to the bounding box, see MeshDesc::getPositionScale()
+		APT_ASSERT(attr->getCount() == _srcCount);
+		for (auto i = 0; i < getVertexCount(); ++i) {
+			vec3 p(0.0f);
+			DataTypeConvert(_srcType, DataType_Float32, src, &p.x, APT_MIN(3u, _srcCount));
+			p = (p - m_desc.getPositionBias()) / m_desc.getPositionScale();
+			DataTypeConvert(DataType_Float32, attr->getDataType(), &p.x, dst, APT_MIN(3, (int)attr->getCount()));
+			src += DataTypeSizeBytes(_srcType) * _srcCount;
+			dst += m_desc.getVertexSize();
+		}
+
+	} else if (_srcType == attr->getDataType()) {
+		APT_ASSERT(attr->getCount() == _srcCount); // \todo implement count conversion (trim or pad with 0s)
 	 // type match, copy directly
 		for (auto i = 0; i < getVertexCount(); ++i) {
 			memcpy(dst, src, DataTypeSizeBytes(_srcType) * attr->getCount());
@@ -361,6 +782,7 @@ void MeshData::setVertexData(VertexAttr::Semantic _semantic, DataType _srcType,
 
 	} else {
 	 // type mismatch, convert
+		APT_ASSERT(attr->getCount() == _srcCount);
 		for (auto i = 0; i < getVertexCount(); ++i) {
 			DataTypeConvert(_srcType, attr->getDataType(), src, dst, attr->getCount());
 			src += DataTypeSizeBytes(_srcType) * _srcCount;
@@ -413,6 +835,7 @@ void MeshData::addSubmeshVertexData(const void* _src, uint _vertexCount)
 {
 	APT_ASSERT(!m_submeshes.empty());
 	APT_ASSERT(_src && _vertexCount > 0);
+	releaseMappedFile();
 	uint vertexSize = m_desc.getVertexSize();
 	m_submeshes[0].m_vertexCount += _vertexCount;
 	m_vertexData = (char*)realloc(m_vertexData, vertexSize * m_submeshes[0].m_vertexCount);
@@ -424,6 +847,7 @@ void MeshData::addSubmeshIndexData(const void* _src, uint _indexCount)
 {
 	APT_ASSERT(!m_submeshes.empty());
 	APT_ASSERT(_src && _indexCount > 0);
+	releaseMappedFile();
 	uint indexSize = DataTypeSizeBytes(m_indexDataType);
 	m_submeshes[0].m_indexCount += _indexCount;
 	m_indexData = (char*)realloc(m_indexData, indexSize * m_submeshes[0].m_indexCount);
@@ -447,7 +871,7 @@ uint64 MeshData::getHash() const
 			ret = Hash<uint64>(m_vertexData, m_desc.getVertexSize() * getVertexCount(), ret);
 		}
 		if (m_indexData) {
-			ret = Hash<uint64>(m_indexData, DataTypeSizeBytes(m_indexDataType) * getIndexCount(), ret);
+			ret = Hash<uint64>(m_indexData, DataTypeSizeBytes(m_indexDataType) * getIndexDataCount(), ret);
 		}
 		if (m_bindPose) {
 			for (int i = 0; i < m_bindPose->getBoneCount(); ++i) {
@@ -467,12 +891,182 @@ void MeshData::setBindPose(const Skeleton& _skel)
 	*m_bindPose = _skel;
 }
 
+void MeshData::addLod(const MeshBuilder& _meshBuilder, float _error)
+{
+	APT_ASSERT(_meshBuilder.getVertexCount() == getVertexCount());
+	APT_ASSERT(m_indexData);
+	APT_ASSERT(m_desc.getPrimitive() == MeshDesc::Primitive_Triangles && !hasRebasedIndices()); // call compactIndexData() after addLod()
+	releaseMappedFile();
+
+	uint indexSize = DataTypeSizeBytes(m_indexDataType);
+	Lod lod;
+	lod.m_indexOffset = getIndexDataCount() * indexSize;
+	lod.m_indexCount  = _meshBuilder.getIndexCount();
+	lod.m_error       = _error;
+	m_indexData = (char*)APT_REALLOC(m_indexData, lod.m_indexOffset + lod.m_indexCount * indexSize);
+	DataTypeConvert(DataType_Uint32, m_indexDataType, _meshBuilder.m_triangles.data(), m_indexData + lod.m_indexOffset, lod.m_indexCount);
+	m_lods.push_back(lod);
+}
+
+MeshData::Lod MeshData::getLod(int _i) const
+{
+	APT_ASSERT(_i < getLodCount());
+	if (_i > 0) {
+		return m_lods[_i - 1];
+	}
+	Lod ret;
+	ret.m_indexOffset = 0;
+	ret.m_indexCount  = getIndexCount();
+	ret.m_error       = 0.0f;
+	return ret;
+}
+
+uint MeshData::compactIndexData(bool _strips)
+{
+	if (!m_indexData || m_desc.getPrimitive() != MeshDesc::Primitive_Triangles) {
+		return 0;
+	}
+
+	const uint oldIndexSize  = DataTypeSizeBytes(m_indexDataType);
+	const uint oldIndexCount = getIndexDataCount();
+	eastl::vector<uint32> indices(oldIndexCount);
+	DataTypeConvert(m_indexDataType, DataType_Uint32, m_indexData, indices.data(), oldIndexCount);
+
+ // index ranges in order (submeshes, then LODs), these must be contiguous such that the meshlet offsets are preserved
+	struct Range { uint32 m_begin, m_count, m_oldBaseVertex, m_baseVertex; };
+	eastl::vector<Range> ranges;
+	const uint firstSubmesh = m_submeshes.size() > 1 ? 1 : 0;
+	const uint submeshCount = m_submeshes.size() > 1 ? (uint)m_submeshes.size() - 1 : 1;
+	for (uint i = firstSubmesh; i < m_submeshes.size(); ++i) {
+		const Submesh& submesh = m_submeshes[i];
+		ranges.push_back({ submesh.m_indexOffset / oldIndexSize, submesh.m_indexCount, submesh.m_baseVertex, 0 });
+	}
+	for (auto& lod : m_lods) {
+		ranges.push_back({ lod.m_indexOffset / oldIndexSize, lod.m_indexCount, 0, 0 });
+	}
+	for (uint i = 0, offset = 0; i < ranges.size(); offset += ranges[i].m_count, ++i) {
+		if (ranges[i].m_begin != offset) {
+			APT_LOG_ERR("MeshData::compactIndexData: Index ranges are not contiguous ('%s')", (const char*)m_path);
+			return 0;
+		}
+	}
+
+ // narrow to 16 bits, rebase the submeshes if the whole vertex range doesn't fit (the max value is reserved for the
+ // primitive restart index)
+	DataType dataType = DataType_Uint16;
+	if (getVertexCount() >= APT_DATA_TYPE_MAX(uint16)) {
+		bool rebase = m_lods.empty() && firstSubmesh == 1;
+		for (uint i = 0; rebase && i < submeshCount; ++i) {
+			const Submesh& submesh = m_submeshes[firstSubmesh + i];
+			Range& range = ranges[i];
+			range.m_baseVertex = submesh.m_vertexOffset / m_desc.getVertexSize();
+			rebase = submesh.m_vertexCount < APT_DATA_TYPE_MAX(uint16);
+			for (uint32 j = range.m_begin, n = range.m_begin + range.m_count; rebase && j < n; ++j) {
+				uint32 index = indices[j] + range.m_oldBaseVertex;
+				rebase = index >= range.m_baseVertex && index - range.m_baseVertex < submesh.m_vertexCount;
+			}
+		}
+		if (!rebase) {
+			dataType = DataType_Uint32;
+			for (auto& range : ranges) {
+				range.m_baseVertex = 0;
+			}
+		}
+	}
+	if (DataTypeSizeBytes(dataType) > oldIndexSize) {
+		dataType = m_indexDataType; // already narrower (and hence not rebased)
+	}
+	const uint32 restart  = dataType == DataType_Uint16 ? APT_DATA_TYPE_MAX(uint16) : APT_DATA_TYPE_MAX(uint32);
+	const bool   stripify = _strips && m_meshlets.empty() && (dataType == DataType_Uint16 || dataType == DataType_Uint32);
+
+ // build lists and (optionally) strips per range
+	eastl::vector<uint32> lists, strips;
+	eastl::vector<uint32> listOffsets, stripOffsets;
+	lists.reserve(oldIndexCount);
+	for (auto& range : ranges) {
+		listOffsets.push_back((uint32)lists.size());
+		for (uint32 j = range.m_begin, n = range.m_begin + range.m_count; j < n; ++j) {
+			lists.push_back(indices[j] + range.m_oldBaseVertex - range.m_baseVertex);
+		}
+		if (stripify) {
+			stripOffsets.push_back((uint32)strips.size());
+			Stripify(lists.data() + listOffsets.back(), range.m_count, restart, strips);
+		}
+	}
+	listOffsets.push_back((uint32)lists.size());
+	stripOffsets.push_back((uint32)strips.size());
+	const bool useStrips = stripify && strips.size() < lists.size();
+	const eastl::vector<uint32>& newIndices = useStrips ? strips : lists;
+	const eastl::vector<uint32>& newOffsets = useStrips ? stripOffsets : listOffsets;
+
+	const uint indexSize = DataTypeSizeBytes(dataType);
+	releaseMappedFile();
+	APT_FREE(m_indexData);
+	m_indexData = (char*)APT_MALLOC(newIndices.size() * indexSize);
+	DataTypeConvert(DataType_Uint32, dataType, newIndices.data(), m_indexData, (uint)newIndices.size());
+
+	for (uint i = 0; i < ranges.size(); ++i) {
+		uint offset = newOffsets[i] * indexSize;
+		uint count  = newOffsets[i + 1] - newOffsets[i];
+		if (i < submeshCount) {
+			Submesh& submesh = m_submeshes[firstSubmesh + i];
+			submesh.m_indexOffset = offset;
+			submesh.m_indexCount  = count;
+			submesh.m_baseVertex  = ranges[i].m_baseVertex;
+		} else {
+			Lod& lod = m_lods[i - submeshCount];
+			lod.m_indexOffset = offset;
+			lod.m_indexCount  = count;
+		}
+	}
+	m_submeshes[0].m_indexCount = newOffsets[submeshCount];
+	for (auto& meshlet : m_meshlets) {
+		meshlet.m_indexOffset = meshlet.m_indexOffset / oldIndexSize * indexSize;
+	}
+	m_indexDataType = dataType;
+	if (useStrips) {
+		m_desc.setPrimitive(MeshDesc::Primitive_TriangleStrip);
+	}
+
+	return oldIndexCount * oldIndexSize - (uint)newIndices.size() * indexSize;
+}
+
+bool MeshData::hasRebasedIndices() const
+{
+	for (uint i = 1; i < m_submeshes.size(); ++i) {
+		if (m_submeshes[i].m_baseVertex != 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void MeshData::getTriangles(eastl::vector<uint32>& out_) const
+{
+	out_.clear();
+	if (!m_indexData) {
+		return;
+	}
+	const bool   strips  = m_desc.getPrimitive() == MeshDesc::Primitive_TriangleStrip;
+	const uint32 restart = m_indexDataType == DataType_Uint16 ? APT_DATA_TYPE_MAX(uint16) : APT_DATA_TYPE_MAX(uint32);
+	eastl::vector<uint32> indices;
+	uint firstSubmesh = hasRebasedIndices() ? 1 : 0;
+	uint lastSubmesh  = hasRebasedIndices() ? (uint)m_submeshes.size() : 1;
+	for (uint i = firstSubmesh; i < lastSubmesh; ++i) {
+		const Submesh& submesh = m_submeshes[i];
+		indices.resize(submesh.m_indexCount);
+		DataTypeConvert(m_indexDataType, DataType_Uint32, m_indexData + submesh.m_indexOffset, indices.data(), submesh.m_indexCount);
+		DecodeTriangles(indices.data(), submesh.m_indexCount, strips, restart, submesh.m_baseVertex, out_);
+	}
+}
+
 // PRIVATE
 
 MeshData::MeshData()
 	: m_bindPose(nullptr)
 	, m_vertexData(nullptr)
 	, m_indexData(nullptr)
+	, m_mappedFile(nullptr)
 {
 }
 
@@ -481,6 +1075,7 @@ MeshData::MeshData(const MeshDesc& _desc)
 	, m_bindPose(nullptr)
 	, m_vertexData(nullptr)
 	, m_indexData(nullptr)
+	, m_mappedFile(nullptr)
 {
 	m_submeshes.push_back(Submesh());
 }
@@ -490,6 +1085,7 @@ MeshData::MeshData(const MeshDesc& _desc, const MeshBuilder& _meshBuilder)
 	, m_bindPose(nullptr)
 	, m_vertexData(nullptr)
 	, m_indexData(nullptr)
+	, m_mappedFile(nullptr)
 {
 	const VertexAttr* positionsAttr   = m_desc.findVertexAttr(VertexAttr::Semantic_Positions);
 	const VertexAttr* texcoordsAttr   = m_desc.findVertexAttr(VertexAttr::Semantic_Texcoords);
@@ -498,21 +1094,64 @@ MeshData::MeshData(const MeshDesc& _desc, const MeshBuilder& _meshBuilder)
 	const VertexAttr* colorsAttr      = m_desc.findVertexAttr(VertexAttr::Semantic_Colors);
 	const VertexAttr* boneWeightsAttr = m_desc.findVertexAttr(VertexAttr::Semantic_BoneWeights);
 	const VertexAttr* boneIndicesAttr = m_desc.findVertexAttr(VertexAttr::Semantic_BoneIndices);
+
+ // normalized positions are quantized relative to the bounding box, else the scale/bias is identity
+	vec3 positionScale(1.0f);
+	vec3 positionBias(0.0f);
+	if (positionsAttr && DataTypeIsNormalized(positionsAttr->getDataType()) && _meshBuilder.getVertexCount() > 0) {
+		vec3 boxMin(FLT_MAX);
+		vec3 boxMax(-FLT_MAX);
+		for (uint32 i = 0, n = _meshBuilder.getVertexCount(); i < n; ++i) {
+			MeshBuilder::Vertex vertex;
+			_meshBuilder.loadVertex(i, vertex);
+			boxMin = min(boxMin, vertex.m_position);
+			boxMax = max(boxMax, vertex.m_position);
+		}
+		if (DataTypeIsSigned(positionsAttr->getDataType())) {
+			positionScale = (boxMax - boxMin) * 0.5f;
+			positionBias  = (boxMax + boxMin) * 0.5f;
+		} else {
+			positionScale = boxMax - boxMin;
+			positionBias  = boxMin;
+		}
+		for (int i = 0; i < 3; ++i) {
+			positionScale[i] = positionScale[i] > 0.0f ? positionScale[i] : 1.0f;
+		}
+	}
+	m_desc.setPositionScaleBias(positionScale, positionBias);
+
 	m_vertexData = (char*)APT_MALLOC(m_desc.getVertexSize() * _meshBuilder.getVertexCount());
 	for (uint32 i = 0, n = _meshBuilder.getVertexCount(); i < n; ++i) {
 		char* dst = m_vertexData + i * m_desc.getVertexSize();
-		const MeshBuilder::Vertex& src = _meshBuilder.getVertex(i);
+		MeshBuilder::Vertex src;
+		_meshBuilder.loadVertex(i, src);
 		if (positionsAttr) {
-			DataTypeConvert(DataType_Float32, positionsAttr->getDataType(), &src.m_position, dst + positionsAttr->getOffset(), APT_MIN(3, (int)positionsAttr->getCount()));
+			vec3 position = (src.m_position - positionBias) / positionScale;
+			DataTypeConvert(DataType_Float32, positionsAttr->getDataType(), &position, dst + positionsAttr->getOffset(), APT_MIN(3, (int)positionsAttr->getCount()));
 		}
 		if (texcoordsAttr) {
-			DataTypeConvert(DataType_Float32, texcoordsAttr->getDataType(), &src.m_texcoord, dst + texcoordsAttr->getOffset(), APT_MIN(2, (int)positionsAttr->getCount()));
+			DataTypeConvert(DataType_Float32, texcoordsAttr->getDataType(), &src.m_texcoord, dst + texcoordsAttr->getOffset(), APT_MIN(2, (int)texcoordsAttr->getCount()));
 		}
 		if (normalsAttr) {
-			DataTypeConvert(DataType_Float32, normalsAttr->getDataType(), &src.m_normal, dst + normalsAttr->getOffset(), APT_MIN(3, (int)normalsAttr->getCount()));
+			if (normalsAttr->getEncoding() == VertexAttr::Encoding_Octahedral) {
+				OctahedralEncode(src.m_normal, normalsAttr->getDataType(), dst + normalsAttr->getOffset());
+			} else {
+				DataTypeConvert(DataType_Float32, normalsAttr->getDataType(), &src.m_normal, dst + normalsAttr->getOffset(), APT_MIN(3, (int)normalsAttr->getCount()));
+			}
 		}
 		if (tangentsAttr) {
-			DataTypeConvert(DataType_Float32, tangentsAttr->getDataType(), &src.m_tangent, dst + tangentsAttr->getOffset(), APT_MIN(4, (int)tangentsAttr->getCount()));
+			if (tangentsAttr->getEncoding() == VertexAttr::Encoding_Octahedral) {
+				OctahedralEncode(vec3(src.m_tangent.x, src.m_tangent.y, src.m_tangent.z), tangentsAttr->getDataType(), dst + tangentsAttr->getOffset());
+				if (tangentsAttr->getCount() > 2) {
+					float sign = src.m_tangent.w < 0.0f ? -1.0f : 1.0f;
+					DataTypeConvert(DataType_Float32, tangentsAttr->getDataType(), &sign, dst + tangentsAttr->getOffset() + 2 * DataTypeSizeBytes(tangentsAttr->getDataType()));
+				}
+			} else {
+				DataTypeConvert(DataType_Float32, tangentsAttr->getDataType(), &src.m_tangent, dst + tangentsAttr->getOffset(), APT_MIN(4, (int)tangentsAttr->getCount()));
+			}
+		}
+		if (colorsAttr) {
+			DataTypeConvert(DataType_Float32, colorsAttr->getDataType(), &src.m_color, dst + colorsAttr->getOffset(), APT_MIN(4, (int)colorsAttr->getCount()));
 		}
 		if (boneWeightsAttr) {
 			DataTypeConvert(DataType_Float32, boneWeightsAttr->getDataType(), &src.m_boneWeights, dst + boneWeightsAttr->getOffset(), APT_MIN(4, (int)boneWeightsAttr->getCount()));
@@ -530,8 +1169,9 @@ MeshData::MeshData(const MeshDesc& _desc, const MeshBuilder& _meshBuilder)
 	m_submeshes.push_back(Submesh());
 	m_submeshes.back().m_vertexCount    = _meshBuilder.getVertexCount();
 	m_submeshes.back().m_indexCount     = _meshBuilder.getIndexCount();
-	m_submeshes.back().m_boundingBox    = _meshBuilder.getBoundingBox();
-	m_submeshes.back().m_boundingSphere = _meshBuilder.getBoundingSphere();
+	m_submeshes.back().m_boundingBox         = _meshBuilder.getBoundingBox();
+	m_submeshes.back().m_boundingSphere      = _meshBuilder.getBoundingSphere();
+	m_submeshes.back().m_boundingOrientedBox = _meshBuilder.getBoundingOrientedBox();
 
 	for (auto& submesh : _meshBuilder.m_submeshes) {
 		m_submeshes.push_back(submesh);
@@ -540,6 +1180,41 @@ MeshData::MeshData(const MeshDesc& _desc, const MeshBuilder& _meshBuilder)
 		m_submeshes.back().m_vertexOffset *= _desc.getVertexSize();
 		m_submeshes.back().m_indexOffset  *= DataTypeSizeBytes(m_indexDataType);
 	}
+
+	for (auto& meshlet : _meshBuilder.m_meshlets) {
+		m_meshlets.push_back(meshlet);
+		m_meshlets.back().m_indexOffset *= DataTypeSizeBytes(m_indexDataType);
+		m_meshlets.back().m_submeshId   += _meshBuilder.m_submeshes.empty() ? 0 : 1;
+	}
+}
+
+uint MeshData::getIndexDataCount() const
+{
+	if (m_lods.empty()) {
+		return getIndexCount();
+	}
+	return m_lods.back().m_indexOffset / DataTypeSizeBytes(m_indexDataType) + m_lods.back().m_indexCount;
+}
+
+void MeshData::releaseMappedFile()
+{
+	if (!m_mappedFile) {
+		return;
+	}
+	const char* vertexData = m_vertexData;
+	const char* indexData  = m_indexData;
+	m_vertexData = m_indexData = nullptr;
+	if (vertexData) {
+		uint vertexDataSize = m_desc.getVertexSize() * getVertexCount();
+		m_vertexData = (char*)APT_MALLOC(vertexDataSize);
+		memcpy(m_vertexData, vertexData, vertexDataSize);
+	}
+	if (indexData) {
+		uint indexDataSize = DataTypeSizeBytes(m_indexDataType) * getIndexDataCount();
+		m_indexData = (char*)APT_MALLOC(indexDataSize);
+		memcpy(m_indexData, indexData, indexDataSize);
+	}
+	MappedFile::Destroy(m_mappedFile);
 }
 
 MeshData::~MeshData()
@@ -547,8 +1222,12 @@ MeshData::~MeshData()
 	if (m_bindPose) {
 		delete m_bindPose;
 	}
-	APT_FREE(m_vertexData);
-	APT_FREE(m_indexData);
+	if (m_mappedFile) {
+		MappedFile::Destroy(m_mappedFile);
+	} else {
+		APT_FREE(m_vertexData);
+		APT_FREE(m_indexData);
+	}
 }
 
 void MeshData::updateSubmeshBounds(Submesh& _submesh)
@@ -557,23 +1236,31 @@ void MeshData::updateSubmeshBounds(Submesh& _submesh)
 	APT_ASSERT(posAttr); // no positions
 	
 	const char* data = m_vertexData + posAttr->getOffset() + _submesh.m_vertexOffset;
-	_submesh.m_boundingBox.m_min = vec3(FLT_MAX);
-	_submesh.m_boundingBox.m_max = vec3(-FLT_MAX);
-	for (auto i = 0; i < _submesh.m_vertexCount; ++i) {
-		vec3 v;
-		for (auto j = 0; j < APT_MIN(posAttr->getCount(), (uint8)3); ++j) {
-			DataTypeConvert(
-				posAttr->getDataType(),
-				DataType_Float32,
-				data + j * DataTypeSizeBytes(posAttr->getDataType()) * j,
-				&v[j]
-				);
+	const vec3* positions = (const vec3*)data;
+	uint32      stride    = m_desc.getVertexSize();
+	eastl::vector<vec3> decoded;
+	if (posAttr->getDataType() != DataType_Float32 || posAttr->getCount() < 3 || m_desc.getPositionScale() != vec3(1.0f) || m_desc.getPositionBias() != vec3(0.0f)) {
+	 // decode to a temporary array
+		decoded.resize(_submesh.m_vertexCount);
+		for (auto i = 0; i < _submesh.m_vertexCount; ++i) {
+			vec3 v(0.0f);
+			for (auto j = 0; j < APT_MIN(posAttr->getCount(), (uint8)3); ++j) {
+				DataTypeConvert(
+					posAttr->getDataType(),
+					DataType_Float32,
+					data + j * DataTypeSizeBytes(posAttr->getDataType()),
+					&v[j]
+					);
+			}
+			decoded[i] = v * m_desc.getPositionScale() + m_desc.getPositionBias();
+			data += m_desc.getVertexSize();
 		}
-		_submesh.m_boundingBox.m_min = min(_submesh.m_boundingBox.m_min, v);
-		_submesh.m_boundingBox.m_max = max(_submesh.m_boundingBox.m_max, v);
-		data += m_desc.getVertexSize();
+		positions = decoded.data();
+		stride    = sizeof(vec3);
 	}
-	_submesh.m_boundingSphere = Sphere(_submesh.m_boundingBox);
+	_submesh.m_boundingBox         = BoundingBox(positions, _submesh.m_vertexCount, stride);
+	_submesh.m_boundingSphere      = BoundingSphere(positions, _submesh.m_vertexCount, stride);
+	_submesh.m_boundingOrientedBox = BoundingOrientedBox(positions, _submesh.m_vertexCount, stride);
 }
 
 /*******************************************************************************
@@ -585,127 +1272,1899 @@ void MeshData::updateSubmeshBounds(Submesh& _submesh)
 // PUBLIC
 
 MeshBuilder::MeshBuilder()
-	: m_boundingBox(vec3(FLT_MAX), vec3(-FLT_MAX))
+	: m_layout(Layout_AoS)
+	, m_streamMask(0)
+	, m_streamVertexCount(0)
+	, m_boundingBox(vec3(FLT_MAX), vec3(-FLT_MAX))
 	, m_boundingSphere(vec3(0.0f), FLT_MAX)
+	, m_boundingOrientedBox(AlignedBox(vec3(-FLT_MAX), vec3(FLT_MAX)))
 {
 }
 
-void MeshBuilder::transform(const mat4& _mat)
+void MeshBuilder::setLayout(Layout _layout, uint32 _semanticMask)
 {
-	mat3 nmat = transpose(inverse(mat3(_mat)));
+	_semanticMask &= (1u << VertexAttr::Semantic_Padding) - 1;
+	if (_layout == m_layout && (_layout == Layout_AoS || _semanticMask == m_streamMask)) {
+		return;
+	}
 
-	for (auto vert = m_vertices.begin(); vert != m_vertices.end(); ++vert) {
-		vert->m_position = TransformPosition(_mat, vert->m_position);
-		vert->m_normal   = normalize(nmat * vert->m_normal);
+ // go via a temporary array of Vertex, this is a (rare) conversion so the extra copy doesn't matter
+	eastl::vector<Vertex> vertices;
+	if (m_layout == Layout_AoS) {
+		vertices.swap(m_vertices);
+	} else {
+		vertices.resize(m_streamVertexCount);
+		for (uint32 i = 0; i < m_streamVertexCount; ++i) {
+			loadVertex(i, vertices[i]);
+		}
+		for (int i = 0; i < VertexAttr::Semantic_BoneIndices; ++i) {
+			for (int j = 0; j < 4; ++j) {
+				eastl::vector<float>().swap(m_streams[i][j]);
+			}
+		}
+		for (int j = 0; j < 4; ++j) {
+			eastl::vector<uint32>().swap(m_boneIndexStreams[j]);
+		}
+	}
 
-		vec3 tng = normalize(nmat * vert->m_tangent.xyz());
-		vert->m_tangent = vec4(tng, vert->m_tangent.w);
+	m_layout = _layout;
+	if (_layout == Layout_AoS) {
+		m_vertices.swap(vertices);
+		m_streamMask = 0;
+		m_streamVertexCount = 0;
+	} else {
+		m_streamMask = _semanticMask;
+		setVertexCount((uint32)vertices.size());
+		for (uint32 i = 0; i < m_streamVertexCount; ++i) {
+			storeVertex(i, vertices[i]);
+		}
 	}
 }
 
-void MeshBuilder::transformTexcoords(const mat3& _mat)
+bool MeshBuilder::hasStream(VertexAttr::Semantic _semantic) const
 {
-	for (auto vert = m_vertices.begin(); vert != m_vertices.end(); ++vert) {
-		vert->m_texcoord = TransformPosition(_mat, vert->m_texcoord);
-	}
+	return m_layout == Layout_SoA && (m_streamMask & (1u << _semantic)) != 0;
 }
 
-void MeshBuilder::transformColors(const mat4& _mat)
+float* MeshBuilder::getStream(VertexAttr::Semantic _semantic, int _component)
 {
-	for (auto vert = m_vertices.begin(); vert != m_vertices.end(); ++vert) {
-		vert->m_color = _mat * vert->m_color;
+	APT_ASSERT(hasStream(_semantic) && _semantic < VertexAttr::Semantic_BoneIndices);
+	APT_ASSERT(_component < kStreamComponentCount[_semantic]);
+	return m_streams[_semantic][_component].data();
+}
+
+const float* MeshBuilder::getStream(VertexAttr::Semantic _semantic, int _component) const
+{
+	APT_ASSERT(hasStream(_semantic) && _semantic < VertexAttr::Semantic_BoneIndices);
+	APT_ASSERT(_component < kStreamComponentCount[_semantic]);
+	return m_streams[_semantic][_component].data();
+}
+
+uint32* MeshBuilder::getBoneIndexStream(int _component)
+{
+	APT_ASSERT(hasStream(VertexAttr::Semantic_BoneIndices) && _component < 4);
+	return m_boneIndexStreams[_component].data();
+}
+
+// Stream helpers for Layout_SoA. Each processes 4 vertices per iteration if MeshBuilder_SIMD, the scalar loop handles
+// the remainder.
+
+// (x,y,z) = _mat * (x,y,z) + _translation, optionally normalize the result.
+static void TransformStreams(const mat3& _mat, const vec3& _translation, bool _normalize, float* x_, float* y_, float* z_, uint32 _count)
+{
+	uint32 i = 0;
+#if MeshBuilder_SIMD
+	const __m128 m00 = _mm_set1_ps(_mat[0][0]), m01 = _mm_set1_ps(_mat[0][1]), m02 = _mm_set1_ps(_mat[0][2]);
+	const __m128 m10 = _mm_set1_ps(_mat[1][0]), m11 = _mm_set1_ps(_mat[1][1]), m12 = _mm_set1_ps(_mat[1][2]);
+	const __m128 m20 = _mm_set1_ps(_mat[2][0]), m21 = _mm_set1_ps(_mat[2][1]), m22 = _mm_set1_ps(_mat[2][2]);
+	const __m128 tx  = _mm_set1_ps(_translation.x), ty = _mm_set1_ps(_translation.y), tz = _mm_set1_ps(_translation.z);
+	for (; i + 4 <= _count; i += 4) {
+		__m128 x = _mm_loadu_ps(x_ + i);
+		__m128 y = _mm_loadu_ps(y_ + i);
+		__m128 z = _mm_loadu_ps(z_ + i);
+		__m128 rx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m00, x), _mm_mul_ps(m10, y)), _mm_add_ps(_mm_mul_ps(m20, z), tx));
+		__m128 ry = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m01, x), _mm_mul_ps(m11, y)), _mm_add_ps(_mm_mul_ps(m21, z), ty));
+		__m128 rz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m02, x), _mm_mul_ps(m12, y)), _mm_add_ps(_mm_mul_ps(m22, z), tz));
+		if (_normalize) {
+			__m128 len = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(rx, rx), _mm_mul_ps(ry, ry)), _mm_mul_ps(rz, rz)));
+			rx = _mm_div_ps(rx, len);
+			ry = _mm_div_ps(ry, len);
+			rz = _mm_div_ps(rz, len);
+		}
+		_mm_storeu_ps(x_ + i, rx);
+		_mm_storeu_ps(y_ + i, ry);
+		_mm_storeu_ps(z_ + i, rz);
+	}
+#endif
+	for (; i < _count; ++i) {
+		vec3 v = _mat * vec3(x_[i], y_[i], z_[i]) + _translation;
+		if (_normalize) {
+			v = normalize(v);
+		}
+		x_[i] = v.x;
+		y_[i] = v.y;
+		z_[i] = v.z;
 	}
 }
 
-void MeshBuilder::normalizeBoneWeights()
+// (x,y) = (_mat * (x,y,1)).xy
+static void TransformStreams(const mat3& _mat, float* x_, float* y_, uint32 _count)
 {
-	for (auto vert = m_vertices.begin(); vert != m_vertices.end(); ++vert) {
-		vert->m_boneWeights = normalize(vert->m_boneWeights);
+	uint32 i = 0;
+#if MeshBuilder_SIMD
+	const __m128 m00 = _mm_set1_ps(_mat[0][0]), m01 = _mm_set1_ps(_mat[0][1]);
+	const __m128 m10 = _mm_set1_ps(_mat[1][0]), m11 = _mm_set1_ps(_mat[1][1]);
+	const __m128 m20 = _mm_set1_ps(_mat[2][0]), m21 = _mm_set1_ps(_mat[2][1]);
+	for (; i + 4 <= _count; i += 4) {
+		__m128 x = _mm_loadu_ps(x_ + i);
+		__m128 y = _mm_loadu_ps(y_ + i);
+		_mm_storeu_ps(x_ + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(m00, x), _mm_mul_ps(m10, y)), m20));
+		_mm_storeu_ps(y_ + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(m01, x), _mm_mul_ps(m11, y)), m21));
+	}
+#endif
+	for (; i < _count; ++i) {
+		vec2 v = TransformPosition(_mat, vec2(x_[i], y_[i]));
+		x_[i] = v.x;
+		y_[i] = v.y;
 	}
 }
 
-void MeshBuilder::generateNormals()
+// Normalize the vectors formed by _componentCount (3 or 4) streams.
+static void NormalizeStreams(float* _streams[4], int _componentCount, uint32 _count)
 {
- // zero normals for accumulation
-	for (auto vert = m_vertices.begin(); vert != m_vertices.end(); ++vert) {
-		vert->m_normal = vec3(0.0f);
+	uint32 i = 0;
+#if MeshBuilder_SIMD
+	for (; i + 4 <= _count; i += 4) {
+		__m128 v[4];
+		__m128 len2 = _mm_setzero_ps();
+		for (int j = 0; j < _componentCount; ++j) {
+			v[j] = _mm_loadu_ps(_streams[j] + i);
+			len2 = _mm_add_ps(len2, _mm_mul_ps(v[j], v[j]));
+		}
+		__m128 len = _mm_sqrt_ps(len2);
+		for (int j = 0; j < _componentCount; ++j) {
+			_mm_storeu_ps(_streams[j] + i, _mm_div_ps(v[j], len));
+		}
+	}
+#endif
+	for (; i < _count; ++i) {
+		float len2 = 0.0f;
+		for (int j = 0; j < _componentCount; ++j) {
+			len2 += _streams[j][i] * _streams[j][i];
+		}
+		float len = sqrtf(len2);
+		for (int j = 0; j < _componentCount; ++j) {
+			_streams[j][i] /= len;
+		}
 	}
+}
 
- // generate normals
-	for (auto tri = m_triangles.begin(); tri != m_triangles.end(); ++tri) {
-		Vertex& va = getVertex(tri->a);
-		Vertex& vb = getVertex(tri->b);
-		Vertex& vc = getVertex(tri->c);
+static void MinMaxStream(const float* _stream, uint32 _count, float& min_, float& max_)
+{
+	uint32 i = 0;
+	float mn = FLT_MAX;
+	float mx = -FLT_MAX;
+#if MeshBuilder_SIMD
+	__m128 mn4 = _mm_set1_ps(FLT_MAX);
+	__m128 mx4 = _mm_set1_ps(-FLT_MAX);
+	for (; i + 4 <= _count; i += 4) {
+		__m128 v = _mm_loadu_ps(_stream + i);
+		mn4 = _mm_min_ps(mn4, v);
+		mx4 = _mm_max_ps(mx4, v);
+	}
+	float mnv[4], mxv[4];
+	_mm_storeu_ps(mnv, mn4);
+	_mm_storeu_ps(mxv, mx4);
+	for (int j = 0; j < 4; ++j) {
+		mn = APT_MIN(mn, mnv[j]);
+		mx = APT_MAX(mx, mxv[j]);
+	}
+#endif
+	for (; i < _count; ++i) {
+		mn = APT_MIN(mn, _stream[i]);
+		mx = APT_MAX(mx, _stream[i]);
+	}
+	min_ = mn;
+	max_ = mx;
+}
 
-		vec3 ab = vb.m_position - va.m_position;
-		vec3 ac = vc.m_position - va.m_position;
-		vec3 n = cross(ab, ac);
+void MeshBuilder::transform(const mat4& _mat)
+{
+	mat3 nmat = transpose(inverse(mat3(_mat)));
 
-		va.m_normal += n;
-		vb.m_normal += n;
-		vc.m_normal += n;
+	if (m_layout == Layout_SoA) {
+		if (hasStream(VertexAttr::Semantic_Positions)) {
+			TransformStreams(mat3(_mat), vec3(_mat[3].x, _mat[3].y, _mat[3].z), false, getStream(VertexAttr::Semantic_Positions, 0), getStream(VertexAttr::Semantic_Positions, 1), getStream(VertexAttr::Semantic_Positions, 2), m_streamVertexCount);
+		}
+		if (hasStream(VertexAttr::Semantic_Normals)) {
+			TransformStreams(nmat, vec3(0.0f), true, getStream(VertexAttr::Semantic_Normals, 0), getStream(VertexAttr::Semantic_Normals, 1), getStream(VertexAttr::Semantic_Normals, 2), m_streamVertexCount);
+		}
+		if (hasStream(VertexAttr::Semantic_Tangents)) {
+			TransformStreams(nmat, vec3(0.0f), true, getStream(VertexAttr::Semantic_Tangents, 0), getStream(VertexAttr::Semantic_Tangents, 1), getStream(VertexAttr::Semantic_Tangents, 2), m_streamVertexCount);
+		}
+		return;
 	}
 
- // normalize results
 	for (auto vert = m_vertices.begin(); vert != m_vertices.end(); ++vert) {
-		vert->m_normal = normalize(vert->m_normal);
+		vert->m_position = TransformPosition(_mat, vert->m_position);
+		vert->m_normal   = normalize(nmat * vert->m_normal);
+
+		vec3 tng = normalize(nmat * vert->m_tangent.xyz());
+		vert->m_tangent = vec4(tng, vert->m_tangent.w);
 	}
 }
 
-void MeshBuilder::generateTangents()
+void MeshBuilder::transformTexcoords(const mat3& _mat)
 {
- // zero tangents for accumulation
-	for (auto vert = m_vertices.begin(); vert != m_vertices.end(); ++vert) {
-		vert->m_tangent = vec4(0.0f);
-	}
-
- // generate normals
-	for (auto tri = m_triangles.begin(); tri != m_triangles.end(); ++tri) {
-		Vertex& va = getVertex(tri->a);
-		Vertex& vb = getVertex(tri->b);
-		Vertex& vc = getVertex(tri->c);
-
-		vec3 pab = vb.m_position - va.m_position;
-		vec3 pac = vc.m_position - va.m_position;
-		vec2 tab = vb.m_texcoord - va.m_texcoord;
-		vec2 tac = vc.m_texcoord - va.m_texcoord;
-		vec4 t(
-			tac.y * pab.x - tab.y * pac.x,
-			tac.y * pab.y - tab.y * pac.y,
-			tac.y * pab.z - tab.y * pac.z,
-			0.0f
-			);
-		t /= (tab.x * tac.y - tab.y * tac.x);
-
-		va.m_tangent += t;
-		vb.m_tangent += t;
-		vc.m_tangent += t;
+	if (m_layout == Layout_SoA) {
+		if (hasStream(VertexAttr::Semantic_Texcoords)) {
+			TransformStreams(_mat, getStream(VertexAttr::Semantic_Texcoords, 0), getStream(VertexAttr::Semantic_Texcoords, 1), m_streamVertexCount);
+		}
+		return;
 	}
 
- // normalize results
 	for (auto vert = m_vertices.begin(); vert != m_vertices.end(); ++vert) {
-		vert->m_tangent = normalize(vert->m_tangent);
-		vert->m_tangent.w = 1.0f;
+		vert->m_texcoord = TransformPosition(_mat, vert->m_texcoord);
 	}
 }
 
-void MeshBuilder::updateBounds()
+void MeshBuilder::transformColors(const mat4& _mat)
 {
-	if (m_vertices.empty()) {
+	if (m_layout == Layout_SoA) {
+		if (hasStream(VertexAttr::Semantic_Colors)) {
+			eastl::vector<float>* streams = m_streams[VertexAttr::Semantic_Colors];
+			for (uint32 i = 0; i < m_streamVertexCount; ++i) {
+				vec4 c = _mat * vec4(streams[0][i], streams[1][i], streams[2][i], streams[3][i]);
+				for (int j = 0; j < 4; ++j) {
+					streams[j][i] = c[j];
+				}
+			}
+		}
 		return;
 	}
-	m_boundingBox.m_min = m_boundingBox.m_max = m_vertices[0].m_position;
-	for (auto vert = m_vertices.begin() + 1; vert != m_vertices.end(); ++vert) {
-		m_boundingBox.m_min = min(m_boundingBox.m_min, vert->m_position);
-		m_boundingBox.m_max = max(m_boundingBox.m_max, vert->m_position);
+
+	for (auto vert = m_vertices.begin(); vert != m_vertices.end(); ++vert) {
+		vert->m_color = _mat * vert->m_color;
 	}
-	m_boundingSphere = Sphere(m_boundingBox);
 }
 
-uint32 MeshBuilder::addTriangle(uint32 _a, uint32 _b, uint32 _c)
+void MeshBuilder::normalizeBoneWeights()
 {
-	return addTriangle(Triangle(_a, _b, _c));
-}
+	if (m_layout == Layout_SoA) {
+		if (hasStream(VertexAttr::Semantic_BoneWeights)) {
+			float* streams[4];
+			for (int i = 0; i < 4; ++i) {
+				streams[i] = getStream(VertexAttr::Semantic_BoneWeights, i);
+			}
+			NormalizeStreams(streams, 4, m_streamVertexCount);
+		}
+		return;
+	}
+
+	for (auto vert = m_vertices.begin(); vert != m_vertices.end(); ++vert) {
+		vert->m_boneWeights = normalize(vert->m_boneWeights);
+	}
+}
+
+// Grain size for the per-triangle/per-vertex loops in generateNormals()/generateTangents(), a multiple of 4 such that 
+// the SIMD/scalar split is the same for every chunk.
+static const uint32 kGenerateGrainSize = 64 * 1024;
+
+void MeshBuilder::generateNormals()
+{
+	APT_AUTOTIMER("MeshBuilder::generateNormals");
+
+	const uint32 triangleCount = getTriangleCount();
+	const uint32 vertexCount   = getVertexCount();
+	eastl::vector<uint32> offsets, corners;
+	GetVertexCorners(m_triangles.data(), triangleCount, vertexCount, offsets, corners);
+
+ // per-triangle (unnormalized) face normals
+	eastl::vector<vec3> faceNormals(triangleCount);
+	if (m_layout == Layout_SoA) {
+		APT_ASSERT(hasStream(VertexAttr::Semantic_Positions) && hasStream(VertexAttr::Semantic_Normals));
+		const float* px = getStream(VertexAttr::Semantic_Positions, 0);
+		const float* py = getStream(VertexAttr::Semantic_Positions, 1);
+		const float* pz = getStream(VertexAttr::Semantic_Positions, 2);
+		ParallelFor(triangleCount, kGenerateGrainSize, [&](uint32 _begin, uint32 _end)
+			{
+			 // 4 triangles at a time, gather from the position streams
+				uint32 i = _begin;
+			#if MeshBuilder_SIMD
+				for (; i + 4 <= _end; i += 4) {
+					const Triangle* t = &m_triangles[i];
+					#define MeshBuilder_GATHER(_stream, _v) _mm_setr_ps(_stream[t[0]._v], _stream[t[1]._v], _stream[t[2]._v], _stream[t[3]._v])
+					__m128 ax = MeshBuilder_GATHER(px, a), ay = MeshBuilder_GATHER(py, a), az = MeshBuilder_GATHER(pz, a);
+					__m128 abx = _mm_sub_ps(MeshBuilder_GATHER(px, b), ax), aby = _mm_sub_ps(MeshBuilder_GATHER(py, b), ay), abz = _mm_sub_ps(MeshBuilder_GATHER(pz, b), az);
+					__m128 acx = _mm_sub_ps(MeshBuilder_GATHER(px, c), ax), acy = _mm_sub_ps(MeshBuilder_GATHER(py, c), ay), acz = _mm_sub_ps(MeshBuilder_GATHER(pz, c), az);
+					#undef MeshBuilder_GATHER
+					float fn[3][4];
+					_mm_storeu_ps(fn[0], _mm_sub_ps(_mm_mul_ps(aby, acz), _mm_mul_ps(abz, acy)));
+					_mm_storeu_ps(fn[1], _mm_sub_ps(_mm_mul_ps(abz, acx), _mm_mul_ps(abx, acz)));
+					_mm_storeu_ps(fn[2], _mm_sub_ps(_mm_mul_ps(abx, acy), _mm_mul_ps(aby, acx)));
+					for (int j = 0; j < 4; ++j) {
+						faceNormals[i + j] = vec3(fn[0][j], fn[1][j], fn[2][j]);
+					}
+				}
+			#endif
+				for (; i < _end; ++i) {
+					const Triangle& t = m_triangles[i];
+					vec3 a(px[t.a], py[t.a], pz[t.a]);
+					faceNormals[i] = cross(vec3(px[t.b], py[t.b], pz[t.b]) - a, vec3(px[t.c], py[t.c], pz[t.c]) - a);
+				}
+			});
+
+		float* n[4] = { getStream(VertexAttr::Semantic_Normals, 0), getStream(VertexAttr::Semantic_Normals, 1), getStream(VertexAttr::Semantic_Normals, 2), nullptr };
+		ParallelFor(vertexCount, kGenerateGrainSize, [&](uint32 _begin, uint32 _end)
+			{
+				for (uint32 i = _begin; i < _end; ++i) {
+					vec3 sum(0.0f);
+					for (uint32 j = offsets[i]; j < offsets[i + 1]; ++j) {
+						sum += faceNormals[corners[j] / 3];
+					}
+					for (int k = 0; k < 3; ++k) {
+						n[k][i] = sum[k];
+					}
+				}
+				float* chunk[4] = { n[0] + _begin, n[1] + _begin, n[2] + _begin, nullptr };
+				NormalizeStreams(chunk, 3, _end - _begin);
+			});
+		return;
+	}
+
+	ParallelFor(triangleCount, kGenerateGrainSize, [&](uint32 _begin, uint32 _end)
+		{
+			for (uint32 i = _begin; i < _end; ++i) {
+				const Triangle& tri = m_triangles[i];
+				const vec3& a = m_vertices[tri.a].m_position;
+				faceNormals[i] = cross(m_vertices[tri.b].m_position - a, m_vertices[tri.c].m_position - a);
+			}
+		});
+
+ // accumulate + normalize per vertex
+	ParallelFor(vertexCount, kGenerateGrainSize, [&](uint32 _begin, uint32 _end)
+		{
+			for (uint32 i = _begin; i < _end; ++i) {
+				vec3 sum(0.0f);
+				for (uint32 j = offsets[i]; j < offsets[i + 1]; ++j) {
+					sum += faceNormals[corners[j] / 3];
+				}
+				m_vertices[i].m_normal = normalize(sum);
+			}
+		});
+}
+
+void MeshBuilder::generateTangents(bool _mikkTSpace)
+{
+	APT_AUTOTIMER("MeshBuilder::generateTangents");
+	APT_ASSERT(m_layout == Layout_AoS);
+
+	const uint32 triangleCount = getTriangleCount();
+	uint32       vertexCount   = getVertexCount();
+	eastl::vector<uint32> offsets, corners;
+	GetVertexCorners(m_triangles.data(), triangleCount, vertexCount, offsets, corners);
+
+	if (!_mikkTSpace) {
+	 // per-triangle tangents, scaled by the inverse texcoord area
+		eastl::vector<vec3> faceTangents(triangleCount);
+		ParallelFor(triangleCount, kGenerateGrainSize, [&](uint32 _begin, uint32 _end)
+			{
+				for (uint32 i = _begin; i < _end; ++i) {
+					const Vertex& va = m_vertices[m_triangles[i].a];
+					const Vertex& vb = m_vertices[m_triangles[i].b];
+					const Vertex& vc = m_vertices[m_triangles[i].c];
+					vec3 pab = vb.m_position - va.m_position;
+					vec3 pac = vc.m_position - va.m_position;
+					vec2 tab = vb.m_texcoord - va.m_texcoord;
+					vec2 tac = vc.m_texcoord - va.m_texcoord;
+					vec3 t(
+						tac.y * pab.x - tab.y * pac.x,
+						tac.y * pab.y - tab.y * pac.y,
+						tac.y * pab.z - tab.y * pac.z
+						);
+					faceTangents[i] = t / (tab.x * tac.y - tab.y * tac.x);
+				}
+			});
+
+		ParallelFor(vertexCount, kGenerateGrainSize, [&](uint32 _begin, uint32 _end)
+			{
+				for (uint32 i = _begin; i < _end; ++i) {
+					vec3 sum(0.0f);
+					for (uint32 j = offsets[i]; j < offsets[i + 1]; ++j) {
+						sum += faceTangents[corners[j] / 3];
+					}
+					m_vertices[i].m_tangent = vec4(normalize(sum), 1.0f);
+				}
+			});
+		return;
+	}
+
+ // MikkTSpace: per-triangle unit tangent (flipped for triangles with mirrored texcoords) + orientation flag
+	eastl::vector<vec4> faceTangents(triangleCount); // w = 1 if orientation preserving, -1 otherwise, 0 if degenerate
+	ParallelFor(triangleCount, kGenerateGrainSize, [&](uint32 _begin, uint32 _end)
+		{
+			for (uint32 i = _begin; i < _end; ++i) {
+				const Vertex& va = m_vertices[m_triangles[i].a];
+				const Vertex& vb = m_vertices[m_triangles[i].b];
+				const Vertex& vc = m_vertices[m_triangles[i].c];
+				vec3 d1 = vb.m_position - va.m_position;
+				vec3 d2 = vc.m_position - va.m_position;
+				vec2 t21 = vb.m_texcoord - va.m_texcoord;
+				vec2 t31 = vc.m_texcoord - va.m_texcoord;
+				float signedArea = t21.x * t31.y - t21.y * t31.x;
+				vec3  os = t31.y * d1 - t21.y * d2;
+				float len = length(os);
+				faceTangents[i] = vec4(0.0f);
+				if (signedArea != 0.0f && len > 0.0f) {
+					float sign = signedArea > 0.0f ? 1.0f : -1.0f;
+					faceTangents[i] = vec4(os * (sign / len), sign);
+				}
+			}
+		});
+
+ // split vertices shared by faces with different orientations (bitangent sign discontinuities, e.g. at mirrored UV
+ // seams), the copy is inserted after the original such that the submesh vertex ranges stay contiguous; corners of
+ // faces which aren't orientation preserving are moved to the copy
+	eastl::vector<uint8> split(vertexCount, 0);
+	ParallelFor(vertexCount, kGenerateGrainSize, [&](uint32 _begin, uint32 _end)
+		{
+			for (uint32 i = _begin; i < _end; ++i) {
+				bool orientation[2] = { false, false }; // [0] = orientation preserving
+				for (uint32 j = offsets[i]; j < offsets[i + 1]; ++j) {
+					const float w = faceTangents[corners[j] / 3].w;
+					orientation[0] |= w > 0.0f;
+					orientation[1] |= w < 0.0f;
+				}
+				split[i] = orientation[0] && orientation[1] ? 1 : 0;
+			}
+		});
+	eastl::vector<uint32> newIndex(vertexCount + 1);
+	newIndex[0] = 0;
+	for (uint32 i = 0; i < vertexCount; ++i) {
+		newIndex[i + 1] = newIndex[i] + 1 + split[i];
+	}
+	if (newIndex[vertexCount] != vertexCount) {
+		eastl::vector<Vertex> vertices(newIndex[vertexCount]);
+		for (uint32 i = 0; i < vertexCount; ++i) {
+			vertices[newIndex[i]] = m_vertices[i];
+			if (split[i]) {
+				vertices[newIndex[i] + 1] = m_vertices[i];
+			}
+		}
+		m_vertices.swap(vertices);
+		for (uint32 i = 0; i < triangleCount; ++i) {
+			const uint32 mirrored = faceTangents[i].w < 0.0f ? 1 : 0;
+			for (int j = 0; j < 3; ++j) {
+				const uint32 v = m_triangles[i][j];
+				m_triangles[i][j] = newIndex[v] + (split[v] & mirrored);
+			}
+		}
+		for (auto& submesh : m_submeshes) {
+			const uint32 vertexEnd = submesh.m_vertexOffset + submesh.m_vertexCount;
+			submesh.m_vertexOffset = newIndex[submesh.m_vertexOffset];
+			submesh.m_vertexCount  = newIndex[vertexEnd] - submesh.m_vertexOffset;
+		}
+		m_meshlets.clear();
+		vertexCount = getVertexCount();
+		GetVertexCorners(m_triangles.data(), triangleCount, vertexCount, offsets, corners);
+	}
+
+ // per corner, project the face tangent onto the plane of the vertex normal and weight by the corner angle; after the
+ // split the valid faces of each vertex have the same orientation, which determines the bitangent sign
+	ParallelFor(vertexCount, kGenerateGrainSize, [&](uint32 _begin, uint32 _end)
+		{
+			for (uint32 i = _begin; i < _end; ++i) {
+				const vec3 n = normalize(m_vertices[i].m_normal);
+				vec3  sum[2]    = { vec3(0.0f), vec3(0.0f) }; // [0] = orientation preserving
+				float weight[2] = { 0.0f, 0.0f };
+				for (uint32 j = offsets[i]; j < offsets[i + 1]; ++j) {
+					const uint32 tri    = corners[j] / 3;
+					const uint32 corner = corners[j] % 3;
+					const vec4&  ft     = faceTangents[tri];
+					if (ft.w == 0.0f) {
+						continue;
+					}
+					vec3 t = ft.xyz() - n * dot(n, ft.xyz());
+					float tlen = length(t);
+					if (tlen == 0.0f) {
+						continue;
+					}
+					const vec3& p0 = m_vertices[i].m_position;
+					const vec3& p1 = m_vertices[m_triangles[tri][(corner + 1) % 3]].m_position;
+					const vec3& p2 = m_vertices[m_triangles[tri][(corner + 2) % 3]].m_position;
+					vec3 e1 = (p1 - p0) - n * dot(n, p1 - p0);
+					vec3 e2 = (p2 - p0) - n * dot(n, p2 - p0);
+					float elen = length(e1) * length(e2);
+					if (elen == 0.0f) {
+						continue;
+					}
+					float angle = acosf(APT_CLAMP(dot(e1, e2) / elen, -1.0f, 1.0f));
+					int k = ft.w > 0.0f ? 0 : 1;
+					sum[k]    += t * (angle / tlen);
+					weight[k] += angle;
+				}
+				int k = weight[1] > weight[0] ? 1 : 0;
+				vec3 t = sum[k];
+				if (weight[k] == 0.0f) {
+				 // no valid faces, any vector orthogonal to the normal
+					t = cross(n, fabsf(n.x) < 0.9f ? vec3(1.0f, 0.0f, 0.0f) : vec3(0.0f, 1.0f, 0.0f));
+				}
+				m_vertices[i].m_tangent = vec4(normalize(t), k == 0 ? 1.0f : -1.0f);
+			}
+		});
+}
+
+void MeshBuilder::updateBounds()
+{
+	if (getVertexCount() == 0) {
+		return;
+	}
+	computeBounds(0, getVertexCount(), m_boundingBox, m_boundingSphere, m_boundingOrientedBox);
+}
+
+// Spatial hash cell, vertices are only merged within a submesh so the submesh index is part of the key.
+struct WeldCell
+{
+	sint64 x, y, z;
+	uint32 submesh;
+
+	bool operator==(const WeldCell& _rhs) const { return x == _rhs.x && y == _rhs.y && z == _rhs.z && submesh == _rhs.submesh; }
+};
+
+static inline uint32 HashWeldCell(const WeldCell& _cell)
+{
+	uint64 h = (uint64)_cell.x * 73856093ull ^ (uint64)_cell.y * 19349663ull ^ (uint64)_cell.z * 83492791ull ^ (uint64)_cell.submesh * 2654435761ull;
+	return (uint32)(h ^ (h >> 32));
+}
+
+static bool WeldCompatible(const MeshBuilder::Vertex& _a, const MeshBuilder::Vertex& _b, const float* _epsilon)
+{
+	#define WeldCompatible_TEST(_semantic, _member) \
+		if (_epsilon[VertexAttr::_semantic] >= 0.0f && length2(_a._member - _b._member) > _epsilon[VertexAttr::_semantic] * _epsilon[VertexAttr::_semantic]) { \
+			return false; \
+		}
+	WeldCompatible_TEST(Semantic_Positions,   m_position);
+	WeldCompatible_TEST(Semantic_Texcoords,   m_texcoord);
+	WeldCompatible_TEST(Semantic_Normals,     m_normal);
+	WeldCompatible_TEST(Semantic_Tangents,    m_tangent);
+	WeldCompatible_TEST(Semantic_Colors,      m_color);
+	WeldCompatible_TEST(Semantic_BoneWeights, m_boneWeights);
+	#undef WeldCompatible_TEST
+	if (_epsilon[VertexAttr::Semantic_BoneIndices] >= 0.0f && _a.m_boneIndices != _b.m_boneIndices) {
+		return false;
+	}
+	return true;
+}
+
+uint32 MeshBuilder::weld(const float* _epsilon)
+{
+	APT_AUTOTIMER("MeshBuilder::weld");
+	APT_ASSERT(m_layout == Layout_AoS);
+
+	const uint32 vertexCount = getVertexCount();
+	if (vertexCount == 0) {
+		return 0;
+	}
+	float epsilon[VertexAttr::Semantic_Padding] = {};
+	if (_epsilon) {
+		memcpy(epsilon, _epsilon, sizeof(epsilon));
+	}
+
+ // cell size is the position epsilon such that matches are in the 27 adjacent cells; for an exact match (or if 
+ // positions are ignored) use a coarse grid and search only the vertex's own cell
+	vec3 boxMin(FLT_MAX), boxMax(-FLT_MAX);
+	for (auto& vertex : m_vertices) {
+		boxMin = min(boxMin, vertex.m_position);
+		boxMax = max(boxMax, vertex.m_position);
+	}
+	const bool  searchAdjacent = epsilon[VertexAttr::Semantic_Positions] > 0.0f;
+	const float maxExtent = APT_MAX(boxMax.x - boxMin.x, APT_MAX(boxMax.y - boxMin.y, boxMax.z - boxMin.z));
+	float cellSize = searchAdjacent ? epsilon[VertexAttr::Semantic_Positions] : maxExtent / 1024.0f;
+	cellSize = APT_MAX(cellSize, maxExtent * 1e-7f); // limit the cell coordinate range
+	cellSize = cellSize > 0.0f ? cellSize : 1.0f;
+	const bool hashPositions = epsilon[VertexAttr::Semantic_Positions] >= 0.0f;
+
+	eastl::vector<uint32> vertexSubmesh(vertexCount, m_submeshes.empty() ? 0 : ~0u);
+	for (uint32 i = 0; i < (uint32)m_submeshes.size(); ++i) {
+		for (uint32 j = m_submeshes[i].m_vertexOffset, n = j + m_submeshes[i].m_vertexCount; j < n; ++j) {
+			vertexSubmesh[j] = i;
+		}
+	}
+	auto GetCell = [&](uint32 _i) -> WeldCell
+		{
+			WeldCell ret = { 0, 0, 0, vertexSubmesh[_i] };
+			if (hashPositions) {
+				vec3 p = (m_vertices[_i].m_position - boxMin) / cellSize;
+				ret.x = (sint64)floorf(p.x);
+				ret.y = (sint64)floorf(p.y);
+				ret.z = (sint64)floorf(p.z);
+			}
+			return ret;
+		};
+
+ // open addressing table of unique cells, then bucket the vertices per cell (counting sort)
+	uint32 tableSize = 1;
+	while (tableSize < vertexCount * 2) {
+		tableSize *= 2;
+	}
+	eastl::vector<WeldCell> cells;
+	eastl::vector<uint32>   table(tableSize, ~0u);
+	eastl::vector<uint32>   vertexCell(vertexCount);
+	auto FindCell = [&](const WeldCell& _cell) -> uint32&
+		{
+			uint32 slot = HashWeldCell(_cell) & (tableSize - 1);
+			while (table[slot] != ~0u && !(cells[table[slot]] == _cell)) {
+				slot = (slot + 1) & (tableSize - 1);
+			}
+			return table[slot];
+		};
+	for (uint32 i = 0; i < vertexCount; ++i) {
+		WeldCell cell = GetCell(i);
+		uint32& entry = FindCell(cell);
+		if (entry == ~0u) {
+			entry = (uint32)cells.size();
+			cells.push_back(cell);
+		}
+		vertexCell[i] = entry;
+	}
+	eastl::vector<uint32> cellOffsets(cells.size() + 1, 0);
+	for (uint32 i = 0; i < vertexCount; ++i) {
+		++cellOffsets[vertexCell[i] + 1];
+	}
+	for (uint32 i = 1; i < (uint32)cellOffsets.size(); ++i) {
+		cellOffsets[i] += cellOffsets[i - 1];
+	}
+	eastl::vector<uint32> cellVertices(vertexCount);
+	{	eastl::vector<uint32> cursor(cellOffsets.begin(), cellOffsets.end() - 1);
+		for (uint32 i = 0; i < vertexCount; ++i) { // vertices are in ascending order within each cell
+			cellVertices[cursor[vertexCell[i]]++] = i;
+		}
+	}
+
+ // for each vertex find the lowest indexed compatible vertex; this only reads shared data so can be done in parallel
+	eastl::vector<uint32> match(vertexCount);
+	auto FindMatches = [&](uint32 _begin, uint32 _end)
+		{
+			for (uint32 i = _begin; i < _end; ++i) {
+				const Vertex& vertex = m_vertices[i];
+				const WeldCell cell = GetCell(i);
+				uint32 best = i;
+				const sint64 r = searchAdjacent ? 1 : 0;
+				for (sint64 z = cell.z - r; z <= cell.z + r; ++z) {
+					for (sint64 y = cell.y - r; y <= cell.y + r; ++y) {
+						for (sint64 x = cell.x - r; x <= cell.x + r; ++x) {
+							WeldCell neighbor = { x, y, z, cell.submesh };
+							uint32 c = FindCell(neighbor);
+							if (c == ~0u) {
+								continue;
+							}
+							for (uint32 j = cellOffsets[c]; j < cellOffsets[c + 1]; ++j) {
+								uint32 candidate = cellVertices[j];
+								if (candidate >= best) {
+									break; // ascending order
+								}
+								if (WeldCompatible(vertex, m_vertices[candidate], epsilon)) {
+									best = candidate;
+									break;
+								}
+							}
+						}
+					}
+				}
+				match[i] = best;
+			}
+		};
+	const uint32 kParallelThreshold = 1024 * 1024;
+	if (vertexCount > kParallelThreshold) {
+		ParallelFor(vertexCount, 16 * 1024, FindMatches);
+	} else {
+		FindMatches(0, vertexCount);
+	}
+
+ // resolve chains in index order (match[i] <= i, hence the target is already resolved), then compact the vertices 
+ // per submesh (compatibility isn't transitive, hence the result depends on the vertex order)
+	eastl::vector<uint32> remap(vertexCount);
+	for (uint32 i = 0; i < vertexCount; ++i) {
+		remap[i] = match[i] == i ? i : remap[match[i]];
+	}
+	eastl::vector<uint32> newIndex(vertexCount, ~0u);
+	eastl::vector<Vertex> vertices;
+	vertices.reserve(vertexCount);
+	auto CompactRange = [&](uint32 _vertexOffset, uint32 _vertexCount)
+		{
+			for (uint32 i = _vertexOffset, n = _vertexOffset + _vertexCount; i < n; ++i) {
+				if (remap[i] == i) {
+					newIndex[i] = (uint32)vertices.size();
+					vertices.push_back(m_vertices[i]);
+				}
+			}
+		};
+	if (m_submeshes.empty()) {
+		CompactRange(0, vertexCount);
+	} else {
+		uint32 covered = 0;
+		for (auto& submesh : m_submeshes) {
+			uint32 offset = (uint32)vertices.size();
+			CompactRange(submesh.m_vertexOffset, submesh.m_vertexCount);
+			covered += submesh.m_vertexCount;
+			submesh.m_vertexOffset = offset;
+			submesh.m_vertexCount  = (uint32)vertices.size() - offset;
+		}
+		if (covered < vertexCount) { // vertices not in any submesh
+			for (uint32 i = 0; i < vertexCount; ++i) {
+				if (remap[i] == i && newIndex[i] == ~0u) {
+					newIndex[i] = (uint32)vertices.size();
+					vertices.push_back(m_vertices[i]);
+				}
+			}
+		}
+	}
+	const uint32 ret = vertexCount - (uint32)vertices.size();
+	m_vertices.swap(vertices);
+
+ // remap triangles, remove degenerates
+	auto CompactTriangles = [&](uint32 _triangleOffset, uint32 _triangleCount, uint32 _dst) -> uint32
+		{
+			for (uint32 i = _triangleOffset, n = _triangleOffset + _triangleCount; i < n; ++i) {
+				Triangle tri = m_triangles[i];
+				for (int j = 0; j < 3; ++j) {
+					tri[j] = newIndex[remap[tri[j]]];
+				}
+				if (tri.a != tri.b && tri.b != tri.c && tri.c != tri.a) {
+					m_triangles[_dst++] = tri;
+				}
+			}
+			return _dst;
+		};
+	uint32 triangleCount = 0;
+	if (m_submeshes.empty()) {
+		triangleCount = CompactTriangles(0, getTriangleCount(), 0);
+	} else {
+		for (auto& submesh : m_submeshes) {
+			uint32 offset = triangleCount;
+			triangleCount = CompactTriangles(submesh.m_indexOffset / 3, submesh.m_indexCount / 3, triangleCount);
+			submesh.m_indexOffset = offset * 3;
+			submesh.m_indexCount  = (triangleCount - offset) * 3;
+		}
+	}
+	m_triangles.resize(triangleCount);
+	m_meshlets.clear();
+
+	return ret;
+}
+
+// Simulate a FIFO post-transform cache with _cacheSize entries, return the number of vertex transforms. Vertex indices
+// must be in [_vertexOffset, _vertexOffset + _vertexCount).
+static uint32 SimulateVertexCache(const MeshBuilder::Triangle* _triangles, uint32 _triangleCount, uint32 _vertexOffset, uint32 _vertexCount, uint _cacheSize, uint32* uniqueVertexCount_ = nullptr)
+{
+ // a vertex is in the cache if fewer than _cacheSize misses occurred since it was last loaded
+	eastl::vector<uint32> cacheTime(_vertexCount, 0);
+	uint32 time = _cacheSize + 1;
+	uint32 ret = 0;
+	uint32 uniqueVertexCount = 0;
+	for (uint32 i = 0; i < _triangleCount; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			uint32 v = _triangles[i][j] - _vertexOffset;
+			if (cacheTime[v] == 0) {
+				++uniqueVertexCount;
+			}
+			if (time - cacheTime[v] > _cacheSize) {
+				cacheTime[v] = time++;
+				++ret;
+			}
+		}
+	}
+	if (uniqueVertexCount_) {
+		*uniqueVertexCount_ = uniqueVertexCount;
+	}
+	return ret;
+}
+
+// Forsyth, "Linear-Speed Vertex Cache Optimisation" (https://tomforsyth1000.github.io/papers/fast_vert_cache_opt.html)
+// Triangles are emitted greedily; each vertex is scored by its position in a simulated LRU cache plus a valence boost 
+// which favors vertices with few remaining triangles (avoids leaving isolated triangles behind). The input order is kept 
+// if it is already better (e.g. meshes generated as regular grids), hence this never increases the ACMR.
+static void OptimizeVertexCache(MeshBuilder::Triangle* _triangles, uint32 _triangleCount)
+{
+	const int   kCacheSize          = 32;
+	const float kCacheDecayPower    = 1.5f;
+	const float kLastTriScore       = 0.75f;
+	const float kValenceBoostScale  = 2.0f;
+	const float kValenceBoostPower  = 0.5f;
+	const int   kMaxValence         = 64;   // size of the valence score table
+
+	if (_triangleCount < 2) {
+		return;
+	}
+
+	float cacheScore[kCacheSize];
+	for (int i = 0; i < kCacheSize; ++i) {
+		cacheScore[i] = i < 3 ? kLastTriScore : powf(1.0f - (float)(i - 3) / (float)(kCacheSize - 3), kCacheDecayPower);
+	}
+	float valenceScore[kMaxValence];
+	valenceScore[0] = -1.0f; // no remaining triangles, vertex is never selected
+	for (int i = 1; i < kMaxValence; ++i) {
+		valenceScore[i] = kValenceBoostScale * powf((float)i, -kValenceBoostPower);
+	}
+	auto VertexScore = [&](int _cachePos, uint32 _valence) -> float
+		{
+			if (_valence == 0) {
+				return -1.0f;
+			}
+			float ret = _cachePos < 0 ? 0.0f : cacheScore[_cachePos];
+			ret += _valence < kMaxValence ? valenceScore[_valence] : kValenceBoostScale * powf((float)_valence, -kValenceBoostPower);
+			return ret;
+		};
+
+ // triangles reference a contiguous range of vertices, work with indices relative to the range
+	uint32 vmin = ~0u, vmax = 0u;
+	for (uint32 i = 0; i < _triangleCount; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			vmin = APT_MIN(vmin, _triangles[i][j]);
+			vmax = APT_MAX(vmax, _triangles[i][j]);
+		}
+	}
+	uint32 vcount = vmax - vmin + 1;
+
+ // vertex -> triangle adjacency, m_valence is the number of triangles not yet emitted
+	struct VertexInfo
+	{
+		uint32 m_triOffset;
+		uint32 m_valence;
+		int    m_cachePos;
+		float  m_score;
+	};
+	eastl::vector<VertexInfo> vertices(vcount);
+	for (auto& vert : vertices) {
+		vert.m_triOffset = 0;
+		vert.m_valence   = 0;
+		vert.m_cachePos  = -1;
+	}
+	for (uint32 i = 0; i < _triangleCount; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			++vertices[_triangles[i][j] - vmin].m_valence;
+		}
+	}
+	for (uint32 i = 1; i < vcount; ++i) {
+		vertices[i].m_triOffset = vertices[i - 1].m_triOffset + vertices[i - 1].m_valence;
+	}
+	eastl::vector<uint32> vertexTriangles(_triangleCount * 3);
+	for (auto& vert : vertices) {
+		vert.m_valence = 0; // use as a counter while filling vertexTriangles
+	}
+	for (uint32 i = 0; i < _triangleCount; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			VertexInfo& vert = vertices[_triangles[i][j] - vmin];
+			vertexTriangles[vert.m_triOffset + vert.m_valence++] = i;
+		}
+	}
+	for (auto& vert : vertices) {
+		vert.m_score = VertexScore(-1, vert.m_valence);
+	}
+
+	eastl::vector<uint8> triangleEmitted(_triangleCount, 0);
+	uint32 bestTriangle = 0;
+	float  bestScore = -1.0f;
+	for (uint32 i = 0; i < _triangleCount; ++i) {
+		const MeshBuilder::Triangle& tri = _triangles[i];
+		float score = vertices[tri.a - vmin].m_score + vertices[tri.b - vmin].m_score + vertices[tri.c - vmin].m_score;
+		if (score > bestScore) {
+			bestScore = score;
+			bestTriangle = i;
+		}
+	}
+
+	eastl::vector<MeshBuilder::Triangle> ret;
+	ret.reserve(_triangleCount);
+	uint32 cache[kCacheSize + 3];
+	int    cacheCount = 0;
+	uint32 scanPos = 0; // all triangles before scanPos have been emitted
+	while (ret.size() < _triangleCount) {
+		if (bestTriangle == ~0u) {
+		 // no candidates in the cache, take the next unemitted triangle in the input order
+			while (triangleEmitted[scanPos]) {
+				++scanPos;
+			}
+			bestTriangle = scanPos;
+		}
+
+		MeshBuilder::Triangle tri = _triangles[bestTriangle];
+		ret.push_back(tri);
+		triangleEmitted[bestTriangle] = 1;
+
+	 // remove the triangle from the adjacency lists, push its vertices to the front of the cache
+		uint32 newCache[kCacheSize + 3];
+		int    newCacheCount = 0;
+		for (int i = 0; i < 3; ++i) {
+			uint32 v = tri[i] - vmin;
+			VertexInfo& vert = vertices[v];
+			uint32* vtris = &vertexTriangles[vert.m_triOffset];
+			for (uint32 j = 0; j < vert.m_valence; ++j) {
+				if (vtris[j] == bestTriangle) {
+					vtris[j] = vtris[vert.m_valence - 1];
+					--vert.m_valence;
+					break;
+				}
+			}
+			if (eastl::find(newCache, newCache + newCacheCount, v) == newCache + newCacheCount) { // degenerate triangles
+				newCache[newCacheCount++] = v;
+			}
+		}
+		const int triVertexCount = newCacheCount; // < 3 if the triangle is degenerate
+		for (int i = 0; i < cacheCount; ++i) {
+			if (eastl::find(newCache, newCache + triVertexCount, cache[i]) == newCache + triVertexCount) {
+				newCache[newCacheCount++] = cache[i];
+			}
+		}
+
+	 // update vertex scores, vertices which fell out of the cache get a position of -1
+		for (int i = 0; i < newCacheCount; ++i) {
+			VertexInfo& vert = vertices[newCache[i]];
+			vert.m_cachePos = i < kCacheSize ? i : -1;
+			vert.m_score = VertexScore(vert.m_cachePos, vert.m_valence);
+		}
+
+	 // update scores for triangles referencing the modified vertices, select the next best
+		bestTriangle = ~0u;
+		bestScore = -1.0f;
+		for (int i = 0; i < newCacheCount; ++i) {
+			const VertexInfo& vert = vertices[newCache[i]];
+			const uint32* vtris = &vertexTriangles[vert.m_triOffset];
+			for (uint32 j = 0; j < vert.m_valence; ++j) {
+				uint32 t = vtris[j];
+				const MeshBuilder::Triangle& vtri = _triangles[t];
+				float score = vertices[vtri.a - vmin].m_score + vertices[vtri.b - vmin].m_score + vertices[vtri.c - vmin].m_score;
+				if (score > bestScore) {
+					bestScore = score;
+					bestTriangle = t;
+				}
+			}
+		}
+
+		cacheCount = APT_MIN(newCacheCount, kCacheSize);
+		memcpy(cache, newCache, sizeof(uint32) * cacheCount);
+	}
+
+	const uint kFifoCacheSize = 16;
+	uint32 transformsBefore = SimulateVertexCache(_triangles,  _triangleCount, vmin, vcount, kFifoCacheSize);
+	uint32 transformsAfter  = SimulateVertexCache(ret.data(), _triangleCount, vmin, vcount, kFifoCacheSize);
+	if (transformsAfter < transformsBefore) {
+		memcpy(_triangles, ret.data(), sizeof(MeshBuilder::Triangle) * _triangleCount);
+	}
+}
+
+void MeshBuilder::optimizeVertexCache()
+{
+	APT_AUTOTIMER("MeshBuilder::optimizeVertexCache");
+
+	m_meshlets.clear();
+
+	if (m_submeshes.empty()) {
+		OptimizeVertexCache(m_triangles.data(), getTriangleCount());
+	} else {
+		for (auto& submesh : m_submeshes) {
+			OptimizeVertexCache(m_triangles.data() + submesh.m_indexOffset / 3, submesh.m_indexCount / 3);
+		}
+	}
+}
+
+void MeshBuilder::optimizeVertexFetch()
+{
+	APT_AUTOTIMER("MeshBuilder::optimizeVertexFetch");
+	APT_ASSERT(m_layout == Layout_AoS);
+
+ // build a remap table per submesh; vertices are only moved within the submesh vertex range so that the submesh 
+ // offsets remain valid, unreferenced vertices are moved to the end of the range
+	eastl::vector<uint32> remap(getVertexCount(), ~0u);
+	auto RemapRange = [&](uint32 _triangleOffset, uint32 _triangleCount, uint32 _vertexOffset, uint32 _vertexCount) -> bool
+		{
+			uint32 next = _vertexOffset;
+			for (uint32 i = _triangleOffset, n = _triangleOffset + _triangleCount; i < n; ++i) {
+				for (int j = 0; j < 3; ++j) {
+					uint32 v = m_triangles[i][j];
+					if (v < _vertexOffset || v >= _vertexOffset + _vertexCount) {
+						return false;
+					}
+					if (remap[v] == ~0u) {
+						remap[v] = next++;
+					}
+				}
+			}
+			for (uint32 i = _vertexOffset, n = _vertexOffset + _vertexCount; i < n; ++i) {
+				if (remap[i] == ~0u) {
+					remap[i] = next++;
+				}
+			}
+			return true;
+		};
+	if (m_submeshes.empty()) {
+		RemapRange(0, getTriangleCount(), 0, getVertexCount());
+	} else {
+		for (auto& submesh : m_submeshes) {
+			if (!RemapRange(submesh.m_indexOffset / 3, submesh.m_indexCount / 3, submesh.m_vertexOffset, submesh.m_vertexCount)) {
+				APT_LOG_ERR("MeshBuilder::optimizeVertexFetch: submesh triangles reference vertices outside of the submesh");
+				return;
+			}
+		}
+		for (uint32 i = 0; i < getVertexCount(); ++i) {
+			if (remap[i] == ~0u) { // vertex not in any submesh
+				remap[i] = i;
+			}
+		}
+	}
+
+	eastl::vector<Vertex> vertices(m_vertices.size());
+	for (uint32 i = 0; i < getVertexCount(); ++i) {
+		vertices[remap[i]] = m_vertices[i];
+	}
+	m_vertices.swap(vertices);
+	for (auto& tri : m_triangles) {
+		tri.a = remap[tri.a];
+		tri.b = remap[tri.b];
+		tri.c = remap[tri.c];
+	}
+}
+
+// Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw"
+// Hard cluster boundaries are placed where the vertex cache optimization restarted (all 3 vertices missed), each hard
+// cluster is then split into soft clusters as long as their ACMR remains below the threshold. Clusters are sorted by 
+// the dot product of the cluster normal with the offset of the cluster centroid from the mesh centroid, i.e. clusters
+// on the outside of the mesh and facing outward are drawn first.
+static void OptimizeOverdraw(MeshBuilder::Triangle* _triangles, uint32 _triangleCount, const MeshBuilder::Vertex* _vertices, float _threshold)
+{
+	const uint32 kCacheSize = 16;
+
+	if (_triangleCount < 2) {
+		return;
+	}
+
+	uint32 vmin = ~0u, vmax = 0u;
+	for (uint32 i = 0; i < _triangleCount; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			vmin = APT_MIN(vmin, _triangles[i][j]);
+			vmax = APT_MAX(vmax, _triangles[i][j]);
+		}
+	}
+	eastl::vector<uint32> cacheTime(vmax - vmin + 1, 0);
+	uint32 time = 0;
+	auto CacheReset = [&]()
+		{
+			time += kCacheSize + 1;
+		};
+	auto CacheMisses = [&](const MeshBuilder::Triangle& _tri) -> uint32
+		{
+			uint32 ret = 0;
+			for (int i = 0; i < 3; ++i) {
+				uint32 v = _tri[i] - vmin;
+				if (time - cacheTime[v] > kCacheSize) {
+					cacheTime[v] = time++;
+					++ret;
+				}
+			}
+			return ret;
+		};
+
+ // hard boundaries
+	eastl::vector<uint32> hardClusters;
+	CacheReset();
+	for (uint32 i = 0; i < _triangleCount; ++i) {
+		if (CacheMisses(_triangles[i]) == 3 || i == 0) {
+			hardClusters.push_back(i);
+		}
+	}
+
+ // soft boundaries
+	eastl::vector<uint32> clusters;
+	for (uint32 i = 0; i < hardClusters.size(); ++i) {
+		uint32 beg = hardClusters[i];
+		uint32 end = i + 1 < hardClusters.size() ? hardClusters[i + 1] : _triangleCount;
+		
+		CacheReset();
+		uint32 misses = 0;
+		for (uint32 j = beg; j < end; ++j) {
+			misses += CacheMisses(_triangles[j]);
+		}
+		float clusterThreshold = _threshold * (float)misses / (float)(end - beg);
+
+		clusters.push_back(beg);
+		CacheReset();
+		uint32 runningMisses = 0;
+		uint32 runningCount  = 0;
+		for (uint32 j = beg; j < end; ++j) {
+			runningMisses += CacheMisses(_triangles[j]);
+			++runningCount;
+			if ((float)runningMisses / (float)runningCount <= clusterThreshold) {
+				clusters.push_back(j + 1);
+				CacheReset();
+				runningMisses = runningCount = 0;
+			}
+		}
+	 // the last soft cluster is usually small with a high ACMR, merge it with the previous one (this also removes the
+	 // boundary at 'end' which may have been added above)
+		if (clusters.back() != beg) {
+			clusters.pop_back();
+		}
+	}
+
+ // area-weighted centroid and average normal per cluster
+	struct Cluster
+	{
+		uint32 m_begin;
+		uint32 m_end;
+		vec3   m_centroid;
+		vec3   m_normal;
+		float  m_sortKey;
+	};
+	eastl::vector<Cluster> sortedClusters(clusters.size());
+	vec3  meshCentroid = vec3(0.0f);
+	float meshArea = 0.0f;
+	for (uint32 i = 0; i < clusters.size(); ++i) {
+		Cluster& cluster = sortedClusters[i];
+		cluster.m_begin    = clusters[i];
+		cluster.m_end      = i + 1 < clusters.size() ? clusters[i + 1] : _triangleCount;
+		cluster.m_centroid = vec3(0.0f);
+		cluster.m_normal   = vec3(0.0f);
+		float area = 0.0f;
+		for (uint32 j = cluster.m_begin; j < cluster.m_end; ++j) {
+			const vec3& a = _vertices[_triangles[j].a].m_position;
+			const vec3& b = _vertices[_triangles[j].b].m_position;
+			const vec3& c = _vertices[_triangles[j].c].m_position;
+			vec3  n = cross(b - a, c - a);
+			float triArea = length(n);
+			cluster.m_centroid += (a + b + c) * (triArea / 3.0f);
+			cluster.m_normal   += n;
+			area += triArea;
+		}
+		meshCentroid += cluster.m_centroid;
+		meshArea     += area;
+		cluster.m_centroid = area > 0.0f ? cluster.m_centroid / area : vec3(0.0f);
+		float normalLength = length(cluster.m_normal);
+		cluster.m_normal = normalLength > 0.0f ? cluster.m_normal / normalLength : vec3(0.0f);
+	}
+	meshCentroid = meshArea > 0.0f ? meshCentroid / meshArea : vec3(0.0f);
+	for (auto& cluster : sortedClusters) {
+		cluster.m_sortKey = dot(cluster.m_centroid - meshCentroid, cluster.m_normal);
+	}
+	eastl::stable_sort(sortedClusters.begin(), sortedClusters.end(), 
+		[](const Cluster& _a, const Cluster& _b) { 
+			return _a.m_sortKey > _b.m_sortKey; 
+		});
+
+	eastl::vector<MeshBuilder::Triangle> ret;
+	ret.reserve(_triangleCount);
+	for (auto& cluster : sortedClusters) {
+		ret.insert(ret.end(), _triangles + cluster.m_begin, _triangles + cluster.m_end);
+	}
+	memcpy(_triangles, ret.data(), sizeof(MeshBuilder::Triangle) * _triangleCount);
+}
+
+void MeshBuilder::optimizeOverdraw(float _threshold)
+{
+	APT_AUTOTIMER("MeshBuilder::optimizeOverdraw");
+	APT_ASSERT(m_layout == Layout_AoS);
+
+	m_meshlets.clear();
+
+	if (m_submeshes.empty()) {
+		OptimizeOverdraw(m_triangles.data(), getTriangleCount(), m_vertices.data(), _threshold);
+	} else {
+		for (auto& submesh : m_submeshes) {
+			OptimizeOverdraw(m_triangles.data() + submesh.m_indexOffset / 3, submesh.m_indexCount / 3, m_vertices.data(), _threshold);
+		}
+	}
+}
+
+static void ComputeMeshletBounds(MeshData::Meshlet& meshlet_, const MeshBuilder::Triangle* _triangles, uint32 _triangleCount, const MeshBuilder::Vertex* _vertices)
+{
+	vec3 p0 = _vertices[_triangles[0].a].m_position;
+	meshlet_.m_boundingBox = AlignedBox(p0, p0);
+	for (uint32 i = 0; i < _triangleCount; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			const vec3& p = _vertices[_triangles[i][j]].m_position;
+			meshlet_.m_boundingBox.m_min = Min(meshlet_.m_boundingBox.m_min, p);
+			meshlet_.m_boundingBox.m_max = Max(meshlet_.m_boundingBox.m_max, p);
+		}
+	}
+	vec3 center = meshlet_.m_boundingBox.getOrigin();
+	float radius2 = 0.0f;
+	for (uint32 i = 0; i < _triangleCount; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			radius2 = APT_MAX(radius2, length2(_vertices[_triangles[i][j]].m_position - center));
+		}
+	}
+	meshlet_.m_boundingSphere = Sphere(center, sqrtf(radius2));
+
+ // normal cone, the axis is the average triangle normal, the apex is placed such that the cone contains all triangle planes
+	meshlet_.m_coneApex   = center;
+	meshlet_.m_coneAxis   = vec3(0.0f);
+	meshlet_.m_coneCutoff = 1.0f;
+	eastl::vector<vec3> normals(_triangleCount);
+	for (uint32 i = 0; i < _triangleCount; ++i) {
+		const vec3& a = _vertices[_triangles[i].a].m_position;
+		const vec3& b = _vertices[_triangles[i].b].m_position;
+		const vec3& c = _vertices[_triangles[i].c].m_position;
+		vec3 n = cross(b - a, c - a);
+		float len = length(n);
+		normals[i] = len > 0.0f ? n / len : vec3(0.0f);
+		meshlet_.m_coneAxis += normals[i];
+	}
+	float axisLength = length(meshlet_.m_coneAxis);
+	if (axisLength <= 0.0f) {
+		return;
+	}
+	meshlet_.m_coneAxis /= axisLength;
+	float minDot = 1.0f;
+	for (auto& n : normals) {
+		if (n != vec3(0.0f)) {
+			minDot = APT_MIN(minDot, dot(n, meshlet_.m_coneAxis));
+		}
+	}
+	if (minDot <= 0.1f) {
+	 // cone is too wide to be useful
+		return;
+	}
+	float maxT = 0.0f;
+	for (uint32 i = 0; i < _triangleCount; ++i) {
+		if (normals[i] == vec3(0.0f)) {
+			continue;
+		}
+		float t = dot(center - _vertices[_triangles[i].a].m_position, normals[i]) / dot(meshlet_.m_coneAxis, normals[i]);
+		maxT = APT_MAX(maxT, t);
+	}
+	meshlet_.m_coneApex   = center - meshlet_.m_coneAxis * maxT;
+	meshlet_.m_coneCutoff = sqrtf(1.0f - minDot * minDot);
+}
+
+// Greedy meshlet construction: grow each meshlet by the adjacent triangle which adds the fewest new vertices (ties are 
+// broken by the distance to the meshlet centroid), seed the next meshlet from the neighborhood of the previous one.
+// Triangles within each meshlet are then reordered for the vertex cache.
+static void BuildMeshlets(MeshBuilder::Triangle* _triangles, uint32 _triangleCount, const MeshBuilder::Vertex* _vertices, uint32 _vertexCount, uint _maxVertices, uint _maxTriangles, uint32 _indexOffset, uint _submeshId, eastl::vector<MeshData::Meshlet>& meshlets_)
+{
+	if (_triangleCount == 0) {
+		return;
+	}
+
+ // vertex -> triangle adjacency
+	eastl::vector<uint32> adjacencyOffsets(_vertexCount + 1, 0);
+	for (uint32 i = 0; i < _triangleCount; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			++adjacencyOffsets[_triangles[i][j] + 1];
+		}
+	}
+	for (uint32 i = 0; i < _vertexCount; ++i) {
+		adjacencyOffsets[i + 1] += adjacencyOffsets[i];
+	}
+	eastl::vector<uint32> adjacency(_triangleCount * 3);
+	{
+		eastl::vector<uint32> cursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (uint32 i = 0; i < _triangleCount; ++i) {
+			for (int j = 0; j < 3; ++j) {
+				adjacency[cursor[_triangles[i][j]]++] = i;
+			}
+		}
+	}
+
+	eastl::vector<vec3> centroids(_triangleCount);
+	for (uint32 i = 0; i < _triangleCount; ++i) {
+		centroids[i] = (_vertices[_triangles[i].a].m_position + _vertices[_triangles[i].b].m_position + _vertices[_triangles[i].c].m_position) / 3.0f;
+	}
+
+	eastl::vector<uint8>  emitted(_triangleCount, 0);
+	eastl::vector<uint32> vertexMeshlet(_vertexCount, ~0u); // last meshlet to reference each vertex
+	eastl::vector<uint32> meshletVertices;
+	eastl::vector<MeshBuilder::Triangle> ret;
+	ret.reserve(_triangleCount);
+	uint32 nextSeed = 0;
+	for (uint32 meshletId = 0; ret.size() < _triangleCount; ++meshletId) {
+	 // seed from a triangle adjacent to the previous meshlet if possible, else the next unemitted triangle
+		uint32 seed = ~0u;
+		for (uint32 v : meshletVertices) {
+			for (uint32 i = adjacencyOffsets[v]; i < adjacencyOffsets[v + 1] && seed == ~0u; ++i) {
+				if (!emitted[adjacency[i]]) {
+					seed = adjacency[i];
+				}
+			}
+		}
+		if (seed == ~0u) {
+			while (emitted[nextSeed]) {
+				++nextSeed;
+			}
+			seed = nextSeed;
+		}
+
+		uint32 begin = (uint32)ret.size();
+		vec3 centroidSum = vec3(0.0f);
+		meshletVertices.clear();
+		for (uint32 tri = seed; tri != ~0u; ) {
+			emitted[tri] = 1;
+			ret.push_back(_triangles[tri]);
+			for (int j = 0; j < 3; ++j) {
+				uint32 v = _triangles[tri][j];
+				if (vertexMeshlet[v] != meshletId) {
+					vertexMeshlet[v] = meshletId;
+					meshletVertices.push_back(v);
+					centroidSum += _vertices[v].m_position;
+				}
+			}
+			if (ret.size() - begin >= _maxTriangles) {
+				break;
+			}
+
+			vec3 centroid = centroidSum / (float)meshletVertices.size();
+			uint32 best = ~0u;
+			uint bestNewVertices = 4;
+			float bestDistance = FLT_MAX;
+			for (uint32 v : meshletVertices) {
+				for (uint32 i = adjacencyOffsets[v]; i < adjacencyOffsets[v + 1]; ++i) {
+					uint32 candidate = adjacency[i];
+					if (emitted[candidate]) {
+						continue;
+					}
+					uint newVertices = 0;
+					for (int j = 0; j < 3; ++j) {
+						newVertices += vertexMeshlet[_triangles[candidate][j]] != meshletId ? 1 : 0;
+					}
+					if (meshletVertices.size() + newVertices > _maxVertices || newVertices > bestNewVertices) {
+						continue;
+					}
+					float distance = length2(centroids[candidate] - centroid);
+					if (newVertices < bestNewVertices || distance < bestDistance) {
+						best = candidate;
+						bestNewVertices = newVertices;
+						bestDistance = distance;
+					}
+				}
+			}
+			tri = best;
+		}
+
+		OptimizeVertexCache(ret.data() + begin, (uint32)ret.size() - begin);
+
+		MeshData::Meshlet meshlet;
+		meshlet.m_indexOffset = (_indexOffset + begin) * 3;
+		meshlet.m_indexCount  = ((uint32)ret.size() - begin) * 3;
+		meshlet.m_vertexCount = (uint32)meshletVertices.size();
+		meshlet.m_submeshId   = _submeshId;
+		ComputeMeshletBounds(meshlet, ret.data() + begin, (uint32)ret.size() - begin, _vertices);
+		meshlets_.push_back(meshlet);
+	}
+
+	memcpy(_triangles, ret.data(), sizeof(MeshBuilder::Triangle) * _triangleCount);
+}
+
+void MeshBuilder::buildMeshlets(uint _maxVertices, uint _maxTriangles)
+{
+	APT_AUTOTIMER("MeshBuilder::buildMeshlets");
+	APT_ASSERT(m_layout == Layout_AoS);
+	APT_ASSERT(_maxVertices >= 3 && _maxTriangles >= 1);
+
+	m_meshlets.clear();
+	if (m_submeshes.empty()) {
+		BuildMeshlets(m_triangles.data(), getTriangleCount(), m_vertices.data(), getVertexCount(), _maxVertices, _maxTriangles, 0, 0, m_meshlets);
+	} else {
+		for (uint i = 0; i < m_submeshes.size(); ++i) {
+			const MeshData::Submesh& submesh = m_submeshes[i];
+			BuildMeshlets(m_triangles.data() + submesh.m_indexOffset / 3, submesh.m_indexCount / 3, m_vertices.data(), getVertexCount(), _maxVertices, _maxTriangles, submesh.m_indexOffset / 3, i, m_meshlets);
+		}
+	}
+}
+
+// Symmetric quadric for simplify(), stores w*(n.p + d)^2 summed over planes plus the total weight w.
+struct Quadric
+{
+	float m_a00, m_a11, m_a22, m_a10, m_a20, m_a21;
+	float m_b0, m_b1, m_b2;
+	float m_c;
+	float m_w;
+
+	Quadric()
+	{
+		memset(this, 0, sizeof(Quadric));
+	}
+
+	Quadric(const vec3& _n, float _d, float _w)
+	{
+		m_a00 = _w * _n.x * _n.x;
+		m_a11 = _w * _n.y * _n.y;
+		m_a22 = _w * _n.z * _n.z;
+		m_a10 = _w * _n.y * _n.x;
+		m_a20 = _w * _n.z * _n.x;
+		m_a21 = _w * _n.z * _n.y;
+		m_b0  = _w * _n.x * _d;
+		m_b1  = _w * _n.y * _d;
+		m_b2  = _w * _n.z * _d;
+		m_c   = _w * _d * _d;
+		m_w   = _w;
+	}
+
+	Quadric& operator+=(const Quadric& _q)
+	{
+		float* dst = &m_a00;
+		const float* src = &_q.m_a00;
+		for (int i = 0; i < 11; ++i) {
+			dst[i] += src[i];
+		}
+		return *this;
+	}
+
+	// Weighted mean squared distance of _p to the planes.
+	float eval(const vec3& _p) const
+	{
+		float rx = m_a00 * _p.x + m_a10 * _p.y + m_a20 * _p.z;
+		float ry = m_a10 * _p.x + m_a11 * _p.y + m_a21 * _p.z;
+		float rz = m_a20 * _p.x + m_a21 * _p.y + m_a22 * _p.z;
+		float ret = rx * _p.x + ry * _p.y + rz * _p.z + 2.0f * (m_b0 * _p.x + m_b1 * _p.y + m_b2 * _p.z) + m_c;
+		return m_w > 0.0f ? APT_MAX(ret / m_w, 0.0f) : 0.0f;
+	}
+};
+
+// Skinned vertices may only collapse if their dominant bone matches, else the simplified mesh deforms incorrectly.
+static bool BoneWeightsCompatible(const MeshBuilder::Vertex& _a, const MeshBuilder::Vertex& _b)
+{
+	int ia = 0, ib = 0;
+	for (int i = 1; i < 4; ++i) {
+		ia = _a.m_boneWeights[i] > _a.m_boneWeights[ia] ? i : ia;
+		ib = _b.m_boneWeights[i] > _b.m_boneWeights[ib] ? i : ib;
+	}
+	if (_a.m_boneWeights[ia] <= 0.0f && _b.m_boneWeights[ib] <= 0.0f) {
+		return true; // not skinned
+	}
+	return _a.m_boneIndices[ia] == _b.m_boneIndices[ib];
+}
+
+float MeshBuilder::simplify(uint32 _targetTriangleCount, float _maxError)
+{
+	APT_AUTOTIMER("MeshBuilder::simplify");
+	APT_ASSERT(m_layout == Layout_AoS);
+
+	const float kBorderWeight = 10.0f;
+
+	uint32 triangleCount = getTriangleCount();
+	uint32 vertexCount = getVertexCount();
+	if (triangleCount <= _targetTriangleCount || vertexCount == 0) {
+		return 0.0f;
+	}
+	m_meshlets.clear();
+
+ // weld vertices by position; vertices which share a position but have different attributes ('wedges') form seams
+	eastl::vector<uint32> positionIds(vertexCount);
+	eastl::vector<vec3>   positions;
+	{
+		eastl::vector<vec3>   positionNormals;
+		eastl::vector<uint32> sorted(vertexCount);
+		for (uint32 i = 0; i < vertexCount; ++i) {
+			sorted[i] = i;
+		}
+		eastl::sort(sorted.begin(), sorted.end(), 
+			[this](uint32 _a, uint32 _b) {
+				const vec3& a = m_vertices[_a].m_position;
+				const vec3& b = m_vertices[_b].m_position;
+				return a.x != b.x ? a.x < b.x : (a.y != b.y ? a.y < b.y : a.z < b.z);
+			});
+	 // within a run of equal positions, vertices with opposing normals are kept apart so that double-sided geometry isn't welded
+		for (uint32 i = 0, runBegin = 0; i < vertexCount; ++i) {
+			const Vertex& v = m_vertices[sorted[i]];
+			if (i == 0 || v.m_position != m_vertices[sorted[i - 1]].m_position) {
+				runBegin = (uint32)positions.size();
+			}
+			uint32 id = (uint32)positions.size();
+			for (uint32 j = runBegin; j < id; ++j) {
+				if (dot(v.m_normal, positionNormals[j]) > -0.5f) {
+					id = j;
+					break;
+				}
+			}
+			if (id == (uint32)positions.size()) {
+				positions.push_back(v.m_position);
+				positionNormals.push_back(v.m_normal);
+			}
+			positionIds[sorted[i]] = id;
+		}
+	}
+	uint32 positionCount = (uint32)positions.size();
+
+ // normalize positions to the bounding sphere such that the error is relative to the mesh size
+	AlignedBox bounds(positions[0], positions[0]);
+	for (auto& p : positions) {
+		bounds.m_min = Min(bounds.m_min, p);
+		bounds.m_max = Max(bounds.m_max, p);
+	}
+	Sphere boundingSphere(bounds);
+	if (boundingSphere.m_radius <= 0.0f) {
+		return 0.0f;
+	}
+	for (auto& p : positions) {
+		p = (p - boundingSphere.m_origin) / boundingSphere.m_radius;
+	}
+	float maxErrorSq = _maxError * _maxError;
+
+ // submesh per triangle, used to rebuild the submesh index ranges
+	eastl::vector<Triangle> triangles(m_triangles);
+	eastl::vector<uint32>   triangleSubmeshes(triangleCount, 0);
+	for (uint32 i = 0; i < m_submeshes.size(); ++i) {
+		for (uint32 j = m_submeshes[i].m_indexOffset / 3, n = j + m_submeshes[i].m_indexCount / 3; j < n; ++j) {
+			triangleSubmeshes[j] = i;
+		}
+	}
+
+ // classify edges: border edges have a single triangle, non-manifold edges (> 2 triangles) lock their vertices
+	eastl::vector<uint8> isBorder(positionCount, 0);
+	eastl::vector<uint8> isLocked(positionCount, 0);
+	eastl::vector<Quadric> quadrics(positionCount);
+	{
+		eastl::vector<uint64> edges;
+		edges.reserve(triangleCount * 3);
+		for (auto& tri : triangles) {
+			for (int i = 0; i < 3; ++i) {
+				uint64 a = positionIds[tri[i]];
+				uint64 b = positionIds[tri[(i + 1) % 3]];
+				edges.push_back(a < b ? (a << 32 | b) : (b << 32 | a));
+			}
+		}
+		eastl::sort(edges.begin(), edges.end());
+		
+		auto FindEdgeCount = [&edges](uint32 _a, uint32 _b) -> uint32
+			{
+				uint64 key = _a < _b ? ((uint64)_a << 32 | _b) : ((uint64)_b << 32 | _a);
+				auto it = eastl::lower_bound(edges.begin(), edges.end(), key);
+				uint32 ret = 0;
+				while (it != edges.end() && *it == key) {
+					++ret;
+					++it;
+				}
+				return ret;
+			};
+
+		for (auto& tri : triangles) {
+			uint32 p[3] = { positionIds[tri.a], positionIds[tri.b], positionIds[tri.c] };
+			vec3 n = cross(positions[p[1]] - positions[p[0]], positions[p[2]] - positions[p[0]]);
+			float area = length(n);
+			if (area <= 0.0f) {
+				continue;
+			}
+			n /= area;
+			Quadric q(n, -dot(n, positions[p[0]]), area);
+			for (int i = 0; i < 3; ++i) {
+				quadrics[p[i]] += q;
+			}
+
+			for (int i = 0; i < 3; ++i) {
+				uint32 a = p[i];
+				uint32 b = p[(i + 1) % 3];
+				uint32 count = FindEdgeCount(a, b);
+				if (count > 2) {
+					isLocked[a] = isLocked[b] = 1;
+				} else if (count == 1) {
+				 // border edge, add a plane perpendicular to the triangle to constrain the border
+					isBorder[a] = isBorder[b] = 1;
+					vec3 edge = positions[b] - positions[a];
+					float edgeLength = length(edge);
+					if (edgeLength > 0.0f) {
+						vec3 bn = normalize(cross(edge, n));
+						Quadric bq(bn, -dot(bn, positions[a]), edgeLength * edgeLength * kBorderWeight);
+						quadrics[a] += bq;
+						quadrics[b] += bq;
+					}
+				}
+			}
+		}
+	}
+
+	struct Collapse
+	{
+		uint32 m_src;
+		uint32 m_dst;
+		float  m_error;
+	};
+	eastl::vector<Collapse> collapses;
+	eastl::vector<uint32>   adjacencyOffsets(positionCount + 1);
+	eastl::vector<uint32>   adjacency;
+	eastl::vector<uint8>    touched(positionCount);
+	eastl::vector<uint32>   wedgeMap;   // src wedge, dst wedge pairs for the current collapse
+	eastl::vector<uint32>   neighbors;  // scratch for the link condition test
+	float maxError = 0.0f;
+
+	auto ContainsPosition = [&](const Triangle& _tri, uint32 _p) -> int
+		{
+			for (int i = 0; i < 3; ++i) {
+				if (positionIds[_tri[i]] == _p) {
+					return i;
+				}
+			}
+			return -1;
+		};
+
+	auto CanCollapse = [&](uint32 _src, uint32 _dst) -> bool
+		{
+			wedgeMap.clear();
+			neighbors.clear();
+			uint32 edgeTriangleCount = 0;
+			for (uint32 i = adjacencyOffsets[_src]; i < adjacencyOffsets[_src + 1]; ++i) {
+				const Triangle& tri = triangles[adjacency[i]];
+				int isrc = ContainsPosition(tri, _src);
+				int idst = ContainsPosition(tri, _dst);
+				for (int j = 0; j < 3; ++j) {
+					uint32 p = positionIds[tri[j]];
+					if (p != _src && eastl::find(neighbors.begin(), neighbors.end(), p) == neighbors.end()) {
+						neighbors.push_back(p);
+					}
+				}
+				if (idst < 0) {
+					continue;
+				}
+				++edgeTriangleCount;
+
+			 // map the src wedge to the dst wedge on the same side of any seam, fail if the mapping is ambiguous
+				uint32 wsrc = tri[isrc];
+				uint32 wdst = tri[idst];
+				bool found = false;
+				for (uint32 j = 0; j < wedgeMap.size(); j += 2) {
+					if (wedgeMap[j] == wsrc) {
+						if (wedgeMap[j + 1] != wdst) {
+							return false;
+						}
+						found = true;
+					}
+				}
+				if (!found) {
+					if (!BoneWeightsCompatible(m_vertices[wsrc], m_vertices[wdst])) {
+						return false;
+					}
+					wedgeMap.push_back(wsrc);
+					wedgeMap.push_back(wdst);
+				}
+			}
+
+		 // border vertices may only collapse along the border
+			if (edgeTriangleCount == 0 || (isBorder[_src] && edgeTriangleCount != 1)) {
+				return false;
+			}
+
+		 // every src wedge must have a mapping (fails e.g. for seam vertices collapsing across the seam), triangles
+		 // must not flip
+			for (uint32 i = adjacencyOffsets[_src]; i < adjacencyOffsets[_src + 1]; ++i) {
+				const Triangle& tri = triangles[adjacency[i]];
+				if (ContainsPosition(tri, _dst) >= 0) {
+					continue;
+				}
+				int isrc = ContainsPosition(tri, _src);
+				bool found = false;
+				for (uint32 j = 0; j < wedgeMap.size(); j += 2) {
+					found |= wedgeMap[j] == tri[isrc];
+				}
+				if (!found) {
+					return false;
+				}
+				
+				vec3 p0 = positions[positionIds[tri.a]];
+				vec3 p1 = positions[positionIds[tri.b]];
+				vec3 p2 = positions[positionIds[tri.c]];
+				vec3 n0 = cross(p1 - p0, p2 - p0);
+				(isrc == 0 ? p0 : (isrc == 1 ? p1 : p2)) = positions[_dst];
+				vec3 n1 = cross(p1 - p0, p2 - p0);
+				if (dot(n0, n1) <= 0.0f) {
+					return false;
+				}
+			}
+
+		 // link condition: src and dst may only share the vertices opposite the collapsed edge, else the result
+		 // is non-manifold
+			uint32 sharedCount = 0;
+			for (uint32 i = adjacencyOffsets[_dst]; i < adjacencyOffsets[_dst + 1]; ++i) {
+				const Triangle& tri = triangles[adjacency[i]];
+				if (ContainsPosition(tri, _src) >= 0) {
+					continue;
+				}
+				for (int j = 0; j < 3; ++j) {
+					uint32 p = positionIds[tri[j]];
+					auto it = eastl::find(neighbors.begin(), neighbors.end(), p);
+					if (p != _dst && it != neighbors.end()) {
+						++sharedCount;
+						neighbors.erase(it); // count each neighbor once
+					}
+				}
+			}
+			return sharedCount <= edgeTriangleCount;
+		};
+
+	while (triangleCount > _targetTriangleCount) {
+	 // position -> triangle adjacency
+		eastl::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+		for (auto& tri : triangles) {
+			for (int i = 0; i < 3; ++i) {
+				++adjacencyOffsets[positionIds[tri[i]] + 1];
+			}
+		}
+		for (uint32 i = 1; i <= positionCount; ++i) {
+			adjacencyOffsets[i] += adjacencyOffsets[i - 1];
+		}
+		adjacency.resize(triangles.size() * 3);
+		{
+			eastl::vector<uint32> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (uint32 i = 0; i < triangles.size(); ++i) {
+				for (int j = 0; j < 3; ++j) {
+					adjacency[fill[positionIds[triangles[i][j]]]++] = i;
+				}
+			}
+		}
+
+	 // candidate collapses in both directions along every edge, sorted by error
+		collapses.clear();
+		for (auto& tri : triangles) {
+			for (int i = 0; i < 3; ++i) {
+				uint32 a = positionIds[tri[i]];
+				uint32 b = positionIds[tri[(i + 1) % 3]];
+				if (!isLocked[a]) {
+					collapses.push_back({ a, b, quadrics[a].eval(positions[b]) });
+				}
+				if (!isLocked[b]) {
+					collapses.push_back({ b, a, quadrics[b].eval(positions[a]) });
+				}
+			}
+		}
+		eastl::sort(collapses.begin(), collapses.end(), 
+			[](const Collapse& _a, const Collapse& _b) {
+				return _a.m_error < _b.m_error;
+			});
+
+	 // apply as many collapses as possible; vertices around each collapse are locked for the rest of the pass 
+	 // such that the validity tests above remain correct
+		eastl::fill(touched.begin(), touched.end(), 0);
+		uint32 collapseGoal = APT_MAX((triangleCount - _targetTriangleCount) / 2, 1u);
+		uint32 collapseCount = 0;
+		for (auto& collapse : collapses) {
+			if (collapse.m_error > maxErrorSq || collapseCount >= collapseGoal || triangleCount <= _targetTriangleCount) {
+				break;
+			}
+			if (touched[collapse.m_src] || touched[collapse.m_dst]) {
+				continue;
+			}
+			if (!CanCollapse(collapse.m_src, collapse.m_dst)) {
+				continue;
+			}
+
+			for (uint32 i = adjacencyOffsets[collapse.m_src]; i < adjacencyOffsets[collapse.m_src + 1]; ++i) {
+				Triangle& tri = triangles[adjacency[i]];
+				if (ContainsPosition(tri, collapse.m_dst) >= 0) {
+					--triangleCount; // becomes degenerate, removed below
+				}
+				for (int j = 0; j < 3; ++j) {
+					for (uint32 k = 0; k < wedgeMap.size(); k += 2) {
+						if (wedgeMap[k] == tri[j]) {
+							tri[j] = wedgeMap[k + 1];
+							break;
+						}
+					}
+					touched[positionIds[tri[j]]] = 1;
+				}
+			}
+			touched[collapse.m_src] = 1;
+			quadrics[collapse.m_dst] += quadrics[collapse.m_src];
+			maxError = APT_MAX(maxError, collapse.m_error);
+			++collapseCount;
+		}
+		
+		if (collapseCount == 0) {
+			break;
+		}
+
+	 // remove degenerate triangles (order is preserved, hence triangles remain grouped by submesh)
+		uint32 j = 0;
+		for (uint32 i = 0; i < triangles.size(); ++i) {
+			const Triangle& tri = triangles[i];
+			uint32 a = positionIds[tri.a];
+			uint32 b = positionIds[tri.b];
+			uint32 c = positionIds[tri.c];
+			if (a != b && b != c && c != a) {
+				triangles[j] = tri;
+				triangleSubmeshes[j] = triangleSubmeshes[i];
+				++j;
+			}
+		}
+		triangles.resize(j);
+		triangleSubmeshes.resize(j);
+	}
+
+	m_triangles.swap(triangles);
+	for (uint32 i = 0, j = 0; i < m_submeshes.size(); ++i) {
+		m_submeshes[i].m_indexOffset = j * 3;
+		while (j < triangleSubmeshes.size() && triangleSubmeshes[j] == i) {
+			++j;
+		}
+		m_submeshes[i].m_indexCount = j * 3 - m_submeshes[i].m_indexOffset;
+	}
+	
+	return sqrtf(maxError);
+}
+
+void MeshBuilder::getVertexCacheStats(uint _cacheSize, float& acmr_, float& atvr_) const
+{
+	acmr_ = atvr_ = 0.0f;
+	if (m_triangles.empty()) {
+		return;
+	}
+	uint32 uniqueVertexCount;
+	uint32 transformCount = SimulateVertexCache(m_triangles.data(), getTriangleCount(), 0, getVertexCount(), _cacheSize, &uniqueVertexCount);
+	acmr_ = (float)transformCount / (float)getTriangleCount();
+	atvr_ = (float)transformCount / (float)uniqueVertexCount;
+}
+
+float MeshBuilder::estimateOverdraw(int _resolution) const
+{
+	APT_ASSERT(m_layout == Layout_AoS);
+	if (m_triangles.empty()) {
+		return 0.0f;
+	}
+
+	AlignedBox bounds(m_vertices[0].m_position, m_vertices[0].m_position);
+	for (auto& vert : m_vertices) {
+		bounds.m_min = Min(bounds.m_min, vert.m_position);
+		bounds.m_max = Max(bounds.m_max, vert.m_position);
+	}
+	vec3  extents = bounds.m_max - bounds.m_min;
+	float scale = (float)_resolution / APT_MAX(APT_MAX(extents.x, extents.y), APT_MAX(extents.z, FLT_EPSILON));
+
+	eastl::vector<float> depth(_resolution * _resolution);
+	uint64 shadedCount  = 0;
+	uint64 coveredCount = 0;
+	for (int view = 0; view < 6; ++view) {
+	 // project along axis k, u/v are the remaining 2 axes in cyclic order such that the 2d winding matches the
+	 // k component of the triangle normal; the camera looks along -k for even views and +k for odd views
+		int   k = view / 2;
+		int   ku = (k + 1) % 3;
+		int   kv = (k + 2) % 3;
+		float sign = (view & 1) ? -1.0f : 1.0f;
+		eastl::fill(depth.begin(), depth.end(), FLT_MAX);
+
+		for (auto& tri : m_triangles) {
+			vec3 p[3];
+			for (int i = 0; i < 3; ++i) {
+				vec3 q = (m_vertices[tri[i]].m_position - bounds.m_min) * scale;
+				p[i] = vec3(q[ku], q[kv], -sign * q[k]);
+			}
+			float area = (p[1].x - p[0].x) * (p[2].y - p[0].y) - (p[1].y - p[0].y) * (p[2].x - p[0].x);
+			if (area * sign <= 0.0f) {
+				continue; // back facing or degenerate
+			}
+			if (area < 0.0f) {
+			 // make the winding consistent for the edge functions below
+				eastl::swap(p[1], p[2]);
+				area = -area;
+			}
+			int x0 = APT_CLAMP((int)floorf(APT_MIN(p[0].x, APT_MIN(p[1].x, p[2].x))), 0, _resolution - 1);
+			int x1 = APT_CLAMP((int)ceilf (APT_MAX(p[0].x, APT_MAX(p[1].x, p[2].x))), 0, _resolution - 1);
+			int y0 = APT_CLAMP((int)floorf(APT_MIN(p[0].y, APT_MIN(p[1].y, p[2].y))), 0, _resolution - 1);
+			int y1 = APT_CLAMP((int)ceilf (APT_MAX(p[0].y, APT_MAX(p[1].y, p[2].y))), 0, _resolution - 1);
+			for (int y = y0; y <= y1; ++y) {
+				for (int x = x0; x <= x1; ++x) {
+					float px = (float)x + 0.5f;
+					float py = (float)y + 0.5f;
+					float w0 = (p[2].x - p[1].x) * (py - p[1].y) - (p[2].y - p[1].y) * (px - p[1].x);
+					float w1 = (p[0].x - p[2].x) * (py - p[2].y) - (p[0].y - p[2].y) * (px - p[2].x);
+					float w2 = (p[1].x - p[0].x) * (py - p[0].y) - (p[1].y - p[0].y) * (px - p[0].x);
+					if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f) {
+						continue;
+					}
+					float z = (w0 * p[0].z + w1 * p[1].z + w2 * p[2].z) / area;
+					float& d = depth[y * _resolution + x];
+					if (z < d) {
+						if (d == FLT_MAX) {
+							++coveredCount;
+						}
+						d = z;
+						++shadedCount;
+					}
+				}
+			}
+		}
+	}
+	return coveredCount > 0 ? (float)((double)shadedCount / (double)coveredCount) : 0.0f;
+}
+
+uint32 MeshBuilder::addTriangle(uint32 _a, uint32 _b, uint32 _c)
+{
+	return addTriangle(Triangle(_a, _b, _c));
+}
 
 uint32 MeshBuilder::addTriangle(const Triangle& _triangle)
 {
@@ -720,7 +3179,12 @@ uint32 MeshBuilder::addTriangle(const Triangle& _triangle)
 uint32 MeshBuilder::addVertex(const Vertex& _vertex)
 {
 	uint32 ret = getVertexCount();
-	m_vertices.push_back(_vertex);
+	if (m_layout == Layout_SoA) {
+		setVertexCount(ret + 1);
+		storeVertex(ret, _vertex);
+	} else {
+		m_vertices.push_back(_vertex);
+	}
 	return ret;
 }
 
@@ -735,6 +3199,7 @@ void MeshBuilder::addVertexData(const MeshDesc& _desc, const void* _data, uint32
 				case VertexAttr::Semantic_Positions: 
 					APT_ASSERT(srcAttr.getCount() <= 3);
 					DataTypeConvert(srcAttr.getDataType(), DataType_Float32, src + srcAttr.getOffset(), &v.m_position.x, srcAttr.getCount());
+					v.m_position = v.m_position * _desc.getPositionScale() + _desc.getPositionBias();
 					break;
 				case VertexAttr::Semantic_Texcoords:
 					APT_ASSERT(srcAttr.getCount() <= 2);
@@ -742,11 +3207,23 @@ void MeshBuilder::addVertexData(const MeshDesc& _desc, const void* _data, uint32
 					break;
 				case VertexAttr::Semantic_Normals:
 					APT_ASSERT(srcAttr.getCount() <= 3);
-					DataTypeConvert(srcAttr.getDataType(), DataType_Float32, src + srcAttr.getOffset(), &v.m_normal.x, srcAttr.getCount());
+					if (srcAttr.getEncoding() == VertexAttr::Encoding_Octahedral) {
+						v.m_normal = OctahedralDecode(srcAttr.getDataType(), src + srcAttr.getOffset());
+					} else {
+						DataTypeConvert(srcAttr.getDataType(), DataType_Float32, src + srcAttr.getOffset(), &v.m_normal.x, srcAttr.getCount());
+					}
 					break;
 				case VertexAttr::Semantic_Tangents:
 					APT_ASSERT(srcAttr.getCount() <= 4);
-					DataTypeConvert(srcAttr.getDataType(), DataType_Float32, src + srcAttr.getOffset(), &v.m_tangent.x, srcAttr.getCount());
+					if (srcAttr.getEncoding() == VertexAttr::Encoding_Octahedral) {
+						v.m_tangent = vec4(OctahedralDecode(srcAttr.getDataType(), src + srcAttr.getOffset()), 1.0f);
+						if (srcAttr.getCount() > 2) {
+							DataTypeConvert(srcAttr.getDataType(), DataType_Float32, src + srcAttr.getOffset() + 2 * DataTypeSizeBytes(srcAttr.getDataType()), &v.m_tangent.w);
+							v.m_tangent.w = v.m_tangent.w < 0.0f ? -1.0f : 1.0f;
+						}
+					} else {
+						DataTypeConvert(srcAttr.getDataType(), DataType_Float32, src + srcAttr.getOffset(), &v.m_tangent.x, srcAttr.getCount());
+					}
 					break;
 				case VertexAttr::Semantic_Colors:
 					APT_ASSERT(srcAttr.getCount() <= 4);
@@ -765,7 +3242,7 @@ void MeshBuilder::addVertexData(const MeshDesc& _desc, const void* _data, uint32
 						
 			};
 		}
-		m_vertices.push_back(v);
+		addVertex(v);
 		src += _desc.getVertexSize();
 	}
 }
@@ -783,7 +3260,23 @@ void MeshBuilder::addIndexData(DataType _type, const void* _data, uint32 _count)
 
 void MeshBuilder::setVertexCount(uint32 _count)
 {
-	m_vertices.resize(_count);
+	if (m_layout == Layout_SoA) {
+		for (int i = 0; i < VertexAttr::Semantic_BoneIndices; ++i) {
+			if (m_streamMask & (1u << i)) {
+				for (int j = 0; j < kStreamComponentCount[i]; ++j) {
+					m_streams[i][j].resize(_count, 0.0f);
+				}
+			}
+		}
+		if (m_streamMask & (1u << VertexAttr::Semantic_BoneIndices)) {
+			for (int j = 0; j < 4; ++j) {
+				m_boneIndexStreams[j].resize(_count, 0);
+			}
+		}
+		m_streamVertexCount = _count;
+	} else {
+		m_vertices.resize(_count);
+	}
 }
 void MeshBuilder::setTriangleCount(uint32 _count)
 {
@@ -805,19 +3298,94 @@ MeshData::Submesh& MeshBuilder::beginSubmesh(uint _materialId)
 void MeshBuilder::endSubmesh()
 {
 	MeshData::Submesh& submesh = m_submeshes.back();
-	submesh.m_vertexCount = m_vertices.size() - submesh.m_vertexOffset;
+	submesh.m_vertexCount = getVertexCount() - submesh.m_vertexOffset;
 	submesh.m_indexCount  = m_triangles.size() * 3 - submesh.m_indexOffset;
 	if (submesh.m_vertexCount == 0) {
 		return;
 	}
-	submesh.m_boundingBox.m_min = submesh.m_boundingBox.m_max = m_vertices[submesh.m_vertexOffset].m_position;
-	for (uint i = submesh.m_vertexOffset + 1, n = submesh.m_vertexOffset + submesh.m_vertexCount; i < n; ++i) {
-		submesh.m_boundingBox.m_min = min(submesh.m_boundingBox.m_min, m_vertices[i].m_position);
-		submesh.m_boundingBox.m_max = max(submesh.m_boundingBox.m_max, m_vertices[i].m_position);
-	}
-	submesh.m_boundingSphere = Sphere(submesh.m_boundingBox);
+	computeBounds(submesh.m_vertexOffset, submesh.m_vertexCount, submesh.m_boundingBox, submesh.m_boundingSphere, submesh.m_boundingOrientedBox);
 
+ // grow the whole mesh bounds (conservative, updateBounds() computes tight bounds from all vertices)
+	if (m_submeshes.size() == 1) {
+		m_boundingBox         = submesh.m_boundingBox;
+		m_boundingSphere      = submesh.m_boundingSphere;
+		m_boundingOrientedBox = submesh.m_boundingOrientedBox;
+		return;
+	}
 	m_boundingBox.m_min = Min(m_boundingBox.m_min, submesh.m_boundingBox.m_min);
 	m_boundingBox.m_max = Max(m_boundingBox.m_max, submesh.m_boundingBox.m_max);
-	m_boundingSphere    = Sphere(m_boundingBox);
+	m_boundingSphere    = BoundingSphere(m_boundingSphere, submesh.m_boundingSphere);
+	if (Sphere(m_boundingBox).m_radius < m_boundingSphere.m_radius) {
+		m_boundingSphere = Sphere(m_boundingBox);
+	}
+	m_boundingOrientedBox = OrientedBox(m_boundingBox);
+}
+
+// PRIVATE
+
+void MeshBuilder::computeBounds(uint32 _vertexOffset, uint32 _vertexCount, AlignedBox& box_, Sphere& sphere_, OrientedBox& orientedBox_) const
+{
+	if (m_layout == Layout_SoA) {
+		APT_ASSERT(hasStream(VertexAttr::Semantic_Positions));
+		eastl::vector<vec3> positions(_vertexCount);
+		for (int i = 0; i < 3; ++i) {
+			const float* stream = getStream(VertexAttr::Semantic_Positions, i) + _vertexOffset;
+			MinMaxStream(stream, _vertexCount, box_.m_min[i], box_.m_max[i]);
+			for (uint32 j = 0; j < _vertexCount; ++j) {
+				positions[j][i] = stream[j];
+			}
+		}
+		sphere_      = BoundingSphere(positions.data(), _vertexCount);
+		orientedBox_ = BoundingOrientedBox(positions.data(), _vertexCount);
+		return;
+	}
+	const vec3* positions = &m_vertices[_vertexOffset].m_position;
+	box_         = BoundingBox(positions, _vertexCount, sizeof(Vertex));
+	sphere_      = BoundingSphere(positions, _vertexCount, sizeof(Vertex));
+	orientedBox_ = BoundingOrientedBox(positions, _vertexCount, sizeof(Vertex));
+}
+
+void MeshBuilder::loadVertex(uint32 _i, Vertex& out_) const
+{
+	APT_ASSERT(_i < getVertexCount());
+	if (m_layout == Layout_AoS) {
+		out_ = m_vertices[_i];
+		return;
+	}
+	memset(&out_, 0, sizeof(Vertex));
+	float* dst[VertexAttr::Semantic_BoneIndices] = { &out_.m_position.x, &out_.m_texcoord.x, &out_.m_normal.x, &out_.m_tangent.x, &out_.m_color.x, &out_.m_boneWeights.x };
+	for (int i = 0; i < VertexAttr::Semantic_BoneIndices; ++i) {
+		if (m_streamMask & (1u << i)) {
+			for (int j = 0; j < kStreamComponentCount[i]; ++j) {
+				dst[i][j] = m_streams[i][j][_i];
+			}
+		}
+	}
+	if (m_streamMask & (1u << VertexAttr::Semantic_BoneIndices)) {
+		for (int j = 0; j < 4; ++j) {
+			out_.m_boneIndices[j] = m_boneIndexStreams[j][_i];
+		}
+	}
+}
+
+void MeshBuilder::storeVertex(uint32 _i, const Vertex& _vertex)
+{
+	APT_ASSERT(_i < getVertexCount());
+	if (m_layout == Layout_AoS) {
+		m_vertices[_i] = _vertex;
+		return;
+	}
+	const float* src[VertexAttr::Semantic_BoneIndices] = { &_vertex.m_position.x, &_vertex.m_texcoord.x, &_vertex.m_normal.x, &_vertex.m_tangent.x, &_vertex.m_color.x, &_vertex.m_boneWeights.x };
+	for (int i = 0; i < VertexAttr::Semantic_BoneIndices; ++i) {
+		if (m_streamMask & (1u << i)) {
+			for (int j = 0; j < kStreamComponentCount[i]; ++j) {
+				m_streams[i][j][_i] = src[i][j];
+			}
+		}
+	}
+	if (m_streamMask & (1u << VertexAttr::Semantic_BoneIndices)) {
+		for (int j = 0; j < 4; ++j) {
+			m_boneIndexStreams[j][_i] = _vertex.m_boneIndices[j];
+		}
+	}
 }
@@ -32,20 +32,30 @@ public:
 
 		Semantic_Count
 	};
+
+	enum Encoding : uint8
+	{
+		Encoding_None,
+		Encoding_Octahedral, // Normals/tangents only, 2 components (+ the bitangent sign as a 3rd component for tangents).
+
+		Encoding_Count
+	};
 	
 	VertexAttr()
 		: m_semantic(Semantic_Count)
 		, m_dataType(apt::DataType_Invalid)
 		, m_count(0)
 		, m_offset(0)
+		, m_encoding(Encoding_None)
 	{
 	}
 
-	VertexAttr(Semantic _semantic, apt::DataType _dataType, uint8 _count)
+	VertexAttr(Semantic _semantic, apt::DataType _dataType, uint8 _count, Encoding _encoding = Encoding_None)
 		: m_semantic(_semantic)
 		, m_dataType(_dataType)
 		, m_count(_count)
 		, m_offset(0)
+		, m_encoding(_encoding)
 	{
 	}
 
@@ -56,11 +66,13 @@ public:
 	uint8         getCount() const                      { return m_count;              }
 	uint8         getOffset() const                     { return m_offset;             }
 	uint8         getSize() const                       { return m_count * (uint8)apt::DataTypeSizeBytes(getDataType()); }
+	Encoding      getEncoding() const                   { return (Encoding)m_encoding; }
 
 	void          setSemantic(Semantic _semantic)       { m_semantic   = _semantic;    }
 	void          setDataType(apt::DataType _dataType)  { m_dataType   = _dataType;    }
 	void          setCount(uint8 _count)                { m_count      = _count;       }
 	void          setOffset(uint8 _offset)              { m_offset     = _offset;      }
+	void          setEncoding(Encoding _encoding)       { m_encoding   = _encoding;    }
 
 	bool operator==(const VertexAttr& _lhs) const;
 	bool operator!=(const VertexAttr& _lhs) const  { return !(*this == _lhs); }
@@ -70,6 +82,7 @@ private:
 	apt::DataType m_dataType;  // Data type per component.
 	uint8         m_count;     // Number of components (1,2,3 or 4).
 	uint8         m_offset;    // Byte offset of the first component.
+	uint8         m_encoding;  // How the components map to the semantic data.
 
 }; // class VertexAttr
 
@@ -96,6 +109,8 @@ public:
 		: m_vertexAttrCount(0)
 		, m_vertexSize(0)
 		, m_primitive(_prim)
+		, m_positionScale(1.0f)
+		, m_positionBias(0.0f)
 	{
 	}
 
@@ -105,7 +120,8 @@ public:
 	VertexAttr* addVertexAttr(
 		VertexAttr::Semantic _semantic, 
 		apt::DataType        _dataType,
-		uint8                _count
+		uint8                _count,
+		VertexAttr::Encoding _encoding = VertexAttr::Encoding_None
 		);
 
 	// \todo This version doesn't ensure 4 byte alignment - test/warn?
@@ -119,6 +135,14 @@ public:
 	void      setPrimitive(Primitive _primitive) { m_primitive = (uint8)_primitive; }
 	uint8     getVertexSize() const              { return m_vertexSize; }
 
+	// Positions are dequantized as p * scale + bias (identity by default). MeshData sets these when converting from a
+	// MeshBuilder if the positions are a normalized integer type, GlContext passes them to shaders as uPositionScale/
+	// uPositionBias.
+	const vec3& getPositionScale() const         { return m_positionScale; }
+	const vec3& getPositionBias() const          { return m_positionBias; }
+	void        setPositionScaleBias(const vec3& _scale, const vec3& _bias) { m_positionScale = _scale; m_positionBias = _bias; }
+	bool        isPositionQuantized() const      { return m_positionScale != vec3(1.0f) || m_positionBias != vec3(0.0f); }
+
 	bool operator==(const MeshDesc& _rhs) const;
 	bool operator!=(const MeshDesc& _lhs) const  { return !(*this == _lhs); }
 
@@ -132,6 +156,8 @@ private:
 	uint8             m_vertexAttrCount;
 	uint8             m_vertexSize;
 	uint8             m_primitive;
+	vec3              m_positionScale;
+	vec3              m_positionBias;
 
 }; // class MeshDesc
 
@@ -150,18 +176,49 @@ public:
 
 	struct Submesh
 	{ 
-		uint       m_indexOffset;  // bytes
-		uint       m_indexCount;
-		uint       m_vertexOffset; // bytes
-		uint       m_vertexCount;
-		uint       m_materialId;
-		AlignedBox m_boundingBox;
-		Sphere     m_boundingSphere;
+		uint        m_indexOffset;  // bytes
+		uint        m_indexCount;
+		uint        m_vertexOffset; // bytes
+		uint        m_vertexCount;
+		uint        m_baseVertex;   // added to the indices when drawing, see MeshData::compactIndexData()
+		uint        m_materialId;
+		AlignedBox  m_boundingBox;
+		Sphere      m_boundingSphere;      // near optimal, see BoundingSphere()
+		OrientedBox m_boundingOrientedBox; // PCA fit, see BoundingOrientedBox()
 
 		Submesh();
 	};
 
+	// Level of detail, an index range which shares the vertex data with the base mesh. LOD 0 is the base mesh (the
+	// whole index range of submesh 0), additional LODs are appended to the index data via addLod(). LODs apply to the
+	// whole mesh, i.e. they don't preserve submeshes.
+	struct Lod
+	{
+		uint  m_indexOffset; // bytes
+		uint  m_indexCount;
+		float m_error;       // simplification error relative to the bounding sphere radius (see MeshBuilder::simplify())
+	};
+
+	// Cluster of triangles, a contiguous index range within a submesh (see MeshBuilder::buildMeshlets()). The normal 
+	// cone bounds the triangle normals: the meshlet is back facing for any view position p where 
+	// dot(normalize(m_coneApex - p), m_coneAxis) >= m_coneCutoff. m_coneCutoff >= 1 disables cone culling.
+	struct Meshlet
+	{
+		uint       m_indexOffset;   // bytes
+		uint       m_indexCount;
+		uint       m_vertexCount;   // unique vertices referenced by the meshlet
+		uint       m_submeshId;
+		Sphere     m_boundingSphere;
+		AlignedBox m_boundingBox;
+		vec3       m_coneApex;
+		vec3       m_coneAxis;
+		float      m_coneCutoff;    // sin(cone half angle)
+	};
+
 	static MeshData* Create(const char* _path);
+	// Parse OBJ data from memory, bypassing the binary cache. If _reference, use the tinyobjloader-based reader (slower,
+	// kept for validation and benchmarking).
+	static MeshData* CreateObj(const char* _data, uint _dataSize, bool _reference = false);
 	static MeshData* Create(
 		const MeshDesc& _desc, 
 		uint            _vertexCount, 
@@ -192,13 +249,27 @@ public:
 		const mat4&     _transform = identity
 		);
 
+	// Return a copy of _desc with the most compact vertex formats for which the quantization error of _meshBuilder's
+	// vertices is within the given budget: positions relative to the largest bounding box extent, normals/tangents as
+	// an angle in radians, texcoords absolute. Positions are quantized relative to the bounding box (see 
+	// MeshDesc::getPositionScale()), normals/tangents are octahedral encoded, colors/bone weights are 8 bit. The vertex
+	// size before and after is written to the log.
+	static MeshDesc PackDesc(
+		const MeshDesc&    _desc,
+		const MeshBuilder& _meshBuilder,
+		float              _maxPositionError = 1e-4f,
+		float              _maxNormalError   = 1e-3f,
+		float              _maxTexcoordError = 1e-4f
+		);
+
 	static void Destroy(MeshData*& _meshData_);
 
 	friend void swap(MeshData& _a, MeshData& _b);
 
 	// Copy vertex data directly from _src. The layout of _src must match the MeshDesc.
 	void setVertexData(const void* _src);
-	// Copy semantic data from _src, converting from _srcType.
+	// Copy semantic data from _src, converting from _srcType. Octahedral normals/tangents (_src has 3/4 components, the
+	// bitangent sign in w) and quantized positions are encoded as per MeshData(MeshBuilder).
 	void setVertexData(VertexAttr::Semantic _semantic, apt::DataType _srcType, uint _srcCount, const void* _src);
 	
 	// Copy index data from _src. The layout of _src must match the index data type/count.
@@ -214,10 +285,33 @@ public:
 	uint            getIndexCount() const         { return m_submeshes[0].m_indexCount; }
 	const void*     getIndexData() const          { return m_indexData; }
 	apt::DataType   getIndexDataType() const      { return m_indexDataType; }
+	int             getSubmeshCount() const       { return (int)m_submeshes.size(); }
+	const Submesh&  getSubmesh(int _i) const      { APT_ASSERT(_i < getSubmeshCount()); return m_submeshes[_i]; }
 
 	const Skeleton* getBindPose() const                { return m_bindPose; }
 	void            setBindPose(const Skeleton& _skel);
 
+	// Append a LOD. _meshBuilder must contain the same vertices as the base mesh (e.g. a copy of the MeshBuilder used
+	// to create the base mesh after a call to simplify()), _error is the value returned by simplify().
+	void            addLod(const MeshBuilder& _meshBuilder, float _error);
+	int             getLodCount() const                { return (int)m_lods.size() + 1; }
+	Lod             getLod(int _i) const;
+
+	uint            getMeshletCount() const            { return (uint)m_meshlets.size(); }
+	const Meshlet&  getMeshlet(uint _i) const          { APT_ASSERT(_i < getMeshletCount()); return m_meshlets[_i]; }
+
+	// Compact the index data (e.g. when baking assets), return the number of bytes saved. Call after addLod().
+	// Indices are narrowed to DataType_Uint16 if the vertex range of each submesh fits, rebasing them relative to 
+	// the first vertex of the submesh if necessary (see Submesh::m_baseVertex, not possible if there are LODs). If 
+	// _strips, the triangle lists are converted to strips separated by primitive restart indices (the max value of
+	// the index type, see GL_PRIMITIVE_RESTART_FIXED_INDEX) if that reduces the total index count. Meshes with
+	// meshlets or a primitive other than Primitive_Triangles are not converted.
+	uint            compactIndexData(bool _strips = false);
+	// If true, submesh indices are relative to Submesh::m_baseVertex and submesh 0 can't be drawn as a single range.
+	bool            hasRebasedIndices() const;
+	// Decode submesh 0 to a triangle list with absolute vertex indices (i.e. undo compactIndexData()).
+	void            getTriangles(eastl::vector<uint32>& out_) const;
+
 protected:
 	apt::String<32> m_path; // empty if not from a file
 	Skeleton*       m_bindPose;
@@ -227,6 +321,14 @@ protected:
 	apt::DataType   m_indexDataType;
 
 	eastl::vector<Submesh> m_submeshes;
+	eastl::vector<Lod>     m_lods;        // LODs > 0
+	eastl::vector<Meshlet> m_meshlets;    // only for the base mesh
+	MappedFile*     m_mappedFile;         // if not null, m_vertexData/m_indexData point into the mapped file (see ReadBin())
+
+	// Total index count including LODs.
+	uint getIndexDataCount() const;
+	// Copy vertex/index data out of m_mappedFile and release it, call before reallocating the data.
+	void releaseMappedFile();
 
 	// \todo 
 	void beginSubmesh(uint _materialId);
@@ -242,9 +344,16 @@ protected:
 
 	
 	static bool ReadObj(MeshData& mesh_, const char* _srcData, uint _srcDataSize);
+	static bool ReadObjTinyobj(MeshData& mesh_, const char* _srcData, uint _srcDataSize); // reference implementation
 	static bool ReadMd5(MeshData& mesh_, const char* _srcData, uint _srcDataSize);
 	static bool ReadBlend(MeshData& mesh_, const char* _srcData, uint _srcDataSize);
 
+	// Binary cache, see MeshData_bin.cpp. ReadBin() fails if the file doesn't exist or _sourceHash doesn't match.
+	// If _compress, the vertex/index data are encoded with MeshCodec and decoded by ReadBin() directly into
+	// m_vertexData/m_indexData, else ReadBin() uses them in place from the mapped file.
+	static bool ReadBin(MeshData& mesh_, const char* _path, uint64 _sourceHash);
+	static bool WriteBin(const MeshData& _mesh, const char* _path, uint64 _sourceHash, bool _compress = true);
+
 }; // class MeshData
 
 
@@ -252,11 +361,26 @@ protected:
 // MeshBuilder
 // Mesh construction/manipulation tools.
 // Unlike Mesh, the submesh 0 has no special meaning. 
+// By default vertices are stored as an array of Vertex (Layout_AoS). In 
+// Layout_SoA each component of each requested semantic is a separate planar
+// stream; transform(), transformTexcoords(), transformColors(),
+// normalizeBoneWeights(), generateNormals() and updateBounds() operate directly
+// on the streams (with SIMD where available). getVertex(), generateTangents(),
+// the optimize functions, buildMeshlets(), simplify() and estimateOverdraw()
+// require Layout_AoS.
 ////////////////////////////////////////////////////////////////////////////////
 class MeshBuilder
 {
 	friend class MeshData;
 public:
+	enum Layout
+	{
+		Layout_AoS,
+		Layout_SoA,
+
+		Layout_Count
+	};
+
 	struct Vertex
 	{
 		vec3   m_position;
@@ -282,18 +406,76 @@ public:
 		{ 
 			return (&a)[_i]; 
 		}
+		const uint32& operator[](int _i) const
+		{ 
+			return (&a)[_i]; 
+		}
 	};
 
 	MeshBuilder();
 
+	// Convert the vertex storage to _layout. For Layout_SoA only semantics in _semanticMask (bits 
+	// 1 << VertexAttr::Semantic) are allocated, data for other semantics is discarded.
+	void               setLayout(Layout _layout, uint32 _semanticMask = ~0u);
+	Layout             getLayout() const            { return m_layout; }
+	bool               hasStream(VertexAttr::Semantic _semantic) const;
+	// Planar stream for _component of _semantic (Layout_SoA only), e.g. getStream(Semantic_Positions, 1) are the y 
+	// coordinates. Bone indices are uint32 (see getBoneIndexStream()).
+	float*             getStream(VertexAttr::Semantic _semantic, int _component);
+	const float*       getStream(VertexAttr::Semantic _semantic, int _component) const;
+	uint32*            getBoneIndexStream(int _component);
+
 	void               transform(const mat4& _mat);
 	void               transformTexcoords(const mat3& _mat);
 	void               transformColors(const mat4& _mat);
 	void               normalizeBoneWeights();
+	// Normals/tangents are accumulated per vertex from the adjacent triangles in triangle order, multi-threaded but 
+	// with results which are identical to a serial loop (independent of the thread count).
 	void               generateNormals();
-	void               generateTangents();
+	// If _mikkTSpace, the tangents follow the MikkTSpace conventions (angle-weighted, orthogonal to the vertex normal,
+	// w = bitangent sign) and require valid normals. Vertices shared by faces with mirrored texcoords are split as in
+	// MikkTSpace's default mode (the vertex count may increase, submesh vertex ranges are updated), but faces with the
+	// same orientation aren't further split into disconnected groups. Otherwise w = 1.
+	void               generateTangents(bool _mikkTSpace = false);
+	// Bounding box, sphere and oriented box of all vertices (submesh bounds are computed by endSubmesh()).
 	void               updateBounds();
 
+	// Merge vertices for which the distance between each attribute is <= _epsilon[semantic] (indexed by 
+	// VertexAttr::Semantic; a negative epsilon ignores the semantic, nullptr merges only identical vertices) and remap 
+	// the triangles, degenerate triangles are removed. Candidates are found via a spatial hash on the positions, the
+	// search is multi-threaded for meshes over 1M vertices. All submeshes are processed in a single pass but vertices
+	// are only merged within a submesh, such that the submesh vertex ranges remain valid. Each vertex is merged into the
+	// target of the lowest indexed compatible vertex; compatibility isn't transitive, hence for a non-zero epsilon the 
+	// result depends on the vertex order (a vertex may be merged into a target further than epsilon away, or two 
+	// compatible vertices may remain separate). Return the number of vertices removed.
+	uint32             weld(const float* _epsilon = nullptr);
+	// Reorder triangles within each submesh to improve post-transform vertex cache efficiency (Forsyth's algorithm).
+	void               optimizeVertexCache();
+	// Reorder vertices within each submesh to match the order in which they are first referenced by the triangles
+	// (improves pre-transform cache efficiency). Call after optimizeVertexCache().
+	void               optimizeVertexFetch();
+	// Partition the triangles of each submesh into clusters and sort the clusters such that those likely to occlude
+	// others are drawn first (reduces overdraw for opaque meshes). Call after optimizeVertexCache(); clusters are split 
+	// as long as the ACMR of the result is within _threshold * the original ACMR (e.g. 1.05 allows a 5% loss).
+	void               optimizeOverdraw(float _threshold = 1.05f);
+	// Reorder the triangles of each submesh into meshlets of at most _maxVertices unique vertices/_maxTriangles 
+	// triangles and compute the meshlet bounds/normal cones. Call after the other optimize functions; weld(), 
+	// optimizeVertexCache(), optimizeOverdraw(), simplify() and vertex splits in generateTangents() discard the meshlets.
+	void               buildMeshlets(uint _maxVertices = 64, uint _maxTriangles = 124);
+	// Reduce the triangle count to _targetTriangleCount via quadric error edge collapse, or until the error would 
+	// exceed _maxError (relative to the bounding sphere radius). Return the error of the result. Only the triangles are
+	// modified (collapses are to existing vertices), hence the result can share the vertex data with the original mesh. 
+	// UV/normal seams (vertices with the same position but different attributes) and mesh borders are preserved, 
+	// vertices with different dominant bones are not collapsed.
+	float              simplify(uint32 _targetTriangleCount, float _maxError = 1.0f);
+	// Simulate a FIFO post-transform cache with _cacheSize entries. acmr_ is the average number of vertex transforms
+	// per triangle (0.5 is optimal for large regular meshes, 3 is the worst case), atvr_ is the average number of 
+	// transforms per referenced vertex (1 is optimal).
+	void               getVertexCacheStats(uint _cacheSize, float& acmr_, float& atvr_) const;
+	// Rasterize the mesh from 6 axis-aligned orthographic views with back face culling and a depth test, return the
+	// average number of shaded fragments per covered pixel (1 is optimal).
+	float              estimateOverdraw(int _resolution = 256) const;
+
 	uint32             addTriangle(uint32 _a, uint32 _b, uint32 _c);
 	uint32             addTriangle(const Triangle& _triangle);
 	uint32             addVertex(const Vertex& _vertex);
@@ -307,26 +489,43 @@ public:
 	MeshData::Submesh& beginSubmesh(uint _materialId); // invalidates any references previously returned
 	void               endSubmesh();
 
-	Vertex&            getVertex(uint32 _i)         { APT_ASSERT(_i < getVertexCount()); return m_vertices[_i]; }
-	const Vertex&      getVertex(uint32 _i) const   { APT_ASSERT(_i < getVertexCount()); return m_vertices[_i]; }
+	Vertex&            getVertex(uint32 _i)         { APT_ASSERT(m_layout == Layout_AoS && _i < getVertexCount()); return m_vertices[_i]; }
+	const Vertex&      getVertex(uint32 _i) const   { APT_ASSERT(m_layout == Layout_AoS && _i < getVertexCount()); return m_vertices[_i]; }
 	Triangle&          getTriangle(uint32 _i)       { APT_ASSERT(_i < getTriangleCount()); return m_triangles[_i]; }
 	const Triangle&    getTriangle(uint32 _i) const { APT_ASSERT(_i < getTriangleCount()); return m_triangles[_i]; }
-	uint32             getVertexCount() const       { return (uint32)m_vertices.size(); }
+	uint32             getVertexCount() const       { return m_layout == Layout_AoS ? (uint32)m_vertices.size() : m_streamVertexCount; }
 	uint32             getTriangleCount() const     { return (uint32)m_triangles.size(); }
 	uint32             getIndexCount() const        { return (uint32)m_triangles.size() * 3; }
 	MeshData::Submesh& getSubmesh(uint32 _i)        { APT_ASSERT(_i < getSubmeshCount()); return m_submeshes[_i]; }
-	uint32             getSubmeshCount() const      { (uint32)m_submeshes.size(); }
+	uint32             getSubmeshCount() const      { return (uint32)m_submeshes.size(); }
+	const MeshData::Meshlet& getMeshlet(uint32 _i) const { APT_ASSERT(_i < getMeshletCount()); return m_meshlets[_i]; }
+	uint32             getMeshletCount() const      { return (uint32)m_meshlets.size(); }
 	const AlignedBox&  getBoundingBox() const       { return m_boundingBox; }
 	const Sphere&      getBoundingSphere() const    { return m_boundingSphere; }
+	const OrientedBox& getBoundingOrientedBox() const { return m_boundingOrientedBox; }
 
 
 private:
-	eastl::vector<Vertex>            m_vertices;
+	Layout                           m_layout;
+	eastl::vector<Vertex>            m_vertices;   // Layout_AoS
+	eastl::vector<float>             m_streams[VertexAttr::Semantic_BoneIndices][4]; // Layout_SoA, indexed by semantic/component
+	eastl::vector<uint32>            m_boneIndexStreams[4];
+	uint32                           m_streamMask;
+	uint32                           m_streamVertexCount;
 	eastl::vector<Triangle>          m_triangles;
 	eastl::vector<MeshData::Submesh> m_submeshes;  // vertex/index offsets are not bytes here
+	eastl::vector<MeshData::Meshlet> m_meshlets;   // index offsets are not bytes here, submesh IDs don't include MeshData's submesh 0
+
+	AlignedBox  m_boundingBox;
+	Sphere      m_boundingSphere;
+	OrientedBox m_boundingOrientedBox;
+
+	// Bounds of vertices [_vertexOffset, _vertexOffset + _vertexCount).
+	void computeBounds(uint32 _vertexOffset, uint32 _vertexCount, AlignedBox& box_, Sphere& sphere_, OrientedBox& orientedBox_) const;
 
-	AlignedBox m_boundingBox;
-	Sphere     m_boundingSphere;
+	// Copy vertex _i to/from either layout. Semantics without a stream are zeroed on load.
+	void loadVertex(uint32 _i, Vertex& out_) const;
+	void storeVertex(uint32 _i, const Vertex& _vertex);
 
 }; // class MeshBuilder
 
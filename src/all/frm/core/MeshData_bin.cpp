@@ -0,0 +1,288 @@
+#include "MeshData.h"
+
+#include <frm/core/MappedFile.h>
+#include <frm/core/MeshCodec.h>
+
+#include <apt/log.h>
+#include <apt/memory.h>
+#include <apt/File.h>
+
+#include <EASTL/vector.h>
+
+#include <cstring>
+
+using namespace frm;
+using namespace apt;
+
+// Binary mesh cache layout: BinHeader followed by the sections, each aligned to kBinAlignment relative to the start of
+// the file such that the vertex/index data can be uploaded directly from the mapped file. Structs are written as-is,
+// hence the cache isn't portable between platforms/compilers (it's a cache, not an interchange format).
+// If BinFlag_Compressed is set the vertex/index sections are encoded (see MeshCodec.h) and decoded on load, else they
+// are used in place.
+static const char   kBinMagic[4]  = { 'F', 'R', 'M', 'M' };
+static const uint32 kBinVersion   = 7; // increment when changing the layout or the output of any of the readers
+static const uint64 kBinAlignment = 16;
+
+enum BinFlag
+{
+	BinFlag_Compressed = 1 << 0,
+};
+
+struct BinHeader
+{
+	char   m_magic[4];
+	uint32 m_version;
+	uint64 m_sourceHash;
+	uint64 m_descHash;
+	uint64 m_fileSize;
+
+	uint32 m_vertexCount;
+	uint32 m_indexDataCount;   // including LODs
+	uint32 m_indexDataType;
+	uint32 m_submeshCount;
+	uint32 m_lodCount;         // LODs > 0
+	uint32 m_meshletCount;
+	uint32 m_boneCount;
+	uint32 m_flags;
+
+	uint64 m_descOffset;
+	uint64 m_vertexDataOffset;
+	uint64 m_indexDataOffset;
+	uint64 m_submeshOffset;
+	uint64 m_lodOffset;
+	uint64 m_meshletOffset;
+	uint64 m_boneOffset;
+	uint64 m_vertexDataSize;   // size of the vertex/index sections (encoded size if BinFlag_Compressed)
+	uint64 m_indexDataSize;
+};
+
+struct BinBone
+{
+	char           m_name[32];
+	Skeleton::Bone m_bone;
+	mat4           m_pose; // the bind pose is stored inverted, i.e. not the result of Skeleton::resolve()
+};
+
+// True if _count elements of _stride bytes at _offset lie within _size bytes, without overflowing.
+static bool InRange(uint64 _offset, uint64 _count, uint64 _stride, uint64 _size)
+{
+	if (_offset > _size) {
+		return false;
+	}
+	return _stride == 0 || _count <= (_size - _offset) / _stride;
+}
+
+bool MeshData::ReadBin(MeshData& mesh_, const char* _path, uint64 _sourceHash)
+{
+	MappedFile* file = MappedFile::Create(_path);
+	if (!file) {
+		return false;
+	}
+	const char* data     = file->getData();
+	uint64      dataSize = file->getDataSize();
+	if (dataSize < sizeof(BinHeader)) {
+		MappedFile::Destroy(file);
+		return false;
+	}
+	const BinHeader& header = *((const BinHeader*)data);
+	if (memcmp(header.m_magic, kBinMagic, sizeof(kBinMagic)) != 0 ||
+		header.m_version    != kBinVersion ||
+		header.m_sourceHash != _sourceHash ||
+		header.m_fileSize   != dataSize
+		) {
+		MappedFile::Destroy(file);
+		return false;
+	}
+
+ // validate every section against the mapped size before it's accessed, the cache may be truncated or corrupt
+	if (!InRange(header.m_descOffset,        1,                        sizeof(MeshDesc), dataSize) ||
+		!InRange(header.m_vertexDataOffset,  header.m_vertexDataSize,  1,                dataSize) ||
+		!InRange(header.m_indexDataOffset,   header.m_indexDataSize,   1,                dataSize) ||
+		!InRange(header.m_submeshOffset,     header.m_submeshCount,    sizeof(Submesh),  dataSize) ||
+		!InRange(header.m_lodOffset,         header.m_lodCount,        sizeof(Lod),      dataSize) ||
+		!InRange(header.m_meshletOffset,     header.m_meshletCount,    sizeof(Meshlet),  dataSize) ||
+		!InRange(header.m_boneOffset,        header.m_boneCount,       sizeof(BinBone),  dataSize) ||
+		header.m_submeshCount == 0 || // submesh 0 is the whole mesh, see getVertexCount()
+		(header.m_indexDataType != DataType_Uint8 && header.m_indexDataType != DataType_Uint16 && header.m_indexDataType != DataType_Uint32)
+		) {
+		APT_LOG_ERR("MeshData: Invalid binary cache '%s'", _path);
+		MappedFile::Destroy(file);
+		return false;
+	}
+	memcpy(&mesh_.m_desc, data + header.m_descOffset, sizeof(MeshDesc));
+	bool descValid = mesh_.m_desc.getVertexAttrCount() <= VertexAttr::Semantic_Count + 1 // else getHash() reads past the attr array
+		&& mesh_.m_desc.getVertexSize() > 0
+		;
+	for (int i = 0; descValid && i < mesh_.m_desc.getVertexAttrCount(); ++i) {
+	 // the vertex size isn't part of the desc hash
+		const VertexAttr& attr = mesh_.m_desc[i];
+		descValid = attr.getOffset() + attr.getSize() <= mesh_.m_desc.getVertexSize();
+	}
+	if (!descValid) {
+		APT_LOG_ERR("MeshData: Invalid binary cache '%s'", _path);
+		MappedFile::Destroy(file);
+		return false;
+	}
+	if (mesh_.m_desc.getHash() != header.m_descHash) {
+		MappedFile::Destroy(file);
+		return false;
+	}
+	mesh_.m_indexDataType = (DataType)header.m_indexDataType;
+	uint64 vertexDataSize = (uint64)mesh_.m_desc.getVertexSize() * header.m_vertexCount;
+	uint64 indexDataSize  = (uint64)DataTypeSizeBytes(mesh_.m_indexDataType) * header.m_indexDataCount;
+	bool sizesValid = (header.m_flags & BinFlag_Compressed)
+		? vertexDataSize <= ~0u && indexDataSize <= ~0u && header.m_vertexDataSize <= ~0u && header.m_indexDataSize <= ~0u
+		: vertexDataSize == header.m_vertexDataSize && indexDataSize == header.m_indexDataSize
+		;
+	if (!sizesValid) {
+		APT_LOG_ERR("MeshData: Invalid binary cache '%s'", _path);
+		MappedFile::Destroy(file);
+		return false;
+	}
+
+ // index/vertex ranges must lie within the (decoded) data, else draws read past the buffers
+	const Submesh* submeshes = (const Submesh*)(data + header.m_submeshOffset);
+	const Lod*     lods      = (const Lod*)(data + header.m_lodOffset);
+	const Meshlet* meshlets  = (const Meshlet*)(data + header.m_meshletOffset);
+	const uint64   indexSize  = DataTypeSizeBytes(mesh_.m_indexDataType);
+	const uint64   vertexSize = mesh_.m_desc.getVertexSize();
+	bool rangesValid = submeshes[0].m_vertexCount == header.m_vertexCount;
+	for (uint32 i = 0; i < header.m_submeshCount; ++i) {
+		const Submesh& submesh = submeshes[i];
+		rangesValid &= InRange(submesh.m_indexOffset, submesh.m_indexCount, indexSize, indexDataSize);
+		rangesValid &= InRange(submesh.m_vertexOffset, submesh.m_vertexCount, vertexSize, vertexDataSize);
+	}
+	for (uint32 i = 0; i < header.m_lodCount; ++i) {
+		rangesValid &= InRange(lods[i].m_indexOffset, lods[i].m_indexCount, indexSize, indexDataSize);
+	}
+	for (uint32 i = 0; i < header.m_meshletCount; ++i) {
+		const Meshlet& meshlet = meshlets[i];
+		rangesValid &= InRange(meshlet.m_indexOffset, meshlet.m_indexCount, indexSize, indexDataSize);
+		rangesValid &= meshlet.m_submeshId < header.m_submeshCount && meshlet.m_vertexCount <= header.m_vertexCount;
+	}
+	if (!rangesValid) {
+		APT_LOG_ERR("MeshData: Invalid binary cache '%s'", _path);
+		MappedFile::Destroy(file);
+		return false;
+	}
+
+	const BinBone* bones = (const BinBone*)(data + header.m_boneOffset);
+	for (uint32 i = 0; i < header.m_boneCount; ++i) {
+		int parentIndex = bones[i].m_bone.m_parentIndex;
+		if (bones[i].m_name[sizeof(bones[i].m_name) - 1] != '\0' || parentIndex < -1 || parentIndex >= (int)i) {
+			APT_LOG_ERR("MeshData: Invalid binary cache '%s'", _path);
+			MappedFile::Destroy(file);
+			return false;
+		}
+	}
+
+ // vertex/index data are either decoded into new allocations or used in place, only the small per-mesh arrays are copied
+	if (header.m_flags & BinFlag_Compressed) {
+		mesh_.m_vertexData  = vertexDataSize ? (char*)APT_MALLOC(vertexDataSize) : nullptr;
+		mesh_.m_indexData   = indexDataSize  ? (char*)APT_MALLOC(indexDataSize)  : nullptr;
+		bool ret = true;
+		ret &= !mesh_.m_vertexData || DecodeVertexData(data + header.m_vertexDataOffset, (uint)header.m_vertexDataSize, header.m_vertexCount, mesh_.m_desc.getVertexSize(), mesh_.m_vertexData);
+		ret &= !mesh_.m_indexData  || DecodeIndexData(data + header.m_indexDataOffset, (uint)header.m_indexDataSize, mesh_.m_indexDataType, header.m_indexDataCount, mesh_.m_indexData);
+		if (!ret) {
+			APT_LOG_ERR("MeshData: Failed to decode binary cache '%s'", _path);
+			APT_FREE(mesh_.m_vertexData);
+			APT_FREE(mesh_.m_indexData);
+			mesh_.m_vertexData = mesh_.m_indexData = nullptr;
+			MappedFile::Destroy(file);
+			return false;
+		}
+	} else {
+		mesh_.m_vertexData  = header.m_vertexCount    ? file->getData() + header.m_vertexDataOffset : nullptr;
+		mesh_.m_indexData   = header.m_indexDataCount ? file->getData() + header.m_indexDataOffset  : nullptr;
+		mesh_.m_mappedFile  = file;
+	}
+
+	mesh_.m_submeshes.assign(submeshes, submeshes + header.m_submeshCount);
+	mesh_.m_lods.assign(lods, lods + header.m_lodCount);
+	mesh_.m_meshlets.assign(meshlets, meshlets + header.m_meshletCount);
+
+	if (header.m_boneCount > 0) {
+		mesh_.m_bindPose = new Skeleton;
+		for (uint32 i = 0; i < header.m_boneCount; ++i) {
+			int boneIndex = mesh_.m_bindPose->addBone(bones[i].m_name, bones[i].m_bone.m_parentIndex);
+			mesh_.m_bindPose->getBone(boneIndex) = bones[i].m_bone;
+		}
+		mesh_.m_bindPose->resolve();
+		for (uint32 i = 0; i < header.m_boneCount; ++i) {
+			mesh_.m_bindPose->getPose()[i] = bones[i].m_pose;
+		}
+	}
+
+	if (!mesh_.m_mappedFile) {
+		MappedFile::Destroy(file);
+	}
+
+	return true;
+}
+
+bool MeshData::WriteBin(const MeshData& _mesh, const char* _path, uint64 _sourceHash, bool _compress)
+{
+	eastl::vector<char> data(sizeof(BinHeader), 0);
+	auto Append = [&data](const void* _src, uint64 _size) -> uint64
+		{
+			uint64 offset = (data.size() + kBinAlignment - 1) & ~(kBinAlignment - 1);
+			data.resize(offset + _size, 0);
+			if (_size > 0) {
+				memcpy(data.data() + offset, _src, _size);
+			}
+			return offset;
+		};
+
+	BinHeader header;
+	memset(&header, 0, sizeof(BinHeader));
+	memcpy(header.m_magic, kBinMagic, sizeof(kBinMagic));
+	header.m_version          = kBinVersion;
+	header.m_sourceHash       = _sourceHash;
+	header.m_descHash         = _mesh.m_desc.getHash();
+	header.m_vertexCount      = _mesh.m_vertexData ? _mesh.getVertexCount() : 0;
+	header.m_indexDataCount   = _mesh.m_indexData ? _mesh.getIndexDataCount() : 0;
+	header.m_indexDataType    = (uint32)_mesh.m_indexDataType;
+	header.m_submeshCount     = (uint32)_mesh.m_submeshes.size();
+	header.m_lodCount         = (uint32)_mesh.m_lods.size();
+	header.m_meshletCount     = (uint32)_mesh.m_meshlets.size();
+	header.m_boneCount        = _mesh.m_bindPose ? (uint32)_mesh.m_bindPose->getBoneCount() : 0;
+	header.m_descOffset       = Append(&_mesh.m_desc, sizeof(MeshDesc));
+	uint vertexDataSize = _mesh.m_desc.getVertexSize() * header.m_vertexCount;
+	uint indexDataSize  = DataTypeSizeBytes(_mesh.m_indexDataType) * header.m_indexDataCount;
+	if (_compress) {
+		header.m_flags |= BinFlag_Compressed;
+		eastl::vector<char> encoded(APT_MAX(EncodeVertexDataBound(header.m_vertexCount, _mesh.m_desc.getVertexSize()), EncodeIndexDataBound(header.m_indexDataCount)));
+		vertexDataSize = header.m_vertexCount    ? EncodeVertexData(_mesh.m_vertexData, header.m_vertexCount, _mesh.m_desc.getVertexSize(), encoded.data()) : 0;
+		header.m_vertexDataOffset = Append(encoded.data(), vertexDataSize);
+		indexDataSize  = header.m_indexDataCount ? EncodeIndexData(_mesh.m_indexData, _mesh.m_indexDataType, header.m_indexDataCount, encoded.data()) : 0;
+		header.m_indexDataOffset  = Append(encoded.data(), indexDataSize);
+	} else {
+		header.m_vertexDataOffset = Append(_mesh.m_vertexData, vertexDataSize);
+		header.m_indexDataOffset  = Append(_mesh.m_indexData, indexDataSize);
+	}
+	header.m_vertexDataSize   = vertexDataSize;
+	header.m_indexDataSize    = indexDataSize;
+	header.m_submeshOffset    = Append(_mesh.m_submeshes.data(), sizeof(Submesh) * header.m_submeshCount);
+	header.m_lodOffset        = Append(_mesh.m_lods.data(), sizeof(Lod) * header.m_lodCount);
+	header.m_meshletOffset    = Append(_mesh.m_meshlets.data(), sizeof(Meshlet) * header.m_meshletCount);
+
+	eastl::vector<BinBone> bones(header.m_boneCount);
+	for (uint32 i = 0; i < header.m_boneCount; ++i) {
+		memset(&bones[i], 0, sizeof(BinBone));
+		strncpy(bones[i].m_name, _mesh.m_bindPose->getBoneName(i), sizeof(bones[i].m_name) - 1);
+		bones[i].m_bone = _mesh.m_bindPose->getBone(i);
+		bones[i].m_pose = _mesh.m_bindPose->getPose()[i];
+	}
+	header.m_boneOffset       = Append(bones.data(), sizeof(BinBone) * header.m_boneCount);
+
+	header.m_fileSize         = data.size();
+	memcpy(data.data(), &header, sizeof(BinHeader));
+
+	File f;
+	f.setData(data.data(), (uint)data.size());
+	if (!File::Write(f, _path)) {
+		APT_LOG_ERR("MeshData: Failed to write binary cache '%s'", _path);
+		return false;
+	}
+	return true;
+}
@@ -1,31 +1,522 @@
 #include "MeshData.h"
 
+#include <frm/core/parallel.h>
+
 #include <apt/log.h>
 
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <tinyobjloader/tiny_obj_loader.h>
 
+#include <EASTL/vector.h>
+
+#include <cmath>
+#include <cstring>
+
 using namespace frm;
 using namespace apt;
 
+namespace {
+
+const uint32 kObjChunkSize = 256 * 1024; // approximate size of the line-aligned chunks parsed in parallel
+
+struct ObjIndex
+{
+	sint32 p, t, n; // 0-based, -1 if not present
+};
+const sint32 kObjIndexInvalid = -2; // index 0 or a relative index before the first element
+
+struct ObjString
+{
+	const char* m_str;
+	uint32      m_length;
+
+	bool operator==(const ObjString& _rhs) const { return m_length == _rhs.m_length && memcmp(m_str, _rhs.m_str, m_length) == 0; }
+};
+
+struct ObjChunk
+{
+	const char*               m_begin;
+	const char*               m_end;
+	uint32                    m_positionOffset;  // global index of the first element in this chunk
+	uint32                    m_texcoordOffset;
+	uint32                    m_normalOffset;
+	uint32                    m_positionCount;
+	uint32                    m_texcoordCount;
+	uint32                    m_normalCount;
+	eastl::vector<ObjIndex>   m_indices;         // 3 per triangle
+	eastl::vector<uint32>     m_triangleMaterials;
+	eastl::vector<ObjString>  m_materials;       // local material table, 0 is the material inherited from the previous chunk
+	uint32                    m_endMaterial;     // local material active at the chunk end (the last usemtl, which may precede no faces)
+	const char*               m_error;           // first error, or nullptr
+	uint32                    m_errorLine;       // relative to the chunk begin
+};
+
+inline bool IsSpace(char _c)   { return _c == ' ' || _c == '\t' || _c == '\r'; }
+inline bool IsDigit(char _c)   { return _c >= '0' && _c <= '9'; }
+
+inline const char* SkipSpace(const char* _s, const char* _end)
+{
+	while (_s < _end && IsSpace(*_s)) {
+		++_s;
+	}
+	return _s;
+}
+
+inline const char* SkipLine(const char* _s, const char* _end)
+{
+	while (_s < _end && *_s != '\n') {
+		++_s;
+	}
+	return _s < _end ? _s + 1 : _end;
+}
+
+// Return nullptr if no digits were found.
+inline const char* ParseInt(const char* _s, const char* _end, sint32& out_)
+{
+	bool negative = false;
+	if (_s < _end && (*_s == '-' || *_s == '+')) {
+		negative = *_s == '-';
+		++_s;
+	}
+	const char* digits = _s;
+	sint32 ret = 0;
+	while (_s < _end && IsDigit(*_s)) {
+		ret = ret * 10 + (*_s - '0');
+		++_s;
+	}
+	out_ = negative ? -ret : ret;
+	return _s == digits ? nullptr : _s;
+}
+
+// Locale-independent float parser; accumulate up to 19 significant digits as an integer and apply the decimal exponent
+// in double precision (accurate to within 1 ulp of the float result). Return nullptr if no digits were found.
+inline const char* ParseFloat(const char* _s, const char* _end, float& out_)
+{
+	static const double kPow10[] = {
+		1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	bool negative = false;
+	if (_s < _end && (*_s == '-' || *_s == '+')) {
+		negative = *_s == '-';
+		++_s;
+	}
+	uint64 mantissa = 0;
+	int digitCount  = 0;
+	int exponent    = 0;
+	bool hasDigits  = false;
+	for (; _s < _end && IsDigit(*_s); ++_s) {
+		hasDigits = true;
+		if (digitCount < 19) {
+			mantissa = mantissa * 10 + (*_s - '0');
+			digitCount += mantissa != 0 ? 1 : 0;
+		} else {
+			++exponent;
+		}
+	}
+	if (_s < _end && *_s == '.') {
+		++_s;
+		for (; _s < _end && IsDigit(*_s); ++_s) {
+			hasDigits = true;
+			if (digitCount < 19) {
+				mantissa = mantissa * 10 + (*_s - '0');
+				digitCount += mantissa != 0 ? 1 : 0;
+				--exponent;
+			}
+		}
+	}
+	if (!hasDigits) {
+		return nullptr;
+	}
+	if (_s < _end && (*_s == 'e' || *_s == 'E')) {
+		sint32 e;
+		const char* s = ParseInt(_s + 1, _end, e);
+		if (s) {
+			exponent += e;
+			_s = s;
+		}
+	}
+
+	double ret = (double)mantissa;
+	if (exponent < 0) {
+		ret = -exponent <= 22 ? ret / kPow10[-exponent] : ret * pow(10.0, exponent);
+	} else if (exponent > 0) {
+		ret = exponent <= 22 ? ret * kPow10[exponent] : ret * pow(10.0, exponent);
+	}
+	out_ = (float)(negative ? -ret : ret);
+	return _s;
+}
+
+// Return the number of floats parsed, up to _count.
+inline int ParseFloats(const char* _s, const char* _end, float* out_, int _count)
+{
+	int ret = 0;
+	for (; ret < _count; ++ret) {
+		_s = SkipSpace(_s, _end);
+		_s = ParseFloat(_s, _end, out_[ret]);
+		if (!_s) {
+			break;
+		}
+	}
+	return ret;
+}
+
+// Resolve a 1-based (or negative, relative) OBJ index given the number of elements read so far.
+inline sint32 ResolveIndex(sint32 _index, uint32 _count)
+{
+	if (_index > 0) {
+		return _index - 1;
+	}
+	sint64 ret = (sint64)_count + _index;
+	return _index == 0 || ret < 0 ? kObjIndexInvalid : (sint32)ret;
+}
+
+// Return true if _index is a valid 0-based index into _count elements (or -1 if _optional).
+inline bool ObjIndexInRange(sint32 _index, uint32 _count, bool _optional)
+{
+	if (_optional && _index == -1) {
+		return true;
+	}
+	return _index >= 0 && _index < (sint32)_count;
+}
+
+// Count v/vt/vn statements such that the chunk offsets are known before parsing.
+void CountObjChunk(ObjChunk& chunk_)
+{
+	chunk_.m_positionCount = chunk_.m_texcoordCount = chunk_.m_normalCount = 0;
+	for (const char* s = chunk_.m_begin, *end = chunk_.m_end; s < end; s = SkipLine(s, end)) {
+		s = SkipSpace(s, end);
+		if (end - s < 2 || s[0] != 'v') {
+			continue;
+		}
+		if (IsSpace(s[1])) {
+			++chunk_.m_positionCount;
+		} else if (s[1] == 't' && end - s > 2 && IsSpace(s[2])) {
+			++chunk_.m_texcoordCount;
+		} else if (s[1] == 'n' && end - s > 2 && IsSpace(s[2])) {
+			++chunk_.m_normalCount;
+		}
+	}
+}
+
+void ParseObjChunk(ObjChunk& chunk_, vec3* positions_, vec2* texcoords_, vec3* normals_)
+{
+	uint32 positionCount = chunk_.m_positionOffset;
+	uint32 texcoordCount = chunk_.m_texcoordOffset;
+	uint32 normalCount   = chunk_.m_normalOffset;
+	uint32 material      = 0;
+	uint32 line          = 0;
+	eastl::vector<ObjIndex> face;
+
+	chunk_.m_materials.clear();
+	chunk_.m_materials.push_back({ "", 0 }); // inherited
+	chunk_.m_error = nullptr;
+
+	for (const char* s = chunk_.m_begin, *end = chunk_.m_end; s < end; s = SkipLine(s, end), ++line) {
+		s = SkipSpace(s, end);
+		if (end - s < 2) {
+			continue;
+		}
+
+		if (s[0] == 'v') {
+			bool isSpace2 = end - s > 2 && IsSpace(s[2]);
+			if (IsSpace(s[1])) {
+				vec3& p = positions_[positionCount++];
+				if (ParseFloats(s + 1, end, &p.x, 3) != 3) {
+					chunk_.m_error = "Invalid vertex position";
+					break;
+				}
+			} else if (s[1] == 't' && isSpace2) {
+				vec2& t = texcoords_[texcoordCount++];
+				t = vec2(0.0f);
+				if (ParseFloats(s + 2, end, &t.x, 2) < 1) {
+					chunk_.m_error = "Invalid vertex texcoord";
+					break;
+				}
+			} else if (s[1] == 'n' && isSpace2) {
+				vec3& n = normals_[normalCount++];
+				if (ParseFloats(s + 2, end, &n.x, 3) != 3) {
+					chunk_.m_error = "Invalid vertex normal";
+					break;
+				}
+			}
+
+		} else if (s[0] == 'f' && IsSpace(s[1])) {
+		 // face vertices are p, p/t, p//n or p/t/n
+			face.clear();
+			for (s = SkipSpace(s + 1, end); s < end && *s != '\n' && *s != '#'; s = SkipSpace(s, end)) {
+				ObjIndex index = { -1, -1, -1 };
+				sint32 i;
+				if (!(s = ParseInt(s, end, i))) {
+					break;
+				}
+				index.p = ResolveIndex(i, positionCount);
+				if (s < end && *s == '/') {
+					++s;
+					if (s < end && *s != '/') {
+						if (!(s = ParseInt(s, end, i))) {
+							break;
+						}
+						index.t = ResolveIndex(i, texcoordCount);
+					}
+					if (s < end && *s == '/') {
+						if (!(s = ParseInt(s + 1, end, i))) {
+							break;
+						}
+						index.n = ResolveIndex(i, normalCount);
+					}
+				}
+				face.push_back(index);
+			}
+			if (!s || face.size() < 3) {
+				chunk_.m_error = "Invalid face";
+				break;
+			}
+
+		 // fan triangulation
+			for (uint32 i = 2; i < face.size(); ++i) {
+				chunk_.m_indices.push_back(face[0]);
+				chunk_.m_indices.push_back(face[i - 1]);
+				chunk_.m_indices.push_back(face[i]);
+				chunk_.m_triangleMaterials.push_back(material);
+			}
+
+		} else if (end - s > 7 && strncmp(s, "usemtl", 6) == 0 && IsSpace(s[6])) {
+			const char* name = SkipSpace(s + 7, end);
+			const char* nameEnd = name;
+			while (nameEnd < end && *nameEnd != '\n' && *nameEnd != '\r') {
+				++nameEnd;
+			}
+			ObjString str = { name, (uint32)(nameEnd - name) };
+			material = 1;
+			while (material < chunk_.m_materials.size() && !(chunk_.m_materials[material] == str)) {
+				++material;
+			}
+			if (material == chunk_.m_materials.size()) {
+				chunk_.m_materials.push_back(str);
+			}
+		}
+	}
+	chunk_.m_endMaterial = material;
+	chunk_.m_errorLine = line;
+}
+
+inline uint32 HashObjIndex(const ObjIndex& _index, uint32 _material)
+{
+	uint32 h = (uint32)_index.p * 0x9e3779b1u;
+	h ^= (uint32)_index.t * 0x85ebca77u + (h << 6) + (h >> 2);
+	h ^= (uint32)_index.n * 0xc2b2ae3du + (h << 6) + (h >> 2);
+	h ^= _material * 0x27d4eb2fu + (h << 6) + (h >> 2);
+	return h ^ (h >> 16);
+}
+
+MeshDesc ObjMeshDesc()
+{
+ // \todo use _mesh desc as a conversion target
+	MeshDesc ret(MeshDesc::Primitive_Triangles);
+	ret.addVertexAttr(VertexAttr::Semantic_Positions, DataType_Float32, 3);
+	ret.addVertexAttr(VertexAttr::Semantic_Normals,   DataType_Sint8N,  3);
+	ret.addVertexAttr(VertexAttr::Semantic_Tangents,  DataType_Sint8N,  3);
+	ret.addVertexAttr(VertexAttr::Semantic_Texcoords, DataType_Uint16N, 2);
+	return ret;
+}
+
+void ObjPostProcess(MeshBuilder& mesh_, bool _generateNormals)
+{
+	if (_generateNormals) {
+		mesh_.generateNormals();
+	}
+	mesh_.generateTangents();
+	mesh_.optimizeVertexCache();
+	mesh_.optimizeVertexFetch();
+	mesh_.updateBounds();
+}
+
+} // namespace
+
 bool MeshData::ReadObj(MeshData& mesh_, const char* _srcData, uint _srcDataSize)
+{
+	const char* srcEnd = _srcData + _srcDataSize;
+
+ // split into line-aligned chunks
+	eastl::vector<ObjChunk> chunks;
+	for (const char* s = _srcData; s < srcEnd; ) {
+		const char* chunkEnd = (uint)(srcEnd - s) > kObjChunkSize ? SkipLine(s + kObjChunkSize, srcEnd) : srcEnd;
+		chunks.push_back(ObjChunk());
+		chunks.back().m_begin = s;
+		chunks.back().m_end   = chunkEnd;
+		s = chunkEnd;
+	}
+
+ // count elements per chunk, compute chunk offsets
+	ParallelFor((uint32)chunks.size(), 1,
+		[&chunks](uint32 _begin, uint32 _end)
+		{
+			for (uint32 i = _begin; i < _end; ++i) {
+				CountObjChunk(chunks[i]);
+			}
+		});
+	uint32 positionCount = 0, texcoordCount = 0, normalCount = 0;
+	for (auto& chunk : chunks) {
+		chunk.m_positionOffset = positionCount;
+		chunk.m_texcoordOffset = texcoordCount;
+		chunk.m_normalOffset   = normalCount;
+		positionCount += chunk.m_positionCount;
+		texcoordCount += chunk.m_texcoordCount;
+		normalCount   += chunk.m_normalCount;
+	}
+
+ // parse, each chunk writes directly to its range of the element arrays
+	eastl::vector<vec3> positions(positionCount);
+	eastl::vector<vec2> texcoords(texcoordCount);
+	eastl::vector<vec3> normals(normalCount);
+	ParallelFor((uint32)chunks.size(), 1,
+		[&](uint32 _begin, uint32 _end)
+		{
+			for (uint32 i = _begin; i < _end; ++i) {
+				ParseObjChunk(chunks[i], positions.data(), texcoords.data(), normals.data());
+			}
+		});
+
+ // resolve materials, check errors/index ranges
+	eastl::vector<ObjString> materials;
+	materials.push_back({ "", 0 }); // default material for faces which precede any usemtl statement
+	uint32 triangleCount = 0;
+	uint32 material = 0;
+	bool hasNormals = true;
+	for (auto& chunk : chunks) {
+		if (chunk.m_error) {
+			uint32 line = 1;
+			for (const char* s = _srcData; s < chunk.m_begin; ++s) {
+				line += *s == '\n' ? 1 : 0;
+			}
+			APT_LOG_ERR("obj error:\n\t'%s' (line %u)", chunk.m_error, line + chunk.m_errorLine);
+			return false;
+		}
+
+		eastl::vector<uint32> materialMap(chunk.m_materials.size());
+		materialMap[0] = material;
+		for (uint32 i = 1; i < chunk.m_materials.size(); ++i) {
+			materialMap[i] = 0;
+			while (materialMap[i] < materials.size() && !(materials[materialMap[i]] == chunk.m_materials[i])) {
+				++materialMap[i];
+			}
+			if (materialMap[i] == materials.size()) {
+				materials.push_back(chunk.m_materials[i]);
+			}
+		}
+		for (auto& triangleMaterial : chunk.m_triangleMaterials) {
+			triangleMaterial = materialMap[triangleMaterial];
+		}
+		material = materialMap[chunk.m_endMaterial];
+
+		for (auto& index : chunk.m_indices) {
+			if (!ObjIndexInRange(index.p, positionCount, false) || !ObjIndexInRange(index.t, texcoordCount, true) || !ObjIndexInRange(index.n, normalCount, true)) {
+				APT_LOG_ERR("obj error:\n\t'Index out of range'");
+				return false;
+			}
+			hasNormals &= index.n >= 0;
+		}
+		triangleCount += (uint32)chunk.m_triangleMaterials.size();
+	}
+
+ // sort triangles by material (counting sort), each material becomes a submesh
+	eastl::vector<uint32> materialTriangleOffsets(materials.size() + 1, 0);
+	for (auto& chunk : chunks) {
+		for (uint32 m : chunk.m_triangleMaterials) {
+			++materialTriangleOffsets[m + 1];
+		}
+	}
+	for (uint32 i = 0; i < materials.size(); ++i) {
+		materialTriangleOffsets[i + 1] += materialTriangleOffsets[i];
+	}
+	eastl::vector<ObjIndex> indices(triangleCount * 3);
+	{
+		eastl::vector<uint32> cursor(materialTriangleOffsets.begin(), materialTriangleOffsets.end() - 1);
+		for (auto& chunk : chunks) {
+			for (uint32 i = 0; i < chunk.m_triangleMaterials.size(); ++i) {
+				memcpy(&indices[cursor[chunk.m_triangleMaterials[i]]++ * 3], &chunk.m_indices[i * 3], sizeof(ObjIndex) * 3);
+			}
+			chunk.m_indices.clear();
+			chunk.m_indices.shrink_to_fit();
+		}
+	}
+
+ // dedupe p/t/n tuples via an open addressing hash table; vertices are unique per submesh
+	uint32 tableSize = 1;
+	while (tableSize < triangleCount * 6) {
+		tableSize <<= 1;
+	}
+	eastl::vector<uint32> table(tableSize, ~0u);
+	eastl::vector<ObjIndex> vertexIndices;
+	vertexIndices.reserve(positionCount);
+
+	MeshBuilder tmpMesh;
+	tmpMesh.m_triangles.reserve(triangleCount);
+	for (uint32 m = 0; m < materials.size(); ++m) {
+		if (materialTriangleOffsets[m] == materialTriangleOffsets[m + 1]) {
+			continue;
+		}
+		tmpMesh.beginSubmesh(m);
+		tmpMesh.m_triangles.resize(materialTriangleOffsets[m + 1]);
+		uint32* triangleIndices = &tmpMesh.m_triangles.data()->a;
+		uint32 vertexOffset = (uint32)vertexIndices.size();
+		for (uint32 i = materialTriangleOffsets[m] * 3, n = materialTriangleOffsets[m + 1] * 3; i < n; ++i) {
+			const ObjIndex& index = indices[i];
+			uint32 slot = HashObjIndex(index, m) & (tableSize - 1);
+			for (;;) {
+				uint32 v = table[slot];
+				if (v == ~0u) {
+					v = table[slot] = (uint32)vertexIndices.size();
+					vertexIndices.push_back(index);
+					triangleIndices[i] = v;
+					break;
+				}
+				const ObjIndex& other = vertexIndices[v];
+				if (v >= vertexOffset && other.p == index.p && other.t == index.t && other.n == index.n) {
+					triangleIndices[i] = v;
+					break;
+				}
+				slot = (slot + 1) & (tableSize - 1);
+			}
+		}
+
+		tmpMesh.m_vertices.resize(vertexIndices.size());
+		for (uint32 i = vertexOffset; i < vertexIndices.size(); ++i) {
+			MeshBuilder::Vertex& vertex = tmpMesh.m_vertices[i];
+			memset(&vertex, 0, sizeof(MeshBuilder::Vertex));
+			const ObjIndex& index = vertexIndices[i];
+			vertex.m_position = positions[index.p];
+			if (index.t >= 0) {
+				vertex.m_texcoord = texcoords[index.t];
+			}
+			if (index.n >= 0) {
+				vertex.m_normal = normals[index.n];
+			}
+		}
+		tmpMesh.endSubmesh();
+	}
+
+	ObjPostProcess(tmpMesh, !hasNormals);
+
+	MeshData retMesh(ObjMeshDesc(), tmpMesh);
+	swap(mesh_, retMesh);
+
+	return true;
+}
+
+bool MeshData::ReadObjTinyobj(MeshData& mesh_, const char* _srcData, uint _srcDataSize)
 {
 	using std::istream;
 	using std::map;
 	using std::string;
 	using std::vector;
-	
+
 	vector<tinyobj::shape_t> shapes;
 	vector<tinyobj::material_t> materials;
 	string err;
-	
- // \todo use _mesh desc as a conversion target
-	MeshDesc retDesc(MeshDesc::Primitive_Triangles);
-	VertexAttr* positionAttr = retDesc.addVertexAttr(VertexAttr::Semantic_Positions, DataType_Float32, 3);
-	VertexAttr* normalAttr   = retDesc.addVertexAttr(VertexAttr::Semantic_Normals,   DataType_Sint8N,  3);
-	VertexAttr* tangentAttr  = retDesc.addVertexAttr(VertexAttr::Semantic_Tangents,  DataType_Sint8N,  3);
-	VertexAttr* texcoordAttr = retDesc.addVertexAttr(VertexAttr::Semantic_Texcoords, DataType_Uint16N, 2);
-	
+
 	MeshBuilder tmpMesh; // append vertices/indices here
 
 	struct mem_streambuf: std::streambuf {
@@ -36,7 +527,7 @@ bool MeshData::ReadObj(MeshData& mesh_, const char* _srcData, uint _srcDataSize)
 	};
 	struct DummyMatReader: public tinyobj::MaterialReader {
 		DummyMatReader() {}
-		virtual ~DummyMatReader() {}	
+		virtual ~DummyMatReader() {}
 		virtual bool operator()(const string& matId, vector<tinyobj::material_t>& materials, map<string, int>& matMap, string& err) {
 			return true;
 		}
@@ -47,7 +538,7 @@ bool MeshData::ReadObj(MeshData& mesh_, const char* _srcData, uint _srcDataSize)
 
 	bool ret = tinyobj::LoadObj(shapes, materials, err, dstream, matreader);
 	if (!ret) {
-		goto MeshData_ReadObj_end;
+		goto MeshData_ReadObjTinyobj_end;
 	}
 
 	bool hasNormals = true;
@@ -61,22 +552,16 @@ bool MeshData::ReadObj(MeshData& mesh_, const char* _srcData, uint _srcDataSize)
 		hasTexcoords &= tcount != 0;
 		uint ncount = m.normals.size() / 3;
 		hasNormals &= ncount != 0;
-		/*if (!((pcount == ncount) && (tcount ? pcount == tcount : true) && (ncount ? pcount == ncount : true))) {
-			ret = false;
-			err = "Mesh data error (position/normal/texcoord counts didn't match)";
-			APT_ASSERT(false);
-			goto Mesh_LoadObj_end;
-		}*/
 		if (pcount > std::numeric_limits<uint32>::max()) {
 			ret = false;
 			err = "Too many vertices";
-			goto MeshData_ReadObj_end;
+			goto MeshData_ReadObjTinyobj_end;
 		}
 
 	 // vertex data
 		for (auto i = 0; i < pcount; ++i) {
 			MeshBuilder::Vertex vtx;
-			
+
 			vtx.m_position.x = m.positions[i * 3 + 0];
 			vtx.m_position.y = m.positions[i * 3 + 1];
 			vtx.m_position.z = m.positions[i * 3 + 2];
@@ -102,7 +587,7 @@ bool MeshData::ReadObj(MeshData& mesh_, const char* _srcData, uint _srcDataSize)
 			if (m.num_vertices[face] != 3) {
 				ret = false;
 				err = "Invalid face (only triangles supported";
-				goto MeshData_ReadObj_end;
+				goto MeshData_ReadObjTinyobj_end;
 			}
 
 		 // find the relevant Submesh list for the mat index, or push a new one
@@ -124,7 +609,7 @@ bool MeshData::ReadObj(MeshData& mesh_, const char* _srcData, uint _srcDataSize)
 			submeshIndices[matIndex].push_back(m.indices[face * 3 + 1] + voffset);
 			submeshIndices[matIndex].push_back(m.indices[face * 3 + 2] + voffset);
 		}
-	 
+
 		for (auto submesh = 0; submesh < submeshIndices.size(); ++submesh) {
 			for (auto i = 0; i < submeshIndices[submesh].size(); i += 3) {
 				tmpMesh.addTriangle(
@@ -133,36 +618,20 @@ bool MeshData::ReadObj(MeshData& mesh_, const char* _srcData, uint _srcDataSize)
 					submeshIndices[submesh][i + 2]
 					);
 			}
-			
-			/*retMesh.beginSubmesh(submesh); // \todo material id is implicit in this case?
-			retMesh.m_submeshes[submesh].m_vertexOffset = 0;
-			retMesh.m_submeshes[submesh].m_vertexCount = retMesh.getVertexCount();
-			retMesh.m_submeshes[submesh].m_indexCount = submeshIndices[submesh].size();
-			retMesh.m_submeshes[submesh].m_indexOffset = 
-				submesh == 0 ? 0 : submeshIndices[submesh - 1].size();
-			
-			retMesh.endSubmesh();*/
 		}
 
 		voffset += (uint32)pcount;
 	}
 
-	
-	if (normalAttr != 0 && !hasNormals) {
-		tmpMesh.generateNormals();
-	}
-	if (tangentAttr != 0) {
-		tmpMesh.generateTangents();
-	}
-	tmpMesh.updateBounds();
+	ObjPostProcess(tmpMesh, !hasNormals);
 
-MeshData_ReadObj_end:
+MeshData_ReadObjTinyobj_end:
 	if (!ret) {
 		APT_LOG_ERR("obj error:\n\t'%s'", err.c_str());
 		return false;
 	}
-	
-	MeshData retMesh(retDesc, tmpMesh);
+
+	MeshData retMesh(ObjMeshDesc(), tmpMesh);
 	swap(mesh_, retMesh);
 
 	return true;
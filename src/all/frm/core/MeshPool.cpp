@@ -0,0 +1,273 @@
+#include "MeshPool.h"
+
+#include <frm/core/Mesh.h>
+
+#include <apt/log.h>
+#include <apt/memory.h>
+
+using namespace frm;
+using namespace apt;
+
+/*******************************************************************************
+
+                                RangeAllocator
+
+*******************************************************************************/
+
+MeshPool::RangeAllocator::RangeAllocator(uint32 _capacity)
+	: m_capacity(_capacity)
+	, m_freeSize(_capacity)
+{
+	if (_capacity > 0) {
+		Range range = { 0, _capacity };
+		m_freeRanges.push_back(range);
+	}
+}
+
+uint32 MeshPool::RangeAllocator::alloc(uint32 _size)
+{
+	if (_size == 0) {
+		return 0;
+	}
+	for (auto it = m_freeRanges.begin(); it != m_freeRanges.end(); ++it) {
+		if (it->m_size >= _size) {
+			uint32 ret = it->m_offset;
+			it->m_offset += _size;
+			it->m_size   -= _size;
+			if (it->m_size == 0) {
+				m_freeRanges.erase(it);
+			}
+			m_freeSize -= _size;
+			return ret;
+		}
+	}
+	return kInvalidOffset;
+}
+
+void MeshPool::RangeAllocator::free(uint32 _offset, uint32 _size)
+{
+	if (_size == 0) {
+		return;
+	}
+	APT_ASSERT(_offset + _size <= m_capacity);
+
+ // find the first free range after _offset, merge with the previous/next ranges if adjacent
+	auto next = m_freeRanges.begin();
+	while (next != m_freeRanges.end() && next->m_offset < _offset) {
+		++next;
+	}
+	APT_ASSERT(next == m_freeRanges.end() || _offset + _size <= next->m_offset); // double free?
+	bool mergePrev = next != m_freeRanges.begin() && (next - 1)->m_offset + (next - 1)->m_size == _offset;
+	bool mergeNext = next != m_freeRanges.end() && _offset + _size == next->m_offset;
+	if (mergePrev && mergeNext) {
+		(next - 1)->m_size += _size + next->m_size;
+		m_freeRanges.erase(next);
+	} else if (mergePrev) {
+		(next - 1)->m_size += _size;
+	} else if (mergeNext) {
+		next->m_offset = _offset;
+		next->m_size  += _size;
+	} else {
+		Range range = { _offset, _size };
+		m_freeRanges.insert(next, range);
+	}
+	m_freeSize += _size;
+}
+
+uint32 MeshPool::RangeAllocator::getLargestFreeRange() const
+{
+	uint32 ret = 0;
+	for (auto& range : m_freeRanges) {
+		ret = APT_MAX(ret, range.m_size);
+	}
+	return ret;
+}
+
+/*******************************************************************************
+
+                                   MeshPool
+
+*******************************************************************************/
+
+// PUBLIC
+
+MeshPool* MeshPool::Create(const MeshDesc& _desc, uint32 _vertexCapacity, uint32 _indexCapacity, DataType _indexDataType, bool _gpu)
+{
+	APT_ASSERT(_indexDataType == DataType_Uint16 || _indexDataType == DataType_Uint32);
+
+	MeshPool* ret = APT_NEW(MeshPool);
+	ret->m_desc            = _desc;
+	ret->m_indexDataType   = _indexDataType;
+	ret->m_vertexAllocator = RangeAllocator(_vertexCapacity);
+	ret->m_indexAllocator  = RangeAllocator(_indexCapacity);
+	if (_gpu) {
+		ret->m_mesh = Mesh::Create(_desc);
+		ret->m_mesh->setVertexData(nullptr, _vertexCapacity, GL_STATIC_DRAW);
+		ret->m_mesh->setIndexData(_indexDataType, nullptr, _indexCapacity, GL_STATIC_DRAW);
+	}
+	return ret;
+}
+
+void MeshPool::Destroy(MeshPool*& _inst_)
+{
+	APT_DELETE(_inst_);
+}
+
+MeshPool::MeshId MeshPool::add(const MeshData& _meshData)
+{
+	if (_meshData.getDesc() != m_desc) {
+		APT_LOG_ERR("MeshPool: Mesh '%s' doesn't match the pool's MeshDesc", _meshData.getPath());
+		return kInvalidMeshId;
+	}
+
+	Entry entry;
+	entry.m_vertexCount    = _meshData.getVertexData() ? _meshData.getVertexCount() : 0;
+	entry.m_rebasedIndices = _meshData.hasRebasedIndices();
+	entry.m_used           = true;
+
+ // convert the indices to the pool index type, non-indexed meshes get a trivial index buffer
+	const uint32 dstRestart = m_indexDataType == DataType_Uint16 ? 0xffffu : 0xffffffffu;
+	eastl::vector<uint32> indices;
+	uint srcIndexSize = 0;
+	if (_meshData.getIndexData()) {
+		DataType srcType    = _meshData.getIndexDataType();
+		uint32   srcRestart = srcType == DataType_Uint8 ? 0xffu : srcType == DataType_Uint16 ? 0xffffu : 0xffffffffu;
+		srcIndexSize        = DataTypeSizeBytes(srcType);
+		indices.resize(_meshData.getIndexCount());
+		for (uint32 i = 0; i < (uint32)indices.size(); ++i) {
+			uint32 index;
+			switch (srcType) {
+				case DataType_Uint8:  index = ((const uint8*)_meshData.getIndexData())[i];  break;
+				case DataType_Uint16: index = ((const uint16*)_meshData.getIndexData())[i]; break;
+				default:              index = ((const uint32*)_meshData.getIndexData())[i]; break;
+			};
+			if (index == srcRestart) {
+				index = dstRestart;
+			} else if (index >= dstRestart) {
+				APT_LOG_ERR("MeshPool: Mesh '%s' indices don't fit the pool's index type", _meshData.getPath());
+				return kInvalidMeshId;
+			}
+			indices[i] = index;
+		}
+	} else {
+		if (entry.m_vertexCount > dstRestart) {
+			APT_LOG_ERR("MeshPool: Mesh '%s' vertex count doesn't fit the pool's index type", _meshData.getPath());
+			return kInvalidMeshId;
+		}
+		indices.resize(entry.m_vertexCount);
+		for (uint32 i = 0; i < entry.m_vertexCount; ++i) {
+			indices[i] = i;
+		}
+	}
+	entry.m_indexCount = (uint32)indices.size();
+
+	for (int i = 0; i < _meshData.getSubmeshCount(); ++i) {
+		const MeshData::Submesh& src = _meshData.getSubmesh(i);
+		Submesh submesh;
+		if (srcIndexSize > 0) {
+			submesh.m_firstIndex = src.m_indexOffset / srcIndexSize;
+			submesh.m_indexCount = src.m_indexCount;
+			submesh.m_baseVertex = src.m_baseVertex;
+		} else {
+			submesh.m_firstIndex = src.m_vertexOffset / m_desc.getVertexSize();
+			submesh.m_indexCount = src.m_vertexCount;
+			submesh.m_baseVertex = 0;
+		}
+		entry.m_submeshes.push_back(submesh);
+	}
+
+	entry.m_vertexOffset = m_vertexAllocator.alloc(entry.m_vertexCount);
+	if (entry.m_vertexOffset == RangeAllocator::kInvalidOffset) {
+		return kInvalidMeshId;
+	}
+	entry.m_indexOffset = m_indexAllocator.alloc(entry.m_indexCount);
+	if (entry.m_indexOffset == RangeAllocator::kInvalidOffset) {
+		m_vertexAllocator.free(entry.m_vertexOffset, entry.m_vertexCount);
+		return kInvalidMeshId;
+	}
+
+	if (m_mesh) {
+		if (entry.m_vertexCount > 0) {
+			m_mesh->setVertexSubData(_meshData.getVertexData(), entry.m_vertexOffset, entry.m_vertexCount);
+		}
+		if (entry.m_indexCount > 0) {
+			if (m_indexDataType == DataType_Uint16) {
+				eastl::vector<uint16> indices16(indices.begin(), indices.end());
+				m_mesh->setIndexSubData(indices16.data(), entry.m_indexOffset, entry.m_indexCount);
+			} else {
+				m_mesh->setIndexSubData(indices.data(), entry.m_indexOffset, entry.m_indexCount);
+			}
+		}
+	}
+
+	MeshId ret;
+	if (m_freeIds.empty()) {
+		ret = (MeshId)m_entries.size();
+		m_entries.push_back(entry);
+	} else {
+		ret = m_freeIds.back();
+		m_freeIds.pop_back();
+		m_entries[ret] = entry;
+	}
+	++m_meshCount;
+	return ret;
+}
+
+void MeshPool::remove(MeshId _id)
+{
+	APT_ASSERT(_id < (MeshId)m_entries.size() && m_entries[_id].m_used);
+	Entry& entry = m_entries[_id];
+	m_vertexAllocator.free(entry.m_vertexOffset, entry.m_vertexCount);
+	m_indexAllocator.free(entry.m_indexOffset, entry.m_indexCount);
+	entry.m_submeshes.clear();
+	entry.m_used = false;
+	m_freeIds.push_back(_id);
+	--m_meshCount;
+}
+
+void MeshPool::addDrawCommands(MeshId _id, int _submeshId, uint32 _instanceCount, uint32 _baseInstance, eastl::vector<Buffer::DrawElementsIndirectCommand>& commands_) const
+{
+	APT_ASSERT(_id < (MeshId)m_entries.size() && m_entries[_id].m_used);
+	const Entry& entry = m_entries[_id];
+	APT_ASSERT(_submeshId < (int)entry.m_submeshes.size());
+
+	int submeshBeg = _submeshId;
+	int submeshEnd = _submeshId + 1;
+	if (_submeshId == 0 && entry.m_rebasedIndices) {
+	 // indices are relative to each submesh, draw the submeshes individually (see GlContext::draw())
+		submeshBeg = 1;
+		submeshEnd = (int)entry.m_submeshes.size();
+	}
+	for (int i = submeshBeg; i < submeshEnd; ++i) {
+		const Submesh& submesh = entry.m_submeshes[i];
+		Buffer::DrawElementsIndirectCommand cmd;
+		cmd.m_indexCount    = submesh.m_indexCount;
+		cmd.m_instanceCount = _instanceCount;
+		cmd.m_firstIndex    = entry.m_indexOffset + submesh.m_firstIndex;
+		cmd.m_baseVertex    = entry.m_vertexOffset + submesh.m_baseVertex;
+		cmd.m_baseInstance  = _baseInstance;
+		commands_.push_back(cmd);
+	}
+}
+
+int MeshPool::getSubmeshCount(MeshId _id) const
+{
+	APT_ASSERT(_id < (MeshId)m_entries.size() && m_entries[_id].m_used);
+	return (int)m_entries[_id].m_submeshes.size();
+}
+
+// PRIVATE
+
+MeshPool::MeshPool()
+	: m_indexDataType(DataType_Uint32)
+	, m_mesh(nullptr)
+	, m_meshCount(0)
+{
+}
+
+MeshPool::~MeshPool()
+{
+	if (m_mesh) {
+		Mesh::Release(m_mesh);
+	}
+}
@@ -0,0 +1,123 @@
+#pragma once
+#ifndef frm_MeshPool_h
+#define frm_MeshPool_h
+
+#include <frm/core/def.h>
+#include <frm/core/Buffer.h>
+#include <frm/core/MeshData.h>
+
+#include <EASTL/vector.h>
+
+namespace frm {
+
+class Mesh;
+
+////////////////////////////////////////////////////////////////////////////////
+// MeshPool
+// Suballocates meshes which share a MeshDesc from a single large vertex/index
+// buffer pair (owned by getMesh()), such that any number of pooled meshes can
+// be drawn with a single glMultiDrawElementsIndirect:
+//
+//    eastl::vector<Buffer::DrawElementsIndirectCommand> commands;
+//    for (each visible instance) {
+//       pool->addDrawCommands(meshId, submeshId, 1, instanceIndex, commands);
+//    }
+//    commandBuffer->setData(...commands...);
+//    ctx->setMesh(pool->getMesh());
+//    ctx->multiDrawIndirect(commandBuffer, commands.size());
+//
+// Per-draw data (e.g. world matrices) can be fetched in the shader via
+// gl_BaseInstanceARB/gl_DrawIDARB.
+// Pools created with _gpu = false only do the suballocation and command
+// building (e.g. for tools or tests without a GL context).
+////////////////////////////////////////////////////////////////////////////////
+class MeshPool: private apt::non_copyable<MeshPool>
+{
+public:
+	typedef uint32 MeshId;
+	static const MeshId kInvalidMeshId = ~MeshId(0);
+
+	// First fit free list allocator over [0, capacity), adjacent free ranges are merged on free().
+	class RangeAllocator
+	{
+	public:
+		static const uint32 kInvalidOffset = ~uint32(0);
+
+		RangeAllocator(uint32 _capacity = 0);
+
+		// Return kInvalidOffset if no free range is large enough.
+		uint32 alloc(uint32 _size);
+		void   free(uint32 _offset, uint32 _size);
+
+		uint32 getCapacity() const         { return m_capacity; }
+		uint32 getFreeSize() const         { return m_freeSize; }
+		uint32 getFreeRangeCount() const   { return (uint32)m_freeRanges.size(); }
+		uint32 getLargestFreeRange() const;
+
+	private:
+		struct Range { uint32 m_offset, m_size; };
+		eastl::vector<Range> m_freeRanges; // sorted by offset, never adjacent
+		uint32               m_capacity;
+		uint32               m_freeSize;
+
+	}; // class RangeAllocator
+
+	// _vertexCapacity/_indexCapacity are in vertices/indices, _indexDataType must be Uint16 or Uint32.
+	static MeshPool* Create(const MeshDesc& _desc, uint32 _vertexCapacity, uint32 _indexCapacity, apt::DataType _indexDataType = apt::DataType_Uint32, bool _gpu = true);
+	static void      Destroy(MeshPool*& _inst_);
+
+	// Suballocate and upload the vertex/index data of _meshData (LOD 0 only, LODs and meshlets are ignored). Return
+	// kInvalidMeshId if the desc of _meshData doesn't match the pool, if its indices don't fit the pool index type or if
+	// the pool is full.
+	MeshId add(const MeshData& _meshData);
+	void   remove(MeshId _id);
+
+	// Append draw commands for submesh _submeshId of _id to commands_ (submesh 0 is the whole mesh). Usually this is
+	// a single command, submesh 0 of a mesh with rebased indices appends one command per submesh (see
+	// MeshData::compactIndexData()).
+	void   addDrawCommands(MeshId _id, int _submeshId, uint32 _instanceCount, uint32 _baseInstance, eastl::vector<Buffer::DrawElementsIndirectCommand>& commands_) const;
+
+	const MeshDesc&       getDesc() const                 { return m_desc; }
+	apt::DataType         getIndexDataType() const        { return m_indexDataType; }
+	Mesh*                 getMesh() const                 { return m_mesh; } // nullptr if !_gpu
+	uint32                getMeshCount() const            { return m_meshCount; }
+	int                   getSubmeshCount(MeshId _id) const;
+	const RangeAllocator& getVertexAllocator() const      { return m_vertexAllocator; }
+	const RangeAllocator& getIndexAllocator() const       { return m_indexAllocator; }
+
+private:
+	struct Submesh
+	{
+		uint32 m_firstIndex;   // relative to the entry
+		uint32 m_indexCount;
+		uint32 m_baseVertex;   // relative to the entry
+	};
+
+	struct Entry
+	{
+		uint32                  m_vertexOffset;
+		uint32                  m_vertexCount;
+		uint32                  m_indexOffset;
+		uint32                  m_indexCount;
+		eastl::vector<Submesh>  m_submeshes;
+		bool                    m_rebasedIndices;
+		bool                    m_used;
+	};
+
+	MeshDesc                 m_desc;
+	apt::DataType            m_indexDataType;
+	Mesh*                    m_mesh;
+	RangeAllocator           m_vertexAllocator;
+	RangeAllocator           m_indexAllocator;
+	eastl::vector<Entry>     m_entries;         // indexed by MeshId
+	eastl::vector<MeshId>    m_freeIds;
+	uint32                   m_meshCount;
+
+	MeshPool();
+	~MeshPool();
+
+}; // class MeshPool
+
+} // namespace frm
+
+#endif // frm_MeshPool_h
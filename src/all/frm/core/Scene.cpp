@@ -4,16 +4,991 @@
 #include <frm/core/Light.h>
 #include <frm/core/Profiler.h>
 #include <frm/core/XForm.h>
+#include <frm/core/parallel.h>
 
 #include <apt/log.h>
+#include <apt/memory.h>
+#include <apt/FileSystem.h>
 #include <apt/Json.h>
 
 #include <EASTl/algorithm.h>
+#include <EASTL/sort.h>
 #include <EASTL/utility.h> // eastl::swap
 
+#include <algorithm> // rotate
+
 using namespace frm;
 using namespace apt;
 
+/*******************************************************************************
+
+                                 NodeHierarchy
+
+*******************************************************************************/
+
+// Rotation part of an orthonormal basis as a quaternion.
+static quat RotationToQuat(const mat3& _m)
+{
+	float trace = _m[0][0] + _m[1][1] + _m[2][2];
+	if (trace > 0.0f) {
+		float s = sqrtf(trace + 1.0f) * 2.0f;
+		return quat((_m[1][2] - _m[2][1]) / s, (_m[2][0] - _m[0][2]) / s, (_m[0][1] - _m[1][0]) / s, 0.25f * s);
+	} else if (_m[0][0] > _m[1][1] && _m[0][0] > _m[2][2]) {
+		float s = sqrtf(1.0f + _m[0][0] - _m[1][1] - _m[2][2]) * 2.0f;
+		return quat(0.25f * s, (_m[1][0] + _m[0][1]) / s, (_m[2][0] + _m[0][2]) / s, (_m[1][2] - _m[2][1]) / s);
+	} else if (_m[1][1] > _m[2][2]) {
+		float s = sqrtf(1.0f + _m[1][1] - _m[0][0] - _m[2][2]) * 2.0f;
+		return quat((_m[1][0] + _m[0][1]) / s, 0.25f * s, (_m[2][1] + _m[1][2]) / s, (_m[2][0] - _m[0][2]) / s);
+	} else {
+		float s = sqrtf(1.0f + _m[2][2] - _m[0][0] - _m[1][1]) * 2.0f;
+		return quat((_m[2][0] + _m[0][2]) / s, (_m[2][1] + _m[1][2]) / s, 0.25f * s, (_m[0][1] - _m[1][0]) / s);
+	}
+}
+
+// Permute _array_ such that _array_[i] = old _array_[_gather[i]].
+template <typename tArray>
+static void Gather(const eastl::vector<uint32>& _gather, tArray& _array_)
+{
+	tArray tmp(_gather.size());
+	for (uint32 i = 0; i < (uint32)_gather.size(); ++i) {
+		tmp[i] = _array_[_gather[i]];
+	}
+	eastl::swap(_array_, tmp);
+}
+
+// Rotate [_first, _last) such that _middle becomes _first.
+template <typename tArray>
+static void Rotate(uint32 _first, uint32 _middle, uint32 _last, tArray& _array_)
+{
+	std::rotate(_array_.begin() + _first, _array_.begin() + _middle, _array_.begin() + _last);
+}
+
+// Replace node index _i_ with _map[_i_] (kInvalidIndex is unchanged).
+static void Remap(const eastl::vector<uint32>& _map, uint32& _i_)
+{
+	if (_i_ != NodeHierarchy::kInvalidIndex) {
+		_i_ = _map[_i_];
+	}
+}
+
+// PUBLIC
+
+const uint32 NodeHierarchy::kInvalidIndex;
+
+void NodeHierarchy::sort()
+{
+	if (m_sorted) {
+		return;
+	}
+	PROFILER_MARKER_CPU("#NodeHierarchy::sort");
+
+ // pre-order traversal from the root, then from any unreachable subtree roots; gather[new] = old
+	uint32 n = getNodeCount();
+	eastl::vector<uint32> gather;
+	gather.reserve(n);
+	auto Traverse = [&](uint32 _root)
+		{
+			for (uint32 i = _root; i != kInvalidIndex; i = next(i, _root)) {
+				gather.push_back(i);
+			}
+		};
+	if (m_root) {
+		Traverse(m_root->m_index);
+	}
+	m_reachableCount = (uint32)gather.size();
+	for (uint32 i = 0; i < n; ++i) {
+		if (m_parents[i] == kInvalidIndex && m_nodes[i] != m_root) {
+			Traverse(i);
+		}
+	}
+	APT_ASSERT(gather.size() == n); // loop in the hierarchy?
+
+ // gather, remap the links via the new node indices
+	Gather(gather, m_nodes);
+	Gather(gather, m_parents);
+	Gather(gather, m_firstChildren);
+	Gather(gather, m_nextSiblings);
+	Gather(gather, m_prevSiblings);
+	Gather(gather, m_flags);
+	Gather(gather, m_localPositions);
+	Gather(gather, m_localOrientations);
+	Gather(gather, m_localScales);
+	Gather(gather, m_worldMatrices);
+	eastl::vector<uint32> scatter(n); // scatter[old] = new
+	for (uint32 i = 0; i < n; ++i) {
+		scatter[gather[i]] = i;
+		m_nodes[i]->m_index = i;
+	}
+	for (uint32 i = 0; i < n; ++i) {
+		Remap(scatter, m_parents[i]);
+		Remap(scatter, m_firstChildren[i]);
+		Remap(scatter, m_nextSiblings[i]);
+		Remap(scatter, m_prevSiblings[i]);
+	}
+
+ // subtree sizes, children are after their parents so accumulate in reverse
+	m_subtreeSizes.assign(n, 1);
+	for (uint32 i = n; i-- > 0; ) {
+		if (m_parents[i] != kInvalidIndex) {
+			m_subtreeSizes[m_parents[i]] += m_subtreeSizes[i];
+		}
+	}
+
+ // xform lists in hierarchy order
+	compactXForms();
+
+	m_sorted = true;
+}
+
+mat4 NodeHierarchy::getLocalMatrix(uint32 _i) const
+{
+	return TransformationMatrix(m_localPositions[_i], m_localOrientations[_i], m_localScales[_i]);
+}
+
+size_t NodeHierarchy::getMemoryUsage() const
+{
+	size_t ret = 0;
+	ret += m_nodes.capacity()             * sizeof(Node*);
+	ret += m_parents.capacity()           * sizeof(uint32);
+	ret += m_firstChildren.capacity()     * sizeof(uint32);
+	ret += m_nextSiblings.capacity()      * sizeof(uint32);
+	ret += m_prevSiblings.capacity()      * sizeof(uint32);
+	ret += m_subtreeSizes.capacity()      * sizeof(uint32);
+	ret += m_flags.capacity()             * sizeof(uint8);
+	ret += m_localPositions.capacity()    * sizeof(vec3);
+	ret += m_localOrientations.capacity() * sizeof(quat);
+	ret += m_localScales.capacity()       * sizeof(vec3);
+	ret += m_worldMatrices.capacity()     * sizeof(Affine);
+	ret += m_nameBlocks.size()            * kNameBlockSize + m_nameBlocks.capacity() * sizeof(char*);
+	ret += m_xforms.capacity()            * sizeof(XForm*);
+ // approximate, one allocation per hash map entry (value + next pointer)
+	ret += m_nodeIds.bucket_count()       * sizeof(void*) + m_nodeIds.size()   * (sizeof(NodeIdMap::value_type) + sizeof(void*));
+	ret += m_nodeNames.bucket_count()     * sizeof(void*) + m_nodeNames.size() * (sizeof(NodeNameMap::value_type) + sizeof(void*));
+	for (auto& it : m_nodeNames) {
+		ret += it.second.capacity() * sizeof(uint64);
+	}
+	return ret;
+}
+
+void NodeHierarchy::setLocalMatrix(uint32 _i, const mat4& _mat)
+{
+	vec3 scale = GetScale(_mat);
+	vec3 axes[3] = { _mat[0].xyz(), _mat[1].xyz(), _mat[2].xyz() };
+	if (dot(cross(axes[0], axes[1]), axes[2]) < 0.0f) {
+	 // mirrored, fold the reflection into the x scale such that the remaining basis is a rotation
+		scale.x = -scale.x;
+	}
+	int zeroCount   = 0;
+	int zeroAxis    = 0;
+	int nonzeroAxis = 0;
+	for (int j = 0; j < 3; ++j) {
+		if (scale[j] == 0.0f) {
+			++zeroCount;
+			zeroAxis = j;
+		} else {
+			axes[j] /= scale[j];
+			nonzeroAxis = j;
+		}
+	}
+ // axes with 0 scale are arbitrary, complete the basis from the others
+	if (zeroCount == 1) {
+		axes[zeroAxis] = cross(axes[(zeroAxis + 1) % 3], axes[(zeroAxis + 2) % 3]);
+	} else if (zeroCount == 2) {
+		const vec3& a = axes[nonzeroAxis];
+		vec3 b = fabsf(a.x) < 0.9f ? vec3(1.0f, 0.0f, 0.0f) : vec3(0.0f, 1.0f, 0.0f);
+		b = normalize(cross(a, b));
+		axes[(nonzeroAxis + 1) % 3] = b;
+		axes[(nonzeroAxis + 2) % 3] = cross(a, b);
+	} else if (zeroCount == 3) {
+		axes[0] = vec3(1.0f, 0.0f, 0.0f);
+		axes[1] = vec3(0.0f, 1.0f, 0.0f);
+		axes[2] = vec3(0.0f, 0.0f, 1.0f);
+	}
+	mat3 rotation = mat3(axes[0], axes[1], axes[2]);
+	m_localPositions[_i]    = GetTranslation(_mat);
+	m_localOrientations[_i] = RotationToQuat(rotation);
+	m_localScales[_i]       = scale;
+}
+
+// PRIVATE
+
+NodeHierarchy::Affine::Affine(const mat4& _mat)
+{
+	m_col[0] = _mat[0].xyz();
+	m_col[1] = _mat[1].xyz();
+	m_col[2] = _mat[2].xyz();
+	m_col[3] = _mat[3].xyz();
+}
+
+mat4 NodeHierarchy::Affine::asMat4() const
+{
+	return mat4(
+		vec4(m_col[0], 0.0f),
+		vec4(m_col[1], 0.0f),
+		vec4(m_col[2], 0.0f),
+		vec4(m_col[3], 1.0f)
+		);
+}
+
+NodeHierarchy::Affine NodeHierarchy::Affine::operator*(const Affine& _rhs) const
+{
+ // as mat4 * mat4 with the implicit last rows (0, 0, 0, 1)
+	Affine ret;
+	for (int i = 0; i < 4; ++i) {
+		const vec3& c = _rhs.m_col[i];
+		ret.m_col[i] = m_col[0] * c.x + m_col[1] * c.y + m_col[2] * c.z;
+	}
+	ret.m_col[3] += m_col[3];
+	return ret;
+}
+
+NodeHierarchy::NodeHierarchy()
+	: m_root(nullptr)
+	, m_reachableCount(0)
+	, m_sorted(true)
+	, m_xformBatching(true)
+	, m_nameEnd(0)
+	, m_xformsUnused(0)
+{
+	memset(m_nameFree, 0, sizeof(m_nameFree));
+	uint32 empty = allocName(1); // offset 0 is the empty string
+	APT_ASSERT(empty == 0);
+	m_nameBlocks[0][empty] = '\0';
+}
+
+NodeHierarchy::~NodeHierarchy()
+{
+	for (char* block : m_nameBlocks) {
+		APT_FREE(block);
+	}
+}
+
+void NodeHierarchy::reserve(uint32 _count, uint32 _xformCount)
+{
+ // grow geometrically, repeated calls (e.g. per partition load) would otherwise reallocate every time; hash_map::reserve()
+ // always rehashes, hence only call it when growing
+	if (_count > (uint32)m_nodes.capacity()) {
+		_count = APT_MAX(_count, (uint32)m_nodes.capacity() * 2);
+		m_nodes.reserve(_count);
+		m_parents.reserve(_count);
+		m_firstChildren.reserve(_count);
+		m_nextSiblings.reserve(_count);
+		m_prevSiblings.reserve(_count);
+		m_subtreeSizes.reserve(_count);
+		m_flags.reserve(_count);
+		m_localPositions.reserve(_count);
+		m_localOrientations.reserve(_count);
+		m_localScales.reserve(_count);
+		m_worldMatrices.reserve(_count);
+		m_nodeIds.reserve(_count);
+		m_nodeNames.reserve(_count);
+	}
+	uint32 xformCount = (uint32)m_xforms.size() + _xformCount;
+	if (xformCount > (uint32)m_xforms.capacity()) {
+		m_xforms.reserve(APT_MAX(xformCount, (uint32)m_xforms.capacity() * 2));
+	}
+}
+
+void NodeHierarchy::add(Node* _node)
+{
+	addUnreachable(_node);
+	m_sorted = false;
+}
+
+void NodeHierarchy::addUnreachable(Node* _node)
+{
+	APT_ASSERT(_node->m_hierarchy == nullptr);
+	_node->m_hierarchy  = this;
+	_node->m_index      = getNodeCount();
+	_node->m_name       = 0;
+	_node->m_xformBegin = (uint32)m_xforms.size();
+	_node->m_xformCount = 0;
+	m_nodes.push_back(_node);
+	m_parents.push_back(kInvalidIndex);
+	m_firstChildren.push_back(kInvalidIndex);
+	m_nextSiblings.push_back(kInvalidIndex);
+	m_prevSiblings.push_back(kInvalidIndex);
+	m_subtreeSizes.push_back(1);
+	m_flags.push_back(Flag_Dirty);
+	m_localPositions.push_back(vec3(0.0f));
+	m_localOrientations.push_back(quat(0.0f, 0.0f, 0.0f, 1.0f));
+	m_localScales.push_back(vec3(1.0f));
+	m_worldMatrices.push_back(Affine(mat4(identity)));
+}
+
+void NodeHierarchy::remove(Node* _node)
+{
+	APT_ASSERT(_node->m_hierarchy == this && m_nodes[_node->m_index] == _node);
+	uint32 i    = _node->m_index;
+	uint32 last = getNodeCount() - 1;
+	APT_ASSERT(m_parents[i] == kInvalidIndex && m_firstChildren[i] == kInvalidIndex);
+	if (m_flags[i] & Flag_Changed) {
+		m_changedNodes.erase(eastl::find(m_changedNodes.begin(), m_changedNodes.end(), _node));
+	}
+	if (i != last) {
+		m_nodes[i]             = m_nodes[last];
+		m_parents[i]           = m_parents[last];
+		m_firstChildren[i]     = m_firstChildren[last];
+		m_nextSiblings[i]      = m_nextSiblings[last];
+		m_prevSiblings[i]      = m_prevSiblings[last];
+		m_subtreeSizes[i]      = m_subtreeSizes[last];
+		m_flags[i]             = m_flags[last];
+		m_localPositions[i]    = m_localPositions[last];
+		m_localOrientations[i] = m_localOrientations[last];
+		m_localScales[i]       = m_localScales[last];
+		m_worldMatrices[i]     = m_worldMatrices[last];
+		m_nodes[i]->m_index    = i;
+
+	 // redirect the links to last
+		uint32 parent = m_parents[i];
+		if (parent != kInvalidIndex) {
+			uint32& first = m_firstChildren[parent];
+			first = first == last ? i : first;
+			if (i != first) {
+				m_nextSiblings[m_prevSiblings[i]] = i;
+			}
+			m_prevSiblings[m_nextSiblings[i] != kInvalidIndex ? m_nextSiblings[i] : first] = i;
+		}
+		for (uint32 child = m_firstChildren[i]; child != kInvalidIndex; child = m_nextSiblings[child]) {
+			m_parents[child] = i;
+		}
+	}
+	m_nodes.pop_back();
+	m_parents.pop_back();
+	m_firstChildren.pop_back();
+	m_nextSiblings.pop_back();
+	m_prevSiblings.pop_back();
+	m_subtreeSizes.pop_back();
+	m_flags.pop_back();
+	m_localPositions.pop_back();
+	m_localOrientations.pop_back();
+	m_localScales.pop_back();
+	m_worldMatrices.pop_back();
+	if (_node == m_root) {
+		m_root = nullptr;
+	}
+
+ // release the name and xform list
+	if (_node->m_name != 0) {
+		freeName(_node->m_name);
+		_node->m_name = 0;
+	}
+	for (uint32 j = 0; j < _node->m_xformCount; ++j) {
+		m_xforms[_node->m_xformBegin + j] = nullptr;
+	}
+	m_xformsUnused += _node->m_xformCount;
+	_node->m_name       = 0;
+	_node->m_xformCount = 0;
+
+	_node->m_hierarchy = nullptr;
+	_node->m_index     = kInvalidIndex;
+ // the last node is also unreachable if i is, hence the reachable range is unchanged
+	if (!m_sorted || i < m_reachableCount) {
+		m_sorted = false;
+	}
+}
+
+void NodeHierarchy::link(uint32 _i, uint32 _parent)
+{
+	APT_ASSERT(m_parents[_i] == kInvalidIndex);
+	m_parents[_i]      = _parent;
+	m_nextSiblings[_i] = kInvalidIndex;
+	uint32 first = m_firstChildren[_parent];
+	if (first == kInvalidIndex) {
+		m_firstChildren[_parent] = _i;
+		m_prevSiblings[_i] = _i;
+	} else {
+		uint32 last = m_prevSiblings[first];
+		m_nextSiblings[last] = _i;
+		m_prevSiblings[_i] = last;
+		m_prevSiblings[first] = _i;
+	}
+}
+
+void NodeHierarchy::unlink(uint32 _i)
+{
+	uint32 parent = m_parents[_i];
+	if (parent == kInvalidIndex) {
+		return;
+	}
+	uint32 first = m_firstChildren[parent];
+	uint32 prev  = m_prevSiblings[_i];
+	uint32 next  = m_nextSiblings[_i];
+	if (_i == first) {
+		m_firstChildren[parent] = next;
+		if (next != kInvalidIndex) {
+			m_prevSiblings[next] = prev; // prev is the last child
+		}
+	} else {
+		m_nextSiblings[prev] = next;
+		m_prevSiblings[next != kInvalidIndex ? next : first] = prev;
+	}
+	m_parents[_i]      = kInvalidIndex;
+	m_nextSiblings[_i] = kInvalidIndex;
+	m_prevSiblings[_i] = kInvalidIndex;
+}
+
+void NodeHierarchy::invalidate(const Node* _parent)
+{
+	if (!m_sorted || _parent->m_index < m_reachableCount) {
+		m_sorted = false;
+	}
+}
+
+void NodeHierarchy::attach(Node* _root, Node* _parent, uint32 _size)
+{
+	APT_ASSERT(_root->m_hierarchy == this && _parent->m_hierarchy == this);
+	link(_root->m_index, _parent->m_index);
+
+ // the subtree must be the unreachable range [beg, end) in pre-order
+	uint32 beg = _root->m_index;
+	uint32 end = beg + _size;
+	if (!m_sorted || _parent->m_index >= m_reachableCount || beg < m_reachableCount || end > getNodeCount()) {
+		invalidate(_parent);
+		return;
+	}
+	uint32 count = 0;
+	for (uint32 i = beg; i != kInvalidIndex; i = next(i, beg), ++count) {
+		if (i != beg + count || count == _size) {
+			m_sorted = false;
+			return;
+		}
+		m_subtreeSizes[i] = 1;
+	}
+	if (count != _size) {
+		m_sorted = false;
+		return;
+	}
+
+ // move the subtree to the end of the parent's subtree (_root is the last child)
+	uint32 dst = _parent->m_index + m_subtreeSizes[_parent->m_index];
+	rotate(dst, beg, end);
+	for (uint32 i = dst + _size - 1; i > dst; --i) {
+		m_subtreeSizes[m_parents[i]] += m_subtreeSizes[i];
+	}
+	for (uint32 i = _parent->m_index; i != kInvalidIndex; i = m_parents[i]) {
+		m_subtreeSizes[i] += _size;
+	}
+	m_reachableCount += _size;
+}
+
+void NodeHierarchy::detach(Node* _root)
+{
+	uint32 beg = _root->m_index;
+	uint32 parent = m_parents[beg];
+	APT_ASSERT(parent != kInvalidIndex);
+	if (!m_sorted || beg >= m_reachableCount) {
+		unlink(beg);
+		invalidate(m_nodes[parent]);
+		return;
+	}
+
+ // move the subtree to the start of the unreachable range
+	uint32 size = m_subtreeSizes[beg];
+	for (uint32 i = parent; i != kInvalidIndex; i = m_parents[i]) {
+		m_subtreeSizes[i] -= size;
+	}
+	unlink(beg);
+	rotate(beg, beg + size, m_reachableCount);
+	m_reachableCount -= size;
+}
+
+void NodeHierarchy::rotate(uint32 _first, uint32 _middle, uint32 _last)
+{
+	if (_first == _middle || _middle == _last) {
+		return;
+	}
+	Rotate(_first, _middle, _last, m_nodes);
+	Rotate(_first, _middle, _last, m_parents);
+	Rotate(_first, _middle, _last, m_firstChildren);
+	Rotate(_first, _middle, _last, m_nextSiblings);
+	Rotate(_first, _middle, _last, m_prevSiblings);
+	Rotate(_first, _middle, _last, m_subtreeSizes);
+	Rotate(_first, _middle, _last, m_flags);
+	Rotate(_first, _middle, _last, m_localPositions);
+	Rotate(_first, _middle, _last, m_localOrientations);
+	Rotate(_first, _middle, _last, m_localScales);
+	Rotate(_first, _middle, _last, m_worldMatrices);
+	for (uint32 i = _first; i < _last; ++i) {
+		m_nodes[i]->m_index = i;
+	}
+ // only nodes in the range and their parents/siblings/children link to the range; the links are still old indices
+	auto Remap = [_first, _middle, _last](uint32 _i) -> uint32
+		{
+			if (_i >= _first && _i < _middle) {
+				return _i + (_last - _middle);
+			} else if (_i >= _middle && _i < _last) {
+				return _i - (_middle - _first);
+			}
+			return _i;
+		};
+	eastl::vector<uint32> outside;
+	auto AddOutside = [&](uint32 _i)
+		{
+			if (_i != kInvalidIndex && (_i < _first || _i >= _last)) {
+				outside.push_back(_i);
+			}
+		};
+	for (uint32 i = _first; i < _last; ++i) {
+		uint32 parent = Remap(m_parents[i]);
+		AddOutside(parent);
+		if (parent != kInvalidIndex) {
+			AddOutside(Remap(m_firstChildren[parent])); // the first child's m_prevSiblings entry is the last child
+		}
+		AddOutside(Remap(m_nextSiblings[i]));
+		AddOutside(Remap(m_prevSiblings[i]));
+		for (uint32 child = Remap(m_firstChildren[i]); child != kInvalidIndex; child = Remap(m_nextSiblings[child])) {
+			AddOutside(child);
+		}
+	}
+	eastl::sort(outside.begin(), outside.end());
+	outside.erase(eastl::unique(outside.begin(), outside.end()), outside.end());
+	auto RemapLinks = [&](uint32 _i)
+		{
+			m_parents[_i]       = Remap(m_parents[_i]);
+			m_firstChildren[_i] = Remap(m_firstChildren[_i]);
+			m_nextSiblings[_i]  = Remap(m_nextSiblings[_i]);
+			m_prevSiblings[_i]  = Remap(m_prevSiblings[_i]);
+		};
+	for (uint32 i = _first; i < _last; ++i) {
+		RemapLinks(i);
+	}
+	for (uint32 i : outside) {
+		RemapLinks(i);
+	}
+}
+
+uint32 NodeHierarchy::next(uint32 _i, uint32 _root) const
+{
+	if (m_firstChildren[_i] != kInvalidIndex) {
+		return m_firstChildren[_i];
+	}
+	while (_i != _root) {
+		if (m_nextSiblings[_i] != kInvalidIndex) {
+			return m_nextSiblings[_i];
+		}
+		_i = m_parents[_i];
+	}
+	return kInvalidIndex;
+}
+
+NodeHierarchy::Affine NodeHierarchy::getLocalAffine(uint32 _i) const
+{
+	return Affine(getLocalMatrix(_i));
+}
+
+void NodeHierarchy::setDirty(Node* _node)
+{
+	m_flags[_node->m_index] |= Flag_Dirty;
+	flagAncestors(_node);
+}
+
+void NodeHierarchy::flagAncestors(Node* _node)
+{
+	for (uint32 parent = m_parents[_node->m_index]; parent != kInvalidIndex && !(m_flags[parent] & Flag_ChildDirty); parent = m_parents[parent]) {
+		m_flags[parent] |= Flag_ChildDirty;
+	}
+}
+
+void NodeHierarchy::clearChangedNodes()
+{
+	for (Node* node : m_changedNodes) {
+		m_flags[node->m_index] &= ~Flag_Changed;
+	}
+	m_changedNodes.clear();
+}
+
+void NodeHierarchy::setChanged(uint32 _i)
+{
+	Node* node = m_nodes[_i];
+	if (!(m_flags[_i] & Flag_Changed)) {
+		m_flags[_i] |= Flag_Changed;
+		m_changedNodes.push_back(node);
+	}
+	if (node->m_xformCount == 0 && node->m_type != Node::Type_Camera) {
+		m_flags[_i] &= ~Flag_Dirty;
+	} else {
+		flagAncestors(node); // Flag_ChildDirty was cleared when the ancestors were visited
+	}
+}
+
+uint32 NodeHierarchy::updateNode(uint32 _i, float _dt, uint8 _stateMask, UpdateContext& _ctx_)
+{
+	uint8& flags = m_flags[_i];
+	Node*  node  = m_nodes[_i];
+
+	if (!(node->m_state & _stateMask)) {
+		if (flags & (Flag_Dirty | Flag_ChildDirty)) {
+			flagAncestors(_i, _ctx_); // keep pending until the node is updated
+		}
+		return _i + m_subtreeSizes[_i];
+	}
+	uint32 parent = m_parents[_i];
+	bool changed = (flags & Flag_Dirty) || (parent != kInvalidIndex && (m_flags[parent] & Flag_Changed));
+	if (!changed) {
+		if (flags & Flag_ChildDirty) {
+			flags &= ~Flag_ChildDirty;
+			return _i + 1;
+		}
+		return _i + m_subtreeSizes[_i];
+	}
+	flags &= ~Flag_ChildDirty;
+
+	m_worldMatrices[_i] = getLocalAffine(_i);
+	applyXForms(node, _dt, _ctx_.m_parallel);
+	if (parent != kInvalidIndex) {
+		m_worldMatrices[_i] = m_worldMatrices[parent] * m_worldMatrices[_i];
+	}
+
+	bool alwaysDirty = node->m_xformCount != 0;
+	if (node->m_type == Node::Type_Camera) {
+		alwaysDirty = true;
+		if (_ctx_.m_parallel) {
+			_ctx_.m_cameraNodes.push_back(node);
+		} else {
+			Camera* camera = node->getSceneDataCamera();
+			APT_ASSERT(camera);
+			camera->update();
+		}
+	}
+
+	flags |= Flag_Changed;
+	(_ctx_.m_parallel ? _ctx_.m_changedNodes : m_changedNodes).push_back(node);
+	if (alwaysDirty) {
+		flagAncestors(_i, _ctx_); // Flag_ChildDirty was cleared when the ancestors were visited
+	} else {
+		flags &= ~Flag_Dirty;
+	}
+
+	return _i + 1;
+}
+
+void NodeHierarchy::updateRange(uint32 _begin, uint32 _end, float _dt, uint8 _stateMask, UpdateContext& _ctx_)
+{
+ // parents are updated before their children and a subtree can be skipped by jumping over its range
+	for (uint32 i = _begin; i < _end; ) {
+		i = updateNode(i, _dt, _stateMask, _ctx_);
+	}
+}
+
+void NodeHierarchy::updateParallel(float _dt, uint8 _stateMask)
+{
+	PROFILER_MARKER_CPU("#NodeHierarchy::updateParallel");
+
+	UpdateContext ctx;
+
+	uint32 n = getReachableCount();
+	uint32 threadCount = GetParallelThreadCount();
+	if (threadCount < 2 || n < kMinParallelNodes) {
+		updateRange(0, n, _dt, _stateMask, ctx);
+		return;
+	}
+
+ // subtrees larger than maxTaskSize are split; their root is updated serially, their children become tasks
+	uint32 maxTaskSize = APT_MAX(kMinTaskSize, n / (threadCount * kTasksPerThread));
+	m_tasks.clear();
+
+ // nodes with xforms which aren't thread safe may access other nodes (e.g. XForm_LookAt reads its target, setting the
+ // local transform flags the ancestors), hence their subtrees are never part of a task and are updated on the calling
+ // thread. Pre-order is preserved between them and the tasks (the tasks preceding a serial root are run before it, the
+ // remainder after it), such that a serial node sees the same state of the other nodes as in updateLinear()
+	m_serialNodes.clear();
+	for (XForm* xform : m_xforms) {
+		if (xform && !(m_xformBatching && xform->m_batch) && !xform->isThreadSafe()) {
+			uint32 i = xform->m_node->m_index;
+			if (i < n) {
+				m_serialNodes.push_back(i);
+			}
+		}
+	}
+	eastl::sort(m_serialNodes.begin(), m_serialNodes.end());
+	m_serialNodes.erase(eastl::unique(m_serialNodes.begin(), m_serialNodes.end()), m_serialNodes.end());
+
+	auto runTasks = [&]()
+		{
+			if (m_tasks.empty()) {
+				return;
+			}
+			if (m_taskContexts.size() < m_tasks.size()) {
+				m_taskContexts.resize(m_tasks.size());
+			}
+			ParallelFor((uint32)m_tasks.size(), 1, [&](uint32 _begin, uint32 _end)
+				{
+					for (uint32 t = _begin; t < _end; ++t) {
+						uint32 i = m_tasks[t];
+						UpdateContext& taskCtx = m_taskContexts[t];
+						taskCtx.m_begin         = i;
+						taskCtx.m_parallel      = true;
+						taskCtx.m_flagAncestors = false;
+						taskCtx.m_changedNodes.clear();
+						taskCtx.m_cameraNodes.clear();
+						updateRange(i, i + m_subtreeSizes[i], _dt, _stateMask, taskCtx);
+					}
+				});
+
+		 // merge the task results
+			for (uint32 t = 0; t < (uint32)m_tasks.size(); ++t) {
+				UpdateContext& taskCtx = m_taskContexts[t];
+				m_changedNodes.insert(m_changedNodes.end(), taskCtx.m_changedNodes.begin(), taskCtx.m_changedNodes.end());
+				for (Node* node : taskCtx.m_cameraNodes) {
+					Camera* camera = node->getSceneDataCamera();
+					APT_ASSERT(camera);
+					camera->update();
+				}
+				if (taskCtx.m_flagAncestors) {
+					flagAncestors(m_tasks[t], ctx);
+				}
+			}
+			m_tasks.clear();
+		};
+
+ // visit in pre-order (children are pushed in reverse), the roots of split subtrees are updated immediately as they
+ // precede all of their descendants
+	eastl::vector<uint32> stack;
+	stack.push_back(0);
+	while (!stack.empty()) {
+		uint32 i = stack.back();
+		stack.pop_back();
+		auto serial = eastl::lower_bound(m_serialNodes.begin(), m_serialNodes.end(), i);
+		if (serial == m_serialNodes.end() || *serial >= i + m_subtreeSizes[i]) {
+			if (m_subtreeSizes[i] <= maxTaskSize) {
+				m_tasks.push_back(i);
+				continue;
+			}
+		} else if (*serial == i) {
+			runTasks();
+			updateRange(i, i + m_subtreeSizes[i], _dt, _stateMask, ctx);
+			continue;
+		}
+		if (updateNode(i, _dt, _stateMask, ctx) != i + 1) {
+			continue; // subtree skipped
+		}
+		uint32 childCount = 0;
+		for (uint32 j = i + 1, end = i + m_subtreeSizes[i]; j < end; j += m_subtreeSizes[j]) {
+			stack.push_back(j);
+			++childCount;
+		}
+		eastl::reverse(stack.end() - childCount, stack.end());
+	}
+	runTasks();
+}
+
+void NodeHierarchy::indexNode(Node* _node)
+{
+	if (_node->m_id == Node::kInvalidId) {
+		return;
+	}
+	APT_ASSERT(m_nodeIds.find(_node->m_id) == m_nodeIds.end()); // duplicate id
+	m_nodeIds[_node->m_id] = _node;
+	m_nodeNames[StringHash(_node->getName()).getHash()].push_back(_node->m_id);
+}
+
+void NodeHierarchy::unindexNode(Node* _node)
+{
+	auto idIt = m_nodeIds.find(_node->m_id);
+	if (idIt == m_nodeIds.end() || idIt->second != _node) {
+		return;
+	}
+	m_nodeIds.erase(idIt);
+
+	auto nameIt = m_nodeNames.find(StringHash(_node->getName()).getHash());
+	APT_ASSERT(nameIt != m_nodeNames.end());
+	eastl::vector<uint64>& ids = nameIt->second;
+	ids.erase(eastl::find(ids.begin(), ids.end(), _node->m_id));
+	if (ids.empty()) {
+		m_nodeNames.erase(nameIt);
+	}
+}
+
+void NodeHierarchy::setName(Node* _node, const char* _name)
+{
+	APT_ASSERT(_node->m_hierarchy == this);
+	uint32 name = 0;
+	if (*_name != '\0') {
+		uint32 len = APT_MIN((uint32)strlen(_name), kNameBlockSize - 1);
+		name = allocName(len + 1);
+		char* dst = m_nameBlocks[name / kNameBlockSize] + name % kNameBlockSize;
+		memcpy(dst, _name, len);
+		dst[len] = '\0';
+	}
+ // release the old name after copying, _name may be the old name
+	if (_node->m_name != 0) {
+		freeName(_node->m_name);
+	}
+	_node->m_name = name;
+}
+
+static uint32 NameClass(uint32 _size, uint32 _slotSize)
+{
+	uint32 ret = 0;
+	while ((_slotSize << ret) < _size) {
+		++ret;
+	}
+	return ret;
+}
+
+uint32 NodeHierarchy::allocName(uint32 _size)
+{
+	uint32 nameClass = NameClass(_size, kNameSlotSize);
+	APT_ASSERT(nameClass < kNameClassCount);
+	uint32& head = m_nameFree[nameClass];
+	if (head != 0) {
+		uint32 ret = head;
+		memcpy(&head, getName(ret), sizeof(uint32));
+		return ret;
+	}
+ // a slot doesn't cross blocks, the remainder of the last block is dropped
+	uint32 slotSize = kNameSlotSize << nameClass;
+	if (m_nameEnd + slotSize > (uint32)m_nameBlocks.size() * kNameBlockSize) {
+		m_nameBlocks.push_back((char*)APT_MALLOC(kNameBlockSize));
+		m_nameEnd = ((uint32)m_nameBlocks.size() - 1) * kNameBlockSize;
+	}
+	uint32 ret = m_nameEnd;
+	m_nameEnd += slotSize;
+	return ret;
+}
+
+void NodeHierarchy::freeName(uint32 _name)
+{
+	APT_ASSERT(_name != 0); // the empty string is never released
+	char* slot = m_nameBlocks[_name / kNameBlockSize] + _name % kNameBlockSize;
+	uint32& head = m_nameFree[NameClass((uint32)strlen(slot) + 1, kNameSlotSize)];
+	memcpy(slot, &head, sizeof(uint32));
+	head = _name;
+}
+
+void NodeHierarchy::appendXForms(Node* _node, XForm* const* _xforms, uint32 _count)
+{
+	APT_ASSERT(_node->m_hierarchy == this);
+	APT_ASSERT((uint32)_node->m_xformCount + _count <= 0xffff);
+	if (m_xformsUnused > kMinCompactSize && m_xformsUnused > (uint32)m_xforms.size() / 2) {
+		compactXForms();
+	}
+	uint32 begin = _node->m_xformBegin;
+	uint32 count = _node->m_xformCount;
+	if (begin + count != (uint32)m_xforms.size()) {
+	 // move the list to the end
+		uint32 newBegin = (uint32)m_xforms.size();
+		m_xforms.resize(newBegin + count);
+		for (uint32 i = 0; i < count; ++i) {
+			m_xforms[newBegin + i] = m_xforms[begin + i];
+			m_xforms[begin + i] = nullptr;
+		}
+		m_xformsUnused += count;
+		_node->m_xformBegin = newBegin;
+	}
+	m_xforms.insert(m_xforms.end(), _xforms, _xforms + _count);
+	_node->m_xformCount = (uint16)(count + _count);
+}
+
+void NodeHierarchy::eraseXForm(Node* _node, uint32 _i)
+{
+	APT_ASSERT(_node->m_hierarchy == this && _i < _node->m_xformCount);
+	uint32 end = _node->m_xformBegin + _node->m_xformCount;
+	for (uint32 i = _node->m_xformBegin + _i; i < end - 1; ++i) {
+		m_xforms[i] = m_xforms[i + 1];
+	}
+	if (end == (uint32)m_xforms.size()) {
+		m_xforms.pop_back();
+	} else {
+		m_xforms[end - 1] = nullptr;
+		++m_xformsUnused;
+	}
+	--_node->m_xformCount;
+}
+
+void NodeHierarchy::compactXForms()
+{
+	eastl::vector<XForm*> xforms;
+	xforms.reserve(m_xforms.size() - m_xformsUnused);
+	for (Node* node : m_nodes) {
+		uint32 begin = (uint32)xforms.size();
+		xforms.insert(xforms.end(), m_xforms.begin() + node->m_xformBegin, m_xforms.begin() + node->m_xformBegin + node->m_xformCount);
+		node->m_xformBegin = begin;
+	}
+	eastl::swap(m_xforms, xforms);
+	m_xformsUnused = 0;
+}
+
+void NodeHierarchy::addXForm(XForm* _xform)
+{
+	_xform->m_batch = XForm::FindBatch(_xform->getClassRef());
+	if (!_xform->m_batch) {
+		return;
+	}
+	int batchIndex = _xform->m_batch->m_index;
+	if ((int)m_xformBatches.size() <= batchIndex) {
+		m_xformBatches.resize(batchIndex + 1);
+	}
+	_xform->m_batchIndex = (uint32)m_xformBatches[batchIndex].size();
+	m_xformBatches[batchIndex].push_back(_xform);
+}
+
+void NodeHierarchy::removeXForm(XForm* _xform)
+{
+	if (!_xform->m_batch) {
+		return;
+	}
+ // swap with the last instance
+	eastl::vector<XForm*>& batch = m_xformBatches[_xform->m_batch->m_index];
+	APT_ASSERT(_xform->m_batchIndex < (uint32)batch.size() && batch[_xform->m_batchIndex] == _xform);
+	XForm* last = batch.back();
+	batch[_xform->m_batchIndex] = last;
+	last->m_batchIndex = _xform->m_batchIndex;
+	batch.pop_back();
+	_xform->m_batch = nullptr;
+	_xform->m_batchIndex = ~0u;
+}
+
+void NodeHierarchy::applyXFormBatches(float _dt, bool _parallel)
+{
+	PROFILER_MARKER_CPU("#NodeHierarchy::applyXFormBatches");
+
+	for (int i = 0; i < (int)m_xformBatches.size(); ++i) {
+		eastl::vector<XForm*>& batch = m_xformBatches[i];
+		if (batch.empty()) {
+			continue;
+		}
+		XForm::ApplyAllFunc* applyAll = XForm::GetBatch(i)->m_applyAll;
+		if (_parallel && batch.size() > kXFormBatchGrainSize) {
+			ParallelFor((uint32)batch.size(), kXFormBatchGrainSize, [&](uint32 _begin, uint32 _end)
+				{
+					applyAll(batch.data() + _begin, _end - _begin, _dt);
+				});
+		} else {
+			applyAll(batch.data(), (uint32)batch.size(), _dt);
+		}
+	}
+}
+
+void NodeHierarchy::applyXForms(Node* _node, float _dt, bool _parallel)
+{
+	for (uint32 i = _node->m_xformBegin, end = i + _node->m_xformCount; i < end; ++i) {
+		XForm* xform = m_xforms[i];
+		if (m_xformBatching && xform->m_batch) {
+			xform->applyBatched();
+		} else {
+			APT_ASSERT(!_parallel || xform->isThreadSafe()); // see updateParallel()
+			xform->apply(_dt);
+		}
+	}
+}
+
+void NodeHierarchy::flagAncestors(uint32 _i, UpdateContext& _ctx_)
+{
+ // during a parallel update, ancestors outside the task range are shared between tasks and are flagged afterwards
+	for (uint32 parent = m_parents[_i]; parent != kInvalidIndex; parent = m_parents[parent]) {
+		if (parent < _ctx_.m_begin) {
+			_ctx_.m_flagAncestors = true;
+			break;
+		}
+		if (m_flags[parent] & Flag_ChildDirty) {
+			break;
+		}
+		m_flags[parent] |= Flag_ChildDirty;
+	}
+}
+
 /*******************************************************************************
 
                                    Node
@@ -39,12 +1014,22 @@ static Node::Type NodeTypeFromStr(const char* _str)
 
 // PUBLIC
 
+void Node::setName(const char* _name)
+{
+	APT_ASSERT(m_hierarchy);
+	m_hierarchy->unindexNode(this);
+	m_hierarchy->setName(this, _name);
+	m_hierarchy->indexNode(this);
+}
+
 void Node::setNamef(const char* _fmt, ...)
 {
 	va_list args;
 	va_start(args, _fmt);
-	m_name.setfv(_fmt, args);
+	NameStr name;
+	name.setfv(_fmt, args);
 	va_end(args);
+	setName((const char*)name);
 }
 
 void Node::addXForm(XForm* _xform)
@@ -52,17 +1037,21 @@ void Node::addXForm(XForm* _xform)
 	APT_ASSERT(_xform);
 	APT_ASSERT(_xform->getNode() == nullptr);
 	_xform->setNode(this);
-	m_xforms.push_back(_xform);
+	m_hierarchy->appendXForms(this, &_xform, 1);
+	m_hierarchy->addXForm(_xform);
+	setDirty();
 }
 
 void Node::removeXForm(XForm* _xform)
 {
-	for (auto it = m_xforms.begin(); it != m_xforms.end(); ++it) {
-		XForm* x = *it;
+	for (int i = 0; i < getXFormCount(); ++i) {
+		XForm* x = getXForm(i);
 		if (x == _xform) {
 			APT_ASSERT(x->getNode() == this);
 			x->setNode(nullptr);
-			m_xforms.erase(it);
+			m_hierarchy->eraseXForm(this, (uint32)i);
+			m_hierarchy->removeXForm(x);
+			setDirty();
 			return;
 		}
 	}
@@ -71,9 +1060,8 @@ void Node::removeXForm(XForm* _xform)
 void Node::moveXForm(const XForm* _xform, int _dir)
 {
 	for (int i = 0, n = getXFormCount(); i < n; ++i) {
-		if (m_xforms[i] == _xform) {
-			int j = APT_CLAMP(i + _dir, 0, n - 1);
-			eastl::swap(m_xforms[i], m_xforms[j]);
+		if (getXForm(i) == _xform) {
+			moveXForm(i, _dir);
 			return;
 		}
 	}
@@ -82,24 +1070,52 @@ void Node::moveXForm(const XForm* _xform, int _dir)
 void Node::setParent(Node* _node)
 {
 	if (_node) {
-		_node->addChild(this); // addChild sets m_parent implicitly
+		_node->addChild(this); // addChild sets the parent implicitly
 	} else {
-		if (m_parent) {
-			m_parent->removeChild(this);
+		Node* parent = getParent();
+		if (parent) {
+			parent->removeChild(this);
+		}
+		if (m_hierarchy) {
+			m_hierarchy->m_sorted = false;
 		}
-		m_parent = nullptr;
 	}
 }
 
+int Node::getChildCount() const
+{
+	if (!m_hierarchy) {
+		return 0;
+	}
+	int ret = 0;
+	for (uint32 i = m_hierarchy->m_firstChildren[m_index]; i != NodeHierarchy::kInvalidIndex; i = m_hierarchy->m_nextSiblings[i]) {
+		++ret;
+	}
+	return ret;
+}
+
+Node* Node::getChild(int _i)
+{
+	APT_ASSERT(_i >= 0);
+	Node* ret = getFirstChild();
+	while (ret && _i-- > 0) {
+		ret = ret->getNextSibling();
+	}
+	return ret;
+}
+
 void Node::addChild(Node* _node)
 {
 	APT_ASSERT(_node);
-	APT_ASSERT(eastl::find(m_children.begin(), m_children.end(), _node) == m_children.end()); // added the same child multiple times?
-	m_children.push_back(_node);
-	if (_node->m_parent && _node->m_parent != this) {
-		_node->m_parent->removeChild(_node);
+	APT_ASSERT(m_hierarchy && _node->m_hierarchy == m_hierarchy);
+	APT_ASSERT(_node->getParent() != this); // added the same child multiple times?
+	Node* parent = _node->getParent();
+	if (parent) {
+		parent->removeChild(_node);
 	}
-	_node->m_parent = this;
+	m_hierarchy->link(_node->m_index, m_index);
+	m_hierarchy->invalidate(this);
+	_node->setDirty();
 
 	if (_node->isStatic()) {
 		Update(_node, 0.0f, Node::State_Any);
@@ -109,10 +1125,10 @@ void Node::addChild(Node* _node)
 void Node::removeChild(Node* _node)
 {
 	APT_ASSERT(_node);
-	auto it = eastl::find(m_children.begin(), m_children.end(), _node);
-	if (it != m_children.end()) {
-		(*it)->m_parent = nullptr;
-		m_children.erase(it);
+	if (_node->getParent() == this) {
+		m_hierarchy->unlink(_node->m_index);
+		m_hierarchy->invalidate(this);
+		_node->setDirty();
 	}
 }
 
@@ -131,17 +1147,55 @@ void Node::Update(Node* _node_, float _dt, uint8 _stateMask)
 		return;
 	}
 
+	UpdateSingle(_node_, _dt);
+
+ // update children
+	const NodeHierarchy& hierarchy = *_node_->m_hierarchy;
+	for (uint32 i = hierarchy.m_firstChildren[_node_->m_index]; i != NodeHierarchy::kInvalidIndex; i = hierarchy.m_nextSiblings[i]) {
+		Update(hierarchy.m_nodes[i], _dt, _stateMask);
+	}
+}
+
+void Node::UpdateDirty(Node* _node_, float _dt, uint8 _stateMask, bool _parentChanged)
+{
+	NodeHierarchy& hierarchy = *_node_->m_hierarchy;
+	uint8& flags = hierarchy.m_flags[_node_->m_index];
+	if (!(_node_->m_state & _stateMask)) {
+		if (flags & (NodeHierarchy::Flag_Dirty | NodeHierarchy::Flag_ChildDirty)) {
+			hierarchy.flagAncestors(_node_); // keep pending until the node is updated
+		}
+		return;
+	}
+	bool changed = _parentChanged || (flags & NodeHierarchy::Flag_Dirty);
+	if (!changed && !(flags & NodeHierarchy::Flag_ChildDirty)) {
+		return;
+	}
+	flags &= ~NodeHierarchy::Flag_ChildDirty;
+
+	if (changed) {
+		UpdateSingle(_node_, _dt);
+		hierarchy.setChanged(_node_->m_index);
+	}
+	for (uint32 i = hierarchy.m_firstChildren[_node_->m_index]; i != NodeHierarchy::kInvalidIndex; i = hierarchy.m_nextSiblings[i]) {
+		UpdateDirty(hierarchy.m_nodes[i], _dt, _stateMask, changed);
+	}
+}
+
+void Node::UpdateSingle(Node* _node_, float _dt)
+{
+	NodeHierarchy& hierarchy = *_node_->m_hierarchy;
+	uint32 i = _node_->m_index;
+
  // reset world matrix
-	_node_->m_worldMatrix = _node_->m_localMatrix;
+	hierarchy.m_worldMatrices[i] = hierarchy.getLocalAffine(i);
 
  // apply xforms
-	for (auto& xform : _node_->m_xforms) {
-		xform->apply(_dt);
-	}
+	hierarchy.applyXForms(_node_, _dt, false);
 
  // move to parent space
-	if (_node_->m_parent) {
-		_node_->m_worldMatrix = _node_->m_parent->m_worldMatrix * _node_->m_worldMatrix;
+	uint32 parent = hierarchy.m_parents[i];
+	if (parent != NodeHierarchy::kInvalidIndex) {
+		hierarchy.m_worldMatrices[i] = hierarchy.m_worldMatrices[parent] * hierarchy.m_worldMatrices[i];
 	}
 
  // type-specific update
@@ -156,65 +1210,74 @@ void Node::Update(Node* _node_, float _dt, uint8 _stateMask)
 		default: 
 			break;
 	};
-
- // update children
-	for (auto& child : _node_->m_children) {
-		Update(child, _dt, _stateMask);
-	}
 }
 
 Node::Node()
 	: m_id(kInvalidId)
+	, m_userData(0)
+	, m_sceneData(0)
+	, m_name(0)
 	, m_type(Type_Count)
 	, m_state(0)
-	, m_parent(nullptr)
+	, m_xformCount(0)
+	, m_xformBegin(0)
+	, m_index(NodeHierarchy::kInvalidIndex)
+	, m_hierarchy(nullptr)
 {
 }
 
-Node::Node(Type _type, Id _id, uint8 _state, const char* _name)
+Node::Node(Type _type, Id _id, uint8 _state)
 	: m_id(_id)
-	, m_type(_type)
-	, m_state(_state)
 	, m_userData(0)
 	, m_sceneData(0)
-	, m_localMatrix(identity)
-	, m_parent(nullptr)
+	, m_name(0)
+	, m_type(_type)
+	, m_state(_state)
+	, m_xformCount(0)
+	, m_xformBegin(0)
+	, m_index(NodeHierarchy::kInvalidIndex)
+	, m_hierarchy(nullptr)
 {
 	APT_ASSERT(_type < Type_Count);
-	if (_name) {
-		m_name.set(_name);
-	} else {
-		AutoName(_type, m_name);
-		s_typeCounters[_type]++;
-	}
 }
 
 Node::~Node()
 {
+ // temporary copies (e.g. passed to Pool::alloc()) are never added to the hierarchy
+	if (!m_hierarchy) {
+		return;
+	}
+
  // re-parent children
-	for (auto it = m_children.begin(); it != m_children.end(); ++it) {
-		Node* n = *it;
-		n->m_parent = nullptr; // prevent m_parent->addChild calling removeChild on this (invalidates it)
-		if (m_parent) {
-			m_parent->addChild(n);
+	Node* parent = getParent();
+	while (Node* child = getFirstChild()) {
+		if (parent) {
+			parent->addChild(child); // implicitly calls removeChild() on this
+		} else {
+			removeChild(child);
 		}
 	}
  // de-parent this
-	if (m_parent) {
-		m_parent->removeChild(this);
+	if (parent) {
+		parent->removeChild(this);
 	}
 
  // delete xforms
-	for (auto it = m_xforms.begin(); it != m_xforms.end(); ++it) {
-		delete *it;
+	for (int i = 0; i < getXFormCount(); ++i) {
+		XForm* xform = getXForm(i);
+		m_hierarchy->removeXForm(xform);
+		delete xform;
 	}
-	m_xforms.clear();
+
+ // remove from the hierarchy, releases the name and xform list
+	m_hierarchy->unindexNode(this);
+	m_hierarchy->remove(this);
 }
 
 int Node::moveXForm(int _i, int _dir)
 {
-	int j = APT_CLAMP(_i + _dir, 0, (int)(m_xforms.size() - 1));
-	eastl::swap(m_xforms[_i], m_xforms[j]);
+	int j = APT_CLAMP(_i + _dir, 0, getXFormCount() - 1);
+	eastl::swap(m_hierarchy->m_xforms[m_xformBegin + _i], m_hierarchy->m_xforms[m_xformBegin + j]);
 	return j;
 }
 
@@ -238,6 +1301,10 @@ void frm::swap(Scene& _a, Scene& _b)
 	apt::swap(_a.m_cameraPool, _b.m_cameraPool);
 	eastl::swap(_a.m_lights,    _b.m_lights);
 	apt::swap(_a.m_lightPool, _b.m_lightPool);
+	eastl::swap(_a.m_hierarchy,  _b.m_hierarchy);
+	eastl::swap(_a.m_updateMode, _b.m_updateMode);
+	eastl::swap(_a.m_partitions, _b.m_partitions);
+	eastl::swap(_a.m_partitionBudget, _b.m_partitionBudget);
 }
 
 
@@ -246,6 +1313,9 @@ void frm::swap(Scene& _a, Scene& _b)
 bool Scene::Load(const char* _path, Scene& scene_)
 {
 	APT_LOG("Loading scene from '%s'", _path);
+	if (FileSystem::CompareExtension("bin", _path)) {
+		return ReadBin(scene_, _path);
+	}
 	Json json;
 	if (!Json::Read(json, _path)) {
 		return false;
@@ -263,6 +1333,9 @@ bool Scene::Load(const char* _path, Scene& scene_)
 bool Scene::Save(const char* _path, Scene& _scene)
 {
 	APT_LOG("Saving scene to '%s'", _path);
+	if (FileSystem::CompareExtension("bin", _path)) {
+		return WriteBin(_scene, _path);
+	}
 	Json json;
 	SerializerJson serializer(json, SerializerJson::Mode_Write);
 	if (!Serialize(serializer, _scene)) {
@@ -271,13 +1344,29 @@ bool Scene::Save(const char* _path, Scene& _scene)
 	return Json::Write(json, _path);
 }
 
+bool Scene::Convert(const char* _srcPath, const char* _dstPath)
+{
+	Scene scene;
+	if (!Load(_srcPath, scene)) {
+		return false;
+	}
+	return Save(_dstPath, scene);
+}
+
 Scene::Scene()
+	: Scene(128)
+{
+}
+
+Scene::Scene(uint32 _nodePoolBlockSize)
 	: m_nextNodeId(0)
-	, m_nodePool(128)
+	, m_nodePool(_nodePoolBlockSize)
 	, m_cameraPool(8)
 	, m_lightPool(16)
 	, m_drawCamera(nullptr)
 	, m_cullCamera(nullptr)
+	, m_updateMode(UpdateMode_Linear)
+	, m_partitionBudget(1.0f)
 #ifdef frm_Scene_ENABLE_EDIT
 	, m_showNodeGraph3d(false)
 	, m_editNode(nullptr)
@@ -289,13 +1378,20 @@ Scene::Scene()
 	, m_editLight(nullptr)
 #endif
 {
-	m_root = m_nodePool.alloc(Node(Node::Type_Root, m_nextNodeId++, Node::State_Any, "ROOT"));
+	m_hierarchy = APT_NEW(NodeHierarchy);
+	m_root = m_nodePool.alloc(Node(Node::Type_Root, m_nextNodeId++, Node::State_Any));
 	m_root->setSceneDataScene(this);
+	m_hierarchy->add(m_root);
+	m_hierarchy->setName(m_root, "ROOT");
+	m_hierarchy->indexNode(m_root);
+	m_hierarchy->m_root = m_root;
 	m_nodes[Node::Type_Root].push_back(m_root);
 }
 
 Scene::~Scene()
 {
+	releasePartitions();
+	m_hierarchy->clearChangedNodes(); // avoid the linear search in NodeHierarchy::remove()
 	while (!m_lights.empty()) {
 		m_lightPool.free(m_lights.back());
 		m_lights.pop_back();
@@ -310,13 +1406,33 @@ Scene::~Scene()
 			m_nodes[i].pop_back();
 		}
 	}
+	APT_DELETE(m_hierarchy);
 }
 
 void Scene::update(float _dt, uint8 _stateMask)
 {
 	PROFILER_MARKER_CPU("#Scene::update");
 	
-	Node::Update(m_root, _dt, _stateMask);
+	m_hierarchy->clearChangedNodes();
+	updatePartitions(m_partitionBudget);
+	if (m_hierarchy->getXFormBatching()) {
+		m_hierarchy->applyXFormBatches(_dt, m_updateMode == UpdateMode_Parallel);
+	}
+	switch (m_updateMode) {
+		case UpdateMode_Linear: {
+			NodeHierarchy::UpdateContext ctx;
+			m_hierarchy->sort();
+			m_hierarchy->updateRange(0, m_hierarchy->getReachableCount(), _dt, _stateMask, ctx);
+			break;
+		}
+		case UpdateMode_Parallel:
+			m_hierarchy->sort();
+			m_hierarchy->updateParallel(_dt, _stateMask);
+			break;
+		default:
+			Node::UpdateDirty(m_root, _dt, _stateMask, false);
+			break;
+	};
 }
 
 bool Scene::traverse(Node* _root_, uint8 _stateMask, OnVisit* _callback)
@@ -327,8 +1443,8 @@ bool Scene::traverse(Node* _root_, uint8 _stateMask, OnVisit* _callback)
 		if (!_callback(_root_)) {
 			return false;
 		}
-		for (int i = 0; i < _root_->getChildCount(); ++i) {
-			if (!traverse(_root_->getChild(i), _stateMask, _callback)) {
+		for (Node* child = _root_->getFirstChild(); child; child = child->getNextSibling()) {
+			if (!traverse(child, _stateMask, _callback)) {
 				return false;
 			}
 		}
@@ -341,6 +1457,12 @@ Node* Scene::createNode(Node::Type _type, Node* _parent)
 	PROFILER_MARKER_CPU("#Scene::createNode");
 
 	Node* ret = m_nodePool.alloc(Node(_type, m_nextNodeId++, Node::State_Active));
+	m_hierarchy->add(ret);
+	Node::NameStr name;
+	Node::AutoName(_type, name);
+	s_typeCounters[_type]++;
+	m_hierarchy->setName(ret, (const char*)name);
+	m_hierarchy->indexNode(ret);
 	if (_type == Node::Type_Camera || _type == Node::Type_Root) {
 		ret->setDynamic(true);
 	}
@@ -354,94 +1476,33 @@ void Scene::destroyNode(Node*& _node_)
 {
 	PROFILER_MARKER_CPU("#Scene::destroyNode");
 
-	APT_ASSERT(_node_ != m_root); // can't destroy the root
-	
-	Node::Type type = _node_->getType();
-	switch (type) {
-		case Node::Type_Camera:
-			if (_node_->m_sceneData) {
-				Camera* camera = _node_->getSceneDataCamera();
-				auto it = eastl::find(m_cameras.begin(), m_cameras.end(), camera);
-				if (it != m_cameras.end()) {
-					APT_ASSERT(camera->m_parent == _node_); // _node_ points to camera, but camera doesn't point to _node_
-					m_cameras.erase(it);
-				}
-				m_cameraPool.free(camera);
-			}
-			break;
-		case Node::Type_Light:
-			if (_node_->m_sceneData) {
-				Light* light = _node_->getSceneDataLight();
-				auto it = eastl::find(m_lights.begin(), m_lights.end(), light);
-				if (it != m_lights.end()) {
-					APT_ASSERT(light->m_parent == _node_); // _node_ points to light, but light doesn't point to _node_
-					m_lights.erase(it);
-				}
-				m_lightPool.free(light);
-			}
-			break;
-		default:
-			break;
-	};
-
-	auto it = eastl::find(m_nodes[type].begin(), m_nodes[type].end(), _node_);
-	if (it != m_nodes[type].end()) {
-		m_nodes[type].erase(it);
-		m_nodePool.free(_node_);
+	if (releaseNode(_node_)) {
 		_node_ = nullptr;
 	}
 }
 
 Node* Scene::findNode(Node::Id _id, Node::Type _typeHint)
 {
-	PROFILER_MARKER_CPU("#Scene::findNode");
-
-	Node* ret = nullptr;
-	if (_typeHint != Node::Type_Count) {
-		for (auto it = m_nodes[_typeHint].begin(); it != m_nodes[_typeHint].end(); ++it) {
-			if ((*it)->getId() == _id) {
-				ret = *it;
-				break;
-			}
-		}
-	}
-	for (int i = 0; ret == nullptr && i < Node::Type_Count; ++i) {
-		if (i == _typeHint) {
-			continue;
-		}
-		for (auto it = m_nodes[i].begin(); it != m_nodes[i].end(); ++it) {
-			if ((*it)->getId() == _id) {
-				ret = *it;
-				break;
-			}
-		}
-	}
-	return ret;
+	auto it = m_hierarchy->m_nodeIds.find(_id);
+	return it == m_hierarchy->m_nodeIds.end() ? nullptr : it->second;
 }
 
 Node* Scene::findNode(const char* _name, Node::Type _typeHint)
 {
-	PROFILER_MARKER_CPU("#Scene::findNode");
-
-	Node* ret = nullptr;
-	if (_typeHint != Node::Type_Count) {
-		for (auto it = m_nodes[_typeHint].begin(); it != m_nodes[_typeHint].end(); ++it) {
-			if (strcmp((*it)->getName(), _name) == 0) {
-				ret = *it;
-				break;
-			}
-		}
+	auto it = m_hierarchy->m_nodeNames.find(StringHash(_name).getHash());
+	if (it == m_hierarchy->m_nodeNames.end()) {
+		return nullptr;
 	}
-	for (int i = 0; ret == nullptr && i < Node::Type_Count; ++i) {
-		if (i == _typeHint) {
-			continue;
+	Node* ret = nullptr;
+	for (Node::Id id : it->second) {
+		Node* node = m_hierarchy->m_nodeIds[id];
+		if (strcmp(node->getName(), _name) != 0) {
+			continue; // hash collision
 		}
-		for (auto it = m_nodes[i].begin(); it != m_nodes[i].end(); ++it) {
-			if (strcmp((*it)->getName(), _name) == 0) {
-				ret = *it;
-				break;
-			}
+		if (_typeHint == Node::Type_Count || node->getType() == _typeHint) {
+			return node;
 		}
+		ret = ret ? ret : node;
 	}
 	return ret;
 }
@@ -508,6 +1569,79 @@ void Scene::destroyLight(Light*& _light_)
 	m_editLight = nullptr;
 }
 
+// PRIVATE
+
+bool Scene::releaseNode(Node* _node_)
+{
+	APT_ASSERT(_node_ != m_root); // can't destroy the root
+
+	Node::Type type = _node_->getType();
+	switch (type) {
+		case Node::Type_Camera:
+			if (_node_->m_sceneData) {
+				Camera* camera = _node_->getSceneDataCamera();
+				auto it = eastl::find(m_cameras.begin(), m_cameras.end(), camera);
+				if (it != m_cameras.end()) {
+					APT_ASSERT(camera->m_parent == _node_); // _node_ points to camera, but camera doesn't point to _node_
+					m_cameras.erase(it);
+				}
+			 // fall back to another camera, e.g. if the current camera was part of an unloaded partition
+				if (m_drawCamera == camera) {
+					m_drawCamera = m_cameras.empty() ? nullptr : m_cameras.front();
+				}
+				if (m_cullCamera == camera) {
+					m_cullCamera = m_drawCamera;
+				}
+				#ifdef frm_Scene_ENABLE_EDIT
+					m_editCamera       = m_editCamera       == camera ? nullptr : m_editCamera;
+					m_storedDrawCamera = m_storedDrawCamera == camera ? nullptr : m_storedDrawCamera;
+					m_storedCullCamera = m_storedCullCamera == camera ? nullptr : m_storedCullCamera;
+				#endif
+				m_cameraPool.free(camera);
+			}
+			break;
+		case Node::Type_Light:
+			if (_node_->m_sceneData) {
+				Light* light = _node_->getSceneDataLight();
+				auto it = eastl::find(m_lights.begin(), m_lights.end(), light);
+				if (it != m_lights.end()) {
+					APT_ASSERT(light->m_parent == _node_); // _node_ points to light, but light doesn't point to _node_
+					m_lights.erase(it);
+				}
+				#ifdef frm_Scene_ENABLE_EDIT
+					m_editLight = m_editLight == light ? nullptr : m_editLight;
+				#endif
+				m_lightPool.free(light);
+			}
+			break;
+		default:
+			break;
+	};
+	#ifdef frm_Scene_ENABLE_EDIT
+		if (m_editNode == _node_) {
+			m_editNode  = nullptr;
+			m_editXForm = nullptr;
+		}
+		m_storedNode = m_storedNode == _node_ ? nullptr : m_storedNode;
+	#endif
+
+ // search from the back, recently created nodes (e.g. partitions) are typically destroyed first
+	auto it = eastl::find(m_nodes[type].rbegin(), m_nodes[type].rend(), _node_);
+	if (it != m_nodes[type].rend()) {
+		m_nodes[type].erase(it.base() - 1);
+		m_nodePool.free(_node_);
+		return true;
+	}
+	return false;
+}
+
+void Scene::updateAutoNameCounters()
+{
+	for (int i = 0; i < Node::Type_Count; ++i) {
+		s_typeCounters[i] = APT_MAX((unsigned int)m_nodes[i].size(), s_typeCounters[i]);
+	}
+}
+
 bool frm::Serialize(Serializer& _serializer_, Scene& _scene_)
 {
 	bool ret = true;
@@ -547,9 +1681,7 @@ bool frm::Serialize(Serializer& _serializer_, Scene& _scene_)
 			}
 		}
 
-		for (int i = 0; i < Node::Type_Count; ++i) {
-			s_typeCounters[i] = APT_MAX((unsigned int)_scene_.m_nodes[i].size(), s_typeCounters[i]);
-		}
+		_scene_.updateAutoNameCounters();
 	}
 
 	APT_ASSERT(_scene_.m_drawCamera != nullptr);
@@ -564,8 +1696,16 @@ bool frm::Serialize(Serializer& _serializer_, Scene& _scene_, Node& _node_)
 {
 	bool ret = true;
 
-	ret &= Serialize(_serializer_, _node_.m_id,   "Id");
-	ret &= Serialize(_serializer_, _node_.m_name, "Name");
+	if (_serializer_.getMode() == Serializer::Mode_Read) {
+		_scene_.m_hierarchy->unindexNode(&_node_);
+	}
+	Node::NameStr name = _node_.getName();
+	ret &= Serialize(_serializer_, _node_.m_id, "Id");
+	ret &= Serialize(_serializer_, name,        "Name");
+	if (_serializer_.getMode() == Serializer::Mode_Read) {
+		_scene_.m_hierarchy->setName(&_node_, (const char*)name);
+		_scene_.m_hierarchy->indexNode(&_node_);
+	}
 	
 	bool active   = _node_.isActive();
 	bool dynamic  = _node_.isDynamic();
@@ -580,12 +1720,16 @@ bool frm::Serialize(Serializer& _serializer_, Scene& _scene_, Node& _node_)
 	}
 
 	ret &= Serialize(_serializer_, _node_.m_userData,    "UserData");
-	ret &= Serialize(_serializer_, _node_.m_localMatrix, "LocalMatrix");
+	mat4 localMatrix = _serializer_.getMode() == Serializer::Mode_Read ? mat4(identity) : _node_.getLocalMatrix();
+	ret &= Serialize(_serializer_, localMatrix, "LocalMatrix");
+	if (_serializer_.getMode() == Serializer::Mode_Read) {
+		_node_.setLocalMatrix(localMatrix);
+	}
 
-	String<64> typeStr = kNodeTypeStr[_node_.m_type];
+	String<64> typeStr = _node_.m_type < Node::Type_Count ? kNodeTypeStr[_node_.m_type] : "";
 	ret &= Serialize(_serializer_, typeStr, "Type");
 	if (_serializer_.getMode() == Serializer::Mode_Read) {
-		_node_.m_type = NodeTypeFromStr((const char*)typeStr);
+		_node_.m_type = (uint8)NodeTypeFromStr((const char*)typeStr);
 		if (_node_.m_type == Node::Type_Count) {
 			APT_LOG_ERR("Scene: Invalid node type '%s'", (const char*)typeStr);
 			return false;
@@ -627,12 +1771,12 @@ bool frm::Serialize(Serializer& _serializer_, Scene& _scene_, Node& _node_)
 		if (_serializer_.beginArray(childCount, "Children")) {
 			while (_serializer_.beginObject()) {
 				Node* child = _scene_.m_nodePool.alloc(Node());
+				_scene_.m_hierarchy->add(child);
 				if (!Serialize(_serializer_, _scene_, *child)) {
 					_scene_.m_nodePool.free(child);
 					return false;
 				}
-				child->m_parent = &_node_;
-				_node_.m_children.push_back(child);
+				_scene_.m_hierarchy->link(child->m_index, _node_.m_index);
 				_scene_.m_nodes[child->m_type].push_back(child);
 				_serializer_.endObject();
 			}
@@ -649,8 +1793,7 @@ bool frm::Serialize(Serializer& _serializer_, Scene& _scene_, Node& _node_)
 				XForm* xform = XForm::Create(StringHash((const char*)className));
 				if (xform) {
 					xform->serialize(_serializer_);
-					xform->setNode(&_node_);
-					_node_.m_xforms.push_back(xform);
+					_node_.addXForm(xform);
 				} else {
 					APT_LOG_ERR("Scene: Invalid xform '%s'", (const char*)className);
 				}
@@ -681,9 +1824,9 @@ bool frm::Serialize(Serializer& _serializer_, Scene& _scene_, Node& _node_)
 
 	 // \todo childCount is incorrect as '#' nodes aren't serialized
 		uint childCount = (uint)_node_.getChildCount();
-		if (!_node_.m_children.empty()) {
+		if (childCount > 0) {
 			_serializer_.beginArray(childCount, "Children");
-				for (auto& child : _node_.m_children) {
+				for (Node* child = _node_.getFirstChild(); child; child = child->getNextSibling()) {
 					if (child->getName()[0] == '#') {
 						continue;
 					}
@@ -695,9 +1838,10 @@ bool frm::Serialize(Serializer& _serializer_, Scene& _scene_, Node& _node_)
 		}
 
 		uint xformCount = (uint)_node_.getXFormCount();
-		if (!_node_.m_xforms.empty()) {
+		if (xformCount > 0) {
 			_serializer_.beginArray(xformCount, "XForms");
-				for (auto& xform : _node_.m_xforms) {
+				for (uint i = 0; i < xformCount; ++i) {
+					XForm* xform = _node_.getXForm((int)i);
 					_serializer_.beginObject();
 						String<64> className = xform->getClassRef()->getName();
 						Serialize(_serializer_, className, "Class");
@@ -832,9 +1976,9 @@ void Scene::editNodes()
 			ImGui::Separator();
 			ImGui::Spacing();
 			static Node::NameStr s_nameBuf;
-			s_nameBuf.set((const char*)m_editNode->m_name);
+			s_nameBuf.set(m_editNode->getName());
 			if (ImGui::InputText("Name", (char*)s_nameBuf, s_nameBuf.getCapacity(), ImGuiInputTextFlags_AutoSelectAll | ImGuiInputTextFlags_CharsNoBlank | ImGuiInputTextFlags_EnterReturnsTrue)) {
-				m_editNode->m_name.set((const char*)s_nameBuf);
+				m_editNode->setName((const char*)s_nameBuf);
 			}
 
 			bool active = m_editNode->isActive();
@@ -862,11 +2006,11 @@ void Scene::editNodes()
 
 			if (newParent != m_editNode->getParent()) {
 			 // maintain child world space position when changing parent
-				mat4 parentWorld = m_editNode->m_parent ? m_editNode->m_parent->m_worldMatrix : identity;
-				mat4 childWorld = parentWorld * m_editNode->m_localMatrix;
+				mat4 parentWorld = m_editNode->getParent() ? m_editNode->getParent()->getWorldMatrix() : identity;
+				mat4 childWorld = parentWorld * m_editNode->getLocalMatrix();
 				m_editNode->setParent(newParent);
-				parentWorld = m_editNode->m_parent ? m_editNode->m_parent->m_worldMatrix : identity;
-				m_editNode->m_localMatrix = inverse(parentWorld) * childWorld;
+				parentWorld = m_editNode->getParent() ? m_editNode->getParent()->getWorldMatrix() : identity;
+				m_editNode->setLocalMatrix(inverse(parentWorld) * childWorld);
 			}
 			ImGui::SameLine();
 			if (m_editNode->getParent()) {
@@ -878,11 +2022,10 @@ void Scene::editNodes()
 				ImGui::Text("--");
 			}
 
-			if (!m_editNode->m_children.empty()) {
+			if (m_editNode->getFirstChild()) {
 				ImGui::Spacing();
 				if (ImGui::TreeNode("Children")) {
-					for (auto it = m_editNode->m_children.begin(); it != m_editNode->m_children.end(); ++it) {
-						Node* child = *it;
+					for (Node* child = m_editNode->getFirstChild(); child; child = child->getNextSibling()) {
 						ImGui::Text("%s %s", kNodeTypeIconStr[child->getType()], child->getName());
 						if (ImGui::IsItemClicked()) {
 							newEditNode = child;
@@ -896,16 +2039,17 @@ void Scene::editNodes()
 
 			if (ImGui::TreeNode("Local Matrix")) {
 			 // hierarchical update - modify the world space node and transform back into parent space
-				mat4 parentWorld = m_editNode->m_parent ? m_editNode->m_parent->m_worldMatrix : identity;
-				mat4 childWorld = parentWorld * m_editNode->m_localMatrix;
+				mat4 parentWorld = m_editNode->getParent() ? m_editNode->getParent()->getWorldMatrix() : identity;
+				mat4 childWorld = parentWorld * m_editNode->getLocalMatrix();
 				if (Im3d::Gizmo("GizmoNodeLocal", (float*)&childWorld)) {
-					m_editNode->m_localMatrix = inverse(parentWorld) * childWorld;
+					m_editNode->setLocalMatrix(inverse(parentWorld) * childWorld);
 					Node::Update(m_editNode, 0.0f, Node::State_Any); // force node update
 				}
 
-				vec3 position = GetTranslation(m_editNode->m_localMatrix);
-				vec3 rotation = ToEulerXYZ(GetRotation(m_editNode->m_localMatrix));
-				vec3 scale    = GetScale(m_editNode->m_localMatrix);
+				mat4 localMatrix = m_editNode->getLocalMatrix();
+				vec3 position = GetTranslation(localMatrix);
+				vec3 rotation = ToEulerXYZ(GetRotation(localMatrix));
+				vec3 scale    = GetScale(localMatrix);
 				ImGui::Text("Position: %.3f, %.3f, %.3f", position.x, position.y, position.z);
 				ImGui::Text("Rotation: %.3f, %.3f, %.3f", Degrees(rotation.x), Degrees(position.y), Degrees(position.z));
 				ImGui::Text("Scale:    %.3f, %.3f, %.3f", scale.x, scale.y, scale.z);
@@ -937,21 +2081,21 @@ void Scene::editNodes()
 					}
 				}
 
-				if (!m_editNode->m_xforms.empty()) {
+				if (m_editNode->getXFormCount() > 0) {
 				 // build list for xform stack
 					const char* xformList[64];
-					APT_ASSERT(m_editNode->m_xforms.size() <= 64);
+					APT_ASSERT(m_editNode->getXFormCount() <= 64);
 					int selectedXForm = 0;
-					for (int i = 0; i < (int)m_editNode->m_xforms.size(); ++i) {
-						XForm* xform = m_editNode->m_xforms[i];
+					for (int i = 0; i < m_editNode->getXFormCount(); ++i) {
+						XForm* xform = m_editNode->getXForm(i);
 						if (xform == m_editXForm) {
 							selectedXForm = i;
 						}
 						xformList[i] = xform->getName();
 					}
 					ImGui::Spacing();
-					if (ImGui::ListBox("##XForms", &selectedXForm, xformList, (int)m_editNode->m_xforms.size())) {
-						newEditXForm = m_editNode->m_xforms[selectedXForm];
+					if (ImGui::ListBox("##XForms", &selectedXForm, xformList, m_editNode->getXFormCount())) {
+						newEditXForm = m_editNode->getXForm(selectedXForm);
 					}
 
 					if (m_editXForm) {
@@ -1090,9 +2234,9 @@ void Scene::editCameras()
 			ImGui::Spacing();
 			
 			static Node::NameStr s_nameBuf;
-			s_nameBuf.set((const char*)m_editCamera->m_parent->m_name);
+			s_nameBuf.set(m_editCamera->m_parent->getName());
 			if (ImGui::InputText("Name", (char*)s_nameBuf, s_nameBuf.getCapacity(), ImGuiInputTextFlags_AutoSelectAll | ImGuiInputTextFlags_CharsNoBlank | ImGuiInputTextFlags_EnterReturnsTrue)) {
-				m_editCamera->m_parent->m_name.set((const char*)s_nameBuf);
+				m_editCamera->m_parent->setName((const char*)s_nameBuf);
 			}
 
 			m_editCamera->edit();
@@ -1160,9 +2304,9 @@ void Scene::editLights()
 			ImGui::Spacing();
 			
 			static Node::NameStr s_nameBuf;
-			s_nameBuf.set((const char*)m_editLight->m_parent->m_name);
+			s_nameBuf.set(m_editLight->m_parent->getName());
 			if (ImGui::InputText("Name", (char*)s_nameBuf, s_nameBuf.getCapacity(), ImGuiInputTextFlags_AutoSelectAll | ImGuiInputTextFlags_CharsNoBlank | ImGuiInputTextFlags_EnterReturnsTrue)) {
-				m_editLight->m_parent->m_name.set((const char*)s_nameBuf);
+				m_editLight->m_parent->setName((const char*)s_nameBuf);
 			}
 
 			m_editLight->edit();
@@ -1344,12 +2488,12 @@ void Scene::drawHierarchy(Node* _node)
 		}
 	}
 	ImGui::PushStyleColor(ImGuiCol_Text, col);
-	if (_node->getChildCount() == 0) {
+	if (!_node->getFirstChild()) {
 		ImGui::Text((const char*)tmp);
 	} else {
 		if (ImGui::TreeNode((const char*)tmp)) {
-			for (int i = 0; i < _node->getChildCount(); ++i) {
-				drawHierarchy(_node->getChild(i));
+			for (Node* child = _node->getFirstChild(); child; child = child->getNextSibling()) {
+				drawHierarchy(child);
 			}
 			ImGui::TreePop();
 		}
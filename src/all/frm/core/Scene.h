@@ -5,22 +5,261 @@
 
 #include <apt/Pool.h>
 #include <apt/String.h>
+#include <apt/StringHash.h>
 
+#include <EASTL/hash_map.h>
 #include <EASTL/vector.h>
 
 #define frm_Scene_ENABLE_EDIT
 
 namespace frm {
 
+class Node;
+class ScenePartitionLoader;
+class XForm;
+
+////////////////////////////////////////////////////////////////////////////////
+// NodeHierarchy
+// Flattened storage for the spatial state of all nodes in a Scene: contiguous
+// arrays of the local TRS, world matrix (3x4 affine) and parent/first child/
+// next sibling indices per node. Nodes are handles into this storage (see
+// Node::m_index), node names are stored in a shared string table (fixed size
+// blocks, names don't move) and xform lists as ranges of a shared xform array.
+// sort() orders the arrays such that each subtree is a contiguous range
+// starting at its root (pre-order), hence parents precede their children and
+// the world matrices can be updated in a single linear pass. Structural
+// changes (adding/removing/reparenting nodes) invalidate the order, it is
+// restored by the next call to sort() (Scene::update() does this implicitly).
+// Nodes which aren't reachable from the root are sorted after all reachable
+// nodes.
+// Change tracking: modifying a node's local transform, parent, xforms or state
+// marks it dirty and flags its ancestors as having a dirty descendant. The
+// update then only visits dirty subtrees; a dirty node (or any node whose
+// parent changed) has its world matrix recomputed and is appended to the
+// changed list (getChangedNodes()). Nodes with xforms and camera nodes are
+// always dirty, as their output may change every frame.
+// Parallel update: subtrees are contiguous, hence independent subtrees (e.g.
+// the children of the root) can be updated as separate tasks. Large subtrees
+// are split by updating their root serially and issuing their children as
+// tasks. Subtrees rooted at nodes with xforms which aren't thread safe (see
+// XForm::isThreadSafe()) are updated on the calling thread once the tasks
+// which precede them in pre-order complete, hence they see the same state as
+// in a linear update. Camera updates are deferred to the calling thread.
+// XForm batching: instances of batched xform types (see XForm::Batch) are
+// grouped per type and advanced via one ApplyAll() call per type before the
+// hierarchy pass.
+// Lookup: nodes are indexed by id and by name hash (see Scene::findNode()).
+// Names aren't unique, each name hash maps to the ids of all nodes with that
+// name hash in creation order.
+// Links: children form a list via the sibling indices (the previous sibling of
+// the first child is the last child, hence appending is O(1)). The links are
+// always valid, sort() only changes the order of the arrays.
+// Staging: nodes added via addUnreachable() don't invalidate the order, nor
+// does linking them to an unreachable parent. Large subtrees can therefore be
+// built incrementally and attached in one step (see Scene::loadPartition()),
+// attach()/detach() move a subtree in/out of the reachable range without a
+// full sort.
+// \note Local transforms are stored as TRS, setting a local matrix with shear
+//   or negative scale isn't supported.
+////////////////////////////////////////////////////////////////////////////////
+class NodeHierarchy: private apt::non_copyable<NodeHierarchy>
+{
+	friend class Node;
+	friend class Scene;
+	friend bool Serialize(apt::Serializer& _serializer_, Scene& _scene_, Node& _node_);
+public:
+	static const uint32 kInvalidIndex = ~0u;
+
+	// Restore the order if the structure changed since the last call.
+	void        sort();
+	bool        isSorted() const                       { return m_sorted; }
+
+	uint32      getNodeCount() const                   { return (uint32)m_nodes.size(); }
+	uint32      getReachableCount() const              { APT_ASSERT(m_sorted); return m_reachableCount; }
+	// Return nullptr if _i is kInvalidIndex.
+	Node*       getNode(uint32 _i) const               { return _i == kInvalidIndex ? nullptr : m_nodes[_i]; }
+	uint32      getParentIndex(uint32 _i) const        { return m_parents[_i]; }
+	uint32      getFirstChildIndex(uint32 _i) const    { return m_firstChildren[_i]; }
+	uint32      getNextSiblingIndex(uint32 _i) const   { return m_nextSiblings[_i]; }
+	// Valid only if isSorted().
+	uint32      getSubtreeSize(uint32 _i) const        { APT_ASSERT(m_sorted); return m_subtreeSizes[_i]; }
+
+	mat4        getLocalMatrix(uint32 _i) const;
+	void        setLocalMatrix(uint32 _i, const mat4& _mat);
+	mat4        getWorldMatrix(uint32 _i) const        { return m_worldMatrices[_i].asMat4(); }
+
+	// Bytes allocated for the node arrays, string table, xform lists and indices.
+	size_t      getMemoryUsage() const;
+
+	// Nodes whose world matrix changed during the last update, valid until the next update. Destroyed nodes are
+	// removed from the list.
+	const eastl::vector<Node*>& getChangedNodes() const { return m_changedNodes; }
+
+	// If disabled, all xforms are applied individually via XForm::apply() (e.g. for comparison).
+	bool        getXFormBatching() const               { return m_xformBatching; }
+	void        setXFormBatching(bool _enable)         { m_xformBatching = _enable; }
+	// Number of instances of XForm::GetBatch(_batchIndex).
+	uint32      getXFormBatchSize(int _batchIndex) const { return _batchIndex < (int)m_xformBatches.size() ? (uint32)m_xformBatches[_batchIndex].size() : 0; }
+
+private:
+	enum Flag
+	{
+		Flag_Dirty      = 1 << 0, // Local state changed, world matrix must be recomputed.
+		Flag_ChildDirty = 1 << 1, // Some descendant is dirty.
+		Flag_Changed    = 1 << 2, // In m_changedNodes.
+	};
+
+	// 3x4 affine matrix, the columns of a mat4 without the last row (always 0, 0, 0, 1 for a world matrix).
+	struct Affine
+	{
+		vec3 m_col[4];
+
+		Affine() {}
+		explicit Affine(const mat4& _mat);
+		mat4   asMat4() const;
+		Affine operator*(const Affine& _rhs) const;
+	};
+
+	eastl::vector<Node*>   m_nodes;
+	eastl::vector<uint32>  m_parents;
+	eastl::vector<uint32>  m_firstChildren;
+	eastl::vector<uint32>  m_nextSiblings;
+	eastl::vector<uint32>  m_prevSiblings;       // the first child's entry is the last child
+	eastl::vector<uint32>  m_subtreeSizes;       // including the subtree root
+	eastl::vector<uint8>   m_flags;
+	eastl::vector<vec3>    m_localPositions;
+	eastl::vector<quat>    m_localOrientations;
+	eastl::vector<vec3>    m_localScales;
+	eastl::vector<Affine>  m_worldMatrices;
+	Node*                  m_root;
+	uint32                 m_reachableCount;
+	bool                   m_sorted;
+	eastl::vector<Node*>   m_changedNodes;
+
+	struct UpdateContext
+	{
+		uint32                m_begin         = 0;     // First node of the range being updated.
+		bool                  m_parallel      = false; // Defer camera updates.
+		bool                  m_flagAncestors = false; // Flag the ancestors of m_begin after the parallel update.
+		eastl::vector<Node*>  m_changedNodes;   // If m_parallel, else append to NodeHierarchy::m_changedNodes.
+		eastl::vector<Node*>  m_cameraNodes;    // If m_parallel, else update inline.
+	};
+	static const uint32 kMinParallelNodes = 4096; // Smaller hierarchies are updated serially.
+	static const uint32 kMinTaskSize      = 256;
+	static const uint32 kTasksPerThread   = 8;
+	eastl::vector<uint32>        m_tasks;        // Subtree roots, see updateParallel().
+	eastl::vector<UpdateContext> m_taskContexts;
+	eastl::vector<uint32>        m_serialNodes;  // Nodes with xforms which aren't thread safe, sorted.
+
+	static const uint32 kXFormBatchGrainSize = 1024;
+	eastl::vector<eastl::vector<XForm*> > m_xformBatches; // Indexed by XForm::Batch::m_index.
+	bool                                  m_xformBatching;
+
+	typedef eastl::hash_map<uint64, Node*> NodeIdMap;                                          // Node::Id -> node.
+	typedef eastl::hash_map<apt::StringHash::HashType, eastl::vector<uint64> > NodeNameMap;    // Name hash -> Node::Ids.
+	NodeIdMap                             m_nodeIds;
+	NodeNameMap                           m_nodeNames;
+
+	static const uint32 kMinCompactSize = 4096;    // Don't compact m_xforms if the unused size is smaller.
+	static const uint32 kNameBlockSize  = 16 * 1024; // Longer names are truncated.
+	static const uint32 kNameSlotSize   = 16;        // Size of the smallest name slot, slot sizes are powers of 2.
+	static const uint32 kNameClassCount = 11;        // kNameSlotSize << (kNameClassCount - 1) == kNameBlockSize.
+	eastl::vector<char*>                  m_nameBlocks;                // Null-terminated node names, see Node::m_name.
+	uint32                                m_nameEnd;                   // Offset of the first unallocated slot.
+	uint32                                m_nameFree[kNameClassCount]; // Free slots per size, linked via the first 4 bytes.
+	eastl::vector<XForm*>                 m_xforms;      // Per-node xform lists, see Node::m_xformBegin.
+	uint32                                m_xformsUnused;
+
+	NodeHierarchy();
+	~NodeHierarchy();
+
+	// Reserve storage for at least _count nodes and _xformCount more xforms (e.g. before bulk loading). Storage grows
+	// geometrically, reserving ahead of time avoids the reallocation during a partition load.
+	void reserve(uint32 _count, uint32 _xformCount = 0);
+	// Append _node with an identity transform, set _node->m_index.
+	void add(Node* _node);
+	// As add() but keep the order, _node must remain unreachable until linked to a reachable parent. If sorted, the
+	// parent index of _node is kInvalidIndex until the next call to sort().
+	void addUnreachable(Node* _node);
+	// Swap _node with the last node and pop, _node must have no parent or children. Removing an unreachable node keeps
+	// the order.
+	void remove(Node* _node);
+	// Append _i to the children of _parent/remove _i from the children of its parent, don't change the order.
+	void link(uint32 _i, uint32 _parent);
+	void unlink(uint32 _i);
+	// Invalidate the order unless _parent is unreachable, call when the children of _parent change.
+	void invalidate(const Node* _parent);
+	// Link _root (staged via addUnreachable(), _size nodes in pre-order) as the last child of _parent, move the
+	// subtree into place such that the order remains valid. Invalidate the order if the subtree isn't contiguous.
+	void attach(Node* _root, Node* _parent, uint32 _size);
+	// Unlink _root from its parent, move its subtree to the start of the unreachable range.
+	void detach(Node* _root);
+	// Rotate the range [_first, _last) such that _middle becomes _first, update the node indices and links.
+	void rotate(uint32 _first, uint32 _middle, uint32 _last);
+	// Return the next node after _i in a pre-order traversal of the subtree at _root, or kInvalidIndex.
+	uint32 next(uint32 _i, uint32 _root) const;
+
+	// Local TRS of _i as an affine matrix.
+	Affine getLocalAffine(uint32 _i) const;
+
+	// Set Flag_Dirty on _node, Flag_ChildDirty on its ancestors.
+	void setDirty(Node* _node);
+	void flagAncestors(Node* _node);
+	// As flagAncestors() but via m_parents (requires isSorted()), see UpdateContext::m_flagAncestors.
+	void flagAncestors(uint32 _i, UpdateContext& _ctx_);
+	// Clear Flag_Changed and empty m_changedNodes, called at the start of each update and before destroying all nodes.
+	void clearChangedNodes();
+	// Called after the world matrix of _i was recomputed; append to m_changedNodes and clear Flag_Dirty unless the node
+	// is always dirty.
+	void setChanged(uint32 _i);
+
+	// Update node _i as part of a linear pass (requires isSorted()), return the index of the next node to visit.
+	uint32 updateNode(uint32 _i, float _dt, uint8 _stateMask, UpdateContext& _ctx_);
+	// Linear update of [_begin, _end) which must contain complete subtrees, the ancestors of which are up to date.
+	void   updateRange(uint32 _begin, uint32 _end, float _dt, uint8 _stateMask, UpdateContext& _ctx_);
+	// Split the hierarchy into subtree tasks and update via ParallelFor().
+	void   updateParallel(float _dt, uint8 _stateMask);
+
+	// Add/remove _node to/from the id and name indices (nodes with an invalid id aren't indexed).
+	void   indexNode(Node* _node);
+	void   unindexNode(Node* _node);
+
+	// Set the name of _node (don't update the name index).
+	void   setName(Node* _node, const char* _name);
+	// Name at offset _name (see Node::m_name). Names are allocated in slots of fixed size blocks and are never moved,
+	// released slots are reused by names of the same size class.
+	const char* getName(uint32 _name) const        { return m_nameBlocks[_name / kNameBlockSize] + _name % kNameBlockSize; }
+	uint32 allocName(uint32 _size);
+	void   freeName(uint32 _name);
+
+	// Append _xforms to the xform list of _node, move the list to the end of m_xforms if required.
+	void   appendXForms(Node* _node, XForm* const* _xforms, uint32 _count);
+	// Remove the _ith xform of _node (doesn't unregister or delete the xform).
+	void   eraseXForm(Node* _node, uint32 _i);
+	// Move the xform lists of all nodes to a new array in hierarchy order, drop unused slots.
+	void   compactXForms();
+
+	// Register/unregister _xform with the instance list for its type (if batched).
+	void   addXForm(XForm* _xform);
+	void   removeXForm(XForm* _xform);
+	// Call ApplyAll() for each batched type, split via ParallelFor() if _parallel.
+	void   applyXFormBatches(float _dt, bool _parallel);
+	// Apply the xforms of _node, batched xforms via XForm::applyBatched().
+	void   applyXForms(Node* _node, float _dt, bool _parallel);
+
+}; // class NodeHierarchy
+
 ////////////////////////////////////////////////////////////////////////////////
 // Node
 // Basic scene unit; comprises a local/world matrix, metadata and hierarchical
-// information.
+// information. The spatial/hierarchical state, name and xform list are stored
+// in the NodeHierarchy, a node only holds metadata and indices.
 // \note Don't create loops in the hiearchy.
 ////////////////////////////////////////////////////////////////////////////////
 class Node
 {
 	friend class apt::Pool<Node>;
+	friend class NodeHierarchy;
 	friend class Scene;
 public:
 	typedef apt::String<24> NameStr;
@@ -47,19 +286,21 @@ public:
 	};
 
 	Id           getId() const                       { return m_id; }
-	const char*  getName() const                     { return (const char*)m_name; }
-	void         setName(const char* _name)          { m_name.set(_name); }
+	// The name is stored in the NodeHierarchy string table, the returned pointer is valid until the node is renamed
+	// or destroyed.
+	const char*  getName() const                     { return m_hierarchy ? m_hierarchy->getName(m_name) : ""; }
+	void         setName(const char* _name);
 	void         setNamef(const char* _fmt, ...);
 
 	Type         getType() const                     { return (Type)m_type; }
 	void         setType(Type _type)                 { m_type = _type; }
 	
 	uint8        getStateMask() const                { return m_state; }
-	void         setStateMask(uint8 _mask)           { m_state = _mask; }
+	void         setStateMask(uint8 _mask)           { m_state = _mask; setDirty(); }
 	bool         isActive() const                    { return (m_state & State_Active) != 0; }
-	void         setActive(bool _state)              { m_state = _state ? (m_state | State_Active) : (m_state & ~State_Active); }
+	void         setActive(bool _state)              { m_state = _state ? (m_state | State_Active) : (m_state & ~State_Active); setDirty(); }
 	bool         isDynamic() const                   { return (m_state & State_Dynamic) != 0; }
-	void         setDynamic(bool _state)             { m_state = _state ? (m_state | State_Dynamic) : (m_state & ~State_Dynamic); }
+	void         setDynamic(bool _state)             { m_state = _state ? (m_state | State_Dynamic) : (m_state & ~State_Dynamic); setDirty(); }
 	bool         isStatic() const                    { return !isDynamic(); }
 	void         setStatic(bool _state)              { setDynamic(!_state); }
 	bool         isSelected() const                  { return (m_state & State_Selected) != 0; }
@@ -73,27 +314,43 @@ public:
 	Light*       getSceneDataLight() const           { APT_ASSERT(m_type == Type_Light); return (Light*)m_sceneData;   }
 	Scene*       getSceneDataScene() const           { APT_ASSERT(m_type == Type_Root); return (Scene*)m_sceneData;    }
 
-	const mat4&  getLocalMatrix() const              { return m_localMatrix; }
-	void         setLocalMatrix(const mat4& _mat)    { m_localMatrix = _mat; }
-	vec3         getLocalPosition() const            { return m_localMatrix[3].xyz(); }
-	void         setLocalPosition(const vec3& _p)    { m_localMatrix[3] = vec4(_p, 1.0f); }
+	// The local transform is stored as TRS (see NodeHierarchy). Setting the local transform marks the node dirty.
+	mat4         getLocalMatrix() const              { return m_hierarchy->getLocalMatrix(m_index); }
+	void         setLocalMatrix(const mat4& _mat)    { m_hierarchy->setLocalMatrix(m_index, _mat); setDirty(); }
+	vec3         getLocalPosition() const            { return m_hierarchy->m_localPositions[m_index]; }
+	void         setLocalPosition(const vec3& _p)    { m_hierarchy->m_localPositions[m_index] = _p; setDirty(); }
+	quat         getLocalOrientation() const         { return m_hierarchy->m_localOrientations[m_index]; }
+	void         setLocalOrientation(const quat& _q) { m_hierarchy->m_localOrientations[m_index] = _q; setDirty(); }
+	vec3         getLocalScale() const               { return m_hierarchy->m_localScales[m_index]; }
+	void         setLocalScale(const vec3& _s)       { m_hierarchy->m_localScales[m_index] = _s; setDirty(); }
 	
-	const mat4&  getWorldMatrix() const              { return m_worldMatrix; }
-	void         setWorldMatrix(const mat4& _mat)    { m_worldMatrix = _mat; }
-	vec3         getWorldPosition() const            { return m_worldMatrix[3].xyz(); }
-	void         setWorldPosition(const vec3& _p)    { m_worldMatrix[3] = vec4(_p, 1.0f); }
+	// The world matrix is recomputed by Scene::update(), setting it directly is only meaningful from within
+	// XForm::apply(). World matrices are stored as 3x4 affine, the last row is ignored by setWorldMatrix().
+	mat4         getWorldMatrix() const              { return m_hierarchy->getWorldMatrix(m_index); }
+	void         setWorldMatrix(const mat4& _mat)    { m_hierarchy->m_worldMatrices[m_index] = NodeHierarchy::Affine(_mat); }
+	vec3         getWorldPosition() const            { return m_hierarchy->m_worldMatrices[m_index].m_col[3]; }
+	void         setWorldPosition(const vec3& _p)    { m_hierarchy->m_worldMatrices[m_index].m_col[3] = _p; }
+
+	// Index into the NodeHierarchy (changes when the hierarchy is sorted).
+	uint32       getHierarchyIndex() const           { return m_index; }
+	// Force the world matrix to be recomputed during the next update (see NodeHierarchy).
+	void         setDirty()                          { if (m_hierarchy) m_hierarchy->setDirty(this); }
 	
 	
 	void         addXForm(XForm* _xform);
 	void         removeXForm(XForm* _xform);
-	int          getXFormCount() const               { return (int)m_xforms.size(); }
-	XForm*       getXForm(int _i)                    { return m_xforms[_i]; }
+	int          getXFormCount() const               { return (int)m_xformCount; }
+	XForm*       getXForm(int _i)                    { APT_ASSERT(_i < (int)m_xformCount); return m_hierarchy->m_xforms[m_xformBegin + _i]; }
 	void         moveXForm(const XForm* _xform, int _dir);
 
-	Node*        getParent()                         { return m_parent; }
+	Node*        getParent()                         { return m_hierarchy ? m_hierarchy->getNode(m_hierarchy->m_parents[m_index]) : nullptr; }
 	void         setParent(Node* _node);
-	int          getChildCount() const               { return (int)m_children.size(); }
-	Node*        getChild(int _i)                    { return m_children[_i]; }
+	// Iterate the children via getFirstChild()/getNextSibling(). getChildCount() walks the list, getChild() is O(_i)
+	// hence a getChild() loop over all children is O(n^2).
+	Node*        getFirstChild()                     { return m_hierarchy ? m_hierarchy->getNode(m_hierarchy->m_firstChildren[m_index]) : nullptr; }
+	Node*        getNextSibling()                    { return m_hierarchy ? m_hierarchy->getNode(m_hierarchy->m_nextSiblings[m_index]) : nullptr; }
+	int          getChildCount() const;
+	Node*        getChild(int _i);
 	void         addChild(Node* _node);
 	void         removeChild(Node* _node);
 
@@ -102,31 +359,33 @@ public:
 private:
  // meta
 	Id                    m_id;          // Unique id.
-	NameStr               m_name;        // User-friendly name (not necessarily unique).
-	Type                  m_type;
-	uint8                 m_state;       // State mask.
 	uint64                m_userData;    // Application-defined node data.
 	uint64                m_sceneData;   // Scene-defined data.
+	uint32                m_name;        // User-friendly name (not necessarily unique), offset into NodeHierarchy::m_nameBlocks.
+	uint8                 m_type;        // Type.
+	uint8                 m_state;       // State mask.
 
  // spatial
-	mat4                  m_localMatrix; // Initial (local) transformation.
-	mat4                  m_worldMatrix; // Final transformation with any XForms applied.
-	eastl::vector<XForm*> m_xforms;      // XForm list (applied in order).
-
- // hierarchy
-	Node*                 m_parent;
-	eastl::vector<Node*>  m_children;
+	uint16                m_xformCount;
+	uint32                m_xformBegin;  // XForm list (applied in order), range of NodeHierarchy::m_xforms.
+	uint32                m_index;
+	NodeHierarchy*        m_hierarchy;   // Local/world transforms and links are stored in the hierarchy at m_index.
 
 	// Auto name based on type, e.g. Camera_001, Object_123
 	static void AutoName(Node::Type _type, Node::NameStr& out_);
 	
 	// Recursively update _node_, apply xforms.
 	static void Update(Node* _node_, float _dt, uint8 _stateMask);
+	// As Update() but only visit dirty subtrees (see NodeHierarchy).
+	static void UpdateDirty(Node* _node_, float _dt, uint8 _stateMask, bool _parentChanged);
+	// Update _node_ only, the parent world matrix must be up to date.
+	static void UpdateSingle(Node* _node_, float _dt);
 
 	Node();
-	Node(Type _type, Id _id, uint8 _state, const char* _name = nullptr);
+	// The name is set once the node is added to a NodeHierarchy.
+	Node(Type _type, Id _id, uint8 _state);
 
-	// Maintains traversability by reparenting child nodes to m_parent.	
+	// Maintains traversability by reparenting child nodes to the parent.
 	~Node();
 
 	// Move _ith XForm within the stack; _dir is an offset from the current index. Return new index.
@@ -148,24 +407,71 @@ class Scene
 public:
 	typedef bool (OnVisit)(Node* _node_);
 
+	enum UpdateMode
+	{
+		UpdateMode_Recursive, // Depth-first recursion from the root via the child/sibling links.
+		UpdateMode_Linear,    // Linear pass over the NodeHierarchy.
+		UpdateMode_Parallel,  // Subtrees of the NodeHierarchy updated in parallel (see ParallelFor()).
+
+		UpdateMode_Count
+	};
+
 	static Scene*  GetCurrent()                      { return s_currentScene; }
 	static void    SetCurrent(Scene* _scene)         { s_currentScene = _scene; }
 
 	static Camera* GetDrawCamera()                   { return s_currentScene->getDrawCamera(); }
 	static Camera* GetCullCamera()                   { return s_currentScene->getCullCamera(); }
 
-	// Load scene from path, swap with scene_ if successful & return true.
+	// Load scene from path, swap with scene_ if successful & return true. Paths with the extension "bin" are read as
+	// binary scenes (see Scene_bin.cpp), else as json.
 	static bool Load(const char* _path, Scene& scene_);
 
-	// Save scene to path, return true if successful.
+	// Save scene to path, return true if successful. The format is selected by the extension as for Load().
 	static bool Save(const char* _path, Scene& _scene);
 
+	// Load _srcPath and save to _dstPath, e.g. to convert a json scene to binary or vice versa.
+	static bool Convert(const char* _srcPath, const char* _dstPath);
+
+	// Partitions are sub-scenes which are streamed in/out at runtime (see Scene_partition.cpp). A partition file is a
+	// binary scene whose root becomes a new dynamic node '#Partition<id>' under the parent node; all nodes get new ids.
+	// Parsing and xform creation happen on a background thread, the nodes are then created during update() within
+	// the partition budget (ms per frame) and attached in a single step, such that the update time doesn't spike.
+	// Unloading detaches the partition root immediately and destroys the nodes within the same budget.
+	// \note Partition nodes aren't saved (their names begin with '#'). Nodes added under partition nodes are
+	//   orphaned when the partition is unloaded. If the parent is destroyed before the partition is attached, the
+	//   partition is unloaded.
+	enum PartitionState
+	{
+		PartitionState_Invalid,   // Unknown id or unloaded.
+		PartitionState_Loading,   // Queued or being parsed.
+		PartitionState_Attaching, // Creating nodes.
+		PartitionState_Attached,
+		PartitionState_Unloading, // Destroying nodes.
+		PartitionState_Error,     // Failed to load, call unloadPartition() to release the id.
+
+		PartitionState_Count
+	};
+	typedef uint32 PartitionId;
+	static const PartitionId kInvalidPartitionId = ~0u;
+
 	Scene();
 	~Scene();
 
 	// Update all nodes matching _stateMask. If a node does not match _stateMask 
-	// then none of its children are updated.
+	// then none of its children are updated. Only dirty subtrees are visited,
+	// see getChangedNodes().
 	void update(float _dt, uint8 _stateMask = Node::State_Active | Node::State_Dynamic);
+	// Advance partitions which are attaching or unloading, spend at most ~_budgetMs; called by update() with the
+	// partition budget. Return true if any partition is loading, attaching or unloading.
+	bool updatePartitions(float _budgetMs);
+	UpdateMode getUpdateMode() const                { return m_updateMode; }
+	void       setUpdateMode(UpdateMode _mode)      { m_updateMode = _mode; }
+
+	NodeHierarchy& getHierarchy()                   { return *m_hierarchy; }
+	// See NodeHierarchy::setXFormBatching().
+	void       setXFormBatching(bool _enable)       { m_hierarchy->setXFormBatching(_enable); }
+	// Nodes whose world matrix changed during the last update (see NodeHierarchy).
+	const eastl::vector<Node*>& getChangedNodes() const { return m_hierarchy->getChangedNodes(); }
 
 	// Pre-order traversal of the node graph starting at _root_, calling _callback 
 	// at every node which matches _stateMask. The callback should return false if 
@@ -174,6 +480,8 @@ public:
 
 	Node*   createNode(Node::Type _type, Node* _parent = nullptr);
 	void    destroyNode(Node*& _node_);
+	// Lookup via the NodeHierarchy indices. If several nodes share _name, a node of _typeHint is preferred, else the
+	// first node created with _name is returned. _typeHint is ignored for id lookups (ids are unique).
 	Node*   findNode(Node::Id _id, Node::Type _typeHint = Node::Type_Count);
 	Node*   findNode(const char* _name, Node::Type _typeHint = Node::Type_Count);
 	int     getNodeCount(Node::Type _type) const    { return (int)m_nodes[_type].size(); }
@@ -193,6 +501,16 @@ public:
 	Light*  createLight(Node* _parent = nullptr);
 	void    destroyLight(Light*& _camera_);
 
+	// Begin loading the binary scene at _path as a partition under _parent (the root if nullptr). Return
+	// kInvalidPartitionId if _path isn't a binary scene.
+	PartitionId    loadPartition(const char* _path, Node* _parent = nullptr);
+	void           unloadPartition(PartitionId _id);
+	PartitionState getPartitionState(PartitionId _id) const;
+	// Root of partition _id if attached, else nullptr.
+	Node*          getPartitionRoot(PartitionId _id) const;
+	float          getPartitionBudget() const       { return m_partitionBudget; }
+	void           setPartitionBudget(float _ms)    { m_partitionBudget = _ms; }
+
 	// \note Node names beginning with '#' are ignored during serialization (use for any nodes added programmatcially).
 	friend bool Serialize(apt::Serializer& _serializer_, Scene& _scene_);
 	friend bool Serialize(apt::Serializer& _serializer_, Scene& _scene_, Node& _node_);
@@ -213,11 +531,42 @@ public:
 private:
 	static Scene*           s_currentScene;
 
+	// Binary scene format, see Scene_bin.cpp.
+	static bool ReadBin(Scene& scene_, const char* _path);
+	static bool WriteBin(Scene& _scene, const char* _path);
+
+	// Incremental binary read, see Scene_bin.cpp. OpenBin() maps and validates the file and creates the xforms, it is
+	// thread safe. readBin() creates up to _maxCount nodes/xforms per call (all if ~0u), return true when complete. If
+	// _partitionName is null the file is read into this scene's root (ReadBin()), else node 0 is created as an
+	// unreachable node named _partitionName, all nodes get new ids and _parent is used to init the world matrices.
+	struct BinFile;
+	static BinFile* OpenBin(const char* _path);
+	static void     CloseBin(BinFile*& _bin_);
+	bool            readBin(BinFile& _bin_, const char* _partitionName, const Node* _parent, uint32 _maxCount, eastl::vector<Node::Id>* nodeIds_ = nullptr);
+
+	// Streamed sub-scenes, see Scene_partition.cpp.
+	friend class ScenePartitionLoader;
+	struct Partition;
+	// Begin unloading _id (detach the root, release the parse results).
+	void beginUnloadPartition(PartitionId _id);
+	// Cancel loads in progress and release all partitions without destroying their nodes (called by ~Scene()).
+	void releasePartitions();
+	// As destroyNode() but without the profiler marker, return false if _node_ wasn't found.
+	bool releaseNode(Node* _node_);
+
+	// _nodePoolBlockSize is the Pool block size (use the node count when bulk loading).
+	explicit Scene(uint32 _nodePoolBlockSize);
+
+	// Ensure that auto names don't collide with the names of loaded nodes.
+	void updateAutoNameCounters();
+
  // nodes
 	Node::Id                m_nextNodeId;               // Monotonically increasing id for nodes.
 	Node*                   m_root;                     // Everything is a child of root.              
 	eastl::vector<Node*>    m_nodes[Node::Type_Count];  // Nodes binned by type.
 	apt::Pool<Node>         m_nodePool;
+	NodeHierarchy*          m_hierarchy;                // Heap allocated, nodes point to it (see swap()).
+	UpdateMode              m_updateMode;
 
  // cameras
 	Camera*                 m_drawCamera;
@@ -229,6 +578,10 @@ private:
 	eastl::vector<Light*>   m_lights;
 	apt::Pool<Light>        m_lightPool;
 
+ // partitions
+	eastl::vector<Partition*> m_partitions;         // Indexed by PartitionId, ids aren't reused.
+	float                     m_partitionBudget;    // ms per update().
+
 #ifdef frm_Scene_ENABLE_EDIT
 	bool      m_showNodeGraph3d;
 	Node*     m_editNode;
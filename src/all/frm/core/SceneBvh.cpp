@@ -0,0 +1,426 @@
+#include "SceneBvh.h"
+
+#include <frm/core/Profiler.h>
+
+#include <apt/memory.h>
+
+#include <cfloat>
+
+using namespace frm;
+using namespace apt;
+
+static const uint32 kStackSize = 256;
+static const uint8  kAllPlanes = (1 << Frustum::Plane_Count) - 1;
+
+static inline float HalfArea(const AlignedBox& _box)
+{
+	vec3 d = _box.m_max - _box.m_min;
+	return d.x * d.y + d.y * d.z + d.z * d.x;
+}
+
+static inline AlignedBox Combine(const AlignedBox& _a, const AlignedBox& _b)
+{
+	return AlignedBox(min(_a.m_min, _b.m_min), max(_a.m_max, _b.m_max));
+}
+
+static inline bool Contains(const AlignedBox& _outer, const AlignedBox& _inner)
+{
+	return
+		_inner.m_min.x >= _outer.m_min.x && _inner.m_min.y >= _outer.m_min.y && _inner.m_min.z >= _outer.m_min.z &&
+		_inner.m_max.x <= _outer.m_max.x && _inner.m_max.y <= _outer.m_max.y && _inner.m_max.z <= _outer.m_max.z
+		;
+}
+
+// Return false if _box is outside _frustum. Only planes in _planeMask_ are tested, planes which _box is entirely
+// inside are removed from the mask (they don't need to be tested for any box contained by _box).
+static inline bool Cull(const Frustum& _frustum, const AlignedBox& _box, uint8& _planeMask_)
+{
+	for (int i = 0; i < Frustum::Plane_Count; ++i) {
+		if (!(_planeMask_ & (1 << i))) {
+			continue;
+		}
+		const Plane& plane = _frustum.m_planes[i];
+		vec3 a = _box.m_min * plane.m_normal;
+		vec3 b = _box.m_max * plane.m_normal;
+		vec3 mx = max(a, b);
+		if (mx.x + mx.y + mx.z - plane.m_offset < 0.0f) {
+			return false;
+		}
+		vec3 mn = min(a, b);
+		if (mn.x + mn.y + mn.z - plane.m_offset >= 0.0f) {
+			_planeMask_ &= ~(1 << i);
+		}
+	}
+	return true;
+}
+
+/*******************************************************************************
+
+                                   SceneBvh
+
+*******************************************************************************/
+
+// PUBLIC
+
+const uint32 SceneBvh::kInvalidIndex;
+
+SceneBvh* SceneBvh::Create(float _margin)
+{
+	return APT_NEW(SceneBvh(_margin));
+}
+
+void SceneBvh::Destroy(SceneBvh*& _inst_)
+{
+	APT_DELETE(_inst_);
+}
+
+void SceneBvh::insert(const Node* _node, const AlignedBox& _localBox)
+{
+	APT_ASSERT(_node);
+	auto it = m_leaves.find(_node->getId());
+	if (it != m_leaves.end()) {
+	 // force reinsertion
+		TreeNode& leaf = m_nodes[it->second];
+		leaf.m_localBox = _localBox;
+		leaf.m_box = AlignedBox(vec3(FLT_MAX), vec3(-FLT_MAX));
+		refit(it->second, _node);
+		return;
+	}
+
+	uint32 i = allocNode();
+	TreeNode& leaf = m_nodes[i];
+	leaf.m_localBox = _localBox;
+	leaf.m_leafBox = _localBox;
+	leaf.m_leafBox.transform(_node->getWorldMatrix());
+	leaf.m_box = AlignedBox(leaf.m_leafBox.m_min - vec3(m_margin), leaf.m_leafBox.m_max + vec3(m_margin));
+	leaf.m_children[0] = leaf.m_children[1] = kInvalidIndex;
+	leaf.m_height = 0;
+	leaf.m_id = _node->getId();
+	insertLeaf(i);
+	m_leaves[_node->getId()] = i;
+}
+
+void SceneBvh::remove(Node::Id _id)
+{
+	auto it = m_leaves.find(_id);
+	if (it == m_leaves.end()) {
+		return;
+	}
+	removeLeaf(it->second);
+	freeNode(it->second);
+	m_leaves.erase(it);
+}
+
+void SceneBvh::update(const Scene& _scene)
+{
+	PROFILER_MARKER_CPU("#SceneBvh::update");
+
+	for (const Node* node : _scene.getChangedNodes()) {
+		auto it = m_leaves.find(node->getId());
+		if (it != m_leaves.end()) {
+			refit(it->second, node);
+		}
+	}
+}
+
+void SceneBvh::update(const Node* _node)
+{
+	auto it = m_leaves.find(_node->getId());
+	if (it != m_leaves.end()) {
+		refit(it->second, _node);
+	}
+}
+
+uint32 SceneBvh::query(const Frustum& _frustum, Node::Id* out_, uint32 _maxCount) const
+{
+	PROFILER_MARKER_CPU("#SceneBvh::query");
+
+	if (m_root == kInvalidIndex || _maxCount == 0) {
+		return 0;
+	}
+
+	struct Entry { uint32 m_node; uint8 m_planeMask; };
+	Entry stack[kStackSize];
+	uint32 stackSize = 0;
+	stack[stackSize++] = { m_root, kAllPlanes };
+
+	uint32 ret = 0;
+	while (stackSize > 0) {
+		Entry entry = stack[--stackSize];
+		const TreeNode& node = m_nodes[entry.m_node];
+		uint8 planeMask = entry.m_planeMask;
+		if (!Cull(_frustum, node.isLeaf() ? node.m_leafBox : node.m_box, planeMask)) {
+			continue;
+		}
+
+		if (planeMask == 0 && !node.isLeaf()) {
+		 // subtree is entirely inside, gather the leaves without testing
+			uint32 base = stackSize;
+			stack[stackSize++] = entry;
+			while (stackSize > base) {
+				const TreeNode& n = m_nodes[stack[--stackSize].m_node];
+				if (n.isLeaf()) {
+					out_[ret++] = n.m_id;
+					if (ret == _maxCount) {
+						return ret;
+					}
+				} else {
+					APT_ASSERT(stackSize + 2 <= kStackSize);
+					stack[stackSize++] = { n.m_children[0], 0 };
+					stack[stackSize++] = { n.m_children[1], 0 };
+				}
+			}
+			continue;
+		}
+
+		if (node.isLeaf()) {
+			out_[ret++] = node.m_id;
+			if (ret == _maxCount) {
+				return ret;
+			}
+		} else {
+			APT_ASSERT(stackSize + 2 <= kStackSize);
+			stack[stackSize++] = { node.m_children[0], planeMask };
+			stack[stackSize++] = { node.m_children[1], planeMask };
+		}
+	}
+	return ret;
+}
+
+float SceneBvh::getAreaRatio() const
+{
+	if (m_root == kInvalidIndex) {
+		return 0.0f;
+	}
+	float rootArea = HalfArea(m_nodes[m_root].m_box);
+	float totalArea = 0.0f;
+	for (auto& node : m_nodes) {
+		if (node.m_height > 0) {
+			totalArea += HalfArea(node.m_box);
+		}
+	}
+	return rootArea > 0.0f ? totalArea / rootArea : 0.0f;
+}
+
+bool SceneBvh::validate() const
+{
+	if (m_root == kInvalidIndex) {
+		return m_leaves.empty();
+	}
+	if (m_nodes[m_root].m_parent != kInvalidIndex) {
+		return false;
+	}
+	uint32 leafCount = 0;
+	eastl::vector<uint32> stack;
+	stack.push_back(m_root);
+	while (!stack.empty()) {
+		uint32 i = stack.back();
+		stack.pop_back();
+		const TreeNode& node = m_nodes[i];
+		if (node.isLeaf()) {
+			auto it = m_leaves.find(node.m_id);
+			if (node.m_height != 0 || it == m_leaves.end() || it->second != i || !Contains(node.m_box, node.m_leafBox)) {
+				return false;
+			}
+			++leafCount;
+			continue;
+		}
+		const TreeNode& c0 = m_nodes[node.m_children[0]];
+		const TreeNode& c1 = m_nodes[node.m_children[1]];
+		if (c0.m_parent != i || c1.m_parent != i) {
+			return false;
+		}
+		if (node.m_height != 1 + APT_MAX(c0.m_height, c1.m_height)) {
+			return false;
+		}
+		if (!Contains(node.m_box, c0.m_box) || !Contains(node.m_box, c1.m_box)) {
+			return false;
+		}
+		stack.push_back(node.m_children[0]);
+		stack.push_back(node.m_children[1]);
+	}
+	return leafCount == (uint32)m_leaves.size();
+}
+
+// PRIVATE
+
+SceneBvh::SceneBvh(float _margin)
+	: m_root(kInvalidIndex)
+	, m_freeList(kInvalidIndex)
+	, m_margin(_margin)
+{
+}
+
+SceneBvh::~SceneBvh()
+{
+}
+
+uint32 SceneBvh::allocNode()
+{
+	uint32 ret = m_freeList;
+	if (ret == kInvalidIndex) {
+		ret = (uint32)m_nodes.size();
+		m_nodes.push_back(TreeNode());
+	} else {
+		m_freeList = m_nodes[ret].m_parent;
+	}
+	m_nodes[ret].m_parent = kInvalidIndex;
+	return ret;
+}
+
+void SceneBvh::freeNode(uint32 _i)
+{
+	m_nodes[_i].m_parent = m_freeList;
+	m_nodes[_i].m_height = -1;
+	m_freeList = _i;
+}
+
+void SceneBvh::insertLeaf(uint32 _leaf)
+{
+	if (m_root == kInvalidIndex) {
+		m_root = _leaf;
+		m_nodes[_leaf].m_parent = kInvalidIndex;
+		return;
+	}
+
+ // find the sibling with the least cost (increase in surface area of the tree)
+	const AlignedBox leafBox = m_nodes[_leaf].m_box;
+	uint32 i = m_root;
+	while (!m_nodes[i].isLeaf()) {
+		const TreeNode& node = m_nodes[i];
+		float area = HalfArea(node.m_box);
+		float combinedArea = HalfArea(Combine(node.m_box, leafBox));
+		float cost = 2.0f * combinedArea;                        // new parent of node + leaf
+		float inheritanceCost = 2.0f * (combinedArea - area);    // increase in the area of the ancestors
+		float childCost[2];
+		for (int j = 0; j < 2; ++j) {
+			const TreeNode& child = m_nodes[node.m_children[j]];
+			float childArea = HalfArea(Combine(child.m_box, leafBox));
+			childCost[j] = (child.isLeaf() ? childArea : childArea - HalfArea(child.m_box)) + inheritanceCost;
+		}
+		if (cost < childCost[0] && cost < childCost[1]) {
+			break;
+		}
+		i = node.m_children[childCost[0] < childCost[1] ? 0 : 1];
+	}
+
+ // new parent for the sibling + leaf
+	uint32 sibling = i;
+	uint32 oldParent = m_nodes[sibling].m_parent;
+	uint32 newParent = allocNode(); // may reallocate m_nodes
+	TreeNode& parent = m_nodes[newParent];
+	parent.m_parent = oldParent;
+	parent.m_box = Combine(m_nodes[sibling].m_box, leafBox);
+	parent.m_height = m_nodes[sibling].m_height + 1;
+	parent.m_children[0] = sibling;
+	parent.m_children[1] = _leaf;
+	parent.m_id = Node::kInvalidId;
+	if (oldParent == kInvalidIndex) {
+		m_root = newParent;
+	} else {
+		TreeNode& op = m_nodes[oldParent];
+		op.m_children[op.m_children[0] == sibling ? 0 : 1] = newParent;
+	}
+	m_nodes[sibling].m_parent = newParent;
+	m_nodes[_leaf].m_parent = newParent;
+
+	refitAncestors(newParent);
+}
+
+void SceneBvh::removeLeaf(uint32 _leaf)
+{
+	if (_leaf == m_root) {
+		m_root = kInvalidIndex;
+		return;
+	}
+
+	uint32 parent = m_nodes[_leaf].m_parent;
+	uint32 grandParent = m_nodes[parent].m_parent;
+	uint32 sibling = m_nodes[parent].m_children[m_nodes[parent].m_children[0] == _leaf ? 1 : 0];
+	freeNode(parent);
+	m_nodes[sibling].m_parent = grandParent;
+	if (grandParent == kInvalidIndex) {
+		m_root = sibling;
+	} else {
+		TreeNode& gp = m_nodes[grandParent];
+		gp.m_children[gp.m_children[0] == parent ? 0 : 1] = sibling;
+		refitAncestors(grandParent);
+	}
+}
+
+uint32 SceneBvh::balance(uint32 _i)
+{
+	TreeNode* a = &m_nodes[_i];
+	if (a->isLeaf() || a->m_height < 2) {
+		return _i;
+	}
+
+ // the higher child b replaces a, a replaces the lower child of b (bl) which moves under a:
+ //   a(c, b(bh, bl)) -> b(a(c, bl), bh)
+	int h0 = m_nodes[a->m_children[0]].m_height;
+	int h1 = m_nodes[a->m_children[1]].m_height;
+	int up;
+	if (h1 - h0 > 1) {
+		up = 1;
+	} else if (h0 - h1 > 1) {
+		up = 0;
+	} else {
+		return _i;
+	}
+	uint32 ib = a->m_children[up];
+	uint32 ic = a->m_children[1 - up];
+	TreeNode* b = &m_nodes[ib];
+	TreeNode* c = &m_nodes[ic];
+	uint32 ibh = b->m_children[0];
+	uint32 ibl = b->m_children[1];
+	if (m_nodes[ibh].m_height < m_nodes[ibl].m_height) {
+		eastl::swap(ibh, ibl);
+	}
+	TreeNode* bh = &m_nodes[ibh];
+	TreeNode* bl = &m_nodes[ibl];
+
+	b->m_parent = a->m_parent;
+	if (b->m_parent == kInvalidIndex) {
+		m_root = ib;
+	} else {
+		TreeNode& p = m_nodes[b->m_parent];
+		p.m_children[p.m_children[0] == _i ? 0 : 1] = ib;
+	}
+	b->m_children[0] = _i;
+	b->m_children[1] = ibh;
+	a->m_parent = ib;
+	a->m_children[up] = ibl;
+	bl->m_parent = _i;
+
+	a->m_box = Combine(c->m_box, bl->m_box);
+	a->m_height = 1 + APT_MAX(c->m_height, bl->m_height);
+	b->m_box = Combine(a->m_box, bh->m_box);
+	b->m_height = 1 + APT_MAX(a->m_height, bh->m_height);
+	return ib;
+}
+
+void SceneBvh::refitAncestors(uint32 _i)
+{
+	while (_i != kInvalidIndex) {
+		_i = balance(_i);
+		TreeNode& node = m_nodes[_i];
+		const TreeNode& c0 = m_nodes[node.m_children[0]];
+		const TreeNode& c1 = m_nodes[node.m_children[1]];
+		node.m_height = 1 + APT_MAX(c0.m_height, c1.m_height);
+		node.m_box = Combine(c0.m_box, c1.m_box);
+		_i = node.m_parent;
+	}
+}
+
+void SceneBvh::refit(uint32 _leaf, const Node* _node)
+{
+	TreeNode& leaf = m_nodes[_leaf];
+	leaf.m_leafBox = leaf.m_localBox;
+	leaf.m_leafBox.transform(_node->getWorldMatrix());
+	if (Contains(leaf.m_box, leaf.m_leafBox)) {
+		return;
+	}
+	removeLeaf(_leaf);
+	leaf.m_box = AlignedBox(leaf.m_leafBox.m_min - vec3(m_margin), leaf.m_leafBox.m_max + vec3(m_margin));
+	insertLeaf(_leaf);
+}
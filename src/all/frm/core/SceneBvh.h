@@ -0,0 +1,105 @@
+#pragma once
+#ifndef frm_SceneBvh_h
+#define frm_SceneBvh_h
+
+#include <frm/core/def.h>
+#include <frm/core/geom.h>
+#include <frm/core/Scene.h>
+
+#include <EASTL/vector.h>
+#include <EASTL/hash_map.h>
+
+namespace frm {
+
+////////////////////////////////////////////////////////////////////////////////
+// SceneBvh
+// Dynamic AABB tree over scene nodes for visibility queries, keyed by Node::Id.
+// Each leaf stores the node's local bounds (e.g. the mesh bounds) transformed
+// by the node's world matrix, enlarged by a margin (the 'fat' box) such that
+// small movements don't modify the tree:
+//
+//    bvh->insert(node, mesh->getBoundingBox());
+//    ...
+//    scene->update(dt);
+//    bvh->update(*scene);  // refit from Scene::getChangedNodes()
+//    uint32 n = bvh->query(Scene::GetCullCamera()->m_worldFrustum, visible, kMaxVisible);
+//
+// Leaves are inserted by descending towards the sibling with the least
+// surface area cost; the tree is rebalanced by rotations (AVL style, by
+// height) on the path back to the root. A leaf whose bounds leave its fat box
+// is removed and reinserted.
+//
+// \note Nodes must be removed from the tree before they are destroyed.
+////////////////////////////////////////////////////////////////////////////////
+class SceneBvh: private apt::non_copyable<SceneBvh>
+{
+public:
+
+	// _margin is the world space distance by which leaf boxes are enlarged.
+	static SceneBvh* Create(float _margin = 0.1f);
+	static void      Destroy(SceneBvh*& _inst_);
+
+	// Insert _node with local space bounds _localBox, or update the bounds if _node is already in the tree.
+	void   insert(const Node* _node, const AlignedBox& _localBox);
+	void   remove(Node::Id _id);
+	bool   contains(Node::Id _id) const   { return m_leaves.find(_id) != m_leaves.end(); }
+
+	// Refit the leaves of nodes in _scene.getChangedNodes(), call after Scene::update().
+	void   update(const Scene& _scene);
+	// Refit the leaf of _node (if it's in the tree).
+	void   update(const Node* _node);
+
+	// Write the ids of nodes whose bounds intersect _frustum to out_, return the number of ids written (at most
+	// _maxCount).
+	uint32 query(const Frustum& _frustum, Node::Id* out_, uint32 _maxCount) const;
+
+	uint32 getLeafCount() const           { return (uint32)m_leaves.size(); }
+	uint32 getHeight() const              { return m_root == kInvalidIndex ? 0 : (uint32)m_nodes[m_root].m_height; }
+	// Sum of the surface area of the inner nodes relative to the root, a measure of the tree quality.
+	float  getAreaRatio() const;
+	// Check the tree invariants (bounds, heights, parent links), return false if any are violated.
+	bool   validate() const;
+
+private:
+	static const uint32 kInvalidIndex = ~0u;
+
+	struct TreeNode
+	{
+		AlignedBox m_box;         // Fat box for leaves.
+		AlignedBox m_leafBox;     // World space bounds (leaves only).
+		AlignedBox m_localBox;    // Local space bounds (leaves only).
+		uint32     m_parent;      // Next free node if unused.
+		uint32     m_children[2]; // kInvalidIndex for leaves.
+		sint32     m_height;      // 0 for leaves, -1 if unused.
+		Node::Id   m_id;
+
+		bool isLeaf() const { return m_children[0] == kInvalidIndex; }
+	};
+
+	eastl::vector<TreeNode>                  m_nodes;
+	eastl::hash_map<Node::Id, uint32>        m_leaves;   // Node::Id -> leaf index.
+	uint32                                   m_root;
+	uint32                                   m_freeList;
+	float                                    m_margin;
+
+	SceneBvh(float _margin);
+	~SceneBvh();
+
+	uint32 allocNode();
+	void   freeNode(uint32 _i);
+
+	void   insertLeaf(uint32 _leaf);
+	void   removeLeaf(uint32 _leaf);
+	// Rotate the tree at _i if unbalanced, return the index of the node which replaced _i.
+	uint32 balance(uint32 _i);
+	// Refit the boxes/heights of the ancestors of _i, balancing each.
+	void   refitAncestors(uint32 _i);
+
+	// Update the leaf bounds from _node's world matrix, reinsert if the bounds leave the fat box.
+	void   refit(uint32 _leaf, const Node* _node);
+
+}; // class SceneBvh
+
+} // namespace frm
+
+#endif // frm_SceneBvh_h
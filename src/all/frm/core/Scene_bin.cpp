@@ -0,0 +1,597 @@
+#include "Scene.h"
+
+#include <frm/core/Camera.h>
+#include <frm/core/Light.h>
+#include <frm/core/MappedFile.h>
+#include <frm/core/Profiler.h>
+#include <frm/core/XForm.h>
+
+#include <apt/log.h>
+#include <apt/memory.h>
+#include <apt/File.h>
+#include <apt/FileSystem.h>
+
+#include <EASTL/algorithm.h>
+#include <EASTL/vector.h>
+
+#include <cstring>
+
+using namespace frm;
+using namespace apt;
+
+// Binary scene layout: BinHeader followed by the sections, each aligned to kBinAlignment relative to the start of the
+// file. The node table is stored as one array per member (SoA) in pre-order, node 0 is the root. XForms are grouped by
+// type; each type stores an array of fixed size payloads (see XForm::BinCodec) plus the node/slot each instance belongs
+// to. Node references are node table indices, strings are offsets into a single string table. As for the mesh cache
+// (MeshData_bin.cpp) structs are written as-is, hence files aren't portable between platforms/compilers.
+static const char   kBinMagic[4]      = { 'F', 'R', 'M', 'S' };
+static const uint32 kBinVersion       = 1; // increment when changing the layout or any XForm::Bin struct
+static const uint64 kBinAlignment     = 16;
+static const uint32 kBinInvalidIndex  = XForm::kBinInvalidIndex;
+
+struct BinHeader
+{
+	char   m_magic[4];
+	uint32 m_version;
+	uint64 m_fileSize;
+
+	uint32 m_nodeCount;
+	uint32 m_xformTypeCount;
+	uint32 m_cameraCount;
+	uint32 m_drawCamera;          // node table index, kBinInvalidIndex if none
+	uint32 m_cullCamera;          //            "
+	uint32 m_stringTableSize;
+
+ // node table
+	uint64 m_idOffset;            // Node::Id
+	uint64 m_nameOffset;          // uint32 string table offset
+	uint64 m_parentOffset;        // uint32 node table index (kBinInvalidIndex for the root)
+	uint64 m_typeOffset;          // uint8
+	uint64 m_stateOffset;         // uint8
+	uint64 m_userDataOffset;      // uint64
+	uint64 m_positionOffset;      // vec3
+	uint64 m_orientationOffset;   // quat
+	uint64 m_scaleOffset;         // vec3
+	uint64 m_xformCountOffset;    // uint32
+
+	uint64 m_xformTypeOffset;     // BinXFormType
+	uint64 m_cameraOffset;        // BinCamera
+	uint64 m_stringTableOffset;
+};
+
+struct BinXFormType
+{
+	uint32 m_className;           // string table offset
+	uint32 m_count;
+	uint32 m_payloadSize;         // bytes per instance, must match XForm::BinCodec::m_payloadSize
+	uint32 m_pad;
+	uint64 m_refOffset;           // BinXFormRef per instance
+	uint64 m_payloadOffset;
+};
+
+struct BinXFormRef
+{
+	uint32 m_node;                // node table index
+	uint32 m_slot;                // index in the node's xform list
+};
+
+struct BinCamera
+{
+	uint32 m_node;                // node table index
+	uint32 m_projFlags;
+	float  m_up, m_down, m_right, m_left, m_near, m_far;
+	mat4   m_world;
+	uint32 m_hasGpuBuffer;
+};
+
+// Pre-order traversal, skip nodes whose names begin with '#' (as for the json format).
+static void GatherNodes(Node* _node, uint32 _parentIndex, eastl::vector<Node*>& nodes_, eastl::vector<uint32>& parents_)
+{
+	uint32 index = (uint32)nodes_.size();
+	nodes_.push_back(_node);
+	parents_.push_back(_parentIndex);
+	for (Node* child = _node->getFirstChild(); child; child = child->getNextSibling()) {
+		if (child->getName()[0] == '#') {
+			continue;
+		}
+		GatherNodes(child, index, nodes_, parents_);
+	}
+}
+
+// Parse results of OpenBin(), consumed incrementally by readBin().
+struct Scene::BinFile
+{
+	struct XFormType
+	{
+		const XForm::BinCodec* m_codec;
+		const char*            m_payload;
+		eastl::vector<XForm*>  m_xforms;        // In payload order.
+	};
+
+	MappedFile*                m_file           = nullptr;
+	const BinHeader*           m_header         = nullptr;
+	const Node::Id*            m_ids            = nullptr;
+	const uint32*              m_names          = nullptr;
+	const uint32*              m_parents        = nullptr;
+	const uint8*               m_types          = nullptr;
+	const uint8*               m_states         = nullptr;
+	const uint64*              m_userData       = nullptr;
+	const vec3*                m_positions      = nullptr;
+	const quat*                m_orientations   = nullptr;
+	const vec3*                m_scales         = nullptr;
+	const BinCamera*           m_cameras        = nullptr;
+
+	eastl::vector<uint32>      m_slotOffsets;   // First slot of each node in m_slots (nodeCount + 1 entries).
+	eastl::vector<XForm*>      m_slots;         // XForms per node, owned by the BinFile until the node is created.
+	eastl::vector<XFormType>   m_xformTypes;
+	XForm::BinContext          m_ctx;           // m_ctx.m_nodes are the nodes created so far.
+
+ // readBin() progress
+	uint32                     m_xformType      = 0;
+	uint32                     m_xform          = 0;
+	bool                       m_complete       = false;
+};
+
+Scene::BinFile* Scene::OpenBin(const char* _path)
+{
+	MappedFile* file = MappedFile::Create((const char*)FileSystem::MakePath(_path));
+	if (!file) {
+		APT_LOG_ERR("Scene: Failed to map '%s'", _path);
+		return nullptr;
+	}
+	const char*  data     = file->getData();
+	const uint64 dataSize = file->getDataSize();
+	if (dataSize < sizeof(BinHeader)) {
+		APT_LOG_ERR("Scene: Invalid binary scene '%s'", _path);
+		MappedFile::Destroy(file);
+		return nullptr;
+	}
+	const BinHeader& header = *((const BinHeader*)data);
+	auto InRange = [dataSize](uint64 _offset, uint64 _size) -> bool
+		{
+			return _offset <= dataSize && _size <= dataSize - _offset; // _offset + _size may overflow
+		};
+	const uint64 nodeCount = header.m_nodeCount;
+	if (memcmp(header.m_magic, kBinMagic, sizeof(kBinMagic)) != 0 ||
+		header.m_version  != kBinVersion ||
+		header.m_fileSize != dataSize ||
+		nodeCount == 0 ||
+		!InRange(header.m_idOffset,          sizeof(uint64) * nodeCount) ||
+		!InRange(header.m_nameOffset,        sizeof(uint32) * nodeCount) ||
+		!InRange(header.m_parentOffset,      sizeof(uint32) * nodeCount) ||
+		!InRange(header.m_typeOffset,        sizeof(uint8)  * nodeCount) ||
+		!InRange(header.m_stateOffset,       sizeof(uint8)  * nodeCount) ||
+		!InRange(header.m_userDataOffset,    sizeof(uint64) * nodeCount) ||
+		!InRange(header.m_positionOffset,    sizeof(vec3)   * nodeCount) ||
+		!InRange(header.m_orientationOffset, sizeof(quat)   * nodeCount) ||
+		!InRange(header.m_scaleOffset,       sizeof(vec3)   * nodeCount) ||
+		!InRange(header.m_xformCountOffset,  sizeof(uint32) * nodeCount) ||
+		!InRange(header.m_xformTypeOffset,   sizeof(BinXFormType) * header.m_xformTypeCount) ||
+		!InRange(header.m_cameraOffset,      sizeof(BinCamera) * header.m_cameraCount) ||
+		!InRange(header.m_stringTableOffset, header.m_stringTableSize) ||
+		header.m_stringTableSize == 0 ||
+		data[header.m_stringTableOffset + header.m_stringTableSize - 1] != '\0'
+		) {
+		APT_LOG_ERR("Scene: Invalid binary scene '%s'", _path);
+		MappedFile::Destroy(file);
+		return nullptr;
+	}
+
+	BinFile* ret = APT_NEW(BinFile);
+	ret->m_file         = file;
+	ret->m_header       = &header;
+	ret->m_ids          = (const Node::Id*)(data + header.m_idOffset);
+	ret->m_names        = (const uint32*)(data + header.m_nameOffset);
+	ret->m_parents      = (const uint32*)(data + header.m_parentOffset);
+	ret->m_types        = (const uint8*)(data + header.m_typeOffset);
+	ret->m_states       = (const uint8*)(data + header.m_stateOffset);
+	ret->m_userData     = (const uint64*)(data + header.m_userDataOffset);
+	ret->m_positions    = (const vec3*)(data + header.m_positionOffset);
+	ret->m_orientations = (const quat*)(data + header.m_orientationOffset);
+	ret->m_scales       = (const vec3*)(data + header.m_scaleOffset);
+	ret->m_cameras      = (const BinCamera*)(data + header.m_cameraOffset);
+	ret->m_ctx.m_stringTable     = data + header.m_stringTableOffset;
+	ret->m_ctx.m_stringTableSize = header.m_stringTableSize;
+	ret->m_ctx.m_nodes.reserve((size_t)nodeCount);
+
+ // node table, count the xform slots
+	const uint32* xformCounts = (const uint32*)(data + header.m_xformCountOffset);
+	const BinXFormType* xformTypes = (const BinXFormType*)(data + header.m_xformTypeOffset);
+	uint64 xformCount = 0;
+	for (uint32 i = 0; i < header.m_xformTypeCount; ++i) {
+		xformCount += xformTypes[i].m_count;
+	}
+	uint32 cameraNodeCount = 0;
+	uint64 slotCount = 0;
+	ret->m_slotOffsets.resize((size_t)nodeCount + 1);
+	for (uint32 i = 0; i < (uint32)nodeCount; ++i) {
+		Node::Type type = (Node::Type)ret->m_types[i];
+		if (!ret->m_ctx.getString(ret->m_names[i]) || type >= Node::Type_Count || (i == 0) != (type == Node::Type_Root) || (i > 0 && ret->m_parents[i] >= i)) {
+			APT_LOG_ERR("Scene: Invalid node %u in binary scene '%s'", i, _path);
+			CloseBin(ret);
+			return nullptr;
+		}
+		cameraNodeCount += type == Node::Type_Camera ? 1 : 0;
+		ret->m_slotOffsets[i] = (uint32)slotCount;
+		slotCount += xformCounts[i];
+		if (slotCount > xformCount) {
+			break; // reported below
+		}
+	}
+	if (slotCount != xformCount || cameraNodeCount != header.m_cameraCount) {
+		APT_LOG_ERR("Scene: Invalid xform/camera count in binary scene '%s'", _path);
+		CloseBin(ret);
+		return nullptr;
+	}
+	ret->m_slotOffsets[(size_t)nodeCount] = (uint32)slotCount;
+	ret->m_slots.resize((size_t)slotCount, nullptr);
+
+ // xforms, create the instances and assign them to their slots
+	ret->m_xformTypes.resize(header.m_xformTypeCount);
+	for (uint32 i = 0; i < header.m_xformTypeCount; ++i) {
+		const BinXFormType& src = xformTypes[i];
+		BinFile::XFormType& xformType = ret->m_xformTypes[i];
+		const char* className = ret->m_ctx.getString(src.m_className);
+		xformType.m_codec = className ? XForm::FindBinCodec(StringHash(className)) : nullptr;
+		if (!xformType.m_codec || xformType.m_codec->m_payloadSize != src.m_payloadSize) {
+			APT_LOG_ERR("Scene: Invalid xform type '%s' in binary scene '%s'", className ? className : "", _path);
+			CloseBin(ret);
+			return nullptr;
+		}
+		if (!InRange(src.m_refOffset, sizeof(BinXFormRef) * (uint64)src.m_count) || !InRange(src.m_payloadOffset, (uint64)src.m_payloadSize * src.m_count)) {
+			APT_LOG_ERR("Scene: Invalid xform data '%s' in binary scene '%s'", className, _path);
+			CloseBin(ret);
+			return nullptr;
+		}
+		const BinXFormRef* refs = (const BinXFormRef*)(data + src.m_refOffset);
+		xformType.m_payload = data + src.m_payloadOffset;
+		xformType.m_xforms.reserve(src.m_count);
+		for (uint32 j = 0; j < src.m_count; ++j) {
+			const BinXFormRef& ref = refs[j];
+			if (ref.m_node >= (uint32)nodeCount || ref.m_slot >= ret->m_slotOffsets[ref.m_node + 1] - ret->m_slotOffsets[ref.m_node] || ret->m_slots[ret->m_slotOffsets[ref.m_node] + ref.m_slot] != nullptr) {
+				APT_LOG_ERR("Scene: Invalid xform reference in binary scene '%s'", _path);
+				CloseBin(ret);
+				return nullptr;
+			}
+			XForm* xform = XForm::Create(xformType.m_codec->m_classNameHash);
+			ret->m_slots[ret->m_slotOffsets[ref.m_node] + ref.m_slot] = xform;
+			xformType.m_xforms.push_back(xform);
+		}
+	}
+ // the slot count matches the instance count and no slot was assigned twice, hence all slots are assigned
+
+ // cameras, one per camera node
+	eastl::vector<uint8> cameraNodes((size_t)nodeCount, 0);
+	for (uint32 i = 0; i < header.m_cameraCount; ++i) {
+		const BinCamera& src = ret->m_cameras[i];
+		if (src.m_node >= (uint32)nodeCount || ret->m_types[src.m_node] != Node::Type_Camera || cameraNodes[src.m_node]++ != 0) {
+			APT_LOG_ERR("Scene: Invalid camera %u in binary scene '%s'", i, _path);
+			CloseBin(ret);
+			return nullptr;
+		}
+	}
+
+	return ret;
+}
+
+void Scene::CloseBin(BinFile*& _bin_)
+{
+	if (!_bin_) {
+		return;
+	}
+ // xforms of nodes which weren't created, the rest are owned by the nodes
+	for (uint32 i = _bin_->m_slotOffsets.empty() ? 0 : _bin_->m_slotOffsets[_bin_->m_ctx.m_nodes.size()]; i < (uint32)_bin_->m_slots.size(); ++i) {
+		delete _bin_->m_slots[i];
+	}
+	MappedFile::Destroy(_bin_->m_file);
+	APT_DELETE(_bin_);
+	_bin_ = nullptr;
+}
+
+bool Scene::readBin(BinFile& _bin_, const char* _partitionName, const Node* _parent, uint32 _maxCount, eastl::vector<Node::Id>* nodeIds_)
+{
+	XForm::BinContext& ctx = _bin_.m_ctx;
+	const BinHeader& header = *_bin_.m_header;
+	uint32 count = 0;
+
+	if (ctx.m_nodes.empty()) {
+	 // reserve up front, growing the hierarchy arrays/indices during an incremental read would cause spikes
+		m_hierarchy->reserve(m_hierarchy->getNodeCount() + header.m_nodeCount, (uint32)_bin_.m_slots.size());
+		if (nodeIds_) {
+			nodeIds_->reserve(header.m_nodeCount);
+		}
+	}
+
+ // nodes, in pre-order hence parents are created before their children
+	while (count < _maxCount && (uint32)ctx.m_nodes.size() < header.m_nodeCount) {
+		uint32 i = (uint32)ctx.m_nodes.size();
+		Node::Type  type  = (Node::Type)_bin_.m_types[i];
+		const char* name  = ctx.getString(_bin_.m_names[i]);
+		uint8       state = _bin_.m_states[i];
+		Node* parent = i > 0 ? ctx.m_nodes[_bin_.m_parents[i]] : nullptr;
+		Node* node;
+		if (!_partitionName) {
+			if (i == 0) {
+				node = m_root;
+				m_hierarchy->unindexNode(node);
+				node->m_id = _bin_.m_ids[i];
+				node->m_state = state;
+			} else {
+				node = m_nodePool.alloc(Node(type, _bin_.m_ids[i], state));
+				m_hierarchy->add(node);
+			}
+			m_nextNodeId = APT_MAX(m_nextNodeId, _bin_.m_ids[i] + 1);
+		} else {
+		 // the partition root replaces the file root, nodes remain unreachable until it's attached (see NodeHierarchy)
+			if (i == 0) {
+				type  = Node::Type_Object;
+				name  = _partitionName;
+				state = Node::State_Active | Node::State_Dynamic;
+			}
+			node = m_nodePool.alloc(Node(type, m_nextNodeId++, state));
+			m_hierarchy->addUnreachable(node);
+		}
+		m_hierarchy->setName(node, name);
+		if (parent) {
+			m_hierarchy->link(node->m_index, parent->m_index);
+		}
+		if (node != m_root) {
+			m_nodes[type].push_back(node);
+		}
+		node->m_userData = _bin_.m_userData[i];
+		m_hierarchy->appendXForms(node, _bin_.m_slots.data() + _bin_.m_slotOffsets[i], _bin_.m_slotOffsets[i + 1] - _bin_.m_slotOffsets[i]);
+		for (int j = 0; j < node->getXFormCount(); ++j) {
+			node->getXForm(j)->setNode(node);
+		}
+		m_hierarchy->indexNode(node);
+
+		uint32 index = node->m_index;
+		m_hierarchy->m_localPositions[index]    = _bin_.m_positions[i];
+		m_hierarchy->m_localOrientations[index] = _bin_.m_orientations[i];
+		m_hierarchy->m_localScales[index]       = _bin_.m_scales[i];
+	 // static nodes aren't visited by update() unless dirty, init the world matrix as Node::addChild() would
+		m_hierarchy->m_worldMatrices[index] = m_hierarchy->getLocalAffine(index);
+		if (parent || _parent) {
+			uint32 parentIndex = (parent ? parent : _parent)->m_index;
+			m_hierarchy->m_worldMatrices[index] = m_hierarchy->m_worldMatrices[parentIndex] * m_hierarchy->m_worldMatrices[index];
+		}
+		if (_partitionName) {
+		 // only nodes which are always dirty (see NodeHierarchy::setChanged()) need to be visited by the next update
+			if (node->m_xformCount == 0 && type != Node::Type_Camera) {
+				m_hierarchy->m_flags[index] &= ~NodeHierarchy::Flag_Dirty;
+			} else {
+				m_hierarchy->flagAncestors(node);
+			}
+		}
+
+		if (type == Node::Type_Light) {
+			Light* light = m_lightPool.alloc();
+			light->m_parent = node;
+			m_lights.push_back(light);
+			node->setSceneDataLight(light);
+		}
+		ctx.m_nodes.push_back(node);
+		if (nodeIds_) {
+			nodeIds_->push_back(node->m_id);
+		}
+		++count;
+	}
+
+ // xforms, all nodes must exist first as xforms may reference other nodes
+	while (count < _maxCount && _bin_.m_xformType < (uint32)_bin_.m_xformTypes.size()) {
+		BinFile::XFormType& xformType = _bin_.m_xformTypes[_bin_.m_xformType];
+		uint32 beg = _bin_.m_xform;
+		uint32 end = (uint32)APT_MIN((uint64)xformType.m_xforms.size(), (uint64)beg + (_maxCount - count));
+		xformType.m_codec->m_readBin(xformType.m_xforms.data() + beg, end - beg, ctx, xformType.m_payload + (uint64)xformType.m_codec->m_payloadSize * beg);
+		for (uint32 j = beg; j < end; ++j) {
+			m_hierarchy->addXForm(xformType.m_xforms[j]);
+		}
+		count += end - beg;
+		if (end == (uint32)xformType.m_xforms.size()) {
+			++_bin_.m_xformType;
+			_bin_.m_xform = 0;
+		} else {
+			_bin_.m_xform = end;
+		}
+	}
+
+ // cameras
+	if (count < _maxCount && !_bin_.m_complete) {
+		for (uint32 i = 0; i < header.m_cameraCount; ++i) {
+			const BinCamera& src = _bin_.m_cameras[i];
+			Node* node = ctx.m_nodes[src.m_node];
+			Camera* cam = m_cameraPool.alloc();
+			cam->m_parent      = node;
+			cam->m_projFlags   = src.m_projFlags;
+			cam->m_up          = src.m_up;
+			cam->m_down        = src.m_down;
+			cam->m_right       = src.m_right;
+			cam->m_left        = src.m_left;
+			cam->m_near        = src.m_near;
+			cam->m_far         = src.m_far;
+			cam->m_world       = src.m_world;
+			cam->m_aspectRatio = abs(cam->m_right - cam->m_left) / abs(cam->m_up - cam->m_down);
+			cam->m_projDirty   = true;
+			if (src.m_hasGpuBuffer) {
+				cam->updateGpuBuffer();
+			}
+			m_cameras.push_back(cam);
+			node->setSceneDataCamera(cam);
+		}
+		if (!_partitionName) {
+			Node* drawCameraNode = ctx.getNode(header.m_drawCamera);
+			Node* cullCameraNode = ctx.getNode(header.m_cullCamera);
+			m_drawCamera = drawCameraNode && drawCameraNode->m_type == Node::Type_Camera ? drawCameraNode->getSceneDataCamera() : nullptr;
+			m_cullCamera = cullCameraNode && cullCameraNode->m_type == Node::Type_Camera ? cullCameraNode->getSceneDataCamera() : nullptr;
+			if (m_cullCamera == nullptr) {
+				m_cullCamera = m_drawCamera;
+			}
+		}
+		_bin_.m_complete = true;
+	}
+
+	return _bin_.m_complete;
+}
+
+bool Scene::ReadBin(Scene& scene_, const char* _path)
+{
+	PROFILER_MARKER_CPU("#Scene::ReadBin");
+
+	BinFile* bin = OpenBin(_path);
+	if (!bin) {
+		return false;
+	}
+	Scene newScene(bin->m_header->m_nodeCount);
+	newScene.readBin(*bin, nullptr, nullptr, ~0u);
+	newScene.updateAutoNameCounters();
+	CloseBin(bin);
+	swap(newScene, scene_);
+	return true;
+}
+
+bool Scene::WriteBin(Scene& _scene, const char* _path)
+{
+	PROFILER_MARKER_CPU("#Scene::WriteBin");
+
+	eastl::vector<char> data(sizeof(BinHeader), 0);
+	auto Append = [&data](const void* _src, uint64 _size) -> uint64
+		{
+			uint64 offset = (data.size() + kBinAlignment - 1) & ~(kBinAlignment - 1);
+			data.resize(offset + _size, 0);
+			if (_size > 0) {
+				memcpy(data.data() + offset, _src, _size);
+			}
+			return offset;
+		};
+
+	eastl::vector<Node*>  nodes;
+	eastl::vector<uint32> parents;
+	nodes.reserve(_scene.m_hierarchy->getNodeCount());
+	parents.reserve(_scene.m_hierarchy->getNodeCount());
+	GatherNodes(_scene.m_root, kBinInvalidIndex, nodes, parents);
+	const uint32 nodeCount = (uint32)nodes.size();
+
+	XForm::BinContext ctx;
+	ctx.m_nodeIndices.reserve(nodeCount);
+	for (uint32 i = 0; i < nodeCount; ++i) {
+		ctx.m_nodeIndices[nodes[i]->m_id] = i;
+	}
+
+ // node table
+	eastl::vector<Node::Id> ids(nodeCount);
+	eastl::vector<uint32>   names(nodeCount);
+	eastl::vector<uint8>    types(nodeCount);
+	eastl::vector<uint8>    states(nodeCount);
+	eastl::vector<uint64>   userData(nodeCount);
+	eastl::vector<vec3>     positions(nodeCount);
+	eastl::vector<quat>     orientations(nodeCount);
+	eastl::vector<vec3>     scales(nodeCount);
+	eastl::vector<uint32>   xformCounts(nodeCount);
+	eastl::vector<BinCamera> cameras;
+	for (uint32 i = 0; i < nodeCount; ++i) {
+		const Node* node = nodes[i];
+		ids[i]          = node->m_id;
+		names[i]        = ctx.addString(node->getName());
+		types[i]        = (uint8)node->m_type;
+		states[i]       = node->m_state;
+		userData[i]     = node->m_userData;
+		positions[i]    = node->getLocalPosition();
+		orientations[i] = node->getLocalOrientation();
+		scales[i]       = node->getLocalScale();
+		xformCounts[i]  = (uint32)node->m_xformCount;
+
+		if (node->m_type == Node::Type_Camera && node->m_sceneData) {
+			const Camera* cam = node->getSceneDataCamera();
+			BinCamera bin;
+			memset(&bin, 0, sizeof(BinCamera));
+			bin.m_node         = i;
+			bin.m_projFlags    = cam->m_projFlags;
+			bin.m_up           = cam->m_up;
+			bin.m_down         = cam->m_down;
+			bin.m_right        = cam->m_right;
+			bin.m_left         = cam->m_left;
+			bin.m_near         = cam->m_near;
+			bin.m_far          = cam->m_far;
+			bin.m_world        = cam->m_world;
+			bin.m_hasGpuBuffer = cam->m_gpuBuffer != nullptr ? 1 : 0;
+			cameras.push_back(bin);
+		}
+	}
+
+ // group xforms by type
+	eastl::vector<const XForm::BinCodec*>        codecs;
+	eastl::vector<eastl::vector<const XForm*> >  xforms;
+	eastl::vector<eastl::vector<BinXFormRef> >   refs;
+	for (uint32 i = 0; i < nodeCount; ++i) {
+		Node* node = nodes[i];
+		for (uint32 j = 0; j < (uint32)node->getXFormCount(); ++j) {
+			const XForm* xform = node->getXForm((int)j);
+			const XForm::BinCodec* codec = XForm::FindBinCodec(xform->getClassRef()->getNameHash());
+			if (!codec) {
+				APT_LOG_ERR("Scene: XForm '%s' doesn't support the binary format (see XFORM_REGISTER_BIN)", xform->getName());
+				return false;
+			}
+			uint32 k = 0;
+			while (k < (uint32)codecs.size() && codecs[k] != codec) {
+				++k;
+			}
+			if (k == (uint32)codecs.size()) {
+				codecs.push_back(codec);
+				xforms.resize(codecs.size());
+				refs.resize(codecs.size());
+			}
+			BinXFormRef ref = { i, j };
+			xforms[k].push_back(xform);
+			refs[k].push_back(ref);
+		}
+	}
+	eastl::vector<BinXFormType> xformTypes(codecs.size());
+	eastl::vector<char> payload;
+	for (uint32 i = 0; i < (uint32)codecs.size(); ++i) {
+		const XForm::BinCodec* codec = codecs[i];
+		BinXFormType& xformType = xformTypes[i];
+		memset(&xformType, 0, sizeof(BinXFormType));
+		xformType.m_className     = ctx.addString(codec->m_className);
+		xformType.m_count         = (uint32)xforms[i].size();
+		xformType.m_payloadSize   = codec->m_payloadSize;
+		xformType.m_refOffset     = Append(refs[i].data(), sizeof(BinXFormRef) * refs[i].size());
+		payload.clear();
+		payload.resize(codec->m_payloadSize * xforms[i].size(), 0);
+		codec->m_writeBin(xforms[i].data(), xformType.m_count, ctx, payload.data());
+		xformType.m_payloadOffset = Append(payload.data(), payload.size());
+	}
+
+	BinHeader header;
+	memset(&header, 0, sizeof(BinHeader));
+	memcpy(header.m_magic, kBinMagic, sizeof(kBinMagic));
+	header.m_version           = kBinVersion;
+	header.m_nodeCount         = nodeCount;
+	header.m_xformTypeCount    = (uint32)xformTypes.size();
+	header.m_cameraCount       = (uint32)cameras.size();
+	header.m_drawCamera        = _scene.m_drawCamera ? ctx.getNodeIndex(_scene.m_drawCamera->m_parent) : kBinInvalidIndex;
+	header.m_cullCamera        = _scene.m_cullCamera ? ctx.getNodeIndex(_scene.m_cullCamera->m_parent) : kBinInvalidIndex;
+	header.m_idOffset          = Append(ids.data(),          sizeof(Node::Id) * nodeCount);
+	header.m_nameOffset        = Append(names.data(),        sizeof(uint32)   * nodeCount);
+	header.m_parentOffset      = Append(parents.data(),      sizeof(uint32)   * nodeCount);
+	header.m_typeOffset        = Append(types.data(),        sizeof(uint8)    * nodeCount);
+	header.m_stateOffset       = Append(states.data(),       sizeof(uint8)    * nodeCount);
+	header.m_userDataOffset    = Append(userData.data(),     sizeof(uint64)   * nodeCount);
+	header.m_positionOffset    = Append(positions.data(),    sizeof(vec3)     * nodeCount);
+	header.m_orientationOffset = Append(orientations.data(), sizeof(quat)     * nodeCount);
+	header.m_scaleOffset       = Append(scales.data(),       sizeof(vec3)     * nodeCount);
+	header.m_xformCountOffset  = Append(xformCounts.data(),  sizeof(uint32)   * nodeCount);
+	header.m_xformTypeOffset   = Append(xformTypes.data(),   sizeof(BinXFormType) * xformTypes.size());
+	header.m_cameraOffset      = Append(cameras.data(),      sizeof(BinCamera)    * cameras.size());
+	header.m_stringTableSize   = (uint32)ctx.m_strings.size();
+	header.m_stringTableOffset = Append(ctx.m_strings.data(), ctx.m_strings.size()); // last, xforms may add strings
+	header.m_fileSize          = data.size();
+	memcpy(data.data(), &header, sizeof(BinHeader));
+
+	File f;
+	f.setData(data.data(), (uint)data.size());
+	if (!FileSystem::Write(f, _path)) {
+		APT_LOG_ERR("Scene: Failed to write binary scene '%s'", _path);
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,312 @@
+#include "Scene.h"
+
+#include <frm/core/Profiler.h>
+
+#include <apt/log.h>
+#include <apt/memory.h>
+#include <apt/FileSystem.h>
+#include <apt/Time.h>
+
+#include <EASTL/algorithm.h>
+#include <EASTL/vector.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+using namespace frm;
+using namespace apt;
+
+// Nodes created/destroyed per step, the budget is checked between steps.
+static const uint32 kPartitionGrainSize = 64;
+
+struct Scene::Partition
+{
+	PathStr                  m_path;
+	Node::Id                 m_parentId;
+	std::atomic<int>         m_state;      // PartitionState, set by the loader thread when parsing completes.
+	BinFile*                 m_bin;        // Set by the loader thread, released once attached.
+	Node*                    m_root;       // Valid while attached.
+	eastl::vector<Node::Id>  m_nodeIds;    // Nodes created so far, in pre-order.
+	bool                     m_unload;     // Unload requested while loading.
+
+	Partition(): m_parentId(Node::kInvalidId), m_state(PartitionState_Loading), m_bin(nullptr), m_root(nullptr), m_unload(false) {}
+};
+
+namespace frm {
+
+// Background thread which parses queued partitions (Scene::OpenBin()), the thread is started by the first push(). The
+// Scene isn't accessed, the results are handed back via Partition::m_bin/m_state.
+class ScenePartitionLoader
+{
+public:
+	static ScenePartitionLoader& Get()
+	{
+		static ScenePartitionLoader s_instance;
+		return s_instance;
+	}
+
+	void push(Scene::Partition* _partition)
+	{
+		{	std::lock_guard<std::mutex> lock(m_mutex);
+			if (!m_thread.joinable()) {
+				m_thread = std::thread(&ScenePartitionLoader::threadMain, this);
+			}
+			m_queue.push_back(_partition);
+		}
+		m_wakeCondition.notify_one();
+	}
+
+	// Remove _partition from the queue, return false if parsing already started.
+	bool remove(Scene::Partition* _partition)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = eastl::find(m_queue.begin(), m_queue.end(), _partition);
+		if (it == m_queue.end()) {
+			return false;
+		}
+		m_queue.erase(it);
+		return true;
+	}
+
+	// Block until _partition isn't being parsed.
+	void wait(Scene::Partition* _partition)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_doneCondition.wait(lock, [this, _partition]{ return m_current != _partition; });
+	}
+
+private:
+	std::thread                        m_thread;
+	std::mutex                         m_mutex;
+	std::condition_variable            m_wakeCondition;
+	std::condition_variable            m_doneCondition;
+	eastl::vector<Scene::Partition*>   m_queue;
+	Scene::Partition*                  m_current  = nullptr;
+	bool                               m_shutdown = false;
+
+	~ScenePartitionLoader()
+	{
+		{	std::lock_guard<std::mutex> lock(m_mutex);
+			m_shutdown = true;
+		}
+		m_wakeCondition.notify_one();
+		if (m_thread.joinable()) {
+			m_thread.join();
+		}
+	}
+
+	void threadMain()
+	{
+		for (;;) {
+			Scene::Partition* partition;
+			{	std::unique_lock<std::mutex> lock(m_mutex);
+				m_wakeCondition.wait(lock, [this]{ return m_shutdown || !m_queue.empty(); });
+				if (m_shutdown) {
+					return;
+				}
+				partition = m_queue.front();
+				m_queue.erase(m_queue.begin());
+				m_current = partition;
+			}
+
+			Scene::BinFile* bin = Scene::OpenBin((const char*)partition->m_path);
+
+			{	std::lock_guard<std::mutex> lock(m_mutex);
+				partition->m_bin   = bin;
+				partition->m_state = bin ? Scene::PartitionState_Attaching : Scene::PartitionState_Error;
+				m_current = nullptr;
+			}
+			m_doneCondition.notify_all();
+		}
+	}
+
+}; // class ScenePartitionLoader
+
+} // namespace frm
+
+/*******************************************************************************
+
+                                   Scene
+
+*******************************************************************************/
+
+// PUBLIC
+
+Scene::PartitionId Scene::loadPartition(const char* _path, Node* _parent)
+{
+	if (!FileSystem::CompareExtension("bin", _path)) {
+		APT_LOG_ERR("Scene: Partition '%s' isn't a binary scene", _path);
+		return kInvalidPartitionId;
+	}
+	Partition* partition = APT_NEW(Partition);
+	partition->m_path.set(_path);
+	partition->m_parentId = (_parent ? _parent : m_root)->getId();
+	PartitionId ret = (PartitionId)m_partitions.size();
+	m_partitions.push_back(partition);
+	ScenePartitionLoader::Get().push(partition);
+	return ret;
+}
+
+void Scene::unloadPartition(PartitionId _id)
+{
+	Partition* partition = _id < (PartitionId)m_partitions.size() ? m_partitions[_id] : nullptr;
+	if (!partition || partition->m_unload) {
+		return;
+	}
+	partition->m_unload = true;
+	if (partition->m_state == PartitionState_Loading) {
+		if (ScenePartitionLoader::Get().remove(partition)) {
+			APT_DELETE(partition);
+			m_partitions[_id] = nullptr;
+		}
+	 // else unload once parsing completes (see updatePartitions())
+		return;
+	}
+	beginUnloadPartition(_id);
+}
+
+Scene::PartitionState Scene::getPartitionState(PartitionId _id) const
+{
+	const Partition* partition = _id < (PartitionId)m_partitions.size() ? m_partitions[_id] : nullptr;
+	return partition ? (PartitionState)partition->m_state.load() : PartitionState_Invalid;
+}
+
+Node* Scene::getPartitionRoot(PartitionId _id) const
+{
+	const Partition* partition = _id < (PartitionId)m_partitions.size() ? m_partitions[_id] : nullptr;
+	return partition ? partition->m_root : nullptr;
+}
+
+bool Scene::updatePartitions(float _budgetMs)
+{
+	if (m_partitions.empty()) {
+		return false;
+	}
+	PROFILER_MARKER_CPU("#Scene::updatePartitions");
+
+	bool ret = false;
+	Timestamp start = Time::GetTimestamp();
+	auto InBudget = [start, _budgetMs]() -> bool
+		{
+			return (Time::GetTimestamp() - start).asMilliseconds() < _budgetMs;
+		};
+	for (PartitionId id = 0; id < (PartitionId)m_partitions.size(); ++id) {
+		Partition* partition = m_partitions[id];
+		if (!partition) {
+			continue;
+		}
+		int state = partition->m_state;
+		if (state == PartitionState_Loading) {
+			ret = true;
+			continue;
+		}
+		if (partition->m_unload && state != PartitionState_Unloading) {
+		 // unload requested while loading
+			beginUnloadPartition(id);
+			partition = m_partitions[id];
+			if (!partition) {
+				continue;
+			}
+			state = partition->m_state;
+		}
+
+		if (state == PartitionState_Attaching) {
+			Node* parent = findNode(partition->m_parentId);
+			if (!parent) {
+				APT_LOG_ERR("Scene: Parent of partition '%s' was destroyed", (const char*)partition->m_path);
+				partition->m_unload = true;
+				beginUnloadPartition(id);
+				partition = m_partitions[id];
+				if (!partition) {
+					continue;
+				}
+				state = partition->m_state;
+			} else {
+				Node::NameStr name;
+				name.setf("#Partition%u", id);
+				bool complete = false;
+				while (!complete && InBudget()) {
+					complete = readBin(*partition->m_bin, (const char*)name, parent, kPartitionGrainSize, &partition->m_nodeIds);
+				}
+				if (complete) {
+				 // the nodes were created in pre-order, hence the subtree is moved into place without sorting the hierarchy
+					CloseBin(partition->m_bin);
+					partition->m_root = findNode(partition->m_nodeIds.front());
+					m_hierarchy->attach(partition->m_root, parent, (uint32)partition->m_nodeIds.size());
+				 // world matrices were initialized by readBin(), the subtree only needs to be updated if the parent moved
+				 // in the meantime, else only nodes which are always dirty are visited
+					NodeHierarchy& hierarchy = *m_hierarchy;
+					uint32 rootIndex = partition->m_root->m_index;
+					NodeHierarchy::Affine world = hierarchy.m_worldMatrices[parent->m_index] * hierarchy.getLocalAffine(rootIndex);
+					if (memcmp(&world, &hierarchy.m_worldMatrices[rootIndex], sizeof(world)) != 0) {
+						partition->m_root->setDirty();
+					} else if (hierarchy.m_flags[rootIndex] & (NodeHierarchy::Flag_Dirty | NodeHierarchy::Flag_ChildDirty)) {
+						hierarchy.flagAncestors(partition->m_root);
+					}
+					partition->m_state = state = PartitionState_Attached;
+				}
+			}
+		}
+
+		if (state == PartitionState_Unloading) {
+		 // reverse pre-order, hence children are destroyed before their parents
+			while (!partition->m_nodeIds.empty() && InBudget()) {
+				uint32 count = APT_MIN((uint32)partition->m_nodeIds.size(), kPartitionGrainSize);
+				for (uint32 i = 0; i < count; ++i) {
+					Node* node = findNode(partition->m_nodeIds.back());
+					if (node) {
+						releaseNode(node);
+					}
+					partition->m_nodeIds.pop_back();
+				}
+			}
+			if (partition->m_nodeIds.empty()) {
+				APT_DELETE(partition);
+				m_partitions[id] = nullptr;
+				continue;
+			}
+		}
+
+		ret |= state == PartitionState_Attaching || state == PartitionState_Unloading;
+	}
+	PROFILER_VALUE_CPU("#Scene partitions (ms)", (Time::GetTimestamp() - start).asMilliseconds(), Profiler::kFormatTimeMs);
+	return ret;
+}
+
+// PRIVATE
+
+void Scene::beginUnloadPartition(PartitionId _id)
+{
+	Partition* partition = m_partitions[_id];
+	APT_ASSERT(partition && partition->m_state != PartitionState_Loading);
+	if (partition->m_root) {
+		if (partition->m_root->getParent()) {
+			m_hierarchy->detach(partition->m_root);
+		}
+		partition->m_root = nullptr;
+	}
+	CloseBin(partition->m_bin);
+	if (partition->m_nodeIds.empty()) {
+		APT_DELETE(partition);
+		m_partitions[_id] = nullptr;
+		return;
+	}
+	partition->m_state = PartitionState_Unloading;
+}
+
+void Scene::releasePartitions()
+{
+	for (Partition*& partition : m_partitions) {
+		if (!partition) {
+			continue;
+		}
+		if (partition->m_state == PartitionState_Loading && !ScenePartitionLoader::Get().remove(partition)) {
+			ScenePartitionLoader::Get().wait(partition);
+		}
+		CloseBin(partition->m_bin);
+		APT_DELETE(partition);
+	}
+	m_partitions.clear();
+}
@@ -0,0 +1,411 @@
+#include "Skinning.h"
+
+#include <frm/core/MeshData.h>
+#include <frm/core/SkeletonAnimation.h>
+#include <frm/core/parallel.h>
+
+#include <apt/log.h>
+
+#include <cmath>
+#include <cstring>
+
+// SSE for the per-vertex math, AVX for the palette blend (8 floats per op).
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE__)
+	#define Skinning_SIMD 1
+	#include <xmmintrin.h>
+	#if defined(__AVX__)
+		#define Skinning_AVX 1
+		#include <immintrin.h>
+	#else
+		#define Skinning_AVX 0
+	#endif
+#else
+	#define Skinning_SIMD 0
+	#define Skinning_AVX 0
+#endif
+
+using namespace frm;
+using namespace apt;
+
+static const uint32 kSkinningGrainSize = 4 * 1024;
+
+// 4-wide float ops, the kernel is written once against these.
+#if Skinning_SIMD
+	typedef __m128 Float4;
+	static inline Float4 Float4Load(const float* _src)           { return _mm_loadu_ps(_src); }
+	static inline void   Float4Store(float* _dst, Float4 _v)     { _mm_storeu_ps(_dst, _v); }
+	static inline Float4 Float4Splat(float _f)                   { return _mm_set1_ps(_f); }
+	static inline Float4 Float4Zero()                            { return _mm_setzero_ps(); }
+	static inline Float4 Float4Add(Float4 _a, Float4 _b)         { return _mm_add_ps(_a, _b); }
+	static inline Float4 Float4Mul(Float4 _a, Float4 _b)         { return _mm_mul_ps(_a, _b); }
+#else
+	struct Float4 { float v[4]; };
+	static inline Float4 Float4Load(const float* _src)           { Float4 ret; memcpy(ret.v, _src, sizeof(ret.v)); return ret; }
+	static inline void   Float4Store(float* _dst, Float4 _v)     { memcpy(_dst, _v.v, sizeof(_v.v)); }
+	static inline Float4 Float4Splat(float _f)                   { Float4 ret = {{ _f, _f, _f, _f }}; return ret; }
+	static inline Float4 Float4Zero()                            { return Float4Splat(0.0f); }
+	static inline Float4 Float4Add(Float4 _a, Float4 _b)         { for (int i = 0; i < 4; ++i) _a.v[i] += _b.v[i]; return _a; }
+	static inline Float4 Float4Mul(Float4 _a, Float4 _b)         { for (int i = 0; i < 4; ++i) _a.v[i] *= _b.v[i]; return _a; }
+#endif
+
+static inline vec3 Float4ToVec3(Float4 _v)
+{
+	float tmp[4];
+	Float4Store(tmp, _v);
+	return vec3(tmp[0], tmp[1], tmp[2]);
+}
+
+// Weighted sum of _count (<= 4) blocks of 16 (matrix) or 8 (dual quaternion) floats.
+template <int kFloatCount>
+static inline void Blend(const float* const* _src, const float* _weights, int _count, Float4 (&out_)[kFloatCount / 4])
+{
+#if Skinning_AVX
+	__m256 acc[kFloatCount / 8];
+	for (int j = 0; j < kFloatCount / 8; ++j) {
+		acc[j] = _mm256_setzero_ps();
+	}
+	for (int i = 0; i < _count; ++i) {
+		__m256 w = _mm256_set1_ps(_weights[i]);
+		for (int j = 0; j < kFloatCount / 8; ++j) {
+			acc[j] = _mm256_add_ps(acc[j], _mm256_mul_ps(w, _mm256_loadu_ps(_src[i] + j * 8)));
+		}
+	}
+	for (int j = 0; j < kFloatCount / 8; ++j) {
+		out_[j * 2 + 0] = _mm256_castps256_ps128(acc[j]);
+		out_[j * 2 + 1] = _mm256_extractf128_ps(acc[j], 1);
+	}
+#else
+	for (int j = 0; j < kFloatCount / 4; ++j) {
+		out_[j] = Float4Zero();
+	}
+	for (int i = 0; i < _count; ++i) {
+		Float4 w = Float4Splat(_weights[i]);
+		for (int j = 0; j < kFloatCount / 4; ++j) {
+			out_[j] = Float4Add(out_[j], Float4Mul(w, Float4Load(_src[i] + j * 4)));
+		}
+	}
+#endif
+}
+
+// Vertices with no influences (all weights zero) are skinned by the identity, i.e. keep their bind pose.
+static const float kIdentityMatrix[16]  = { 1.0f, 0.0f, 0.0f, 0.0f,  0.0f, 1.0f, 0.0f, 0.0f,  0.0f, 0.0f, 1.0f, 0.0f,  0.0f, 0.0f, 0.0f, 1.0f };
+static const float kIdentityDualQuat[8] = { 0.0f, 0.0f, 0.0f, 1.0f,  0.0f, 0.0f, 0.0f, 0.0f };
+
+// Rigid transform as a dual quaternion, xyz = vector part, w = scalar part.
+struct DualQuat
+{
+	vec4 m_real;
+	vec4 m_dual;
+};
+
+static inline vec4 QuatMul(const vec4& _a, const vec4& _b)
+{
+	return vec4(
+		_a.w * _b.x + _a.x * _b.w + _a.y * _b.z - _a.z * _b.y,
+		_a.w * _b.y - _a.x * _b.z + _a.y * _b.w + _a.z * _b.x,
+		_a.w * _b.z + _a.x * _b.y - _a.y * _b.x + _a.z * _b.w,
+		_a.w * _b.w - _a.x * _b.x - _a.y * _b.y - _a.z * _b.z
+		);
+}
+
+static DualQuat ToDualQuat(const mat4& _m)
+{
+ // remove scale, then extract the rotation (Shepperd's method)
+	vec3 c0 = normalize(vec3(_m[0].x, _m[0].y, _m[0].z));
+	vec3 c1 = normalize(vec3(_m[1].x, _m[1].y, _m[1].z));
+	vec3 c2 = normalize(vec3(_m[2].x, _m[2].y, _m[2].z));
+	float trace = c0.x + c1.y + c2.z;
+	vec4 q;
+	if (trace > 0.0f) {
+		float s = sqrtf(trace + 1.0f) * 2.0f;
+		q = vec4((c1.z - c2.y) / s, (c2.x - c0.z) / s, (c0.y - c1.x) / s, 0.25f * s);
+	} else if (c0.x > c1.y && c0.x > c2.z) {
+		float s = sqrtf(1.0f + c0.x - c1.y - c2.z) * 2.0f;
+		q = vec4(0.25f * s, (c1.x + c0.y) / s, (c2.x + c0.z) / s, (c1.z - c2.y) / s);
+	} else if (c1.y > c2.z) {
+		float s = sqrtf(1.0f + c1.y - c0.x - c2.z) * 2.0f;
+		q = vec4((c1.x + c0.y) / s, 0.25f * s, (c2.y + c1.z) / s, (c2.x - c0.z) / s);
+	} else {
+		float s = sqrtf(1.0f + c2.z - c0.x - c1.y) * 2.0f;
+		q = vec4((c2.x + c0.z) / s, (c2.y + c1.z) / s, 0.25f * s, (c0.y - c1.x) / s);
+	}
+	q = normalize(q);
+	DualQuat ret;
+	ret.m_real = q;
+	ret.m_dual = QuatMul(vec4(_m[3].x, _m[3].y, _m[3].z, 0.0f), q) * 0.5f;
+	return ret;
+}
+
+static inline vec3 QuatRotate(const vec3& _v, const vec3& _qv, float _qs)
+{
+	return _v + cross(_qv, cross(_qv, _v) + _v * _qs) * 2.0f;
+}
+
+namespace {
+
+// Writers receive the skinned attributes for each vertex; vertex ranges are disjoint between threads.
+struct StreamWriter
+{
+	const Skinning::Streams& m_streams;
+
+	StreamWriter(const Skinning::Streams& _streams): m_streams(_streams) {}
+
+	bool writePositions() const { return m_streams.m_positions[0] != nullptr; }
+	bool writeNormals() const   { return m_streams.m_normals[0]   != nullptr; }
+	bool writeTangents() const  { return m_streams.m_tangents[0]  != nullptr; }
+
+	static void Write(float* const* _streams, uint32 _i, const vec3& _v)
+	{
+		_streams[0][_i] = _v.x;
+		_streams[1][_i] = _v.y;
+		_streams[2][_i] = _v.z;
+	}
+	void position(uint32 _i, const vec3& _v) const { Write(m_streams.m_positions, _i, _v); }
+	void normal(uint32 _i, const vec3& _v) const   { Write(m_streams.m_normals,   _i, _v); }
+	void tangent(uint32 _i, const vec3& _v) const  { Write(m_streams.m_tangents,  _i, _v); }
+};
+
+struct VertexWriter
+{
+	char*             m_data;
+	uint32            m_stride;
+	const VertexAttr* m_positions;
+	const VertexAttr* m_normals;
+	const VertexAttr* m_tangents;
+
+	static const VertexAttr* Find(const MeshDesc& _desc, VertexAttr::Semantic _semantic)
+	{
+		const VertexAttr* ret = _desc.findVertexAttr(_semantic);
+		return ret && ret->getEncoding() == VertexAttr::Encoding_None && ret->getCount() >= 3 ? ret : nullptr;
+	}
+
+	VertexWriter(const MeshDesc& _desc, void* _data)
+		: m_data((char*)_data)
+		, m_stride(_desc.getVertexSize())
+	{
+		APT_ASSERT(!_desc.isPositionQuantized());
+		m_positions = Find(_desc, VertexAttr::Semantic_Positions);
+		m_normals   = Find(_desc, VertexAttr::Semantic_Normals);
+		m_tangents  = Find(_desc, VertexAttr::Semantic_Tangents);
+	}
+
+	bool writePositions() const { return m_positions != nullptr; }
+	bool writeNormals() const   { return m_normals   != nullptr; }
+	bool writeTangents() const  { return m_tangents  != nullptr; }
+
+	void write(const VertexAttr* _attr, uint32 _i, const vec3& _v) const
+	{
+		char* dst = m_data + (size_t)_i * m_stride + _attr->getOffset();
+		if (_attr->getDataType() == DataType_Float32) {
+			memcpy(dst, &_v.x, sizeof(float) * 3);
+		} else {
+			DataTypeConvert(DataType_Float32, _attr->getDataType(), &_v.x, dst, 3);
+		}
+	}
+	void position(uint32 _i, const vec3& _v) const { write(m_positions, _i, _v); }
+	void normal(uint32 _i, const vec3& _v) const   { write(m_normals,   _i, _v); }
+	void tangent(uint32 _i, const vec3& _v) const  { write(m_tangents,  _i, _v); }
+};
+
+} // namespace
+
+/*******************************************************************************
+
+                                   Skinning
+
+*******************************************************************************/
+
+// PUBLIC
+
+Skinning::Streams::Streams()
+{
+	memset(this, 0, sizeof(Streams));
+}
+
+Skinning* Skinning::Create(const MeshData& _meshData)
+{
+	const MeshDesc& desc = _meshData.getDesc();
+	if (!desc.findVertexAttr(VertexAttr::Semantic_BoneWeights) || !desc.findVertexAttr(VertexAttr::Semantic_BoneIndices)) {
+		APT_LOG_ERR("Skinning: Mesh has no bone weights/indices");
+		return nullptr;
+	}
+
+	MeshBuilder meshBuilder;
+	meshBuilder.beginSubmesh(0);
+	meshBuilder.addVertexData(desc, _meshData.getVertexData(), _meshData.getVertexCount());
+	meshBuilder.endSubmesh();
+
+	Skinning* ret = new Skinning;
+	ret->m_vertexCount = meshBuilder.getVertexCount();
+	ret->m_hasNormals  = desc.findVertexAttr(VertexAttr::Semantic_Normals)  != nullptr;
+	ret->m_hasTangents = desc.findVertexAttr(VertexAttr::Semantic_Tangents) != nullptr;
+	ret->m_positions.resize(ret->m_vertexCount);
+	ret->m_normals.resize(ret->m_hasNormals ? ret->m_vertexCount : 0);
+	ret->m_tangents.resize(ret->m_hasTangents ? ret->m_vertexCount : 0);
+	ret->m_boneWeights.resize(ret->m_vertexCount);
+	ret->m_boneIndices.resize(ret->m_vertexCount);
+	for (uint32 i = 0; i < ret->m_vertexCount; ++i) {
+		const MeshBuilder::Vertex& vertex = meshBuilder.getVertex(i);
+		ret->m_positions[i] = vec4(vertex.m_position, 1.0f);
+		if (ret->m_hasNormals) {
+			ret->m_normals[i] = vec4(vertex.m_normal, 0.0f);
+		}
+		if (ret->m_hasTangents) {
+			ret->m_tangents[i] = vec4(vertex.m_tangent.x, vertex.m_tangent.y, vertex.m_tangent.z, 0.0f);
+		}
+		ret->m_boneWeights[i] = vertex.m_boneWeights;
+		ret->m_boneIndices[i] = vertex.m_boneIndices;
+		for (int j = 0; j < 4; ++j) {
+			if (vertex.m_boneWeights[j] != 0.0f) {
+				ret->m_boneCount = APT_MAX(ret->m_boneCount, vertex.m_boneIndices[j] + 1);
+			}
+		}
+	}
+	return ret;
+}
+
+void Skinning::Destroy(Skinning*& _skinning_)
+{
+	delete _skinning_;
+	_skinning_ = nullptr;
+}
+
+void Skinning::GetPalette(const Skeleton& _pose, const Skeleton& _bindPose, mat4* out_)
+{
+	APT_ASSERT(_pose.getBoneCount() == _bindPose.getBoneCount());
+	for (int i = 0; i < _pose.getBoneCount(); ++i) {
+		out_[i] = _pose.getPose()[i] * _bindPose.getPose()[i];
+	}
+}
+
+void Skinning::skin(const mat4* _palette, Mode _mode, const Streams& out_) const
+{
+	StreamWriter writer(out_);
+	skinVertices(_palette, _mode, writer);
+}
+
+void Skinning::skin(const mat4* _palette, Mode _mode, const MeshDesc& _desc, void* out_) const
+{
+	VertexWriter writer(_desc, out_);
+	skinVertices(_palette, _mode, writer);
+}
+
+// PRIVATE
+
+Skinning::Skinning()
+	: m_vertexCount(0)
+	, m_boneCount(0)
+	, m_hasNormals(false)
+	, m_hasTangents(false)
+{
+}
+
+Skinning::~Skinning()
+{
+}
+
+template <typename tWriter>
+void Skinning::skinVertices(const mat4* _palette, Mode _mode, tWriter& _writer) const
+{
+	const bool writePositions = _writer.writePositions();
+	const bool writeNormals   = _writer.writeNormals()  && m_hasNormals;
+	const bool writeTangents  = _writer.writeTangents() && m_hasTangents;
+
+	if (_mode == Mode_Linear) {
+		ParallelFor(m_vertexCount, kSkinningGrainSize, [&](uint32 _begin, uint32 _end)
+			{
+				for (uint32 i = _begin; i < _end; ++i) {
+				 // blend the matrix columns, skip zero weights (most vertices have < 4 influences)
+					const float* src[4];
+					float        weights[4];
+					int          count = 0;
+					for (int j = 0; j < 4; ++j) {
+						if (m_boneWeights[i][j] != 0.0f) {
+							src[count]     = &_palette[m_boneIndices[i][j]][0].x;
+							weights[count] = m_boneWeights[i][j];
+							++count;
+						}
+					}
+					if (count == 0) {
+						src[0]     = kIdentityMatrix;
+						weights[0] = 1.0f;
+						count      = 1;
+					}
+					Float4 m[4];
+					Blend<16>(src, weights, count, m);
+
+					if (writePositions) {
+						const vec4& p = m_positions[i];
+						Float4 r = Float4Add(Float4Add(Float4Mul(m[0], Float4Splat(p.x)), Float4Mul(m[1], Float4Splat(p.y))), Float4Add(Float4Mul(m[2], Float4Splat(p.z)), m[3]));
+						_writer.position(i, Float4ToVec3(r));
+					}
+					if (writeNormals) {
+						const vec4& n = m_normals[i];
+						Float4 r = Float4Add(Float4Add(Float4Mul(m[0], Float4Splat(n.x)), Float4Mul(m[1], Float4Splat(n.y))), Float4Mul(m[2], Float4Splat(n.z)));
+						_writer.normal(i, normalize(Float4ToVec3(r)));
+					}
+					if (writeTangents) {
+						const vec4& t = m_tangents[i];
+						Float4 r = Float4Add(Float4Add(Float4Mul(m[0], Float4Splat(t.x)), Float4Mul(m[1], Float4Splat(t.y))), Float4Mul(m[2], Float4Splat(t.z)));
+						_writer.tangent(i, normalize(Float4ToVec3(r)));
+					}
+				}
+			});
+		return;
+	}
+
+	APT_ASSERT(_mode == Mode_DualQuaternion);
+	eastl::vector<DualQuat> dualQuats(m_boneCount);
+	for (uint32 i = 0; i < m_boneCount; ++i) {
+		dualQuats[i] = ToDualQuat(_palette[i]);
+	}
+	ParallelFor(m_vertexCount, kSkinningGrainSize, [&](uint32 _begin, uint32 _end)
+		{
+			for (uint32 i = _begin; i < _end; ++i) {
+			 // blend, flip weights for quaternions in the opposite hemisphere to the first influence
+				const float* src[4];
+				float        weights[4];
+				int          count = 0;
+				const vec4*  pivot = nullptr;
+				for (int j = 0; j < 4; ++j) {
+					if (m_boneWeights[i][j] != 0.0f) {
+						const DualQuat& dq = dualQuats[m_boneIndices[i][j]];
+						pivot = pivot ? pivot : &dq.m_real;
+						src[count]     = &dq.m_real.x;
+						weights[count] = dot(*pivot, dq.m_real) < 0.0f ? -m_boneWeights[i][j] : m_boneWeights[i][j];
+						++count;
+					}
+				}
+				if (count == 0) {
+					src[0]     = kIdentityDualQuat;
+					weights[0] = 1.0f;
+					count      = 1;
+				}
+				Float4 dq[2];
+				Blend<8>(src, weights, count, dq);
+				float tmp[8];
+				Float4Store(tmp + 0, dq[0]);
+				Float4Store(tmp + 4, dq[1]);
+				float len = sqrtf(tmp[0] * tmp[0] + tmp[1] * tmp[1] + tmp[2] * tmp[2] + tmp[3] * tmp[3]);
+				len = len > 0.0f ? 1.0f / len : 0.0f;
+				const vec3  rv(tmp[0] * len, tmp[1] * len, tmp[2] * len);
+				const float rs = tmp[3] * len;
+				const vec3  dv(tmp[4] * len, tmp[5] * len, tmp[6] * len);
+				const float ds = tmp[7] * len;
+
+				if (writePositions) {
+					const vec4& p = m_positions[i];
+					vec3 translation = (dv * rs - rv * ds + cross(rv, dv)) * 2.0f;
+					_writer.position(i, QuatRotate(vec3(p.x, p.y, p.z), rv, rs) + translation);
+				}
+				if (writeNormals) {
+					const vec4& n = m_normals[i];
+					_writer.normal(i, QuatRotate(vec3(n.x, n.y, n.z), rv, rs));
+				}
+				if (writeTangents) {
+					const vec4& t = m_tangents[i];
+					_writer.tangent(i, QuatRotate(vec3(t.x, t.y, t.z), rv, rs));
+				}
+			}
+		});
+}
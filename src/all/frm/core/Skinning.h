@@ -0,0 +1,91 @@
+#pragma once
+#ifndef frm_Skinning_h
+#define frm_Skinning_h
+
+#include <frm/core/def.h>
+#include <frm/core/math.h>
+
+#include <EASTL/vector.h>
+
+namespace frm {
+
+class MeshData;
+class MeshDesc;
+class Skeleton;
+
+////////////////////////////////////////////////////////////////////////////////
+// Skinning
+// CPU vertex skinning, e.g. for tools, ray queries against an animated mesh or
+// headless validation of the skinning shaders.
+// Create() decodes the bind pose positions/normals/tangents and the bone
+// weights/indices of a MeshData once, skin() then transforms all vertices by a
+// palette of bone matrices (see GetPalette()). The kernel is vectorized (SSE,
+// AVX for the palette blend where available) and split across the ParallelFor
+// worker threads.
+// Mode_DualQuaternion ignores any scale in the palette. Vertices whose bone
+// weights are all zero keep their bind pose.
+////////////////////////////////////////////////////////////////////////////////
+class Skinning: private apt::non_copyable<Skinning>
+{
+public:
+	enum Mode
+	{
+		Mode_Linear,
+		Mode_DualQuaternion,
+
+		Mode_Count
+	};
+
+	// Planar output, each non-null stream receives getVertexCount() floats. Set a semantic's streams to nullptr to
+	// skip it.
+	struct Streams
+	{
+		float* m_positions[3];
+		float* m_normals[3];
+		float* m_tangents[3];
+
+		Streams();
+	};
+
+	// Return nullptr if _meshData has no bone weights/indices.
+	static Skinning* Create(const MeshData& _meshData);
+	static void      Destroy(Skinning*& _skinning_);
+
+	// Skinning palette, _pose * _bindPose (the bind pose is stored inverted, see MeshData::getBindPose()).
+	static void      GetPalette(const Skeleton& _pose, const Skeleton& _bindPose, mat4* out_);
+
+	// Skin all vertices, _palette must contain at least getBoneCount() matrices.
+	void skin(const mat4* _palette, Mode _mode, const Streams& out_) const;
+	// As skin(), but write to a vertex buffer with layout _desc (e.g. a copy of the source vertex data). Only the
+	// xyz components of the positions/normals/tangents are written. Positions must not be quantized, encoded
+	// attributes are skipped.
+	void skin(const mat4* _palette, Mode _mode, const MeshDesc& _desc, void* out_) const;
+
+	uint32 getVertexCount() const { return m_vertexCount; }
+	uint32 getBoneCount() const   { return m_boneCount; }
+	bool   hasNormals() const     { return m_hasNormals; }
+	bool   hasTangents() const    { return m_hasTangents; }
+
+private:
+	// Bind pose, w = 1 for positions and 0 for normals/tangents such that the kernel can load 4 floats per vertex.
+	eastl::vector<vec4>   m_positions;
+	eastl::vector<vec4>   m_normals;
+	eastl::vector<vec4>   m_tangents;
+	eastl::vector<vec4>   m_boneWeights;
+	eastl::vector<uvec4>  m_boneIndices;
+	uint32                m_vertexCount;
+	uint32                m_boneCount;   // max bone index + 1
+	bool                  m_hasNormals;
+	bool                  m_hasTangents;
+
+	Skinning();
+	~Skinning();
+
+	template <typename tWriter>
+	void skinVertices(const mat4* _palette, Mode _mode, tWriter& _writer) const;
+
+}; // class Skinning
+
+} // namespace frm
+
+#endif // frm_Skinning_h
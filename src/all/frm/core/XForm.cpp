@@ -85,6 +85,120 @@ bool XForm::SerializeCallback(Serializer& _serializer_, OnComplete*& _callback,
 	}
 }
 
+eastl::vector<const XForm::Batch*> XForm::s_batchRegistry;
+
+XForm::Batch::Batch(const char* _className, ApplyAllFunc* _applyAll, BatchOp _op)
+	: m_className(_className)
+	, m_classNameHash(_className)
+	, m_applyAll(_applyAll)
+	, m_op(_op)
+	, m_index((int)s_batchRegistry.size())
+{
+	for (auto& batch : s_batchRegistry) {
+		if (batch->m_classNameHash == m_classNameHash) {
+			APT_LOG_ERR("XForm: Batch '%s' already exists", _className);
+			APT_ASSERT(false);
+			return;
+		}
+	}
+	s_batchRegistry.push_back(this);
+}
+
+int XForm::GetBatchCount()
+{
+	return (int)s_batchRegistry.size();
+}
+const XForm::Batch* XForm::GetBatch(int _i)
+{
+	return s_batchRegistry[_i];
+}
+const XForm::Batch* XForm::FindBatch(const ClassRef* _classRef)
+{
+	if (_classRef) {
+		for (auto& ret : s_batchRegistry) {
+			if (ret->m_classNameHash == _classRef->getNameHash()) {
+				return ret;
+			}
+		}
+	}
+	return nullptr;
+}
+
+uint32 XForm::BinContext::getNodeIndex(const Node* _node) const
+{
+	return _node ? getNodeIndex(_node->getId()) : kBinInvalidIndex;
+}
+uint32 XForm::BinContext::getNodeIndex(uint64 _nodeId) const
+{
+	auto it = m_nodeIndices.find(_nodeId);
+	return it == m_nodeIndices.end() ? kBinInvalidIndex : it->second;
+}
+Node* XForm::BinContext::getNode(uint32 _index) const
+{
+	return _index < (uint32)m_nodes.size() ? m_nodes[_index] : nullptr;
+}
+uint32 XForm::BinContext::addString(const char* _str)
+{
+	uint64 hash = StringHash(_str).getHash();
+	auto it = m_stringOffsets.find(hash);
+	if (it != m_stringOffsets.end()) {
+		return it->second;
+	}
+	uint32 ret = (uint32)m_strings.size();
+	m_strings.insert(m_strings.end(), _str, _str + strlen(_str) + 1);
+	m_stringOffsets[hash] = ret;
+	return ret;
+}
+const char* XForm::BinContext::getString(uint32 _offset) const
+{
+	return _offset < m_stringTableSize ? m_stringTable + _offset : nullptr;
+}
+uint32 XForm::BinContext::addCallback(OnComplete* _callback)
+{
+	const Callback* cbk = _callback ? FindCallback(_callback) : nullptr;
+	return cbk ? addString(cbk->m_name) : kBinInvalidIndex;
+}
+XForm::OnComplete* XForm::BinContext::getCallback(uint32 _offset) const
+{
+	const char* name = getString(_offset);
+	if (!name) {
+		return nullptr;
+	}
+	const Callback* cbk = FindCallback(StringHash(name));
+	if (cbk == nullptr) {
+		APT_LOG_ERR("XForm: Invalid callback '%s'", name);
+		return nullptr;
+	}
+	return cbk->m_callback;
+}
+
+eastl::vector<const XForm::BinCodec*> XForm::s_binCodecRegistry;
+
+XForm::BinCodec::BinCodec(const char* _className, uint32 _payloadSize, WriteBinFunc* _writeBin, ReadBinFunc* _readBin)
+	: m_className(_className)
+	, m_classNameHash(_className)
+	, m_payloadSize(_payloadSize)
+	, m_writeBin(_writeBin)
+	, m_readBin(_readBin)
+{
+	if (FindBinCodec(m_classNameHash) != nullptr) {
+		APT_LOG_ERR("XForm: BinCodec '%s' already exists", _className);
+		APT_ASSERT(false);
+		return;
+	}
+	s_binCodecRegistry.push_back(this);
+}
+
+const XForm::BinCodec* XForm::FindBinCodec(StringHash _classNameHash)
+{
+	for (auto& ret : s_binCodecRegistry) {
+		if (ret->m_classNameHash == _classNameHash) {
+			return ret;
+		}
+	}
+	return nullptr;
+}
+
 
 /*******************************************************************************
 
@@ -92,6 +206,8 @@ bool XForm::SerializeCallback(Serializer& _serializer_, OnComplete*& _callback,
 
 *******************************************************************************/
 APT_FACTORY_REGISTER_DEFAULT(XForm, XForm_PositionOrientationScale);
+XFORM_REGISTER_BATCH(XForm_PositionOrientationScale, BatchOp_PostMultiply);
+XFORM_REGISTER_BIN(XForm_PositionOrientationScale);
 
 void XForm_PositionOrientationScale::apply(float _dt)
 {
@@ -99,6 +215,14 @@ void XForm_PositionOrientationScale::apply(float _dt)
 	m_node->setWorldMatrix(m_node->getWorldMatrix() * mat);
 }
 
+void XForm_PositionOrientationScale::ApplyAll(XForm* const* _xforms, uint32 _count, float _dt)
+{
+	for (uint32 i = 0; i < _count; ++i) {
+		XForm_PositionOrientationScale* xform = (XForm_PositionOrientationScale*)_xforms[i];
+		xform->m_batchMatrix = TransformationMatrix(xform->m_position, xform->m_orientation, xform->m_scale);
+	}
+}
+
 bool XForm_PositionOrientationScale::edit()
 {
 	bool ret = false;
@@ -133,12 +257,27 @@ bool XForm_PositionOrientationScale::serialize(Serializer& _serializer_)
 	return ret;
 }
 
+void XForm_PositionOrientationScale::toBin(Bin& out_, BinContext& _ctx_) const
+{
+	out_.m_position    = m_position;
+	out_.m_orientation = m_orientation;
+	out_.m_scale       = m_scale;
+}
+
+void XForm_PositionOrientationScale::fromBin(const Bin& _bin, const BinContext& _ctx)
+{
+	m_position    = _bin.m_position;
+	m_orientation = _bin.m_orientation;
+	m_scale       = _bin.m_scale;
+}
+
 /*******************************************************************************
 
                                 XForm_FreeCamera
 
 *******************************************************************************/
 APT_FACTORY_REGISTER_DEFAULT(XForm, XForm_FreeCamera);
+XFORM_REGISTER_BIN(XForm_FreeCamera);
 
 void XForm_FreeCamera::apply(float _dt)
 {
@@ -146,7 +285,7 @@ void XForm_FreeCamera::apply(float _dt)
 		return;
 	}
 
-	const mat4& localMatrix = m_node->getLocalMatrix();
+	mat4 localMatrix = m_node->getLocalMatrix();
 
 	const Gamepad* gpad = Input::GetGamepad();
 	const Keyboard* keyb = Input::GetKeyboard();
@@ -228,7 +367,9 @@ void XForm_FreeCamera::apply(float _dt)
 	m_orientation   = qmul(qmul(qmul(qyaw, qpitch), qroll), m_orientation);
 	m_pitchYawRoll *= powf(m_rotationDamp, _dt);
 
-	m_node->setLocalMatrix(TransformationMatrix(m_position, m_orientation));
+	m_node->setLocalPosition(m_position);
+	m_node->setLocalOrientation(m_orientation);
+	m_node->setLocalScale(vec3(1.0f));
 	
 }
 
@@ -268,12 +409,35 @@ bool XForm_FreeCamera::serialize(Serializer& _serializer_)
 	return ret;
 }
 
+void XForm_FreeCamera::toBin(Bin& out_, BinContext& _ctx_) const
+{
+	out_.m_position         = m_position;
+	out_.m_orientation      = m_orientation;
+	out_.m_maxSpeed         = m_maxSpeed;
+	out_.m_maxSpeedMul      = m_maxSpeedMul;
+	out_.m_accelTime        = m_accelTime;
+	out_.m_rotationInputMul = m_rotationInputMul;
+	out_.m_rotationDamp     = m_rotationDamp;
+}
+
+void XForm_FreeCamera::fromBin(const Bin& _bin, const BinContext& _ctx)
+{
+	m_position         = _bin.m_position;
+	m_orientation      = _bin.m_orientation;
+	m_maxSpeed         = _bin.m_maxSpeed;
+	m_maxSpeedMul      = _bin.m_maxSpeedMul;
+	m_accelTime        = _bin.m_accelTime;
+	m_rotationInputMul = _bin.m_rotationInputMul;
+	m_rotationDamp     = _bin.m_rotationDamp;
+}
+
 /*******************************************************************************
 
                                  XForm_LookAt
 
 *******************************************************************************/
 APT_FACTORY_REGISTER_DEFAULT(XForm, XForm_LookAt);
+XFORM_REGISTER_BIN(XForm_LookAt);
 
 void XForm_LookAt::apply(float _dt)
 {
@@ -321,12 +485,27 @@ bool XForm_LookAt::serialize(Serializer& _serializer_)
 	return ret;
 }
 
+void XForm_LookAt::toBin(Bin& out_, BinContext& _ctx_) const
+{
+	out_.m_offset = m_offset;
+	out_.m_target = _ctx_.getNodeIndex(m_targetId);
+}
+
+void XForm_LookAt::fromBin(const Bin& _bin, const BinContext& _ctx)
+{
+	m_offset   = _bin.m_offset;
+	m_target   = _ctx.getNode(_bin.m_target);
+	m_targetId = m_target ? m_target->getId() : Node::kInvalidId;
+}
+
 /*******************************************************************************
 
                                 XForm_Spin
 
 *******************************************************************************/
 APT_FACTORY_REGISTER_DEFAULT(XForm, XForm_Spin);
+XFORM_REGISTER_BATCH(XForm_Spin, BatchOp_PostMultiply);
+XFORM_REGISTER_BIN(XForm_Spin);
 
 void XForm_Spin::apply(float _dt)
 {
@@ -334,6 +513,15 @@ void XForm_Spin::apply(float _dt)
 	m_node->setWorldMatrix(m_node->getWorldMatrix() * RotationMatrix(m_axis, m_rotation));
 }
 
+void XForm_Spin::ApplyAll(XForm* const* _xforms, uint32 _count, float _dt)
+{
+	for (uint32 i = 0; i < _count; ++i) {
+		XForm_Spin* xform = (XForm_Spin*)_xforms[i];
+		xform->m_rotation += xform->m_rate * _dt;
+		xform->m_batchMatrix = RotationMatrix(xform->m_axis, xform->m_rotation);
+	}
+}
+
 bool XForm_Spin::edit()
 {
 	bool ret = false;
@@ -364,12 +552,25 @@ bool XForm_Spin::serialize(Serializer& _serializer_)
 	return ret;
 }
 
+void XForm_Spin::toBin(Bin& out_, BinContext& _ctx_) const
+{
+	out_.m_axis = m_axis;
+	out_.m_rate = m_rate;
+}
+
+void XForm_Spin::fromBin(const Bin& _bin, const BinContext& _ctx)
+{
+	m_axis = _bin.m_axis;
+	m_rate = _bin.m_rate;
+}
+
 /*******************************************************************************
 
                               XForm_PositionTarget
 
 *******************************************************************************/
 APT_FACTORY_REGISTER_DEFAULT(XForm, XForm_PositionTarget);
+XFORM_REGISTER_BIN(XForm_PositionTarget);
 
 void XForm_PositionTarget::apply(float _dt)
 {
@@ -433,6 +634,22 @@ bool XForm_PositionTarget::serialize(Serializer& _serializer_)
 	return ret;
 }
 
+void XForm_PositionTarget::toBin(Bin& out_, BinContext& _ctx_) const
+{
+	out_.m_start      = m_start;
+	out_.m_end        = m_end;
+	out_.m_duration   = m_duration;
+	out_.m_onComplete = _ctx_.addCallback(m_onComplete);
+}
+
+void XForm_PositionTarget::fromBin(const Bin& _bin, const BinContext& _ctx)
+{
+	m_start      = _bin.m_start;
+	m_end        = _bin.m_end;
+	m_duration   = _bin.m_duration;
+	m_onComplete = _ctx.getCallback(_bin.m_onComplete);
+}
+
 void XForm_PositionTarget::reset()
 {
 	m_currentTime = 0.0f;
@@ -457,6 +674,7 @@ void XForm_PositionTarget::reverse()
 
 *******************************************************************************/
 APT_FACTORY_REGISTER_DEFAULT(XForm, XForm_SplinePath);
+XFORM_REGISTER_BIN(XForm_SplinePath);
 
 void XForm_SplinePath::apply(float _dt)
 {
@@ -496,6 +714,18 @@ bool XForm_SplinePath::serialize(Serializer& _serializer_)
 	return ret;
 }
 
+void XForm_SplinePath::toBin(Bin& out_, BinContext& _ctx_) const
+{
+	out_.m_duration   = m_duration;
+	out_.m_onComplete = _ctx_.addCallback(m_onComplete);
+}
+
+void XForm_SplinePath::fromBin(const Bin& _bin, const BinContext& _ctx)
+{
+	m_duration   = _bin.m_duration;
+	m_onComplete = _ctx.getCallback(_bin.m_onComplete);
+}
+
 void XForm_SplinePath::reset()
 {
 	m_currentTime = 0.0f;
@@ -513,8 +743,26 @@ void XForm_SplinePath::reverse()
 
 *******************************************************************************/
 APT_FACTORY_REGISTER_DEFAULT(XForm, XForm_OrbitalPath);
+XFORM_REGISTER_BATCH(XForm_OrbitalPath, BatchOp_Translate);
+XFORM_REGISTER_BIN(XForm_OrbitalPath);
 
 void XForm_OrbitalPath::apply(float _dt)
+{
+	vec3 offset = advance(_dt);
+	if (m_node) {
+		m_node->setWorldPosition(m_node->getWorldPosition() + offset);
+	}
+}
+
+void XForm_OrbitalPath::ApplyAll(XForm* const* _xforms, uint32 _count, float _dt)
+{
+	for (uint32 i = 0; i < _count; ++i) {
+		XForm_OrbitalPath* xform = (XForm_OrbitalPath*)_xforms[i];
+		xform->m_batchMatrix[3] = vec4(xform->advance(_dt), 1.0f);
+	}
+}
+
+vec3 XForm_OrbitalPath::advance(float _dt)
 {
 	m_theta = Fract(m_theta + m_speed * _dt);
 
@@ -544,9 +792,7 @@ void XForm_OrbitalPath::apply(float _dt)
 		));
 	m_direction = amat * bmat * tmat * vec3(1.0f, 0.0f, 0.0f);
 	m_normal = amat * bmat * vec3(0.0f, 1.0f, 0.0f);
-	if (m_node) {
-		m_node->setWorldPosition(m_node->getWorldPosition() + m_direction * m_radius);
-	}
+	return m_direction * m_radius;
 }
 
 bool XForm_OrbitalPath::edit()
@@ -588,6 +834,24 @@ bool XForm_OrbitalPath::serialize(Serializer& _serializer_)
 	return ret;
 }
 
+void XForm_OrbitalPath::toBin(Bin& out_, BinContext& _ctx_) const
+{
+	out_.m_azimuth   = m_azimuth;
+	out_.m_elevation = m_elevation;
+	out_.m_theta     = m_theta;
+	out_.m_radius    = m_radius;
+	out_.m_speed     = m_speed;
+}
+
+void XForm_OrbitalPath::fromBin(const Bin& _bin, const BinContext& _ctx)
+{
+	m_azimuth   = _bin.m_azimuth;
+	m_elevation = _bin.m_elevation;
+	m_theta     = _bin.m_theta;
+	m_radius    = _bin.m_radius;
+	m_speed     = _bin.m_speed;
+}
+
 void XForm_OrbitalPath::reset()
 {
 	m_theta = 0.0f;
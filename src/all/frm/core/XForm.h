@@ -8,6 +8,7 @@
 #include <apt/StringHash.h>
 #include <apt/Factory.h>
 
+#include <EASTL/hash_map.h>
 #include <EASTL/vector.h>
 
 namespace frm {
@@ -17,10 +18,49 @@ class Node;
 ////////////////////////////////////////////////////////////////////////////////
 // XForm
 // Base class/factory for XForms.
+//
+// Batched execution: a type may register a static ApplyAll() via
+// XFORM_REGISTER_BATCH. Instances of batched types are grouped per type by the
+// NodeHierarchy and ApplyAll() is called once per type before the hierarchy
+// pass, it should advance the state of each instance and write the result to
+// m_batchMatrix. During the hierarchy pass m_batchMatrix is combined with the
+// node's world matrix according to the batch op (applyBatched(), no virtual
+// call). The result must be identical to apply().
+//
+// Binary serialization: a type may register a fixed size payload (_class::Bin)
+// via XFORM_REGISTER_BIN, in which case the binary scene format stores its
+// instances grouped by type as arrays of payloads (see Scene_bin.cpp). The
+// payload is converted by the non-virtual _class::toBin()/fromBin(); node
+// references are stored as node table indices and strings as string table
+// offsets (see BinContext).
+// \note Batched xforms are advanced every update, irrespective of the node's
+//   state.
 ////////////////////////////////////////////////////////////////////////////////
 class XForm: public apt::Factory<XForm>
 {
 public:
+	typedef void (ApplyAllFunc)(XForm* const* _xforms, uint32 _count, float _dt);
+	enum BatchOp
+	{
+		BatchOp_PostMultiply, // world = world * m_batchMatrix
+		BatchOp_Translate,    // world position += m_batchMatrix[3]
+
+		BatchOp_Count
+	};
+	struct Batch
+	{
+		const char*     m_className;
+		apt::StringHash m_classNameHash;
+		ApplyAllFunc*   m_applyAll;
+		BatchOp         m_op;
+		int             m_index;          // In the batch registry, see GetBatch().
+
+		Batch(const char* _className, ApplyAllFunc* _applyAll, BatchOp _op);
+	};
+	static int             GetBatchCount();
+	static const Batch*    GetBatch(int _i);
+	static const Batch*    FindBatch(const ClassRef* _classRef);
+
 	typedef void (OnComplete)(XForm* _xform_);
 	struct Callback
 	{
@@ -36,6 +76,62 @@ public:
 	static const Callback* FindCallback(OnComplete* _callback);
 	static bool            SerializeCallback(apt::Serializer& _serializer_, OnComplete*& _callback, const char* _name);
 
+	static const uint32 kBinInvalidIndex = ~0u;
+	struct BinContext
+	{
+		eastl::vector<Node*>                      m_nodes;         // Node table index -> node.
+		eastl::hash_map<uint64, uint32>           m_nodeIndices;   // Node::Id -> node table index (write only).
+		eastl::vector<char>                       m_strings;       // String table (write only).
+		eastl::hash_map<uint64, uint32>           m_stringOffsets; // String hash -> offset in m_strings (write only).
+		const char*                               m_stringTable;   // String table (read only).
+		uint32                                    m_stringTableSize;
+
+		BinContext(): m_stringTable(nullptr), m_stringTableSize(0) {}
+
+		// Return kBinInvalidIndex if _node is nullptr or not in the node table.
+		uint32      getNodeIndex(const Node* _node) const;
+		uint32      getNodeIndex(uint64 _nodeId) const;
+		// Return nullptr if _index is kBinInvalidIndex.
+		Node*       getNode(uint32 _index) const;
+		// Append _str to the string table if it isn't already present, return its offset.
+		uint32      addString(const char* _str);
+		// Return nullptr if _offset is kBinInvalidIndex or out of range.
+		const char* getString(uint32 _offset) const;
+		// Callbacks are stored by name, kBinInvalidIndex if _callback is nullptr.
+		uint32      addCallback(OnComplete* _callback);
+		OnComplete* getCallback(uint32 _offset) const;
+	};
+	typedef void (WriteBinFunc)(const XForm* const* _xforms, uint32 _count, BinContext& _ctx_, void* out_);
+	typedef void (ReadBinFunc)(XForm* const* _xforms, uint32 _count, const BinContext& _ctx, const void* _data);
+	struct BinCodec
+	{
+		const char*     m_className;
+		apt::StringHash m_classNameHash;
+		uint32          m_payloadSize;    // Bytes per instance.
+		WriteBinFunc*   m_writeBin;
+		ReadBinFunc*    m_readBin;
+
+		BinCodec(const char* _className, uint32 _payloadSize, WriteBinFunc* _writeBin, ReadBinFunc* _readBin);
+	};
+	static const BinCodec* FindBinCodec(apt::StringHash _classNameHash);
+
+	template <typename tXForm>
+	static void WriteBinT(const XForm* const* _xforms, uint32 _count, BinContext& _ctx_, void* out_)
+	{
+		typename tXForm::Bin* out = (typename tXForm::Bin*)out_;
+		for (uint32 i = 0; i < _count; ++i) {
+			((const tXForm*)_xforms[i])->toBin(out[i], _ctx_);
+		}
+	}
+	template <typename tXForm>
+	static void ReadBinT(XForm* const* _xforms, uint32 _count, const BinContext& _ctx, const void* _data)
+	{
+		const typename tXForm::Bin* data = (const typename tXForm::Bin*)_data;
+		for (uint32 i = 0; i < _count; ++i) {
+			((tXForm*)_xforms[i])->fromBin(data[i], _ctx);
+		}
+	}
+
 	// Reset initial state.
 	virtual void reset() {}
 	static  void Reset(XForm* _xform_)         { _xform_->reset(); }
@@ -52,8 +148,26 @@ public:
 	Node*        getNode() const               { return m_node; }
 	void         setNode(Node* _node)          { m_node = _node; }
 
+	// Batch for this xform's type, nullptr if the type isn't batched (see NodeHierarchy).
+	const Batch* getBatch() const              { return m_batch; }
+	// Combine m_batchMatrix with the node's world matrix.
+	void         applyBatched()
+	{
+		if (m_batch->m_op == BatchOp_PostMultiply) {
+			m_node->setWorldMatrix(m_node->getWorldMatrix() * m_batchMatrix);
+		} else {
+			m_node->setWorldPosition(m_node->getWorldPosition() + m_batchMatrix[3].xyz());
+		}
+	}
+
 	virtual void apply(float _dt) = 0;	
 	virtual bool edit() = 0;
+
+	// Return true if apply() only accesses the xform and its node, in which case it may be called concurrently with
+	// other xforms during a parallel Scene::update(). Nodes with xforms which aren't thread safe are updated (with
+	// their subtree) on the calling thread, in the same order relative to the other nodes as a linear update.
+	virtual bool isThreadSafe() const          { return false; }
+
 	virtual bool serialize(apt::Serializer& _serializer_) = 0;
 	friend bool Serialize(apt::Serializer& _serializer_, XForm& _xform_)
 	{
@@ -61,17 +175,39 @@ public:
 	}
 
 protected:
-	static eastl::vector<const Callback*> s_callbackRegistry;
+	friend class NodeHierarchy;
 
-	XForm(): m_node(nullptr)      {}
+	static eastl::vector<const Callback*> s_callbackRegistry;
+	static eastl::vector<const Batch*>    s_batchRegistry;
+	static eastl::vector<const BinCodec*> s_binCodecRegistry;
+
+	XForm()
+		: m_node(nullptr)
+		, m_batch(nullptr)
+		, m_batchIndex(~0u)
+		, m_batchMatrix(identity)
+	{
+	}
 
-	Node* m_node;
+	Node*        m_node;
+	const Batch* m_batch;        // Set by NodeHierarchy::addXForm().
+	uint32       m_batchIndex;   // Index in the per-type instance list.
+	mat4         m_batchMatrix;  // Written by ApplyAll().
 
 }; // class XForm
 
 #define XFORM_REGISTER_CALLBACK(_callback) \
 	static XForm::Callback APT_UNIQUE_NAME(XForm_Callback_)(#_callback, _callback);
 
+// _class must declare static void ApplyAll(XForm* const* _xforms, uint32 _count, float _dt).
+#define XFORM_REGISTER_BATCH(_class, _op) \
+	static XForm::Batch APT_UNIQUE_NAME(XForm_Batch_)(#_class, _class::ApplyAll, XForm::_op);
+
+// _class must declare a POD struct Bin and void toBin(Bin& out_, BinContext& _ctx_) const, void fromBin(const Bin& _bin,
+// const BinContext& _ctx).
+#define XFORM_REGISTER_BIN(_class) \
+	static XForm::BinCodec APT_UNIQUE_NAME(XForm_BinCodec_)(#_class, sizeof(_class::Bin), XForm::WriteBinT<_class>, XForm::ReadBinT<_class>);
+
 ////////////////////////////////////////////////////////////////////////////////
 // XForm_PositionOrientationScale
 ////////////////////////////////////////////////////////////////////////////////
@@ -82,8 +218,14 @@ struct XForm_PositionOrientationScale: public XForm
 	vec3  m_scale         = vec3(1.0f);
 	
 	virtual void apply(float _dt) override;
+	virtual bool isThreadSafe() const override { return true; }
+	static  void ApplyAll(XForm* const* _xforms, uint32 _count, float _dt);
 	virtual bool edit() override;
 	virtual bool serialize(apt::Serializer& _serializer_) override;
+
+	struct Bin { vec3 m_position; quat m_orientation; vec3 m_scale; };
+	void toBin(Bin& out_, BinContext& _ctx_) const;
+	void fromBin(const Bin& _bin, const BinContext& _ctx);
 	
 };
 
@@ -120,6 +262,10 @@ struct XForm_FreeCamera: public XForm
 	virtual void apply(float _dt) override;
 	virtual bool edit() override;
 	virtual bool serialize(apt::Serializer& _serializer_) override;
+
+	struct Bin { vec3 m_position; quat m_orientation; float m_maxSpeed, m_maxSpeedMul, m_accelTime, m_rotationInputMul, m_rotationDamp; };
+	void toBin(Bin& out_, BinContext& _ctx_) const;
+	void fromBin(const Bin& _bin, const BinContext& _ctx);
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -135,6 +281,10 @@ struct XForm_LookAt: public XForm
 	virtual void apply(float _dt) override;
 	virtual bool edit() override;
 	virtual bool serialize(apt::Serializer& _serializer_) override;
+
+	struct Bin { vec3 m_offset; uint32 m_target; }; // m_target is a node table index
+	void toBin(Bin& out_, BinContext& _ctx_) const;
+	void fromBin(const Bin& _bin, const BinContext& _ctx);
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -148,8 +298,14 @@ struct XForm_Spin: public XForm
 	float m_rotation   = 0.0f;
 	
 	virtual void apply(float _dt) override;
+	virtual bool isThreadSafe() const override { return true; }
+	static  void ApplyAll(XForm* const* _xforms, uint32 _count, float _dt);
 	virtual bool edit() override;
 	virtual bool serialize(apt::Serializer& _serializer_) override;
+
+	struct Bin { vec3 m_axis; float m_rate; };
+	void toBin(Bin& out_, BinContext& _ctx_) const;
+	void fromBin(const Bin& _bin, const BinContext& _ctx);
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -167,9 +323,14 @@ struct XForm_PositionTarget: public XForm
 	OnComplete* m_onComplete;
 	
 	virtual void apply(float _dt) override;
+	virtual bool isThreadSafe() const override { return m_onComplete == nullptr; }
 	virtual bool edit() override;
 	virtual bool serialize(apt::Serializer& _serializer_) override;
 
+	struct Bin { vec3 m_start; vec3 m_end; float m_duration; uint32 m_onComplete; }; // m_onComplete is a string table offset
+	void toBin(Bin& out_, BinContext& _ctx_) const;
+	void fromBin(const Bin& _bin, const BinContext& _ctx);
+
 	virtual void reset() override;
 	virtual void relativeReset() override;
 	virtual void reverse() override;
@@ -188,9 +349,14 @@ struct XForm_SplinePath: public XForm
 	OnComplete* m_onComplete;
 
 	virtual void apply(float _dt) override;
+	virtual bool isThreadSafe() const override { return m_onComplete == nullptr; }
 	virtual bool edit() override;
 	virtual bool serialize(apt::Serializer& _serializer_) override;
 
+	struct Bin { float m_duration; uint32 m_onComplete; }; // m_onComplete is a string table offset
+	void toBin(Bin& out_, BinContext& _ctx_) const;
+	void fromBin(const Bin& _bin, const BinContext& _ctx);
+
 	virtual void reset() override;
 	virtual void reverse() override;
 };
@@ -211,10 +377,20 @@ struct XForm_OrbitalPath: public XForm
 	vec4  m_displayColor    = vec4(1.0f, 1.0f, 0.0f, 1.0f);
 
 	virtual void apply(float _dt) override;
+	virtual bool isThreadSafe() const override { return true; }
+	static  void ApplyAll(XForm* const* _xforms, uint32 _count, float _dt);
 	virtual bool edit() override;
 	virtual bool serialize(apt::Serializer& _serializer_) override;
 
+	struct Bin { float m_azimuth, m_elevation, m_theta, m_radius, m_speed; };
+	void toBin(Bin& out_, BinContext& _ctx_) const;
+	void fromBin(const Bin& _bin, const BinContext& _ctx);
+
 	virtual void reset() override;
+
+private:
+	// Advance m_theta, update m_direction/m_normal, return the world space offset.
+	vec3 advance(float _dt);
 };
 
 } // namespace frm
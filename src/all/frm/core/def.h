@@ -45,6 +45,7 @@ namespace frm {
 	class  Keyboard;
 	class  Light;
 	class  LuaScript;
+	class  MappedFile;
 	class  Mesh;
 	class  MeshBuilder;
 	class  MeshData;
@@ -81,6 +82,7 @@ namespace frm {
 	struct Frustum;
 	struct Line;
 	struct LineSegment;
+	struct OrientedBox;
 	struct Plane;
 	struct Ray;
 	struct Sphere;
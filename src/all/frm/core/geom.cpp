@@ -3,6 +3,15 @@
 #include <frm/core/math.h>
 #include <frm/core/interpolation.h>
 
+// SSE paths for the bounding volume reductions.
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE__)
+	#define geom_SIMD 1
+	#include <xmmintrin.h>
+	#include <emmintrin.h>
+#else
+	#define geom_SIMD 0
+#endif
+
 #define geom_debug
 #ifdef geom_debug
 	#include <imgui/imgui.h>
@@ -219,6 +228,59 @@ void AlignedBox::getVertices(vec3* out_) const
 	out_[7] = vec3(m_min.x, m_max.y, m_max.z);
 }
 
+/*******************************************************************************
+
+                               OrientedBox
+
+*******************************************************************************/
+
+OrientedBox::OrientedBox(const vec3& _origin, const vec3& _extents, const mat3& _axes)
+	: m_origin(_origin)
+	, m_extents(_extents)
+	, m_axes(_axes)
+{
+}
+
+OrientedBox::OrientedBox(const AlignedBox& _box)
+	: m_origin(_box.getOrigin())
+	, m_extents((_box.m_max - _box.m_min) * 0.5f)
+	, m_axes(vec3(1.0f, 0.0f, 0.0f), vec3(0.0f, 1.0f, 0.0f), vec3(0.0f, 0.0f, 1.0f))
+{
+}
+
+void OrientedBox::transform(const mat4& _mat)
+{
+ // scale is absorbed into the extents, shear relative to the box axes is ignored
+	mat3 m = mat3(_mat);
+	for (int i = 0; i < 3; ++i) {
+		vec3 axis = m * m_axes[i];
+		float len = length(axis);
+		m_extents[i] *= len;
+		m_axes[i] = len > 0.0f ? axis / len : m_axes[i];
+	}
+	m_origin = TransformPosition(_mat, m_origin);
+}
+
+float OrientedBox::getVolume() const
+{
+	return m_extents.x * m_extents.y * m_extents.z * 8.0f;
+}
+
+void OrientedBox::getVertices(vec3* out_) const
+{
+	vec3 x = m_axes[0] * m_extents.x;
+	vec3 y = m_axes[1] * m_extents.y;
+	vec3 z = m_axes[2] * m_extents.z;
+	out_[0] = m_origin - x - y - z;
+	out_[1] = m_origin + x - y - z;
+	out_[2] = m_origin + x - y + z;
+	out_[3] = m_origin - x - y + z;
+	out_[4] = m_origin - x + y - z;
+	out_[5] = m_origin + x + y - z;
+	out_[6] = m_origin + x + y + z;
+	out_[7] = m_origin - x + y + z;
+}
+
 /*******************************************************************************
 
                                  Cylinder
@@ -433,6 +495,22 @@ bool Frustum::inside(const AlignedBox& _box) const
 #endif
 }
 
+bool Frustum::inside(const OrientedBox& _box) const
+{
+	for (int i = 0; i < 6; ++i) {
+		vec3 n = m_planes[i].m_normal;
+		float r = 
+			abs(dot(n, _box.m_axes[0])) * _box.m_extents.x +
+			abs(dot(n, _box.m_axes[1])) * _box.m_extents.y +
+			abs(dot(n, _box.m_axes[2])) * _box.m_extents.z
+			;
+		if (Distance(m_planes[i], _box.m_origin) < -r) {
+			return false;
+		}
+	}
+	return true;
+}
+
 void Frustum::setVertices(const vec3 _vertices[8])
 {
 	memcpy(m_vertices, _vertices, sizeof(m_vertices));
@@ -450,6 +528,518 @@ void Frustum::initPlanes()
 }
 
 
+/*******************************************************************************
+
+                             Bounding Volumes
+
+*******************************************************************************/
+
+// Directions for the extreme points search in BoundingSphere(), the diagonals needn't be normalized.
+static const int  kExtremeDirCount = 7;
+static const vec3 kExtremeDirs[kExtremeDirCount] =
+{
+	vec3( 1.0f,  0.0f,  0.0f),
+	vec3( 0.0f,  1.0f,  0.0f),
+	vec3( 0.0f,  0.0f,  1.0f),
+	vec3( 1.0f,  1.0f,  1.0f),
+	vec3( 1.0f,  1.0f, -1.0f),
+	vec3( 1.0f, -1.0f,  1.0f),
+	vec3( 1.0f, -1.0f, -1.0f)
+};
+
+// Shrink/regrow passes after the initial sphere (see BoundingSphere()).
+static const int kSphereRefineIterations = 8;
+
+inline static const vec3& PointAt(const char* _points, uint32 _i, uint32 _stride)
+{
+	return *((const vec3*)(_points + (size_t)_i * _stride));
+}
+
+#if geom_SIMD
+// Load 4 points as xxxx/yyyy/zzzz. Components are loaded individually, _mm_loadu_ps could read past the end of the
+// point array.
+inline static void Load4(const char* _points, uint32 _stride, __m128& x_, __m128& y_, __m128& z_)
+{
+	const float* p0 = (const float*)(_points);
+	const float* p1 = (const float*)(_points + _stride);
+	const float* p2 = (const float*)(_points + _stride * 2);
+	const float* p3 = (const float*)(_points + _stride * 3);
+	x_ = _mm_setr_ps(p0[0], p1[0], p2[0], p3[0]);
+	y_ = _mm_setr_ps(p0[1], p1[1], p2[1], p3[1]);
+	z_ = _mm_setr_ps(p0[2], p1[2], p2[2], p3[2]);
+}
+
+inline static float HorizontalMin(__m128 _v)
+{
+	_v = _mm_min_ps(_v, _mm_shuffle_ps(_v, _v, _MM_SHUFFLE(2, 3, 0, 1)));
+	_v = _mm_min_ps(_v, _mm_shuffle_ps(_v, _v, _MM_SHUFFLE(1, 0, 3, 2)));
+	return _mm_cvtss_f32(_v);
+}
+
+inline static float HorizontalMax(__m128 _v)
+{
+	_v = _mm_max_ps(_v, _mm_shuffle_ps(_v, _v, _MM_SHUFFLE(2, 3, 0, 1)));
+	_v = _mm_max_ps(_v, _mm_shuffle_ps(_v, _v, _MM_SHUFFLE(1, 0, 3, 2)));
+	return _mm_cvtss_f32(_v);
+}
+
+inline static float HorizontalSum(__m128 _v)
+{
+	_v = _mm_add_ps(_v, _mm_shuffle_ps(_v, _v, _MM_SHUFFLE(2, 3, 0, 1)));
+	_v = _mm_add_ps(_v, _mm_shuffle_ps(_v, _v, _MM_SHUFFLE(1, 0, 3, 2)));
+	return _mm_cvtss_f32(_v);
+}
+#endif
+
+// Min/max of the projection of the points onto _axes, write to min_/max_.
+static void MinMaxProject(const char* _points, uint32 _count, uint32 _stride, const vec3 _axes[3], vec3& min_, vec3& max_)
+{
+	min_ = vec3(FLT_MAX);
+	max_ = vec3(-FLT_MAX);
+	uint32 i = 0;
+#if geom_SIMD
+	if (_count >= 4) {
+		__m128 ax[3], ay[3], az[3], mn[3], mx[3];
+		for (int k = 0; k < 3; ++k) {
+			ax[k] = _mm_set1_ps(_axes[k].x);
+			ay[k] = _mm_set1_ps(_axes[k].y);
+			az[k] = _mm_set1_ps(_axes[k].z);
+			mn[k] = _mm_set1_ps(FLT_MAX);
+			mx[k] = _mm_set1_ps(-FLT_MAX);
+		}
+		for (; i + 4 <= _count; i += 4) {
+			__m128 x, y, z;
+			Load4(_points + (size_t)i * _stride, _stride, x, y, z);
+			for (int k = 0; k < 3; ++k) {
+				__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, ax[k]), _mm_mul_ps(y, ay[k])), _mm_mul_ps(z, az[k]));
+				mn[k] = _mm_min_ps(mn[k], d);
+				mx[k] = _mm_max_ps(mx[k], d);
+			}
+		}
+		for (int k = 0; k < 3; ++k) {
+			min_[k] = HorizontalMin(mn[k]);
+			max_[k] = HorizontalMax(mx[k]);
+		}
+	}
+#endif
+	for (; i < _count; ++i) {
+		const vec3& p = PointAt(_points, i, _stride);
+		for (int k = 0; k < 3; ++k) {
+			float d = dot(p, _axes[k]);
+			min_[k] = APT_MIN(min_[k], d);
+			max_[k] = APT_MAX(max_[k], d);
+		}
+	}
+}
+
+// Indices of the points with the min/max projection onto each of kExtremeDirs.
+static void ExtremePoints(const char* _points, uint32 _count, uint32 _stride, uint32 min_[kExtremeDirCount], uint32 max_[kExtremeDirCount])
+{
+	float mn[kExtremeDirCount], mx[kExtremeDirCount];
+	for (int k = 0; k < kExtremeDirCount; ++k) {
+		mn[k] = FLT_MAX;
+		mx[k] = -FLT_MAX;
+		min_[k] = max_[k] = 0;
+	}
+	uint32 i = 0;
+#if geom_SIMD
+	if (_count >= 4) {
+		__m128  mn4[kExtremeDirCount], mx4[kExtremeDirCount];
+		__m128i mni[kExtremeDirCount], mxi[kExtremeDirCount];
+		for (int k = 0; k < kExtremeDirCount; ++k) {
+			mn4[k] = _mm_set1_ps(FLT_MAX);
+			mx4[k] = _mm_set1_ps(-FLT_MAX);
+			mni[k] = mxi[k] = _mm_setzero_si128();
+		}
+		__m128i idx  = _mm_setr_epi32(0, 1, 2, 3);
+		__m128i four = _mm_set1_epi32(4);
+		for (; i + 4 <= _count; i += 4) {
+			__m128 x, y, z;
+			Load4(_points + (size_t)i * _stride, _stride, x, y, z);
+			for (int k = 0; k < kExtremeDirCount; ++k) {
+				const vec3& dir = kExtremeDirs[k];
+				__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(dir.x)), _mm_mul_ps(y, _mm_set1_ps(dir.y))), _mm_mul_ps(z, _mm_set1_ps(dir.z)));
+				__m128i lt = _mm_castps_si128(_mm_cmplt_ps(d, mn4[k]));
+				__m128i gt = _mm_castps_si128(_mm_cmpgt_ps(d, mx4[k]));
+				mni[k] = _mm_or_si128(_mm_and_si128(lt, idx), _mm_andnot_si128(lt, mni[k]));
+				mxi[k] = _mm_or_si128(_mm_and_si128(gt, idx), _mm_andnot_si128(gt, mxi[k]));
+				mn4[k] = _mm_min_ps(mn4[k], d);
+				mx4[k] = _mm_max_ps(mx4[k], d);
+			}
+			idx = _mm_add_epi32(idx, four);
+		}
+		for (int k = 0; k < kExtremeDirCount; ++k) {
+			float  mnv[4], mxv[4];
+			uint32 mnvi[4], mxvi[4];
+			_mm_storeu_ps(mnv, mn4[k]);
+			_mm_storeu_ps(mxv, mx4[k]);
+			_mm_storeu_si128((__m128i*)mnvi, mni[k]);
+			_mm_storeu_si128((__m128i*)mxvi, mxi[k]);
+			for (int j = 0; j < 4; ++j) {
+				if (mnv[j] < mn[k]) {
+					mn[k] = mnv[j];
+					min_[k] = mnvi[j];
+				}
+				if (mxv[j] > mx[k]) {
+					mx[k] = mxv[j];
+					max_[k] = mxvi[j];
+				}
+			}
+		}
+	}
+#endif
+	for (; i < _count; ++i) {
+		const vec3& p = PointAt(_points, i, _stride);
+		for (int k = 0; k < kExtremeDirCount; ++k) {
+			float d = dot(p, kExtremeDirs[k]);
+			if (d < mn[k]) {
+				mn[k] = d;
+				min_[k] = i;
+			}
+			if (d > mx[k]) {
+				mx[k] = d;
+				max_[k] = i;
+			}
+		}
+	}
+}
+
+inline static bool Contains(const Sphere& _sphere, const vec3& _point)
+{
+ // tolerance for the support sets in Welzl(), the final sphere is made to contain all points by GrowSphere()
+	float r = _sphere.m_radius * (1.0f + 1e-5f) + 1e-7f;
+	return length2(_point - _sphere.m_origin) <= r * r;
+}
+
+static Sphere SphereFrom2(const vec3& _p0, const vec3& _p1)
+{
+	return Sphere((_p0 + _p1) * 0.5f, length(_p1 - _p0) * 0.5f);
+}
+
+static Sphere SphereFrom3(const vec3& _p0, const vec3& _p1, const vec3& _p2)
+{
+	vec3  a = _p1 - _p0;
+	vec3  b = _p2 - _p0;
+	vec3  axb = cross(a, b);
+	float denom = 2.0f * length2(axb);
+	if (denom <= FLT_EPSILON * length2(a) * length2(b)) {
+	 // collinear, the sphere through the 2 most distant points contains the 3rd
+		Sphere s01 = SphereFrom2(_p0, _p1);
+		Sphere s02 = SphereFrom2(_p0, _p2);
+		Sphere s12 = SphereFrom2(_p1, _p2);
+		Sphere ret = s01.m_radius > s02.m_radius ? s01 : s02;
+		return ret.m_radius > s12.m_radius ? ret : s12;
+	}
+	vec3 o = cross(b * length2(a) - a * length2(b), axb) / denom;
+	return Sphere(_p0 + o, length(o));
+}
+
+static Sphere SphereFrom4(const vec3& _p0, const vec3& _p1, const vec3& _p2, const vec3& _p3)
+{
+	vec3  a = _p1 - _p0;
+	vec3  b = _p2 - _p0;
+	vec3  c = _p3 - _p0;
+	float det = dot(a, cross(b, c));
+	if (abs(det) <= FLT_EPSILON * length(a) * length(b) * length(c)) {
+	 // coplanar, smallest circumcircle of 3 points which contains the 4th (else the largest)
+		const vec3* p[4] = { &_p0, &_p1, &_p2, &_p3 };
+		Sphere ret(vec3(0.0f), FLT_MAX);
+		Sphere largest(vec3(0.0f), -1.0f);
+		for (int i = 0; i < 4; ++i) {
+			Sphere s = SphereFrom3(*p[(i + 1) % 4], *p[(i + 2) % 4], *p[(i + 3) % 4]);
+			if (s.m_radius < ret.m_radius && Contains(s, *p[i])) {
+				ret = s;
+			}
+			if (s.m_radius > largest.m_radius) {
+				largest = s;
+			}
+		}
+		return ret.m_radius < FLT_MAX ? ret : largest;
+	}
+	vec3 o = (cross(b, c) * length2(a) + cross(c, a) * length2(b) + cross(a, b) * length2(c)) / (2.0f * det);
+	return Sphere(_p0 + o, length(o));
+}
+
+// Minimum sphere of _points with _support on the boundary (Welzl's algorithm). Only used for a handful of points,
+// hence the simple recursive form.
+static Sphere Welzl(const vec3* _points, int _count, vec3* _support, int _supportCount)
+{
+	if (_count == 0 || _supportCount == 4) {
+		switch (_supportCount) {
+			default:
+			case 0: return Sphere(vec3(0.0f), -1.0f);
+			case 1: return Sphere(_support[0], 0.0f);
+			case 2: return SphereFrom2(_support[0], _support[1]);
+			case 3: return SphereFrom3(_support[0], _support[1], _support[2]);
+			case 4: return SphereFrom4(_support[0], _support[1], _support[2], _support[3]);
+		}
+	}
+	const vec3& p = _points[_count - 1];
+	Sphere ret = Welzl(_points, _count - 1, _support, _supportCount);
+	if (ret.m_radius >= 0.0f && Contains(ret, p)) {
+		return ret;
+	}
+	_support[_supportCount] = p;
+	return Welzl(_points, _count - 1, _support, _supportCount + 1);
+}
+
+inline static void GrowSphere(Sphere& sphere_, const vec3& _point)
+{
+	vec3  v  = _point - sphere_.m_origin;
+	float d2 = length2(v);
+	if (d2 > sphere_.m_radius * sphere_.m_radius) {
+		float d = sqrt(d2);
+		float r = (sphere_.m_radius + d) * 0.5f;
+		sphere_.m_origin += v * ((r - sphere_.m_radius) / d);
+		sphere_.m_radius = r;
+	}
+}
+
+// Grow sphere_ to contain points [_begin, _end) in order (Ritter). The SIMD path tests 4 points at a time and only
+// falls back to scalar code for the (rare) points outside the current sphere.
+static void GrowSphere(Sphere& sphere_, const char* _points, uint32 _begin, uint32 _end, uint32 _stride)
+{
+	uint32 i = _begin;
+#if geom_SIMD
+	__m128 ox = _mm_set1_ps(sphere_.m_origin.x);
+	__m128 oy = _mm_set1_ps(sphere_.m_origin.y);
+	__m128 oz = _mm_set1_ps(sphere_.m_origin.z);
+	__m128 r2 = _mm_set1_ps(sphere_.m_radius * sphere_.m_radius);
+	for (; i + 4 <= _end; i += 4) {
+		__m128 x, y, z;
+		Load4(_points + (size_t)i * _stride, _stride, x, y, z);
+		x = _mm_sub_ps(x, ox);
+		y = _mm_sub_ps(y, oy);
+		z = _mm_sub_ps(z, oz);
+		__m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+		int mask = _mm_movemask_ps(_mm_cmpgt_ps(d2, r2));
+		if (mask) {
+			for (uint32 j = 0; j < 4; ++j) {
+				if (mask & (1 << j)) {
+					GrowSphere(sphere_, PointAt(_points, i + j, _stride));
+				}
+			}
+			ox = _mm_set1_ps(sphere_.m_origin.x);
+			oy = _mm_set1_ps(sphere_.m_origin.y);
+			oz = _mm_set1_ps(sphere_.m_origin.z);
+			r2 = _mm_set1_ps(sphere_.m_radius * sphere_.m_radius);
+		}
+	}
+#endif
+	for (; i < _end; ++i) {
+		GrowSphere(sphere_, PointAt(_points, i, _stride));
+	}
+}
+
+// Jacobi eigen decomposition of the symmetric matrix _a, eigenvectors are written to the columns of v_.
+static void Jacobi(float _a[3][3], float v_[3][3])
+{
+	for (int i = 0; i < 3; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			v_[i][j] = i == j ? 1.0f : 0.0f;
+		}
+	}
+	for (int sweep = 0; sweep < 50; ++sweep) {
+	 // largest off-diagonal element
+		int p = 0, q = 1;
+		for (int i = 0; i < 3; ++i) {
+			for (int j = i + 1; j < 3; ++j) {
+				if (abs(_a[i][j]) > abs(_a[p][q])) {
+					p = i;
+					q = j;
+				}
+			}
+		}
+		float off = abs(_a[p][q]);
+		if (off <= 1e-7f * (abs(_a[p][p]) + abs(_a[q][q])) || off < FLT_MIN) {
+			break;
+		}
+
+	 // rotation which zeroes a[p][q]
+		float r = (_a[q][q] - _a[p][p]) / (2.0f * _a[p][q]);
+		float t = r >= 0.0f ? 1.0f / (r + sqrt(1.0f + r * r)) : -1.0f / (-r + sqrt(1.0f + r * r));
+		float c = 1.0f / sqrt(1.0f + t * t);
+		float s = t * c;
+
+	 // a = J^T a J, v = v J
+		for (int k = 0; k < 3; ++k) {
+			float akp = _a[k][p];
+			float akq = _a[k][q];
+			_a[k][p] = c * akp - s * akq;
+			_a[k][q] = s * akp + c * akq;
+		}
+		for (int k = 0; k < 3; ++k) {
+			float apk = _a[p][k];
+			float aqk = _a[q][k];
+			_a[p][k] = c * apk - s * aqk;
+			_a[q][k] = s * apk + c * aqk;
+		}
+		for (int k = 0; k < 3; ++k) {
+			float vkp = v_[k][p];
+			float vkq = v_[k][q];
+			v_[k][p] = c * vkp - s * vkq;
+			v_[k][q] = s * vkp + c * vkq;
+		}
+	}
+}
+
+AlignedBox frm::BoundingBox(const vec3* _points, uint32 _count, uint32 _stride)
+{
+	static const vec3 kAxes[3] = { vec3(1.0f, 0.0f, 0.0f), vec3(0.0f, 1.0f, 0.0f), vec3(0.0f, 0.0f, 1.0f) };
+	AlignedBox ret;
+	MinMaxProject((const char*)_points, _count, _stride, kAxes, ret.m_min, ret.m_max);
+	return ret;
+}
+
+Sphere frm::BoundingSphere(const vec3* _points, uint32 _count, uint32 _stride)
+{
+	if (_count == 0) {
+		return Sphere(vec3(0.0f), 0.0f);
+	}
+	const char* points = (const char*)_points;
+
+ // minimum sphere of the extreme points is a good initial guess (usually within a few % of the optimal radius)
+	uint32 mn[kExtremeDirCount], mx[kExtremeDirCount];
+	ExtremePoints(points, _count, _stride, mn, mx);
+	vec3 extremes[kExtremeDirCount * 2];
+	for (int k = 0; k < kExtremeDirCount; ++k) {
+		extremes[k * 2 + 0] = PointAt(points, mn[k], _stride);
+		extremes[k * 2 + 1] = PointAt(points, mx[k], _stride);
+	}
+	vec3 support[4];
+	Sphere ret = Welzl(extremes, kExtremeDirCount * 2, support, 0);
+	ret.m_radius = APT_MAX(ret.m_radius, 0.0f);
+	Sphere boxSphere(BoundingBox(_points, _count, _stride));
+	if (!(ret.m_radius <= boxSphere.m_radius)) {
+	 // numerically degenerate support set, fall back to the box
+		ret = boxSphere;
+	}
+
+ // grow to contain all points
+	GrowSphere(ret, points, 0, _count, _stride);
+
+ // refine: shrink the sphere slightly and regrow it, starting at a different point each iteration, keep the result
+ // if it's smaller
+	Sphere s = ret;
+	for (int k = 0; k < kSphereRefineIterations; ++k) {
+		s.m_radius *= 0.95f;
+		uint32 first = (uint32)(((uint64)(k + 1) * 0x9e3779b1u) % _count);
+		GrowSphere(s, points, first, _count, _stride);
+		GrowSphere(s, points, 0, first, _stride);
+		if (s.m_radius < ret.m_radius) {
+			ret = s;
+		}
+	}
+
+	return ret;
+}
+
+OrientedBox frm::BoundingOrientedBox(const vec3* _points, uint32 _count, uint32 _stride)
+{
+	AlignedBox aabb = BoundingBox(_points, _count, _stride);
+	if (_count < 4) {
+		return OrientedBox(aabb);
+	}
+	const char* points = (const char*)_points;
+
+ // covariance, relative to the aabb center for precision; accumulate in float per block then in double
+	vec3   center = aabb.getOrigin();
+	double sum[9] = {}; // x, y, z, xx, yy, zz, xy, xz, yz
+	for (uint32 block = 0; block < _count; block += 4096) {
+		uint32 i   = block;
+		uint32 end = APT_MIN(block + 4096, _count);
+		float  blockSum[9] = {};
+	#if geom_SIMD
+		__m128 cx = _mm_set1_ps(center.x);
+		__m128 cy = _mm_set1_ps(center.y);
+		__m128 cz = _mm_set1_ps(center.z);
+		__m128 s[9];
+		for (int k = 0; k < 9; ++k) {
+			s[k] = _mm_setzero_ps();
+		}
+		for (; i + 4 <= end; i += 4) {
+			__m128 x, y, z;
+			Load4(points + (size_t)i * _stride, _stride, x, y, z);
+			x = _mm_sub_ps(x, cx);
+			y = _mm_sub_ps(y, cy);
+			z = _mm_sub_ps(z, cz);
+			s[0] = _mm_add_ps(s[0], x);
+			s[1] = _mm_add_ps(s[1], y);
+			s[2] = _mm_add_ps(s[2], z);
+			s[3] = _mm_add_ps(s[3], _mm_mul_ps(x, x));
+			s[4] = _mm_add_ps(s[4], _mm_mul_ps(y, y));
+			s[5] = _mm_add_ps(s[5], _mm_mul_ps(z, z));
+			s[6] = _mm_add_ps(s[6], _mm_mul_ps(x, y));
+			s[7] = _mm_add_ps(s[7], _mm_mul_ps(x, z));
+			s[8] = _mm_add_ps(s[8], _mm_mul_ps(y, z));
+		}
+		for (int k = 0; k < 9; ++k) {
+			blockSum[k] = HorizontalSum(s[k]);
+		}
+	#endif
+		for (; i < end; ++i) {
+			vec3 p = PointAt(points, i, _stride) - center;
+			blockSum[0] += p.x;
+			blockSum[1] += p.y;
+			blockSum[2] += p.z;
+			blockSum[3] += p.x * p.x;
+			blockSum[4] += p.y * p.y;
+			blockSum[5] += p.z * p.z;
+			blockSum[6] += p.x * p.y;
+			blockSum[7] += p.x * p.z;
+			blockSum[8] += p.y * p.z;
+		}
+		for (int k = 0; k < 9; ++k) {
+			sum[k] += blockSum[k];
+		}
+	}
+	double n  = (double)_count;
+	double mx = sum[0] / n;
+	double my = sum[1] / n;
+	double mz = sum[2] / n;
+	float cov[3][3];
+	cov[0][0] = (float)(sum[3] / n - mx * mx);
+	cov[1][1] = (float)(sum[4] / n - my * my);
+	cov[2][2] = (float)(sum[5] / n - mz * mz);
+	cov[0][1] = cov[1][0] = (float)(sum[6] / n - mx * my);
+	cov[0][2] = cov[2][0] = (float)(sum[7] / n - mx * mz);
+	cov[1][2] = cov[2][1] = (float)(sum[8] / n - my * mz);
+
+	float v[3][3];
+	Jacobi(cov, v);
+	vec3 axes[3];
+	axes[0] = normalize(vec3(v[0][0], v[1][0], v[2][0]));
+	axes[1] = normalize(vec3(v[0][1], v[1][1], v[2][1]));
+	axes[2] = normalize(cross(axes[0], axes[1]));
+	axes[1] = cross(axes[2], axes[0]);
+
+	vec3 mn, mx3;
+	MinMaxProject(points, _count, _stride, axes, mn, mx3);
+	vec3 mid = (mn + mx3) * 0.5f;
+	OrientedBox ret(
+		axes[0] * mid.x + axes[1] * mid.y + axes[2] * mid.z,
+		(mx3 - mn) * 0.5f,
+		mat3(axes[0], axes[1], axes[2])
+		);
+
+	OrientedBox aobb(aabb);
+	return aobb.getVolume() <= ret.getVolume() ? aobb : ret;
+}
+
+Sphere frm::BoundingSphere(const Sphere& _sphere0, const Sphere& _sphere1)
+{
+	vec3  v = _sphere1.m_origin - _sphere0.m_origin;
+	float d = length(v);
+	if (d + _sphere1.m_radius <= _sphere0.m_radius) {
+		return _sphere0;
+	}
+	if (d + _sphere0.m_radius <= _sphere1.m_radius) {
+		return _sphere1;
+	}
+	float r = (d + _sphere0.m_radius + _sphere1.m_radius) * 0.5f;
+	return Sphere(_sphere0.m_origin + v * ((r - _sphere0.m_radius) / d), r);
+}
+
 /*******************************************************************************
 *******************************************************************************/
 
@@ -128,6 +128,29 @@ struct AlignedBox
 }; // struct AlignedBox
 
 
+////////////////////////////////////////////////////////////////////////////////
+// OrientedBox
+// m_axes are orthonormal, m_extents are the half extents along each axis.
+////////////////////////////////////////////////////////////////////////////////
+struct OrientedBox
+{
+	vec3 m_origin;
+	vec3 m_extents;
+	mat3 m_axes;
+
+	OrientedBox() {}
+	OrientedBox(const vec3& _origin, const vec3& _extents, const mat3& _axes);
+	OrientedBox(const AlignedBox& _box);
+
+	void transform(const mat4& _mat);
+	float getVolume() const;
+
+	// Generate 8 vertices, write to out_ (same ordering as AlignedBox::getVertices()).
+	void getVertices(vec3* out_) const;
+
+}; // struct OrientedBox
+
+
 ////////////////////////////////////////////////////////////////////////////////
 // Cylinder
 ////////////////////////////////////////////////////////////////////////////////
@@ -224,6 +247,7 @@ struct Frustum
 
 	bool inside(const Sphere& _sphere) const;
 	bool inside(const AlignedBox& _box) const;
+	bool inside(const OrientedBox& _box) const;
 	
 	bool insideIgnoreNear(const Sphere& _sphere) const;
 
@@ -235,6 +259,17 @@ private:
 }; // struct Frustum
 
 
+// Bounding volumes of a point set. _stride is the byte offset between points.
+// BoundingSphere() is near optimal: the minimum sphere (Welzl) of the extreme points along 7 directions is grown
+// to contain all points (Ritter), then iteratively shrunk and regrown to converge on a smaller sphere.
+// BoundingOrientedBox() fits the box to the principal axes of the point covariance (PCA), the aligned box is
+// returned if it has a smaller volume.
+AlignedBox  BoundingBox(const vec3* _points, uint32 _count, uint32 _stride = sizeof(vec3));
+Sphere      BoundingSphere(const vec3* _points, uint32 _count, uint32 _stride = sizeof(vec3));
+OrientedBox BoundingOrientedBox(const vec3* _points, uint32 _count, uint32 _stride = sizeof(vec3));
+// Smallest sphere which contains _sphere0 and _sphere1.
+Sphere      BoundingSphere(const Sphere& _sphere0, const Sphere& _sphere1);
+
 // Find the nearest point on a primitive to _point.
 vec3 Nearest(const Line& _line, const vec3& _point); 
 vec3 Nearest(const Ray& _ray, const vec3& _point);
@@ -0,0 +1,169 @@
+#include "parallel.h"
+
+#include <EASTL/vector.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+using namespace frm;
+using namespace apt;
+
+namespace {
+
+// Workers sleep until m_jobId changes, then pull chunks from the current job until none remain. The job is owned by 
+// the thread which called ParallelFor(), which also executes chunks and waits until all chunks are complete and all 
+// workers have left the job (such that a late worker can't pull chunks from the next job).
+class ThreadPool
+{
+public:
+	static ThreadPool& Get()
+	{
+		static ThreadPool s_instance;
+		return s_instance;
+	}
+
+	uint getThreadCount() const { uint limit = m_threadLimit; return limit > 0 && limit < m_threads.size() + 1 ? limit : (uint)m_threads.size() + 1; }
+	void setThreadLimit(uint _count) { m_threadLimit = _count; }
+
+	void run(uint32 _count, uint32 _grainSize, ParallelForFunc* _func, void* _ctx)
+	{
+		std::unique_lock<std::mutex> runLock(m_runMutex, std::try_to_lock);
+		if (s_isWorker || !runLock.owns_lock() || getThreadCount() < 2) {
+		 // nested or concurrent call, run serially
+			_func(_ctx, 0, _count);
+			return;
+		}
+
+		{	std::lock_guard<std::mutex> lock(m_mutex);
+			m_func          = _func;
+			m_ctx           = _ctx;
+			m_count         = _count;
+			m_grainSize     = _grainSize;
+			m_nextChunk     = 0;
+			m_pendingChunks = (_count + _grainSize - 1) / _grainSize;
+			++m_jobId;
+		}
+		m_wakeCondition.notify_all();
+
+		execute(_func, _ctx, _count, _grainSize);
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_doneCondition.wait(lock, [this]{ return m_pendingChunks == 0 && m_activeWorkers == 0; });
+		m_func = nullptr;
+	}
+
+private:
+	static thread_local bool s_isWorker;
+
+	eastl::vector<std::thread> m_threads;
+	std::mutex                 m_runMutex;      // serializes calls to run()
+	std::mutex                 m_mutex;         // protects the job state
+	std::condition_variable    m_wakeCondition;
+	std::condition_variable    m_doneCondition;
+	bool                       m_shutdown      = false;
+	uint64                     m_jobId         = 0;
+	uint                       m_activeWorkers = 0;
+	std::atomic<uint>          m_threadLimit;   // 0 = all threads
+
+	ParallelForFunc*           m_func          = nullptr;
+	void*                      m_ctx           = nullptr;
+	uint32                     m_count         = 0;
+	uint32                     m_grainSize     = 1;
+	std::atomic<uint32>        m_nextChunk;
+	std::atomic<uint32>        m_pendingChunks;
+
+	ThreadPool()
+		: m_nextChunk(0)
+		, m_pendingChunks(0)
+		, m_threadLimit(0)
+	{
+		uint threadCount = std::thread::hardware_concurrency();
+		threadCount = threadCount > 1 ? threadCount - 1 : 0;
+		for (uint i = 0; i < threadCount; ++i) {
+			m_threads.push_back(std::thread(&ThreadPool::workerMain, this, i));
+		}
+	}
+
+	~ThreadPool()
+	{
+		{	std::lock_guard<std::mutex> lock(m_mutex);
+			m_shutdown = true;
+		}
+		m_wakeCondition.notify_all();
+		for (auto& thread : m_threads) {
+			thread.join();
+		}
+	}
+
+	void workerMain(uint _index)
+	{
+		s_isWorker = true;
+		uint64 jobId = 0;
+		for (;;) {
+			ParallelForFunc* func;
+			void*  ctx;
+			uint32 count, grainSize;
+			{	std::unique_lock<std::mutex> lock(m_mutex);
+			 // workers beyond the thread limit skip jobs (the calling thread is thread 0)
+				m_wakeCondition.wait(lock, [this, jobId, _index]{ return m_shutdown || (m_jobId != jobId && m_func != nullptr && _index + 1 < getThreadCount()); });
+				if (m_shutdown) {
+					return;
+				}
+				jobId     = m_jobId;
+				func      = m_func;
+				ctx       = m_ctx;
+				count     = m_count;
+				grainSize = m_grainSize;
+				++m_activeWorkers;
+			}
+			execute(func, ctx, count, grainSize);
+			{	std::lock_guard<std::mutex> lock(m_mutex);
+				--m_activeWorkers;
+			}
+			m_doneCondition.notify_all();
+		}
+	}
+
+	void execute(ParallelForFunc* _func, void* _ctx, uint32 _count, uint32 _grainSize)
+	{
+		uint32 chunkCount = (_count + _grainSize - 1) / _grainSize;
+		for (uint32 chunk = m_nextChunk++; chunk < chunkCount; chunk = m_nextChunk++) {
+			uint32 begin = chunk * _grainSize;
+			uint32 end   = begin + _grainSize < _count ? begin + _grainSize : _count;
+			_func(_ctx, begin, end);
+			if (--m_pendingChunks == 0) {
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_doneCondition.notify_all();
+			}
+		}
+	}
+};
+
+thread_local bool ThreadPool::s_isWorker = false;
+
+} // namespace
+
+uint frm::GetParallelThreadCount()
+{
+	return ThreadPool::Get().getThreadCount();
+}
+
+void frm::SetParallelThreadLimit(uint _count)
+{
+	ThreadPool::Get().setThreadLimit(_count);
+}
+
+void frm::ParallelFor(uint32 _count, uint32 _grainSize, ParallelForFunc* _func, void* _ctx)
+{
+	if (_count == 0) {
+		return;
+	}
+	_grainSize = _grainSize > 0 ? _grainSize : 1;
+	if (_count <= _grainSize) {
+		_func(_ctx, 0, _count);
+		return;
+	}
+	ThreadPool::Get().run(_count, _grainSize, _func, _ctx);
+}
@@ -0,0 +1,37 @@
+#pragma once
+#ifndef frm_parallel_h
+#define frm_parallel_h
+
+#include <frm/core/def.h>
+
+#include <type_traits>
+
+namespace frm {
+
+// Number of threads which execute ParallelFor() chunks, including the calling thread.
+uint GetParallelThreadCount();
+// Limit the number of threads which execute ParallelFor() chunks (e.g. for scaling tests), 0 removes the limit.
+void SetParallelThreadLimit(uint _count);
+
+// Split [0, _count) into chunks of _grainSize elements (the last chunk may be smaller) and call _func(begin, end) for
+// each chunk. Chunks are distributed between a pool of worker threads (created on the first call) and the calling 
+// thread, the function returns once all chunks are complete. Chunks may execute in any order, hence _func must only 
+// write to per-chunk data. Calls from inside _func, or concurrent calls from other threads, execute serially.
+typedef void (ParallelForFunc)(void* _ctx, uint32 _begin, uint32 _end);
+void ParallelFor(uint32 _count, uint32 _grainSize, ParallelForFunc* _func, void* _ctx);
+
+template <typename tFunc>
+inline void ParallelFor(uint32 _count, uint32 _grainSize, tFunc&& _func)
+{
+	ParallelFor(_count, _grainSize, 
+		[](void* _ctx, uint32 _begin, uint32 _end)
+		{
+			(*(typename std::remove_reference<tFunc>::type*)_ctx)(_begin, _end);
+		}, 
+		(void*)&_func
+		);
+}
+
+} // namespace frm
+
+#endif // frm_parallel_h
@@ -0,0 +1,76 @@
+#include <frm/core/MappedFile.h>
+
+#include <apt/log.h>
+#include <apt/platform.h>
+#include <apt/win.h>
+
+using namespace frm;
+
+/*******************************************************************************
+
+                               MappedFile::Impl
+
+*******************************************************************************/
+
+struct MappedFile::Impl
+{
+	HANDLE m_file;
+	HANDLE m_mapping;
+};
+
+
+/*******************************************************************************
+
+                                 MappedFile
+
+*******************************************************************************/
+
+// PUBLIC
+
+MappedFile* MappedFile::Create(const char* _path)
+{
+	HANDLE file = CreateFileA(_path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		return nullptr; // not an error, the file may not exist
+	}
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+		CloseHandle(file);
+		return nullptr;
+	}
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+	if (mapping == NULL) {
+		APT_LOG_ERR("MappedFile: CreateFileMapping failed for '%s'", _path);
+		CloseHandle(file);
+		return nullptr;
+	}
+	void* view = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+	if (view == NULL) {
+		APT_LOG_ERR("MappedFile: MapViewOfFile failed for '%s'", _path);
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return nullptr;
+	}
+
+	MappedFile* ret = new MappedFile;
+	ret->m_impl = new MappedFile::Impl;
+	ret->m_impl->m_file    = file;
+	ret->m_impl->m_mapping = mapping;
+	ret->m_data            = (char*)view;
+	ret->m_dataSize        = (uint64)size.QuadPart;
+	return ret;
+}
+
+void MappedFile::Destroy(MappedFile*& _inst_)
+{
+	APT_ASSERT(_inst_ != nullptr);
+	APT_ASSERT(_inst_->m_impl != nullptr);
+
+	APT_PLATFORM_VERIFY(UnmapViewOfFile(_inst_->m_data));
+	APT_PLATFORM_VERIFY(CloseHandle(_inst_->m_impl->m_mapping));
+	APT_PLATFORM_VERIFY(CloseHandle(_inst_->m_impl->m_file));
+
+	delete _inst_->m_impl;
+	delete _inst_;
+	_inst_ = nullptr;
+}
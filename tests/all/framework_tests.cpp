@@ -4,17 +4,25 @@
 #include <frm/core/gl.h>
 #include <frm/core/AppSample3d.h>
 #include <frm/core/Buffer.h>
+#include <frm/core/Camera.h>
 #include <frm/core/Curve.h>
 #include <frm/core/Framebuffer.h>
 #include <frm/core/GlContext.h>
 #include <frm/core/Input.h>
 #include <frm/core/LuaScript.h>
 #include <frm/core/Mesh.h>
+#include <frm/core/MeshBvh.h>
+#include <frm/core/MeshCodec.h>
 #include <frm/core/MeshData.h>
+#include <frm/core/MeshPool.h>
+#include <frm/core/parallel.h>
 #include <frm/core/Profiler.h>
 #include <frm/core/Property.h>
+#include <frm/core/Scene.h>
+#include <frm/core/SceneBvh.h>
 #include <frm/core/Shader.h>
 #include <frm/core/SkeletonAnimation.h>
+#include <frm/core/Skinning.h>
 #include <frm/core/Spline.h>
 #include <frm/core/Texture.h>
 #include <frm/core/Window.h>
@@ -27,7 +35,10 @@
 #include <apt/log.h>
 #include <apt/rand.h>
 #include <apt/ArgList.h>
+#include <apt/File.h>
+#include <apt/FileSystem.h>
 #include <apt/Image.h>
+#include <apt/Json.h>
 #include <apt/Quadtree.h>
 #include <apt/StringHash.h>
 
@@ -39,6 +50,20 @@
 using namespace frm;
 using namespace apt;
 
+// Deterministic xorshift generator for the test data, operator() returns a float in [0, 1].
+struct TestRand
+{
+	uint32 m_state = 0x9e3779b9;
+
+	uint32 raw()
+	{
+		m_state ^= m_state << 13; m_state ^= m_state >> 17; m_state ^= m_state << 5;
+		return m_state;
+	}
+
+	float operator()() { return (float)(raw() & 0xffffff) / (float)0xffffff; }
+};
+
 class AppSampleTest: public AppSample3d
 {
 public:
@@ -55,6 +80,7 @@ public:
 		Shader*             m_shMeshShaded;
 		Shader*             m_shMeshLines;
 		Buffer*             m_bfSkinning;
+		Skinning*           m_skinning;
 		mat4                m_worldMatrix;
 	} m_meshTest;
 
@@ -72,6 +98,8 @@ public:
 
 	frm::Texture* m_txTest;
 
+	MeshBvh* m_meshBvh;
+
 	AppSampleTest()
 		: AppBase("AppSampleTest") 
 	{
@@ -87,6 +115,8 @@ public:
 		depthTestProps.addPath ("Mesh Path",             "models/teapot.obj",                     &m_depthTest.m_meshPath);
 		depthTestProps.addInt  ("Mesh Count",            64,                                      1,      128,    &m_depthTest.m_meshCount);
 		depthTestProps.addFloat("Max Error",             0.0001f,                                 0.0f,   1.0f,   &m_depthTest.m_maxError);
+
+		m_meshBvh = nullptr;
 	}
 	
 	virtual bool init(const apt::ArgList& _args) override
@@ -104,6 +134,7 @@ public:
 	virtual void shutdown() override
 	{
 		Buffer::Destroy(m_meshTest.m_bfSkinning);
+		Skinning::Destroy(m_meshTest.m_skinning);
 		Mesh::Release(m_meshTest.m_mesh);
 		SkeletonAnimation::Release(m_meshTest.m_anim);
 		Shader::Release(m_meshTest.m_shMeshLines);
@@ -116,6 +147,8 @@ public:
 
 		Texture::Release(m_txRadar);
 
+		MeshBvh::Destroy(m_meshBvh);
+
 		AppBase::shutdown();
 	}
 
@@ -426,6 +459,1316 @@ public:
 			ImGui::TreePop();
 		}
 
+		//ImGui::SetNextTreeNodeOpen(true, ImGuiCond_Once);
+		if (ImGui::TreeNode("MeshBuilder")) {
+			static vec2   loadedStats, shuffledStats, optimizedStats, overdrawStats; // acmr, atvr
+			static float  optimizedOverdraw, overdrawOverdraw;
+			static double optimizeMs, overdrawMs;
+			static uint   cacheSize = 16;
+			static const int kLodCount = 5;
+			static uint32 lodTriangles[kLodCount];
+			static float  lodErrors[kLodCount];
+			static double simplifyMs;
+			static uint   meshletCount, visibleMeshletCount, drawCount;
+			static double meshletMs;
+			static double loadMs, cachedLoadMs;
+			static double objMbps, objReferenceMbps;
+			static uint   unpackedVertexSize, packedVertexSize;
+			static uint32 weldRemoved;
+			static double weldMs, tangentsMs;
+			APT_ONCE {
+			 // the first load writes the binary cache (if it didn't exist), the second load reads it
+				Timestamp t = Time::GetTimestamp();
+				MeshData* meshData = MeshData::Create("models/teapot.obj");
+				loadMs = (Time::GetTimestamp() - t).asMilliseconds();
+				APT_ASSERT(meshData);
+				t = Time::GetTimestamp();
+				MeshData* cachedMeshData = MeshData::Create("models/teapot.obj");
+				cachedLoadMs = (Time::GetTimestamp() - t).asMilliseconds();
+				APT_ASSERT(cachedMeshData);
+				APT_ASSERT(cachedMeshData->getDesc() == meshData->getDesc());
+				APT_ASSERT(cachedMeshData->getVertexCount() == meshData->getVertexCount() && cachedMeshData->getIndexCount() == meshData->getIndexCount());
+				APT_ASSERT(memcmp(cachedMeshData->getVertexData(), meshData->getVertexData(), meshData->getVertexCount() * meshData->getDesc().getVertexSize()) == 0);
+				APT_ASSERT(memcmp(cachedMeshData->getIndexData(), meshData->getIndexData(), meshData->getIndexCount() * DataTypeSizeBytes(meshData->getIndexDataType())) == 0);
+				MeshData::Destroy(cachedMeshData);
+
+			 // OBJ reader throughput vs. the reference (tinyobj) reader, both include the post process
+				File objFile;
+				APT_VERIFY(FileSystem::Read(objFile, "models/teapot.obj"));
+				for (int reference = 0; reference < 2; ++reference) {
+					const int kRepeatCount = 8;
+					t = Time::GetTimestamp();
+					for (int i = 0; i < kRepeatCount; ++i) {
+						MeshData* objMeshData = MeshData::CreateObj(objFile.getData(), objFile.getDataSize(), reference != 0);
+						APT_ASSERT(objMeshData);
+						APT_ASSERT(objMeshData->getIndexCount() == meshData->getIndexCount());
+						MeshData::Destroy(objMeshData);
+					}
+					double ms = (Time::GetTimestamp() - t).asMilliseconds() / kRepeatCount;
+					(reference ? objReferenceMbps : objMbps) = (double)objFile.getDataSize() / (1024.0 * 1024.0) / (ms / 1000.0);
+				}
+
+				MeshBuilder meshBuilder;
+				meshBuilder.beginSubmesh(0);
+				meshBuilder.addVertexData(meshData->getDesc(), meshData->getVertexData(), meshData->getVertexCount());
+				meshBuilder.addIndexData(meshData->getIndexDataType(), meshData->getIndexData(), meshData->getIndexCount());
+				meshBuilder.endSubmesh();
+				MeshDesc meshDesc = meshData->getDesc();
+				MeshData::Destroy(meshData);
+				meshBuilder.getVertexCacheStats(cacheSize, loadedStats.x, loadedStats.y);
+
+			 // shuffle the triangles to simulate an unstructured mesh (e.g. a scan)
+				TestRand rnd;
+				for (uint32 i = meshBuilder.getTriangleCount() - 1; i > 0; --i) {
+					eastl::swap(meshBuilder.getTriangle(i), meshBuilder.getTriangle(rnd.raw() % (i + 1)));
+				}
+				meshBuilder.getVertexCacheStats(cacheSize, shuffledStats.x, shuffledStats.y);
+
+				t = Time::GetTimestamp();
+				meshBuilder.optimizeVertexCache();
+				meshBuilder.optimizeVertexFetch();
+				optimizeMs = (Time::GetTimestamp() - t).asMilliseconds();
+				meshBuilder.getVertexCacheStats(cacheSize, optimizedStats.x, optimizedStats.y);
+
+				APT_ASSERT(optimizedStats.x < shuffledStats.x * 0.5f);
+				APT_ASSERT(optimizedStats.y < shuffledStats.y * 0.5f);
+
+				optimizedOverdraw = meshBuilder.estimateOverdraw();
+				t = Time::GetTimestamp();
+				meshBuilder.optimizeOverdraw(1.05f);
+				overdrawMs = (Time::GetTimestamp() - t).asMilliseconds();
+				meshBuilder.getVertexCacheStats(cacheSize, overdrawStats.x, overdrawStats.y);
+				overdrawOverdraw = meshBuilder.estimateOverdraw();
+
+				APT_ASSERT(overdrawOverdraw < optimizedOverdraw);
+				APT_ASSERT(overdrawStats.x < optimizedStats.x * 1.1f);
+				for (uint32 i = 0; i < meshBuilder.getTriangleCount(); ++i) {
+					const MeshBuilder::Triangle& tri = meshBuilder.getTriangle(i);
+					APT_ASSERT(tri.a < meshBuilder.getVertexCount() && tri.b < meshBuilder.getVertexCount() && tri.c < meshBuilder.getVertexCount());
+				}
+
+			 // LOD chain, each LOD halves the triangle count of the previous
+				MeshData* lodData = MeshData::Create(meshDesc, meshBuilder);
+				MeshBuilder lod = meshBuilder;
+				lodTriangles[0] = lod.getTriangleCount();
+				lodErrors[0] = 0.0f;
+				t = Time::GetTimestamp();
+				for (int i = 1; i < kLodCount; ++i) {
+					lodErrors[i] = lod.simplify(lod.getTriangleCount() / 2, 0.1f);
+					lodTriangles[i] = lod.getTriangleCount();
+					APT_ASSERT(lodTriangles[i] < lodTriangles[i - 1]);
+					APT_ASSERT(lodErrors[i] <= 0.1f);
+					lod.optimizeVertexCache();
+					lodData->addLod(lod, lodErrors[i]);
+				}
+				simplifyMs = (Time::GetTimestamp() - t).asMilliseconds();
+				APT_ASSERT(lodData->getLodCount() == kLodCount);
+				for (int i = 0; i < kLodCount; ++i) {
+					APT_ASSERT(lodData->getLod(i).m_indexCount == lodTriangles[i] * 3);
+				}
+				MeshData::Destroy(lodData);
+
+			 // welding, split every triangle corner into a unique vertex then weld back to the original vertex count
+				{
+					MeshBuilder unwelded;
+					unwelded.beginSubmesh(0);
+					for (uint32 i = 0; i < meshBuilder.getTriangleCount(); ++i) {
+						const MeshBuilder::Triangle& tri = meshBuilder.getTriangle(i);
+						unwelded.addTriangle(unwelded.addVertex(meshBuilder.getVertex(tri.a)), unwelded.addVertex(meshBuilder.getVertex(tri.b)), unwelded.addVertex(meshBuilder.getVertex(tri.c)));
+					}
+					unwelded.endSubmesh();
+					t = Time::GetTimestamp();
+					weldRemoved = unwelded.weld();
+					weldMs = (Time::GetTimestamp() - t).asMilliseconds();
+					APT_ASSERT(unwelded.getVertexCount() <= meshBuilder.getVertexCount());
+					APT_ASSERT(unwelded.getTriangleCount() <= meshBuilder.getTriangleCount());
+					APT_ASSERT(unwelded.getSubmesh(0).m_vertexCount == unwelded.getVertexCount());
+
+				 // normal/tangent generation is deterministic, regenerating must give bit-identical results
+					t = Time::GetTimestamp();
+					unwelded.generateNormals();
+					unwelded.generateTangents(true);
+					tangentsMs = (Time::GetTimestamp() - t).asMilliseconds();
+					MeshBuilder regenerated = unwelded;
+					regenerated.generateNormals();
+					regenerated.generateTangents(true);
+					for (uint32 i = 0; i < unwelded.getVertexCount(); ++i) {
+						const MeshBuilder::Vertex& a = unwelded.getVertex(i);
+						const MeshBuilder::Vertex& b = regenerated.getVertex(i);
+						APT_ASSERT(memcmp(&a.m_normal, &b.m_normal, sizeof(vec3)) == 0 && memcmp(&a.m_tangent, &b.m_tangent, sizeof(vec4)) == 0);
+						APT_ASSERT(fabs(dot(a.m_normal, a.m_tangent.xyz())) < 1e-4f && fabs(a.m_tangent.w) == 1.0f);
+					}
+				}
+
+			 // vertex packing, round trip via a MeshBuilder and check the error against the budget
+				{
+					const float kMaxPositionError = 1e-4f;
+					const float kMaxNormalError   = 1e-3f;
+					MeshDesc packedDesc = MeshData::PackDesc(meshDesc, meshBuilder, kMaxPositionError, kMaxNormalError);
+					unpackedVertexSize = meshDesc.getVertexSize();
+					packedVertexSize = packedDesc.getVertexSize();
+					APT_ASSERT(packedVertexSize < unpackedVertexSize);
+					MeshData* packedData = MeshData::Create(packedDesc, meshBuilder);
+					APT_ASSERT(packedData->getDesc().isPositionQuantized() == DataTypeIsNormalized(packedData->getDesc().findVertexAttr(VertexAttr::Semantic_Positions)->getDataType()));
+				 // setVertexData() must encode/quantize as per the MeshBuilder conversion
+					{
+						eastl::vector<vec3> positions(meshBuilder.getVertexCount()), normals(meshBuilder.getVertexCount());
+						for (uint32 i = 0; i < meshBuilder.getVertexCount(); ++i) {
+							positions[i] = meshBuilder.getVertex(i).m_position;
+							normals[i]   = meshBuilder.getVertex(i).m_normal;
+						}
+						MeshData* encodedData = MeshData::Create(packedData->getDesc(), meshBuilder);
+						encodedData->setVertexData(VertexAttr::Semantic_Positions, DataType_Float32, 3, positions.data());
+						encodedData->setVertexData(VertexAttr::Semantic_Normals,   DataType_Float32, 3, normals.data());
+						APT_ASSERT(memcmp(encodedData->getVertexData(), packedData->getVertexData(), packedData->getVertexCount() * packedVertexSize) == 0);
+						MeshData::Destroy(encodedData);
+					}
+					MeshBuilder unpacked;
+					unpacked.beginSubmesh(0);
+					unpacked.addVertexData(packedData->getDesc(), packedData->getVertexData(), packedData->getVertexCount());
+					unpacked.endSubmesh();
+					MeshData::Destroy(packedData);
+					const AlignedBox& box = meshBuilder.getSubmesh(0).m_boundingBox;
+					const vec3 boxSize = box.m_max - box.m_min;
+					const float maxSize = APT_MAX(boxSize.x, APT_MAX(boxSize.y, boxSize.z));
+					for (uint32 i = 0; i < meshBuilder.getVertexCount(); ++i) {
+						const MeshBuilder::Vertex& a = meshBuilder.getVertex(i);
+						const MeshBuilder::Vertex& b = unpacked.getVertex(i);
+						APT_ASSERT(length(a.m_position - b.m_position) / maxSize <= kMaxPositionError);
+						APT_ASSERT(length(normalize(a.m_normal) - normalize(b.m_normal)) <= kMaxNormalError * 1.01f); // chord <= angle
+					}
+				}
+
+			 // meshlets + cluster culling, view the mesh from the front such that the back faces are cone culled
+				t = Time::GetTimestamp();
+				meshBuilder.buildMeshlets(64, 124);
+				meshletMs = (Time::GetTimestamp() - t).asMilliseconds();
+				meshletCount = meshBuilder.getMeshletCount();
+				uint32 meshletIndexCount = 0;
+				for (uint32 i = 0; i < meshletCount; ++i) {
+					const MeshData::Meshlet& meshlet = meshBuilder.getMeshlet(i);
+					APT_ASSERT(meshlet.m_indexOffset == meshletIndexCount);
+					APT_ASSERT(meshlet.m_vertexCount <= 64 && meshlet.m_indexCount <= 124 * 3);
+					meshletIndexCount += meshlet.m_indexCount;
+				}
+				APT_ASSERT(meshletIndexCount == meshBuilder.getIndexCount());
+
+				MeshData* meshletData = MeshData::Create(meshDesc, meshBuilder);
+				Mesh* meshletMesh = Mesh::Create(*meshletData);
+				MeshData::Destroy(meshletData);
+				Camera camera;
+				camera.setPerspective(Radians(45.0f), 1.0f, 0.1f, 100.0f);
+				camera.lookAt(vec3(0.0f, 0.5f, 4.0f), vec3(0.0f, 0.5f, 0.0f));
+				camera.updateView();
+				camera.updateProj();
+				eastl::vector<Buffer::DrawElementsIndirectCommand> drawCommands(meshletMesh->getMeshletCount());
+				drawCount = meshletMesh->cullMeshlets(camera.m_worldFrustum, camera.getPosition(), drawCommands.data());
+				visibleMeshletCount = 0;
+				for (uint i = 0; i < meshletMesh->getMeshletCount(); ++i) {
+					const MeshData::Meshlet& meshlet = meshletMesh->getMeshlet(i);
+					for (uint j = 0; j < drawCount; ++j) {
+						uint firstIndex = meshlet.m_indexOffset / (meshletMesh->getIndexDataType() == GL_UNSIGNED_SHORT ? 2 : 4);
+						if (firstIndex >= drawCommands[j].m_firstIndex && firstIndex < drawCommands[j].m_firstIndex + drawCommands[j].m_indexCount) {
+							++visibleMeshletCount;
+							break;
+						}
+					}
+				}
+				APT_ASSERT(visibleMeshletCount > 0 && visibleMeshletCount < meshletCount);
+				APT_ASSERT(drawCount <= visibleMeshletCount);
+				Mesh::Release(meshletMesh);
+			}
+
+			ImGui::Text("Load: %.2fms, cached %.2fms", loadMs, cachedLoadMs);
+			ImGui::Text("OBJ: %.1fMB/s, reference %.1fMB/s", objMbps, objReferenceMbps);
+			ImGui::Text("Vertex Cache (FIFO %u)", cacheSize);
+			ImGui::Text("  Loaded:    ACMR %.3f, ATVR %.3f", loadedStats.x,    loadedStats.y);
+			ImGui::Text("  Shuffled:  ACMR %.3f, ATVR %.3f", shuffledStats.x,  shuffledStats.y);
+			ImGui::Text("  Optimized: ACMR %.3f, ATVR %.3f, overdraw %.3f (%.2fms)", optimizedStats.x, optimizedStats.y, optimizedOverdraw, optimizeMs);
+			ImGui::Text("  Overdraw:  ACMR %.3f, ATVR %.3f, overdraw %.3f (%.2fms)", overdrawStats.x, overdrawStats.y, overdrawOverdraw, overdrawMs);
+			ImGui::Text("LODs (%.2fms)", simplifyMs);
+			for (int i = 0; i < kLodCount; ++i) {
+				ImGui::Text("  %d: %u triangles, error %.4f", i, lodTriangles[i], lodErrors[i]);
+			}
+			ImGui::Text("Meshlets: %u (%.2fms), %u visible, %u draws", meshletCount, meshletMs, visibleMeshletCount, drawCount);
+			ImGui::Text("Weld: %u vertices removed (%.2fms)", weldRemoved, weldMs);
+			ImGui::Text("Normals + MikkTSpace tangents: %.2fms", tangentsMs);
+			ImGui::Text("Packed vertex size: %u -> %u bytes", unpackedVertexSize, packedVertexSize);
+
+		 // AoS vs. SoA vertex layout on a large grid, only positions/normals/texcoords/bone weights are allocated for SoA
+			static const uint32 kSoaGridSize = 3163; // ~10M vertices
+			static double soaMs[2][5] = {};
+			if (ImGui::Button("Benchmark AoS vs. SoA (10M vertices)")) {
+				for (int layout = 0; layout < 2; ++layout) {
+					MeshBuilder grid;
+					grid.setLayout((MeshBuilder::Layout)layout, 
+						(1u << VertexAttr::Semantic_Positions) | (1u << VertexAttr::Semantic_Normals) | (1u << VertexAttr::Semantic_Texcoords) | (1u << VertexAttr::Semantic_BoneWeights)
+						);
+					MeshBuilder::Vertex vertex;
+					memset(&vertex, 0, sizeof(MeshBuilder::Vertex));
+					vertex.m_boneWeights = vec4(0.4f, 0.3f, 0.2f, 0.1f);
+					for (uint32 y = 0; y < kSoaGridSize; ++y) {
+						for (uint32 x = 0; x < kSoaGridSize; ++x) {
+							vertex.m_position = vec3((float)x, sinf((float)x * 0.1f) * cosf((float)y * 0.1f), (float)y);
+							vertex.m_texcoord = vec2((float)x, (float)y) / (float)kSoaGridSize;
+							grid.addVertex(vertex);
+						}
+					}
+					for (uint32 y = 0; y < kSoaGridSize - 1; ++y) {
+						for (uint32 x = 0; x < kSoaGridSize - 1; ++x) {
+							uint32 i = y * kSoaGridSize + x;
+							grid.addTriangle(i, i + kSoaGridSize, i + 1);
+							grid.addTriangle(i + 1, i + kSoaGridSize, i + kSoaGridSize + 1);
+						}
+					}
+
+					Timestamp t = Time::GetTimestamp();
+					grid.transform(RotationMatrix(vec3(0.0f, 1.0f, 0.0f), Radians(30.0f)));
+					soaMs[layout][0] = (Time::GetTimestamp() - t).asMilliseconds();
+					t = Time::GetTimestamp();
+					grid.transformTexcoords(mat3(2.0f));
+					soaMs[layout][1] = (Time::GetTimestamp() - t).asMilliseconds();
+					t = Time::GetTimestamp();
+					grid.normalizeBoneWeights();
+					soaMs[layout][2] = (Time::GetTimestamp() - t).asMilliseconds();
+					t = Time::GetTimestamp();
+					grid.generateNormals();
+					soaMs[layout][3] = (Time::GetTimestamp() - t).asMilliseconds();
+					t = Time::GetTimestamp();
+					grid.updateBounds();
+					soaMs[layout][4] = (Time::GetTimestamp() - t).asMilliseconds();
+				}
+			}
+			for (int layout = 0; layout < 2; ++layout) {
+				ImGui::Text("  %s: transform %.2fms, texcoords %.2fms, bone weights %.2fms, normals %.2fms, bounds %.2fms", layout ? "SoA" : "AoS", 
+					soaMs[layout][0], soaMs[layout][1], soaMs[layout][2], soaMs[layout][3], soaMs[layout][4]);
+			}
+
+			ImGui::TreePop();
+		}
+
+		//ImGui::SetNextTreeNodeOpen(true, ImGuiCond_Once);
+		if (ImGui::TreeNode("MeshBvh")) {
+			static double bvhBuildMs, closestMrays, anyMrays;
+			APT_ONCE {
+				MeshData* meshData = MeshData::Create("models/teapot.obj");
+				APT_ASSERT(meshData);
+				Timestamp t = Time::GetTimestamp();
+				m_meshBvh = MeshBvh::Create(*meshData);
+				bvhBuildMs = (Time::GetTimestamp() - t).asMilliseconds();
+				MeshData::Destroy(meshData);
+
+			 // rays from a sphere around the mesh toward random points inside the bounding box
+				const AlignedBox& box = m_meshBvh->getBoundingBox();
+				const vec3  center = (box.m_min + box.m_max) * 0.5f;
+				const float radius = length(box.m_max - box.m_min);
+				const int kRayCount = 100000;
+				eastl::vector<Ray> rays(kRayCount);
+				TestRand Rand;
+				for (auto& ray : rays) {
+					vec3 origin = center + normalize(vec3(Rand(), Rand(), Rand()) - vec3(0.5f)) * radius;
+					vec3 target = box.m_min + (box.m_max - box.m_min) * vec3(Rand(), Rand(), Rand());
+					ray = Ray(origin, normalize(target - origin));
+				}
+				for (int anyHit = 0; anyHit < 2; ++anyHit) {
+					uint32 hitCount = 0;
+					t = Time::GetTimestamp();
+					for (auto& ray : rays) {
+						MeshBvh::Hit hit;
+						hitCount += (anyHit ? m_meshBvh->intersects(ray) : m_meshBvh->intersect(ray, hit)) ? 1 : 0;
+					}
+					double s = (Time::GetTimestamp() - t).asSeconds();
+					(anyHit ? anyMrays : closestMrays) = (double)kRayCount / s / 1e6;
+					APT_ASSERT(hitCount > 0 && hitCount < (uint32)kRayCount);
+				}
+				for (int i = 0; i < 1000; ++i) {
+					MeshBvh::Hit hit;
+					bool closest = m_meshBvh->intersect(rays[i], hit);
+					APT_ASSERT(closest == m_meshBvh->intersects(rays[i]));
+					if (closest) {
+						APT_ASSERT(!m_meshBvh->intersects(rays[i], hit.m_t * 0.999f)); // no closer hit
+						APT_ASSERT(m_meshBvh->intersects(LineSegment(rays[i].m_origin, rays[i].m_origin + rays[i].m_direction * (hit.m_t * 1.001f))));
+					}
+				}
+			}
+
+			ImGui::Text("%u triangles, %u nodes, depth %u (%.2fms)", m_meshBvh->getTriangleCount(), m_meshBvh->getNodeCount(), m_meshBvh->getMaxDepth(), bvhBuildMs);
+			ImGui::Text("Closest hit: %.2f Mrays/s, any hit: %.2f Mrays/s", closestMrays, anyMrays);
+
+		 // cursor picking
+			Ray cursorRay = getCursorRayW();
+			MeshBvh::Hit hit;
+			if (m_meshBvh->intersect(cursorRay, hit)) {
+				ImGui::Text("Cursor: triangle %u, t = %.3f", hit.m_triangle, hit.m_t);
+				Im3d::PushDrawState();
+				Im3d::SetColor(Im3d::Color_Magenta);
+				Im3d::SetSize(8.0f);
+				Im3d::BeginPoints();
+					Im3d::Vertex(cursorRay.m_origin + cursorRay.m_direction * hit.m_t);
+				Im3d::End();
+				Im3d::PopDrawState();
+			}
+			Im3d::DrawAlignedBox(m_meshBvh->getBoundingBox().m_min, m_meshBvh->getBoundingBox().m_max);
+
+			ImGui::TreePop();
+		}
+
+		//ImGui::SetNextTreeNodeOpen(true, ImGuiCond_Once);
+		if (ImGui::TreeNode("Bounding Volumes")) {
+		 // cull rate of the tight bounding volumes vs. the sphere derived from the aligned box, for randomly placed
+		 // teapot instances
+			enum Volume { Volume_BoxSphere, Volume_Sphere, Volume_OrientedBox, Volume_Count };
+			static const char* kVolumeNames[Volume_Count] = { "Box sphere", "Tight sphere", "Oriented box" };
+			static const int kInstanceCount = 10000;
+			static eastl::vector<Sphere>      boxSpheres(kInstanceCount);
+			static eastl::vector<Sphere>      spheres(kInstanceCount);
+			static eastl::vector<OrientedBox> orientedBoxes(kInstanceCount);
+			static Sphere      localSphere;
+			static OrientedBox localOrientedBox;
+			static AlignedBox  localBox;
+			static double boundsMs;
+			static uint32 boundsVertexCount;
+			APT_ONCE {
+				MeshData* meshData = MeshData::Create("models/teapot.obj");
+				APT_ASSERT(meshData);
+				MeshBuilder meshBuilder;
+				meshBuilder.beginSubmesh(0);
+				meshBuilder.addVertexData(meshData->getDesc(), meshData->getVertexData(), meshData->getVertexCount());
+				meshBuilder.addIndexData(meshData->getIndexDataType(), meshData->getIndexData(), meshData->getIndexCount());
+				meshBuilder.endSubmesh();
+				MeshData::Destroy(meshData);
+
+				Timestamp t = Time::GetTimestamp();
+				meshBuilder.updateBounds();
+				boundsMs = (Time::GetTimestamp() - t).asMilliseconds();
+				boundsVertexCount = meshBuilder.getVertexCount();
+				localBox         = meshBuilder.getBoundingBox();
+				localSphere      = meshBuilder.getBoundingSphere();
+				localOrientedBox = meshBuilder.getBoundingOrientedBox();
+				APT_ASSERT(localSphere.m_radius <= Sphere(localBox).m_radius);
+				APT_ASSERT(localOrientedBox.getVolume() <= OrientedBox(localBox).getVolume() * 1.0001f);
+				for (uint32 i = 0; i < meshBuilder.getVertexCount(); ++i) {
+					const vec3& p = meshBuilder.getVertex(i).m_position;
+					APT_ASSERT(length(p - localSphere.m_origin) <= localSphere.m_radius * 1.0001f);
+					for (int j = 0; j < 3; ++j) {
+						APT_ASSERT(abs(dot(p - localOrientedBox.m_origin, localOrientedBox.m_axes[j])) <= localOrientedBox.m_extents[j] * 1.0001f + 1e-5f);
+					}
+				}
+
+				TestRand Rand;
+				for (int i = 0; i < kInstanceCount; ++i) {
+					vec3 position = (vec3(Rand(), Rand(), Rand()) - vec3(0.5f)) * 200.0f;
+					quat orientation = RotationQuaternion(normalize(vec3(Rand(), Rand(), Rand()) - vec3(0.5f)), Rand() * 2.0f * kPi);
+					mat4 world = TransformationMatrix(position, orientation, vec3(0.5f + Rand() * 1.5f));
+					boxSpheres[i] = Sphere(localBox);
+					boxSpheres[i].transform(world);
+					spheres[i] = localSphere;
+					spheres[i].transform(world);
+					orientedBoxes[i] = localOrientedBox;
+					orientedBoxes[i].transform(world);
+				}
+			}
+
+			ImGui::Text("updateBounds(): %.3fms (%u vertices)", boundsMs, boundsVertexCount);
+			const Frustum& frustum = Scene::GetCullCamera()->m_worldFrustum;
+			int culled[Volume_Count] = {};
+			double cullMs[Volume_Count];
+			for (int volume = 0; volume < Volume_Count; ++volume) {
+				Timestamp t = Time::GetTimestamp();
+				for (int i = 0; i < kInstanceCount; ++i) {
+					bool inside = 
+						volume == Volume_BoxSphere ? frustum.inside(boxSpheres[i]) :
+						volume == Volume_Sphere    ? frustum.inside(spheres[i]) :
+						                             frustum.inside(orientedBoxes[i])
+						;
+					culled[volume] += inside ? 0 : 1;
+				}
+				cullMs[volume] = (Time::GetTimestamp() - t).asMilliseconds();
+			}
+			APT_ASSERT(culled[Volume_Sphere] >= culled[Volume_BoxSphere]);
+			for (int volume = 0; volume < Volume_Count; ++volume) {
+				ImGui::Text("%-14s culled %5d/%d (%5.1f%%, %.3fms)", kVolumeNames[volume], culled[volume], kInstanceCount, (float)culled[volume] / kInstanceCount * 100.0f, cullMs[volume]);
+			}
+
+			Im3d::PushDrawState();
+			Im3d::SetColor(Im3d::Color_Yellow);
+			Im3d::DrawSphere(localBox.getOrigin(), Sphere(localBox).m_radius);
+			Im3d::SetColor(Im3d::Color_Green);
+			Im3d::DrawSphere(localSphere.m_origin, localSphere.m_radius);
+			Im3d::SetColor(Im3d::Color_Cyan);
+			const mat3& axes = localOrientedBox.m_axes;
+			Im3d::PushMatrix(mat4(vec4(axes[0], 0.0f), vec4(axes[1], 0.0f), vec4(axes[2], 0.0f), vec4(localOrientedBox.m_origin, 1.0f)));
+				Im3d::DrawAlignedBox(-localOrientedBox.m_extents, localOrientedBox.m_extents);
+			Im3d::PopMatrix();
+			Im3d::PopDrawState();
+
+			ImGui::TreePop();
+		}
+
+		//ImGui::SetNextTreeNodeOpen(true, ImGuiCond_Once);
+		if (ImGui::TreeNode("Index Compaction")) {
+		 // index memory saved by MeshData::compactIndexData() across all the models in the asset directory
+			static const int kMaxFiles = 256;
+			static int    fileCount;
+			static uint64 totalBytes, narrowedBytes, stripBytes;
+			static int    stripMeshCount;
+			static double compactMs;
+			APT_ONCE {
+				static PathStr files[kMaxFiles];
+				fileCount = FileSystem::ListFiles(files, kMaxFiles, "models", { "*.obj", "*.md5mesh" }, true);
+				Timestamp t = Time::GetTimestamp();
+				for (int i = 0; i < APT_MIN(fileCount, kMaxFiles); ++i) {
+					for (int strips = 0; strips < 2; ++strips) {
+						MeshData* meshData = MeshData::Create((const char*)files[i]);
+						if (!meshData) {
+							continue;
+						}
+						eastl::vector<uint32> before, after;
+						meshData->getTriangles(before);
+						uint bytes = meshData->getIndexCount() * DataTypeSizeBytes(meshData->getIndexDataType());
+						uint saved = meshData->compactIndexData(strips != 0);
+						meshData->getTriangles(after);
+						APT_ASSERT(strips || before == after); // lists are only narrowed/rebased
+						APT_ASSERT(after.size() <= before.size()); // strips skip degenerate triangles
+						if (strips) {
+							stripBytes += saved;
+							stripMeshCount += meshData->getDesc().getPrimitive() == MeshDesc::Primitive_TriangleStrip ? 1 : 0;
+						} else {
+							totalBytes += bytes;
+							narrowedBytes += saved;
+						}
+						MeshData::Destroy(meshData);
+					}
+				}
+				compactMs = (Time::GetTimestamp() - t).asMilliseconds();
+			}
+			ImGui::Text("%d files, %llu index bytes (%.2fms)", fileCount, totalBytes, compactMs);
+			ImGui::Text("Narrowed: saved %llu bytes (%.1f%%)", narrowedBytes, totalBytes ? (double)narrowedBytes / totalBytes * 100.0 : 0.0);
+			ImGui::Text("Strips:   saved %llu bytes (%.1f%%), %d meshes converted", stripBytes, totalBytes ? (double)stripBytes / totalBytes * 100.0 : 0.0, stripMeshCount);
+
+			ImGui::TreePop();
+		}
+
+		if (ImGui::TreeNode("Mesh Codec")) {
+		 // compression ratio and decode throughput of MeshCodec across all the models in the asset directory
+			static const int kMaxFiles = 256;
+			static const int kDecodeRepeat = 16;
+			static int    fileCount;
+			static uint64 vertexBytes, vertexEncodedBytes, indexBytes, indexEncodedBytes;
+			static double vertexDecodeSeconds, indexDecodeSeconds;
+			APT_ONCE {
+				static PathStr files[kMaxFiles];
+				fileCount = FileSystem::ListFiles(files, kMaxFiles, "models", { "*.obj", "*.md5mesh" }, true);
+				for (int i = 0; i < APT_MIN(fileCount, kMaxFiles); ++i) {
+					MeshData* meshData = MeshData::Create((const char*)files[i]);
+					if (!meshData) {
+						continue;
+					}
+					uint vertexCount = meshData->getVertexCount();
+					uint vertexSize  = meshData->getDesc().getVertexSize();
+					uint indexCount  = meshData->getIndexCount();
+					DataType indexType = meshData->getIndexDataType();
+
+					eastl::vector<char> encoded(EncodeVertexDataBound(vertexCount, vertexSize));
+					eastl::vector<char> decoded(vertexCount * vertexSize);
+					uint encodedSize = EncodeVertexData(meshData->getVertexData(), vertexCount, vertexSize, encoded.data());
+					Timestamp t = Time::GetTimestamp();
+					for (int j = 0; j < kDecodeRepeat; ++j) {
+						DecodeVertexData(encoded.data(), encodedSize, vertexCount, vertexSize, decoded.data());
+					}
+					vertexDecodeSeconds += (Time::GetTimestamp() - t).asSeconds();
+					APT_ASSERT(memcmp(decoded.data(), meshData->getVertexData(), decoded.size()) == 0);
+					vertexBytes += decoded.size();
+					vertexEncodedBytes += encodedSize;
+
+					encoded.resize(EncodeIndexDataBound(indexCount));
+					decoded.resize(indexCount * DataTypeSizeBytes(indexType));
+					encodedSize = EncodeIndexData(meshData->getIndexData(), indexType, indexCount, encoded.data());
+					t = Time::GetTimestamp();
+					for (int j = 0; j < kDecodeRepeat; ++j) {
+						DecodeIndexData(encoded.data(), encodedSize, indexType, indexCount, decoded.data());
+					}
+					indexDecodeSeconds += (Time::GetTimestamp() - t).asSeconds();
+					APT_ASSERT(memcmp(decoded.data(), meshData->getIndexData(), decoded.size()) == 0);
+					indexBytes += decoded.size();
+					indexEncodedBytes += encodedSize;
+
+					MeshData::Destroy(meshData);
+				}
+			}
+			ImGui::Text("%d files", fileCount);
+			ImGui::Text("Vertex: %llu -> %llu bytes (%.1f%%), decode %.2f GB/s", vertexBytes, vertexEncodedBytes, vertexBytes ? (double)vertexEncodedBytes / vertexBytes * 100.0 : 0.0, vertexDecodeSeconds > 0.0 ? (double)vertexBytes * kDecodeRepeat / vertexDecodeSeconds / 1e9 : 0.0);
+			ImGui::Text("Index:  %llu -> %llu bytes (%.1f%%), decode %.2f GB/s", indexBytes, indexEncodedBytes, indexBytes ? (double)indexEncodedBytes / indexBytes * 100.0 : 0.0, indexDecodeSeconds > 0.0 ? (double)indexBytes * kDecodeRepeat / indexDecodeSeconds / 1e9 : 0.0);
+
+			ImGui::TreePop();
+		}
+
+		if (ImGui::TreeNode("Mesh Cache")) {
+		 // truncate/corrupt the binary cache, every load must either reject it (and fall back to the source) or return
+		 // a mesh whose ranges lie within its data
+			static const int kLoadCount = 64;
+			static int truncatedCount, corruptedCount, invalidCount;
+			APT_ONCE {
+				MeshData* meshData = MeshData::Create("models/teapot.obj"); // writes the cache
+				APT_ASSERT(meshData);
+				File objFile;
+				APT_VERIFY(FileSystem::Read(objFile, "models/teapot.obj"));
+				PathStr cachePath("%s.bin", objFile.getPath());
+				File cacheFile;
+				APT_VERIFY(File::Read(cacheFile, (const char*)cachePath));
+				eastl::vector<char> cache(cacheFile.getData(), cacheFile.getData() + cacheFile.getDataSize());
+
+				TestRand rnd;
+				for (int i = 0; i < kLoadCount; ++i) {
+					eastl::vector<char> corrupt = cache;
+					bool truncate = (i & 1) != 0;
+					if (truncate) {
+						corrupt.resize(rnd.raw() % corrupt.size());
+						++truncatedCount;
+					} else {
+						for (int j = 0; j < 4; ++j) {
+							corrupt[rnd.raw() % corrupt.size()] = (char)rnd.raw();
+						}
+						++corruptedCount;
+					}
+					cacheFile.setData(corrupt.data(), (uint)corrupt.size());
+					APT_VERIFY(File::Write(cacheFile, (const char*)cachePath));
+
+					MeshData* cachedMeshData = MeshData::Create("models/teapot.obj");
+					if (!cachedMeshData) {
+						++invalidCount;
+						continue;
+					}
+					bool valid = cachedMeshData->getSubmeshCount() > 0;
+					const uint vertexSize = cachedMeshData->getDesc().getVertexSize();
+					for (int j = 0; valid && j < cachedMeshData->getSubmeshCount(); ++j) {
+						const MeshData::Submesh& submesh = cachedMeshData->getSubmesh(j);
+						valid = submesh.m_vertexOffset / vertexSize + submesh.m_vertexCount <= cachedMeshData->getVertexCount();
+					}
+					for (uint j = 0; valid && j < cachedMeshData->getMeshletCount(); ++j) {
+						valid = cachedMeshData->getMeshlet(j).m_submeshId < (uint)cachedMeshData->getSubmeshCount();
+					}
+					if (truncate) {
+					 // the size check always rejects a truncated cache, the mesh is reloaded from the source
+						valid &= cachedMeshData->getVertexCount() == meshData->getVertexCount() && cachedMeshData->getIndexCount() == meshData->getIndexCount();
+						valid &= memcmp(cachedMeshData->getIndexData(), meshData->getIndexData(), meshData->getIndexCount() * DataTypeSizeBytes(meshData->getIndexDataType())) == 0;
+					}
+					invalidCount += valid ? 0 : 1;
+					MeshData::Destroy(cachedMeshData);
+				}
+				APT_ASSERT(invalidCount == 0);
+
+				cacheFile.setData(cache.data(), (uint)cache.size());
+				APT_VERIFY(File::Write(cacheFile, (const char*)cachePath));
+				MeshData::Destroy(meshData);
+			}
+			ImGui::Text("%d truncated, %d corrupted loads, %d invalid", truncatedCount, corruptedCount, invalidCount);
+
+			ImGui::TreePop();
+		}
+
+		if (ImGui::TreeNode("Mesh Pool")) {
+		 // suballocation and draw command building without a GL context (MeshPool created with _gpu = false)
+			static const int kMeshCount = 1000;
+			static uint32 vertexFree, indexFree, freeRanges, commandCount;
+			static double addMs, commandMs;
+			APT_ONCE {
+				MeshPool::RangeAllocator allocator(1000);
+				uint32 a = allocator.alloc(100);
+				uint32 b = allocator.alloc(200);
+				uint32 c = allocator.alloc(300);
+				APT_ASSERT(a == 0 && b == 100 && c == 300);
+				APT_ASSERT(allocator.alloc(1000) == MeshPool::RangeAllocator::kInvalidOffset);
+				allocator.free(b, 200);
+				APT_ASSERT(allocator.alloc(150) == 100); // first fit
+				allocator.free(100, 150);
+				allocator.free(a, 100);
+				allocator.free(c, 300);
+				APT_ASSERT(allocator.getFreeRangeCount() == 1 && allocator.getFreeSize() == 1000);
+
+				MeshData* meshData = MeshData::Create("models/teapot.obj");
+				MeshPool* pool = MeshPool::Create(meshData->getDesc(), meshData->getVertexCount() * kMeshCount, meshData->getIndexCount() * kMeshCount, DataType_Uint32, false);
+				eastl::vector<MeshPool::MeshId> ids;
+				Timestamp t = Time::GetTimestamp();
+				for (int i = 0; i < kMeshCount; ++i) {
+					ids.push_back(pool->add(*meshData));
+				}
+				addMs = (Time::GetTimestamp() - t).asMilliseconds();
+				APT_ASSERT(pool->add(*meshData) == MeshPool::kInvalidMeshId); // full
+				for (int i = 0; i < kMeshCount; i += 2) {
+					pool->remove(ids[i]);
+				}
+				APT_ASSERT(pool->add(*meshData) == ids[kMeshCount - 2]); // ids are recycled
+
+				eastl::vector<Buffer::DrawElementsIndirectCommand> commands;
+				t = Time::GetTimestamp();
+				for (int i = 1; i < kMeshCount; i += 2) {
+					pool->addDrawCommands(ids[i], 0, 1, (uint32)commands.size(), commands);
+				}
+				commandMs = (Time::GetTimestamp() - t).asMilliseconds();
+				for (auto& cmd : commands) {
+					APT_ASSERT(cmd.m_indexCount == meshData->getIndexCount());
+					APT_ASSERT(cmd.m_firstIndex + cmd.m_indexCount <= pool->getIndexAllocator().getCapacity());
+					APT_ASSERT(cmd.m_baseVertex + meshData->getVertexCount() <= pool->getVertexAllocator().getCapacity());
+				}
+				vertexFree   = pool->getVertexAllocator().getFreeSize();
+				indexFree    = pool->getIndexAllocator().getFreeSize();
+				freeRanges   = pool->getVertexAllocator().getFreeRangeCount();
+				commandCount = (uint32)commands.size();
+
+				MeshPool::Destroy(pool);
+				MeshData::Destroy(meshData);
+			}
+			ImGui::Text("Add %d meshes: %.2fms", kMeshCount, addMs);
+			ImGui::Text("Build %u commands: %.3fms", commandCount, commandMs);
+			ImGui::Text("Free: %u vertices, %u indices (%u vertex ranges)", vertexFree, indexFree, freeRanges);
+
+			ImGui::TreePop();
+		}
+
+		if (ImGui::TreeNode("Scene Update")) {
+		 // recursive vs. linear (NodeHierarchy) update for random trees, world matrices must match; full updates are forced
+		 // by dirtying the root, then the cost of a clean update and of dirtying 1% of the nodes
+			static const int kNodeCounts[] = { 100000, 1000000 };
+			static const int kUpdateRepeat = 4;
+			static double recursiveMs[APT_ARRAY_COUNT(kNodeCounts)], linearMs[APT_ARRAY_COUNT(kNodeCounts)], sortMs[APT_ARRAY_COUNT(kNodeCounts)];
+			static double cleanMs[APT_ARRAY_COUNT(kNodeCounts)], dirtyMs[APT_ARRAY_COUNT(kNodeCounts)];
+			static int    cleanChanged[APT_ARRAY_COUNT(kNodeCounts)], dirtyChanged[APT_ARRAY_COUNT(kNodeCounts)];
+			APT_ONCE {
+				TestRand Rand;
+				for (int i = 0; i < (int)APT_ARRAY_COUNT(kNodeCounts); ++i) {
+					Scene scene;
+					eastl::vector<Node*> nodes;
+					nodes.push_back(scene.getRoot());
+					for (int j = 1; j < kNodeCounts[i]; ++j) {
+						Node* parent = nodes[(int)(Rand() * (nodes.size() - 1))];
+						Node* node = scene.createNode(Node::Type_Object, parent);
+						node->setDynamic(true);
+						node->setLocalPosition((vec3(Rand(), Rand(), Rand()) - vec3(0.5f)) * 10.0f);
+						node->setLocalOrientation(RotationQuaternion(normalize(vec3(Rand(), Rand(), Rand()) - vec3(0.5f)), Rand() * 2.0f * kPi));
+						node->setLocalScale(vec3(0.5f + Rand()));
+						if (Rand() < 0.1f) {
+							XForm_Spin* spin = (XForm_Spin*)XForm::Create("XForm_Spin");
+							spin->m_rate = 1.0f;
+							node->addXForm(spin);
+						}
+						nodes.push_back(node);
+					}
+
+					Timestamp t = Time::GetTimestamp();
+					scene.getHierarchy().sort();
+					sortMs[i] = (Time::GetTimestamp() - t).asMilliseconds();
+
+					scene.setUpdateMode(Scene::UpdateMode_Recursive);
+					t = Time::GetTimestamp();
+					for (int j = 0; j < kUpdateRepeat; ++j) {
+						scene.getRoot()->setDirty();
+						scene.update(0.0f, Node::State_Active);
+					}
+					recursiveMs[i] = (Time::GetTimestamp() - t).asMilliseconds() / kUpdateRepeat;
+					eastl::vector<mat4> worldMatrices;
+					for (Node* node : nodes) {
+						worldMatrices.push_back(node->getWorldMatrix());
+					}
+
+					scene.setUpdateMode(Scene::UpdateMode_Linear);
+					t = Time::GetTimestamp();
+					for (int j = 0; j < kUpdateRepeat; ++j) {
+						scene.getRoot()->setDirty();
+						scene.update(0.0f, Node::State_Active);
+					}
+					linearMs[i] = (Time::GetTimestamp() - t).asMilliseconds() / kUpdateRepeat;
+					for (int j = 0; j < (int)nodes.size(); ++j) {
+						mat4 world = nodes[j]->getWorldMatrix();
+						APT_ASSERT(memcmp(&worldMatrices[j], &world, sizeof(mat4)) == 0);
+					}
+
+				 // only nodes with xforms (and their subtrees) change
+					scene.update(0.0f, Node::State_Active);
+					t = Time::GetTimestamp();
+					scene.update(0.0f, Node::State_Active);
+					cleanMs[i] = (Time::GetTimestamp() - t).asMilliseconds();
+					cleanChanged[i] = (int)scene.getChangedNodes().size();
+
+					for (int j = 0; j < kNodeCounts[i] / 100; ++j) {
+						Node* node = nodes[(int)(Rand() * (nodes.size() - 1))];
+						node->setLocalPosition(node->getLocalPosition() + vec3(1.0f));
+					}
+					t = Time::GetTimestamp();
+					scene.update(0.0f, Node::State_Active);
+					dirtyMs[i] = (Time::GetTimestamp() - t).asMilliseconds();
+					dirtyChanged[i] = (int)scene.getChangedNodes().size();
+					APT_ASSERT(dirtyChanged[i] >= cleanChanged[i]);
+				}
+			}
+			for (int i = 0; i < (int)APT_ARRAY_COUNT(kNodeCounts); ++i) {
+				ImGui::Text("%d nodes: recursive %.2fms, linear %.2fms (%.2fx), sort %.2fms", kNodeCounts[i], recursiveMs[i], linearMs[i], linearMs[i] > 0.0 ? recursiveMs[i] / linearMs[i] : 0.0, sortMs[i]);
+				ImGui::Text("   clean %.2fms (%d changed), 1%% dirty %.2fms (%d changed)", cleanMs[i], cleanChanged[i], dirtyMs[i], dirtyChanged[i]);
+			}
+
+			ImGui::TreePop();
+		}
+
+		if (ImGui::TreeNode("Node Local Matrix")) {
+		 // setLocalMatrix() -> getLocalMatrix() must round trip, including mirrored and zero scales
+			static const vec3 kScales[] = {
+				vec3( 1.0f,  2.0f,  3.0f),
+				vec3( 1.0f, -2.0f,  3.0f),
+				vec3(-1.0f, -2.0f,  3.0f),
+				vec3(-1.0f, -2.0f, -3.0f),
+				vec3( 0.0f,  2.0f,  3.0f),
+				vec3( 1.0f,  0.0f, -3.0f),
+				vec3( 0.0f,  0.0f,  3.0f),
+				vec3( 0.0f)
+			};
+			static float maxError;
+			APT_ONCE {
+				Scene scene;
+				Node* node = scene.createNode(Node::Type_Object, scene.getRoot());
+				mat4 rotationTranslation = TranslationMatrix(vec3(1.0f, -2.0f, 3.0f)) * RotationMatrix(normalize(vec3(0.3f, 1.0f, -0.5f)), 1.1f);
+				for (const vec3& scale : kScales) {
+					mat4 localMatrix = rotationTranslation * ScaleMatrix(scale);
+					node->setLocalMatrix(localMatrix);
+					mat4 result = node->getLocalMatrix();
+					for (int i = 0; i < 4; ++i) {
+						for (int j = 0; j < 4; ++j) {
+							float error = fabsf(result[i][j] - localMatrix[i][j]);
+							APT_ASSERT(error < 1e-5f); // false if NaN
+							maxError = APT_MAX(maxError, error);
+						}
+					}
+				}
+			}
+			ImGui::Text("%d matrices, max error %g", (int)APT_ARRAY_COUNT(kScales), maxError);
+
+			ImGui::TreePop();
+		}
+
+		if (ImGui::TreeNode("Scene Update Scaling")) {
+		 // full UpdateMode_Parallel update with 1..N threads, many independent root-level subtrees
+			static const int kNodeCount = 250000;
+			static const int kRootChildCount = 4000;
+			static const int kUpdateRepeat = 4;
+			static eastl::vector<double> threadMs;
+			static double linearMs;
+			APT_ONCE {
+				TestRand Rand;
+				Scene scene;
+				eastl::vector<Node*> nodes;
+				nodes.push_back(scene.getRoot());
+				for (int i = 1; i < kNodeCount; ++i) {
+					Node* parent = i <= kRootChildCount ? scene.getRoot() : nodes[1 + (int)(Rand() * (nodes.size() - 2))];
+					Node* node = scene.createNode(Node::Type_Object, parent);
+					node->setLocalPosition((vec3(Rand(), Rand(), Rand()) - vec3(0.5f)) * 10.0f);
+					node->setLocalOrientation(RotationQuaternion(normalize(vec3(Rand(), Rand(), Rand()) - vec3(0.5f)), Rand() * 2.0f * kPi));
+					if (Rand() < 0.1f) {
+						XForm_Spin* spin = (XForm_Spin*)XForm::Create("XForm_Spin");
+						spin->m_rate = 1.0f;
+						node->addXForm(spin);
+					}
+					nodes.push_back(node);
+				}
+
+				scene.setUpdateMode(Scene::UpdateMode_Linear);
+				scene.update(0.0f);
+				Timestamp t = Time::GetTimestamp();
+				for (int i = 0; i < kUpdateRepeat; ++i) {
+					scene.getRoot()->setDirty();
+					scene.update(0.0f);
+				}
+				linearMs = (Time::GetTimestamp() - t).asMilliseconds() / kUpdateRepeat;
+				eastl::vector<mat4> worldMatrices;
+				for (Node* node : nodes) {
+					worldMatrices.push_back(node->getWorldMatrix());
+				}
+
+				scene.setUpdateMode(Scene::UpdateMode_Parallel);
+				uint maxThreadCount = GetParallelThreadCount();
+				for (uint threadCount = 1; threadCount <= maxThreadCount; ++threadCount) {
+					SetParallelThreadLimit(threadCount);
+					t = Time::GetTimestamp();
+					for (int i = 0; i < kUpdateRepeat; ++i) {
+						scene.getRoot()->setDirty();
+						scene.update(0.0f);
+					}
+					threadMs.push_back((Time::GetTimestamp() - t).asMilliseconds() / kUpdateRepeat);
+					for (int i = 0; i < (int)nodes.size(); ++i) {
+						mat4 world = nodes[i]->getWorldMatrix();
+						APT_ASSERT(memcmp(&worldMatrices[i], &world, sizeof(mat4)) == 0);
+					}
+				}
+				SetParallelThreadLimit(0);
+			}
+			ImGui::Text("%d nodes, %d root children: linear %.2fms", kNodeCount, kRootChildCount, linearMs);
+			for (int i = 0; i < (int)threadMs.size(); ++i) {
+				ImGui::Text("   %2d threads: %.2fms (%.2fx)", i + 1, threadMs[i], threadMs[i] > 0.0 ? linearMs / threadMs[i] : 0.0);
+			}
+
+			ImGui::TreePop();
+		}
+
+		if (ImGui::TreeNode("Parallel XForms")) {
+		 // xforms which aren't thread safe (XForm_LookAt reads its target, XForm_FreeCamera flags the ancestors of its node)
+		 // mixed with thread safe ones, UpdateMode_Parallel must produce the same results as UpdateMode_Linear. Half of the
+		 // look at targets are any node, i.e. may move and may be later in pre-order than the look at node (which then
+		 // sees the target's previous frame in both modes)
+			static const int kNodeCount = 50000;
+			static const int kRootChildCount = 1000;
+			static const int kUpdateRepeat = 8;
+			static int  unsafeCount;
+			static bool match;
+			APT_ONCE {
+				Scene scenes[2];
+				eastl::vector<Node*> nodes[2];
+				for (int s = 0; s < 2; ++s) {
+					TestRand Rand;
+					Scene& scene = scenes[s];
+					eastl::vector<Node*> targets; // static root children
+					unsafeCount = 0;
+					nodes[s].push_back(scene.getRoot());
+					for (int i = 1; i < kNodeCount; ++i) {
+						Node* parent = i <= kRootChildCount ? scene.getRoot() : nodes[s][1 + (int)(Rand() * (nodes[s].size() - 2))];
+						Node* node = scene.createNode(Node::Type_Object, parent);
+						node->setLocalPosition((vec3(Rand(), Rand(), Rand()) - vec3(0.5f)) * 10.0f);
+						float r = Rand();
+						if (r < 0.1f) {
+							XForm_Spin* spin = (XForm_Spin*)XForm::Create("XForm_Spin");
+							spin->m_rate = 1.0f;
+							node->addXForm(spin);
+						} else if (i <= kRootChildCount) {
+							targets.push_back(node);
+						} else if (r < 0.105f) {
+							XForm_LookAt* lookAt = (XForm_LookAt*)XForm::Create("XForm_LookAt");
+							lookAt->m_target = targets[(int)(Rand() * (targets.size() - 1))];
+							node->addXForm(lookAt);
+							++unsafeCount;
+						} else if (r < 0.11f) {
+							XForm_LookAt* lookAt = (XForm_LookAt*)XForm::Create("XForm_LookAt");
+							lookAt->m_target = nodes[s][1 + (int)(Rand() * (nodes[s].size() - 2))];
+							node->addXForm(lookAt);
+							++unsafeCount;
+						} else if (r < 0.115f) {
+							XForm_FreeCamera* freeCamera = (XForm_FreeCamera*)XForm::Create("XForm_FreeCamera");
+							freeCamera->m_position = node->getLocalPosition();
+							node->addXForm(freeCamera);
+							node->setSelected(true); // else apply() does nothing
+							++unsafeCount;
+						}
+						nodes[s].push_back(node);
+					}
+				 // the first update is linear for both scenes
+					scene.setUpdateMode(Scene::UpdateMode_Linear);
+					scene.update(1.0f / 60.0f);
+					scene.setUpdateMode(s == 0 ? Scene::UpdateMode_Linear : Scene::UpdateMode_Parallel);
+				}
+
+				for (int s = 0; s < 2; ++s) {
+					for (int i = 0; i < kUpdateRepeat; ++i) {
+						scenes[s].update(1.0f / 60.0f);
+					}
+				}
+				match = true;
+				for (int i = 0; i < kNodeCount; ++i) {
+					mat4 world[2] = { nodes[0][i]->getWorldMatrix(), nodes[1][i]->getWorldMatrix() };
+					match &= memcmp(&world[0], &world[1], sizeof(mat4)) == 0;
+				}
+				APT_ASSERT(match);
+			}
+			ImGui::Text("%d nodes, %d with xforms which aren't thread safe", kNodeCount, unsafeCount);
+			ImGui::Text("Results match: %s", match ? "YES" : "NO");
+
+			ImGui::TreePop();
+		}
+
+		if (ImGui::TreeNode("XForm Batching")) {
+		 // batched (XForm::Batch) vs. virtual xform execution, identical scenes must produce identical results
+			static const int kNodeCount = 50000;
+			static const int kUpdateRepeat = 8;
+			static double batchedMs, virtualMs;
+			static bool match;
+			APT_ONCE {
+				Scene scenes[2];
+				eastl::vector<Node*> nodes[2];
+				for (int s = 0; s < 2; ++s) {
+					TestRand Rand;
+					Scene& scene = scenes[s];
+					nodes[s].push_back(scene.getRoot());
+					for (int i = 1; i < kNodeCount; ++i) {
+						Node* parent = i <= 1000 ? scene.getRoot() : nodes[s][1 + (int)(Rand() * (nodes[s].size() - 2))];
+						Node* node = scene.createNode(Node::Type_Object, parent);
+						node->setLocalPosition((vec3(Rand(), Rand(), Rand()) - vec3(0.5f)) * 10.0f);
+						if (Rand() < 0.5f) {
+							XForm_Spin* spin = (XForm_Spin*)XForm::Create("XForm_Spin");
+							spin->m_axis = normalize(vec3(Rand(), Rand(), Rand()) + vec3(0.1f));
+							spin->m_rate = Rand();
+							node->addXForm(spin);
+						} else {
+							XForm_OrbitalPath* orbit = (XForm_OrbitalPath*)XForm::Create("XForm_OrbitalPath");
+							orbit->m_radius = Rand() * 4.0f;
+							orbit->m_speed  = Rand();
+							orbit->reset();
+							node->addXForm(orbit);
+						}
+						nodes[s].push_back(node);
+					}
+					scene.setXFormBatching(s == 0);
+					scene.update(1.0f / 60.0f);
+				}
+
+				for (int s = 0; s < 2; ++s) {
+					Timestamp t = Time::GetTimestamp();
+					for (int i = 0; i < kUpdateRepeat; ++i) {
+						scenes[s].update(1.0f / 60.0f); // nodes with xforms are always updated
+					}
+					(s == 0 ? batchedMs : virtualMs) = (Time::GetTimestamp() - t).asMilliseconds() / kUpdateRepeat;
+				}
+				match = true;
+				for (int i = 0; i < kNodeCount; ++i) {
+					mat4 world[2] = { nodes[0][i]->getWorldMatrix(), nodes[1][i]->getWorldMatrix() };
+					match &= memcmp(&world[0], &world[1], sizeof(mat4)) == 0;
+				}
+			}
+			ImGui::Text("%d nodes: batched %.2fms, virtual %.2fms (%.2fx)", kNodeCount, batchedMs, virtualMs, batchedMs > 0.0 ? virtualMs / batchedMs : 0.0);
+			ImGui::Text("Results match: %s", match ? "YES" : "NO");
+
+			ImGui::TreePop();
+		}
+
+		if (ImGui::TreeNode("Scene Bvh")) {
+		 // SceneBvh frustum query vs. brute force Frustum::inside(), 1% of the nodes move per update
+			static const int kNodeCount = 100000;
+			static const int kQueryRepeat = 8;
+			static double buildMs, refitMs, queryMs, bruteMs;
+			static uint32 queryCount, bruteCount, height;
+			static bool valid;
+			APT_ONCE {
+				TestRand Rand;
+				Scene scene;
+				eastl::vector<Node*> nodes;
+				eastl::vector<AlignedBox> boxes;
+				for (int i = 0; i < kNodeCount; ++i) {
+					Node* node = scene.createNode(Node::Type_Object, scene.getRoot());
+					node->setLocalPosition((vec3(Rand(), Rand(), Rand()) - vec3(0.5f)) * 1000.0f);
+					nodes.push_back(node);
+					vec3 extents = vec3(Rand(), Rand(), Rand()) + vec3(0.1f);
+					boxes.push_back(AlignedBox(-extents, extents));
+				}
+				scene.update(0.0f);
+
+				SceneBvh* bvh = SceneBvh::Create(1.0f);
+				Timestamp t = Time::GetTimestamp();
+				for (int i = 0; i < kNodeCount; ++i) {
+					bvh->insert(nodes[i], boxes[i]);
+				}
+				buildMs = (Time::GetTimestamp() - t).asMilliseconds();
+
+				for (int i = 0; i < kNodeCount / 100; ++i) {
+					Node* node = nodes[(int)(Rand() * (kNodeCount - 1))];
+					node->setLocalPosition(node->getLocalPosition() + (vec3(Rand(), Rand(), Rand()) - vec3(0.5f)) * 4.0f);
+				}
+				scene.update(0.0f);
+				t = Time::GetTimestamp();
+				bvh->update(scene);
+				refitMs = (Time::GetTimestamp() - t).asMilliseconds();
+				valid = bvh->validate();
+				height = bvh->getHeight();
+
+				float tanHalfFov = tanf(Radians(30.0f));
+				Frustum frustum(tanHalfFov, -tanHalfFov, tanHalfFov * 16.0f / 9.0f, -tanHalfFov * 16.0f / 9.0f, 0.1f, 500.0f, false);
+				frustum.transform(RotationMatrix(normalize(vec3(1.0f, 0.5f, 0.2f)), 1.0f));
+
+				eastl::vector<Node::Id> visible(kNodeCount);
+				t = Time::GetTimestamp();
+				for (int i = 0; i < kQueryRepeat; ++i) {
+					queryCount = bvh->query(frustum, visible.data(), kNodeCount);
+				}
+				queryMs = (Time::GetTimestamp() - t).asMilliseconds() / kQueryRepeat;
+
+				t = Time::GetTimestamp();
+				for (int i = 0; i < kQueryRepeat; ++i) {
+					bruteCount = 0;
+					for (int j = 0; j < kNodeCount; ++j) {
+						AlignedBox box = boxes[j];
+						box.transform(nodes[j]->getWorldMatrix());
+						if (frustum.inside(box)) {
+							visible[bruteCount++] = nodes[j]->getId();
+						}
+					}
+				}
+				bruteMs = (Time::GetTimestamp() - t).asMilliseconds() / kQueryRepeat;
+
+				SceneBvh::Destroy(bvh);
+			}
+			ImGui::Text("%d nodes: build %.2fms, refit %.2fms, height %u, valid %s", kNodeCount, buildMs, refitMs, height, valid ? "YES" : "NO");
+			ImGui::Text("Query:       %.3fms (%u visible)", queryMs, queryCount);
+			ImGui::Text("Brute force: %.3fms (%u visible)", bruteMs, bruteCount);
+
+			ImGui::TreePop();
+		}
+
+		if (ImGui::TreeNode("Scene Lookup")) {
+		 // deserialize a large scene, then look up every node by id and by name (names are duplicated)
+			static const int kNodeCount = 100000;
+			static double writeMs, readMs, findIdMs, findNameMs;
+			static int findFailures;
+			APT_ONCE {
+				Json json;
+				{	Scene scene;
+					scene.createCamera(Camera());
+					eastl::vector<Node*> nodes;
+					nodes.push_back(scene.getRoot());
+					for (int i = 1; i < kNodeCount; ++i) {
+						Node* node = scene.createNode(Node::Type_Object, nodes[i / 2]);
+						node->setNamef("Node%d", i % (kNodeCount / 2));
+						nodes.push_back(node);
+					}
+					Timestamp t = Time::GetTimestamp();
+					SerializerJson serializer(json, SerializerJson::Mode_Write);
+					Serialize(serializer, scene);
+					writeMs = (Time::GetTimestamp() - t).asMilliseconds();
+				}
+
+				Scene scene;
+				Timestamp t = Time::GetTimestamp();
+				SerializerJson serializer(json, SerializerJson::Mode_Read);
+				Serialize(serializer, scene);
+				readMs = (Time::GetTimestamp() - t).asMilliseconds();
+
+				findFailures = 0;
+				t = Time::GetTimestamp();
+				for (int i = 0; i < scene.getNodeCount(Node::Type_Object); ++i) {
+					Node* node = scene.getNode(Node::Type_Object, i);
+					findFailures += scene.findNode(node->getId()) == node ? 0 : 1;
+				}
+				findIdMs = (Time::GetTimestamp() - t).asMilliseconds();
+				t = Time::GetTimestamp();
+				for (int i = 0; i < scene.getNodeCount(Node::Type_Object); ++i) {
+					Node* node = scene.getNode(Node::Type_Object, i);
+					findFailures += strcmp(scene.findNode(node->getName())->getName(), node->getName()) == 0 ? 0 : 1;
+				}
+				findNameMs = (Time::GetTimestamp() - t).asMilliseconds();
+			}
+			ImGui::Text("%d nodes: write %.2fms, read %.2fms", kNodeCount, writeMs, readMs);
+			ImGui::Text("findNode: by id %.2fms, by name %.2fms (%d failures)", findIdMs, findNameMs, findFailures);
+
+			ImGui::TreePop();
+		}
+
+		if (ImGui::TreeNode("Scene Binary")) {
+		 // round trip a large scene json -> binary -> json, compare the json and binary load times
+			static const int kNodeCount = 100000;
+			static double jsonSaveMs, jsonLoadMs, binSaveMs, binLoadMs;
+			static int mismatches;
+			static bool ok;
+			APT_ONCE {
+				{	Scene scene;
+					scene.createCamera(Camera());
+					eastl::vector<Node*> nodes;
+					nodes.push_back(scene.getRoot());
+					for (int i = 1; i < kNodeCount; ++i) {
+						Node* node = scene.createNode(Node::Type_Object, nodes[i / 2]);
+						node->setLocalPosition(vec3((float)(i % 100), (float)(i / 100 % 100), (float)(i / 10000)));
+						if (i % 4 == 0) {
+							XForm_Spin* spin = (XForm_Spin*)XForm::Create(StringHash("XForm_Spin"));
+							spin->m_rate = (float)i * 0.001f;
+							node->addXForm(spin);
+						}
+						if (i % 1024 == 0) {
+							XForm_LookAt* lookAt = (XForm_LookAt*)XForm::Create(StringHash("XForm_LookAt"));
+							lookAt->m_target   = nodes[i / 2];
+							lookAt->m_targetId = nodes[i / 2]->getId();
+							node->addXForm(lookAt);
+						}
+						nodes.push_back(node);
+					}
+					Timestamp t = Time::GetTimestamp();
+					ok = Scene::Save("SceneBinaryTest.json", scene);
+					jsonSaveMs = (Time::GetTimestamp() - t).asMilliseconds();
+				}
+
+				Scene jsonScene, binScene;
+				Timestamp t = Time::GetTimestamp();
+				ok &= Scene::Load("SceneBinaryTest.json", jsonScene);
+				jsonLoadMs = (Time::GetTimestamp() - t).asMilliseconds();
+				t = Time::GetTimestamp();
+				ok &= Scene::Save("SceneBinaryTest.bin", jsonScene);
+				binSaveMs = (Time::GetTimestamp() - t).asMilliseconds();
+				t = Time::GetTimestamp();
+				ok &= Scene::Load("SceneBinaryTest.bin", binScene);
+				binLoadMs = (Time::GetTimestamp() - t).asMilliseconds();
+				ok &= Scene::Convert("SceneBinaryTest.bin", "SceneBinaryTest2.json");
+
+				mismatches = abs(jsonScene.getNodeCount(Node::Type_Object) - binScene.getNodeCount(Node::Type_Object));
+				for (int i = 0; i < jsonScene.getNodeCount(Node::Type_Object); ++i) {
+					Node* a = jsonScene.getNode(Node::Type_Object, i);
+					Node* b = binScene.findNode(a->getId());
+					if (!b || strcmp(a->getName(), b->getName()) != 0 || a->getParent()->getId() != b->getParent()->getId() || a->getXFormCount() != b->getXFormCount()) {
+						++mismatches;
+						continue;
+					}
+					if (length(a->getLocalPosition() - b->getLocalPosition()) > 1e-4f || length(a->getLocalScale() - b->getLocalScale()) > 1e-4f) {
+						++mismatches;
+					}
+					for (int j = 0; j < a->getXFormCount(); ++j) {
+						mismatches += strcmp(a->getXForm(j)->getName(), b->getXForm(j)->getName()) == 0 ? 0 : 1;
+					}
+				}
+			}
+			ImGui::Text("%d nodes: %s, %d mismatches", kNodeCount, ok ? "ok" : "failed", mismatches);
+			ImGui::Text("json: save %.2fms, load %.2fms", jsonSaveMs, jsonLoadMs);
+			ImGui::Text("bin:  save %.2fms, load %.2fms", binSaveMs, binLoadMs);
+
+			ImGui::TreePop();
+		}
+
+		if (ImGui::TreeNode("Scene Partitions")) {
+		 // stream a large partition in/out of a small scene, compare the max update time per state with a blocking load
+			static const int kNodeCount = 100000;
+			static const float kBudgetMs = 1.0f;
+			static double loadMs, maxUpdateMs[Scene::PartitionState_Count];
+			static int frames[Scene::PartitionState_Count];
+			static uint32 attachedCount, unloadedCount, baseCount;
+			static bool ok;
+			APT_ONCE {
+				{	Scene scene;
+					eastl::vector<Node*> nodes;
+					nodes.push_back(scene.getRoot());
+					for (int i = 1; i < kNodeCount; ++i) {
+						Node* node = scene.createNode(i % 100 == 0 ? Node::Type_Light : Node::Type_Object, nodes[i / 2]);
+						node->setLocalPosition(vec3((float)(i % 100), (float)(i / 100 % 100), (float)(i / 10000)));
+						if (i % 4 == 0) {
+							XForm_Spin* spin = (XForm_Spin*)XForm::Create(StringHash("XForm_Spin"));
+							spin->m_rate = (float)i * 0.001f;
+							node->addXForm(spin);
+						}
+						nodes.push_back(node);
+					}
+					scene.createCamera(Camera(), nodes[1]);
+					ok = Scene::Save("ScenePartitionTest.bin", scene);
+				}
+				{	Scene scene;
+					Timestamp t = Time::GetTimestamp();
+					ok &= Scene::Load("ScenePartitionTest.bin", scene);
+					loadMs = (Time::GetTimestamp() - t).asMilliseconds();
+				}
+
+				Scene scene;
+				scene.setPartitionBudget(kBudgetMs);
+				Camera* baseCamera = scene.createCamera(Camera());
+				for (int i = 0; i < 1000; ++i) {
+					scene.createNode(Node::Type_Object)->setLocalPosition(vec3((float)i, 0.0f, 0.0f));
+				}
+				Node* parent = scene.createNode(Node::Type_Object);
+				scene.update(0.0f);
+				baseCount = scene.getHierarchy().getNodeCount();
+
+				Scene::PartitionId id = scene.loadPartition("ScenePartitionTest.bin", parent);
+				auto Update = [&scene, id]()
+					{
+						Scene::PartitionState state = scene.getPartitionState(id);
+						Timestamp t = Time::GetTimestamp();
+						scene.update(1.0f / 60.0f);
+						double ms = (Time::GetTimestamp() - t).asMilliseconds();
+						maxUpdateMs[state] = APT_MAX(maxUpdateMs[state], ms);
+						++frames[state];
+					};
+				while (scene.getPartitionState(id) == Scene::PartitionState_Loading || scene.getPartitionState(id) == Scene::PartitionState_Attaching) {
+					Update();
+				}
+				ok &= scene.getPartitionState(id) == Scene::PartitionState_Attached;
+				for (int i = 0; i < 10; ++i) {
+					Update();
+				}
+				attachedCount = scene.getHierarchy().getNodeCount();
+
+			 // draw/cull from the partition's camera, which must fall back to the base camera when it's unloaded
+				ok &= scene.getCameraCount() == 2;
+				scene.setDrawCamera(scene.getCamera(1));
+				scene.setCullCamera(scene.getCamera(1));
+				scene.unloadPartition(id);
+				while (scene.getPartitionState(id) == Scene::PartitionState_Unloading) {
+					Update();
+				}
+				unloadedCount = scene.getHierarchy().getNodeCount();
+				ok &= scene.getDrawCamera() == baseCamera && scene.getCullCamera() == baseCamera;
+			}
+			ImGui::Text("%d nodes, budget %.1fms: %s, blocking load %.2fms", kNodeCount, kBudgetMs, ok ? "ok" : "failed", loadMs);
+			ImGui::Text("Loading:   %4d frames, max update %.2fms", frames[Scene::PartitionState_Loading],   maxUpdateMs[Scene::PartitionState_Loading]);
+			ImGui::Text("Attaching: %4d frames, max update %.2fms", frames[Scene::PartitionState_Attaching], maxUpdateMs[Scene::PartitionState_Attaching]);
+			ImGui::Text("Attached:  %4d frames, max update %.2fms", frames[Scene::PartitionState_Attached],  maxUpdateMs[Scene::PartitionState_Attached]);
+			ImGui::Text("Unloading: %4d frames, max update %.2fms", frames[Scene::PartitionState_Unloading], maxUpdateMs[Scene::PartitionState_Unloading]);
+			ImGui::Text("Node count: %u -> %u -> %u", baseCount, attachedCount, unloadedCount);
+
+			ImGui::TreePop();
+		}
+
+		if (ImGui::TreeNode("Scene Node Storage")) {
+		 // per-node memory and the cost of walking a large random hierarchy, recursive and linear updates must produce identical results
+			static const int kNodeCount = 100000;
+			static const int kRepeat = 8;
+			static double traverseMs, recursiveMs, linearMs;
+			static size_t hierarchyBytes;
+			static int visited, mismatches;
+			APT_ONCE {
+				TestRand Rand;
+				Scene scene;
+				eastl::vector<Node*> nodes;
+				nodes.push_back(scene.getRoot());
+				for (int i = 1; i < kNodeCount; ++i) {
+					Node* node = scene.createNode(Node::Type_Object, nodes[(int)(Rand() * (nodes.size() - 1))]);
+					node->setLocalPosition((vec3(Rand(), Rand(), Rand()) - vec3(0.5f)) * 10.0f);
+					node->setLocalScale(vec3(0.5f + Rand()));
+					nodes.push_back(node);
+				}
+				scene.update(0.0f);
+				hierarchyBytes = scene.getHierarchy().getMemoryUsage();
+
+				int childIndex = 0;
+				for (Node* child = scene.getRoot()->getFirstChild(); child; child = child->getNextSibling(), ++childIndex) {
+					mismatches += scene.getRoot()->getChild(childIndex) == child ? 0 : 1;
+				}
+				mismatches += childIndex == scene.getRoot()->getChildCount() ? 0 : 1;
+
+				static int s_visited;
+				auto Visit = [](Node* _node) -> bool
+					{
+						++s_visited;
+						return true;
+					};
+				Timestamp t = Time::GetTimestamp();
+				for (int i = 0; i < kRepeat; ++i) {
+					s_visited = 0;
+					scene.traverse(scene.getRoot(), Node::State_Any, Visit);
+				}
+				traverseMs = (Time::GetTimestamp() - t).asMilliseconds() / kRepeat;
+				visited = s_visited;
+
+				eastl::vector<mat4> worldMatrices;
+				for (int mode = Scene::UpdateMode_Recursive; mode <= Scene::UpdateMode_Linear; ++mode) {
+					scene.setUpdateMode((Scene::UpdateMode)mode);
+					t = Time::GetTimestamp();
+					for (int i = 0; i < kRepeat; ++i) {
+						scene.getRoot()->setDirty();
+						scene.update(0.0f);
+					}
+					(mode == Scene::UpdateMode_Recursive ? recursiveMs : linearMs) = (Time::GetTimestamp() - t).asMilliseconds() / kRepeat;
+					for (int i = 0; i < kNodeCount; ++i) {
+						mat4 world = nodes[i]->getWorldMatrix();
+						if (mode == Scene::UpdateMode_Recursive) {
+							worldMatrices.push_back(world);
+						} else {
+							mismatches += memcmp(&worldMatrices[i], &world, sizeof(mat4)) == 0 ? 0 : 1;
+						}
+					}
+				}
+			}
+			ImGui::Text("%d nodes: sizeof(Node) %u bytes, hierarchy %.1f bytes/node", kNodeCount, (uint32)sizeof(Node), (double)hierarchyBytes / kNodeCount);
+			ImGui::Text("traverse %.2fms (%d visited), recursive update %.2fms, linear update %.2fms", traverseMs, visited, recursiveMs, linearMs);
+			ImGui::Text("Results match: %s", mismatches == 0 ? "YES" : "NO");
+
+			ImGui::TreePop();
+		}
+
 		#if FRM_MODULE_AUDIO
 			ImGui::SetNextTreeNodeOpen(true, ImGuiCond_Once);
 
@@ -479,6 +1822,11 @@ public:
 
 				if (!m_meshTest.m_meshPath.isEmpty()) {
 					m_meshTest.m_mesh = Mesh::Create((const char*)m_meshTest.m_meshPath);
+					const VertexAttr* normalsAttr = m_meshTest.m_mesh ? m_meshTest.m_mesh->getDesc().findVertexAttr(VertexAttr::Semantic_Normals) : nullptr;
+					if (normalsAttr && normalsAttr->getEncoding() == VertexAttr::Encoding_Octahedral) {
+						m_meshTest.m_shMeshShaded->addGlobalDefines({ "PACKED_VERTEX 1" });
+						m_meshTest.m_shMeshLines->addGlobalDefines({ "PACKED_VERTEX 1" });
+					}
 					Buffer::Destroy(m_meshTest.m_bfSkinning);
 					if (m_meshTest.m_mesh && m_meshTest.m_mesh->getBindPose()) {
 						m_meshTest.m_bfSkinning = Buffer::Create(GL_SHADER_STORAGE_BUFFER, sizeof(mat4) * m_meshTest.m_mesh->getBindPose()->getBoneCount(), GL_DYNAMIC_STORAGE_BIT | GL_MAP_WRITE_BIT);
@@ -488,7 +1836,63 @@ public:
 							bf[i] = mat4(1.0f);
 						}
 						m_meshTest.m_bfSkinning->unmap();
-						
+
+					 // CPU skinning, the identity palette must reproduce the bind pose
+						MeshData* meshData = MeshData::Create((const char*)m_meshTest.m_meshPath);
+						m_meshTest.m_skinning = Skinning::Create(*meshData);
+						if (m_meshTest.m_skinning) {
+							eastl::vector<mat4> palette(m_meshTest.m_skinning->getBoneCount(), mat4(1.0f));
+							eastl::vector<char> vertexData((const char*)meshData->getVertexData(), (const char*)meshData->getVertexData() + meshData->getVertexCount() * meshData->getDesc().getVertexSize());
+							for (int mode = 0; mode < Skinning::Mode_Count; ++mode) {
+								m_meshTest.m_skinning->skin(palette.data(), (Skinning::Mode)mode, meshData->getDesc(), vertexData.data());
+								MeshBuilder bindPose, skinned;
+								bindPose.beginSubmesh(0);
+								bindPose.addVertexData(meshData->getDesc(), meshData->getVertexData(), meshData->getVertexCount());
+								bindPose.endSubmesh();
+								skinned.beginSubmesh(0);
+								skinned.addVertexData(meshData->getDesc(), vertexData.data(), meshData->getVertexCount());
+								skinned.endSubmesh();
+								for (uint32 i = 0; i < bindPose.getVertexCount(); ++i) {
+									APT_ASSERT(length(bindPose.getVertex(i).m_position - skinned.getVertex(i).m_position) < 1e-3f);
+								}
+							}
+						}
+						MeshData::Destroy(meshData);
+
+					 // a vertex with all weights zero keeps its bind pose for any palette
+						MeshBuilder unweighted;
+						unweighted.beginSubmesh(0);
+						for (int i = 0; i < 2; ++i) {
+							MeshBuilder::Vertex v;
+							memset(&v, 0, sizeof(v));
+							v.m_position    = vec3(1.0f, 2.0f, 3.0f);
+							v.m_normal      = vec3(0.0f, 1.0f, 0.0f);
+							v.m_boneWeights = i == 0 ? vec4(0.0f) : vec4(1.0f, 0.0f, 0.0f, 0.0f);
+							unweighted.addVertex(v);
+						}
+						unweighted.endSubmesh();
+						MeshDesc unweightedDesc;
+						unweightedDesc.addVertexAttr(VertexAttr::Semantic_Positions,   DataType_Float32, 3);
+						unweightedDesc.addVertexAttr(VertexAttr::Semantic_Normals,     DataType_Float32, 3);
+						unweightedDesc.addVertexAttr(VertexAttr::Semantic_BoneWeights, DataType_Float32, 4);
+						unweightedDesc.addVertexAttr(VertexAttr::Semantic_BoneIndices, DataType_Uint8,   4);
+						MeshData* unweightedData = MeshData::Create(unweightedDesc, unweighted);
+						Skinning* unweightedSkinning = Skinning::Create(*unweightedData);
+						mat4 palette = TranslationMatrix(vec3(5.0f)) * RotationMatrix(vec3(0.0f, 0.0f, 1.0f), Radians(90.0f));
+						for (int mode = 0; mode < Skinning::Mode_Count; ++mode) {
+							float positions[3][2], normals[3][2];
+							Skinning::Streams streams;
+							for (int i = 0; i < 3; ++i) {
+								streams.m_positions[i] = positions[i];
+								streams.m_normals[i]   = normals[i];
+							}
+							unweightedSkinning->skin(&palette, (Skinning::Mode)mode, streams);
+							APT_ASSERT(positions[0][0] == 1.0f && positions[1][0] == 2.0f && positions[2][0] == 3.0f);
+							APT_ASSERT(normals[0][0] == 0.0f && normals[1][0] == 1.0f && normals[2][0] == 0.0f);
+							APT_ASSERT(positions[0][1] != 1.0f); // the weighted vertex moves
+						}
+						Skinning::Destroy(unweightedSkinning);
+						MeshData::Destroy(unweightedData);
 					}
 					m_meshTest.m_worldMatrix = RotationMatrix(vec3(-1.0f, 0.0f, 0.0f), Radians(90.0f));
 				}
@@ -510,11 +1914,40 @@ public:
 				{	PROFILER_MARKER_CPU("Skinning");
 					m_meshTest.m_anim->sample(m_meshTest.m_animTime, framePose, m_meshTest.m_animHints.data());
 					framePose.resolve();
+					eastl::vector<mat4> palette(framePose.getBoneCount());
+					Skinning::GetPalette(framePose, *m_meshTest.m_mesh->getBindPose(), palette.data());
 					mat4* bf = (mat4*)m_meshTest.m_bfSkinning->map(GL_WRITE_ONLY);
-					for (int i = 0; i < framePose.getBoneCount(); ++i) {
-						bf[i] = framePose.getPose()[i] * m_meshTest.m_mesh->getBindPose()->getPose()[i];
-					}
+					memcpy(bf, palette.data(), sizeof(mat4) * palette.size());
 					m_meshTest.m_bfSkinning->unmap();
+
+					static bool cpuSkinning = false;
+					static int  cpuSkinningMode = Skinning::Mode_Linear;
+					ImGui::Checkbox("CPU Skinning", &cpuSkinning);
+					if (cpuSkinning && m_meshTest.m_skinning) {
+						ImGui::SameLine();
+						ImGui::Combo("Mode", &cpuSkinningMode, "Linear\0Dual Quaternion\0");
+						static eastl::vector<float> skinned;
+						const uint32 vertexCount = m_meshTest.m_skinning->getVertexCount();
+						skinned.resize(vertexCount * 3);
+						Skinning::Streams streams;
+						for (int i = 0; i < 3; ++i) {
+							streams.m_positions[i] = skinned.data() + vertexCount * i;
+						}
+						Timestamp t = Time::GetTimestamp();
+						m_meshTest.m_skinning->skin(palette.data(), (Skinning::Mode)cpuSkinningMode, streams);
+						ImGui::Text("%u vertices, %.3fms", vertexCount, (Time::GetTimestamp() - t).asMilliseconds());
+						Im3d::PushDrawState();
+						Im3d::PushMatrix(m_meshTest.m_worldMatrix);
+						Im3d::SetColor(Im3d::Color_Yellow);
+						Im3d::SetSize(2.0f);
+						Im3d::BeginPoints();
+							for (uint32 i = 0; i < vertexCount; ++i) {
+								Im3d::Vertex(skinned[i], skinned[vertexCount + i], skinned[vertexCount * 2 + i]);
+							}
+						Im3d::End();
+						Im3d::PopMatrix();
+						Im3d::PopDrawState();
+					}
 					Im3d::PushMatrix(m_meshTest.m_worldMatrix);
 						framePose.draw();
 					Im3d::PopMatrix();